@@ -0,0 +1,163 @@
+#include "command_dispatcher.h"
+
+#include <spdlog/spdlog.h>
+#include "process_command.h"
+
+CommandDispatcher::CommandDispatcher() : readOnlyPool_(kReadOnlyThreadsCount), mutatingPool_(kMutatingThreadsCount),
+    readOnlyQueueDepth_(0), mutatingQueueDepth_(0), finishedCount_(0)
+{
+}
+
+CommandDispatcher::~CommandDispatcher()
+{
+    readOnlyPool_.join();
+    mutatingPool_.join();
+}
+
+void CommandDispatcher::dispatch(int cmdId, const std::string &packet, Callback callback)
+{
+    const CommandTraits commandTraits = traits(cmdId);
+    const auto queuedTime = std::chrono::steady_clock::now();
+    if (commandTraits.isReadOnly) {
+        readOnlyQueueDepth_++;
+        boost::asio::post(readOnlyPool_, [this, cmdId, packet, callback, commandTraits, queuedTime]() {
+            readOnlyQueueDepth_--;
+            run(cmdId, packet, callback, commandTraits, queuedTime);
+        });
+    } else {
+        mutatingQueueDepth_++;
+        boost::asio::post(mutatingPool_, [this, cmdId, packet, callback, commandTraits, queuedTime]() {
+            mutatingQueueDepth_--;
+            run(cmdId, packet, callback, commandTraits, queuedTime);
+        });
+    }
+}
+
+void CommandDispatcher::post(int domains, std::function<void()> task)
+{
+    mutatingQueueDepth_++;
+    boost::asio::post(mutatingPool_, [this, domains, task]() {
+        mutatingQueueDepth_--;
+        const CommandTraits commandTraits = { false, domains };
+        lockDomains(commandTraits);
+        task();
+        unlockDomains(commandTraits);
+    });
+}
+
+CommandDispatcher::CommandTraits CommandDispatcher::traits(int cmdId)
+{
+    switch (cmdId) {
+    case HELPER_CMD_GET_CMD_STATUS:
+        // ExecuteCmd is synchronized by itself
+        return { true, 0 };
+    case HELPER_CMD_CHECK_FIREWALL_STATE:
+    case HELPER_CMD_GET_FIREWALL_RULES:
+        return { true, kFirewall };
+    case HELPER_CMD_START_OPENVPN:
+    case HELPER_CMD_CLEAR_CMDS:
+    case HELPER_CMD_TASK_KILL:
+    case HELPER_CMD_START_CTRLD:
+    case HELPER_CMD_START_STUNNEL:
+    case HELPER_CMD_START_WSTUNNEL:
+        return { false, kProcesses };
+    case HELPER_CMD_CLEAR_FIREWALL_RULES:
+    case HELPER_CMD_SET_FIREWALL_RULES:
+    case HELPER_CMD_SET_FIREWALL_ON_BOOT:
+    case HELPER_CMD_SET_DNS_LEAK_PROTECT_ENABLED:
+        return { false, kFirewall };
+    case HELPER_CMD_CHANGE_MTU:
+    case HELPER_CMD_SET_MAC_ADDRESS:
+    case HELPER_CMD_RESET_MAC_ADDRESSES:
+        return { false, kRoutes };
+    case HELPER_CMD_START_WIREGUARD:
+    case HELPER_CMD_STOP_WIREGUARD:
+    case HELPER_CMD_CONFIGURE_WIREGUARD:
+        return { false, kWireGuard | kRoutes };
+    case HELPER_CMD_GET_WIREGUARD_STATUS:
+        // it shares the connection to the wireguard-go daemon, so it is serialized with the other WireGuard commands
+        return { false, kWireGuard };
+    case HELPER_CMD_SPLIT_TUNNELING_SETTINGS:
+    case HELPER_CMD_SEND_CONNECT_STATUS:
+        return { false, kSplitTunneling | kFirewall | kRoutes };
+    default:
+        // unknown commands are answered by processCommand(), lock everything to be safe
+        return { false, kProcesses | kFirewall | kRoutes | kWireGuard | kSplitTunneling };
+    }
+}
+
+void CommandDispatcher::run(int cmdId, const std::string &packet, const Callback &callback, const CommandTraits &traits,
+                            std::chrono::steady_clock::time_point queuedTime)
+{
+    lockDomains(traits);
+
+    const auto startTime = std::chrono::steady_clock::now();
+    CMD_ANSWER answer = processCommand(cmdId, packet);
+    const auto finishTime = std::chrono::steady_clock::now();
+
+    unlockDomains(traits);
+
+    callback(answer);
+
+    updateStatistics(cmdId, std::chrono::duration_cast<std::chrono::milliseconds>(startTime - queuedTime).count(),
+                     std::chrono::duration_cast<std::chrono::milliseconds>(finishTime - startTime).count());
+}
+
+void CommandDispatcher::lockDomains(const CommandTraits &traits)
+{
+    // the locks are always taken in the same order, so there are no deadlocks between the commands of several domains
+    for (int i = 0; i < kDomainsCount; ++i) {
+        if (traits.domains & (1 << i)) {
+            if (traits.isReadOnly)
+                domainMutexes_[i].lock_shared();
+            else
+                domainMutexes_[i].lock();
+        }
+    }
+}
+
+void CommandDispatcher::unlockDomains(const CommandTraits &traits)
+{
+    for (int i = kDomainsCount - 1; i >= 0; --i) {
+        if (traits.domains & (1 << i)) {
+            if (traits.isReadOnly)
+                domainMutexes_[i].unlock_shared();
+            else
+                domainMutexes_[i].unlock();
+        }
+    }
+}
+
+void CommandDispatcher::updateStatistics(int cmdId, long long waitMs, long long runMs)
+{
+    if (waitMs + runMs >= kSlowCommandMs) {
+        spdlog::warn("Slow helper command {}: waited {} ms, ran {} ms (queued read-only: {}, mutating: {})",
+                     cmdId, waitMs, runMs, readOnlyQueueDepth_.load(), mutatingQueueDepth_.load());
+    }
+
+    bool isLog;
+    {
+        std::lock_guard<std::mutex> locker(statisticsMutex_);
+        Statistics &s = statistics_[cmdId];
+        s.count++;
+        s.totalWaitMs += waitMs;
+        s.totalRunMs += runMs;
+        if (waitMs + runMs > s.maxLatencyMs)
+            s.maxLatencyMs = waitMs + runMs;
+        isLog = (++finishedCount_ % kStatisticsLogInterval) == 0;
+    }
+
+    if (isLog)
+        logStatistics();
+}
+
+void CommandDispatcher::logStatistics()
+{
+    std::lock_guard<std::mutex> locker(statisticsMutex_);
+    spdlog::debug("Helper command queues: read-only {}, mutating {}", readOnlyQueueDepth_.load(), mutatingQueueDepth_.load());
+    for (const auto &it : statistics_) {
+        const Statistics &s = it.second;
+        spdlog::debug("Helper command {}: count={} avg wait={}ms avg run={}ms max latency={}ms", it.first, s.count,
+                      s.totalWaitMs / (long long)s.count, s.totalRunMs / (long long)s.count, s.maxLatencyMs);
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+
+#include "../../posix_common/helper_commands.h"
+
+// Runs the helper commands off the IPC server thread.
+// The read-only commands (status and state queries) run concurrently on their own thread pool and take a shared lock
+// of their resource domains. The mutating commands run on another pool and take exclusive locks of all the domains
+// they touch, so the changes of one domain are serialized while the others stay available.
+class CommandDispatcher
+{
+public:
+    typedef std::function<void(const CMD_ANSWER &answer)> Callback;
+
+    enum Domain {
+        kProcesses = 1 << 0,
+        kFirewall = 1 << 1,
+        kRoutes = 1 << 2,          // routes and network interfaces
+        kWireGuard = 1 << 3,
+        kSplitTunneling = 1 << 4,
+        kDomainsCount = 5
+    };
+
+    static CommandDispatcher &instance()
+    {
+        static CommandDispatcher cd;
+        return cd;
+    }
+
+    // the callback is invoked in a pool thread
+    void dispatch(int cmdId, const std::string &packet, Callback callback);
+    // runs a change initiated by the helper itself (not by a client command) on the mutating pool,
+    // under the exclusive locks of the given domains
+    void post(int domains, std::function<void()> task);
+
+private:
+
+    struct CommandTraits
+    {
+        bool isReadOnly;
+        int domains;
+    };
+
+    struct Statistics
+    {
+        unsigned long count = 0;
+        long long totalWaitMs = 0;
+        long long totalRunMs = 0;
+        long long maxLatencyMs = 0;
+    };
+
+    CommandDispatcher();
+    ~CommandDispatcher();
+
+    static CommandTraits traits(int cmdId);
+    void lockDomains(const CommandTraits &traits);
+    void unlockDomains(const CommandTraits &traits);
+    void run(int cmdId, const std::string &packet, const Callback &callback, const CommandTraits &traits,
+             std::chrono::steady_clock::time_point queuedTime);
+    void updateStatistics(int cmdId, long long waitMs, long long runMs);
+    void logStatistics();
+
+    static constexpr int kReadOnlyThreadsCount = 4;
+    static constexpr int kMutatingThreadsCount = 4;
+    static constexpr long long kSlowCommandMs = 2000;
+    static constexpr unsigned long kStatisticsLogInterval = 200;
+
+    boost::asio::thread_pool readOnlyPool_;
+    boost::asio::thread_pool mutatingPool_;
+    std::shared_mutex domainMutexes_[kDomainsCount];
+
+    std::atomic<int> readOnlyQueueDepth_;
+    std::atomic<int> mutatingQueueDepth_;
+
+    std::mutex statisticsMutex_;
+    std::map<int, Statistics> statistics_;
+    unsigned long finishedCount_;
+};
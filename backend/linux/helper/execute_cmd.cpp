@@ -1,6 +1,5 @@
 #include "execute_cmd.h"
-#include <boost/thread.hpp>
-#include <syslog.h>
+#include "process_executor.h"
 
 unsigned long ExecuteCmd::execute(const std::string &cmd, const std::string &cwd, bool deleteOnFinish)
 {
@@ -11,15 +10,21 @@ unsigned long ExecuteCmd::execute(const std::string &cmd, const std::string &cwd
     cmdDescr->bSuccess = false;
     cmdDescr->cmdId = curCmdId_;
     executingCmds_.push_back(cmdDescr);
+
+    const unsigned long cmdId = curCmdId_;
     mutex_.unlock();
 
-    if (!cwd.empty()) {
-        boost::thread(runCmd, curCmdId_, "cd \"" + cwd + "\" && " + cmd, deleteOnFinish);
-    } else {
-        boost::thread(runCmd, curCmdId_, cmd, deleteOnFinish);
-    }
+    // the daemons run until stopped, so no timeout and no concurrency limit; only the tail of their output is kept
+    ProcessExecutor::Options options;
+    options.appendFromStdErr = false;
+    options.maxOutputSize = kMaxDaemonOutputSize;
+    options.isLongRunning = true;
+    options.cwd = cwd;
+    ProcessExecutor::instance().executeAsync(cmd, options, [cmdId, deleteOnFinish](const ProcessExecutor::Result &result) {
+        instance().cmdFinished(cmdId, result.isStarted, result.output, deleteOnFinish);
+    });
 
-    return curCmdId_;
+    return cmdId;
 }
 
 void ExecuteCmd::getStatus(unsigned long cmdId, bool &bFinished, std::string &log)
@@ -55,26 +60,6 @@ ExecuteCmd::ExecuteCmd() : curCmdId_(0)
 {
 }
 
-void ExecuteCmd::runCmd(unsigned long cmdId, std::string cmd, bool deleteOnFinish)
-{
-    std::string strReply;
-
-    // run openvpn command
-    FILE *file = popen(cmd.c_str(), "r");
-    if (file) {
-        char szLine[4096];
-        while(fgets(szLine, sizeof(szLine), file) != 0) {
-            if (instance().isCmdExist(cmdId)) {
-                strReply += szLine;
-            }
-        }
-        pclose(file);
-        instance().cmdFinished(cmdId, true, strReply, deleteOnFinish);
-    } else {
-        instance().cmdFinished(cmdId, false, std::string(), deleteOnFinish);
-    }
-}
-
 void ExecuteCmd::cmdFinished(unsigned long cmdId, bool bSuccess, std::string log, bool del)
 {
     mutex_.lock();
@@ -93,19 +78,3 @@ void ExecuteCmd::cmdFinished(unsigned long cmdId, bool bSuccess, std::string log
     }
     mutex_.unlock();
 }
-
-bool ExecuteCmd::isCmdExist(unsigned long cmdId)
-{
-    mutex_.lock();
-    bool bFound = false;
-    for (auto it = executingCmds_.begin(); it != executingCmds_.end(); ++it)
-    {
-        if ((*it)->cmdId == cmdId)
-        {
-            bFound = true;
-            break;
-        }
-    }
-    mutex_.unlock();
-    return bFound;
-}
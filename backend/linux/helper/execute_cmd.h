@@ -19,13 +19,13 @@ public:
     void clearCmds();
 
 private:
+    static constexpr size_t kMaxDaemonOutputSize = 64 * 1024;
+
     ExecuteCmd();
 
     unsigned long curCmdId_;
 
-    static void runCmd(unsigned long cmdId, std::string cmd, bool deleteOnFinish);
     void cmdFinished(unsigned long cmdId, bool bSuccess, std::string log, bool del);
-    bool isCmdExist(unsigned long cmdId);
 
     struct CmdDescr
     {
@@ -2,8 +2,6 @@
 
 #include <algorithm>
 #include <fcntl.h>
-#include <fstream>
-#include <sstream>
 #include <spdlog/spdlog.h>
 
 #include "split_tunneling/cgroups.h"
@@ -46,10 +44,12 @@ bool FirewallController::enable(bool ipv6, const std::string &rules)
         return 1;
     }
 
+    // the restore is transactional, if any rule fails (e.g. a deleted rule does not exist) nothing is applied
+    int status;
     if (ipv6) {
-        Utils::executeCommand("ip6tables-restore", {"-n", "/etc/windscribe/rules.v6"});
+        status = Utils::executeCommand("ip6tables-restore", {"-n", "/etc/windscribe/rules.v6"});
     } else {
-        Utils::executeCommand("iptables-restore", {"-n", "/etc/windscribe/rules.v4"});
+        status = Utils::executeCommand("iptables-restore", {"-n", "/etc/windscribe/rules.v4"});
     }
 
     // reapply split tunneling rules if necessary
@@ -57,25 +57,17 @@ bool FirewallController::enable(bool ipv6, const std::string &rules)
     setSplitTunnelAppExceptions();
     setSplitTunnelIngressRules(defaultAdapterIp_);
 
+    if (status != 0) {
+        spdlog::error("Could not restore firewall rules: {}", status);
+        return 1;
+    }
     return 0;
 }
 
 void FirewallController::getRules(bool ipv6, std::string *outRules)
 {
-    std::string filename;
-
-    if (ipv6) {
-        filename = "/etc/windscribe/rules.v6";
-        Utils::executeCommand("ip6tables-save", {"-f", filename.c_str()});
-    } else {
-        filename = "/etc/windscribe/rules.v4";
-        Utils::executeCommand("iptables-save", {"-f", filename.c_str()});
-    }
-
-    std::ifstream ifs(filename.c_str());
-    std::stringstream buffer;
-    buffer << ifs.rdbuf();
-    *outRules = buffer.str();
+    // read the rules from stdout, concurrent readers must not share a file with each other or with enable()
+    Utils::executeCommand(ipv6 ? "ip6tables-save" : "iptables-save", {}, outRules, false);
 }
 
 bool FirewallController::enabled(const std::string &tag)
@@ -124,32 +116,32 @@ void FirewallController::removeInclusiveIpRules()
 void FirewallController::removeExclusiveAppRules()
 {
     // v4
-    removeRule({"OUTPUT", "-t", "mangle", "-m", "cgroup", "--cgroup", CGroups::instance().netClassId(), "-j", "MARK", "--set-mark", CGroups::instance().mark(), "-m", "comment", "--comment", kTag});
+    removeRule({"OUTPUT", "-t", "mangle", "-m", "cgroup", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-j", "MARK", "--set-mark", CGroups::instance().mark(), "-m", "comment", "--comment", kTag});
     if (!prevAdapter_.empty()) {
-        removeRule({"POSTROUTING", "-t", "nat", "-m", "cgroup", "--cgroup", CGroups::instance().netClassId(), "-o", prevAdapter_.c_str(), "-j", "MASQUERADE", "-m", "comment", "--comment", kTag});
+        removeRule({"POSTROUTING", "-t", "nat", "-m", "cgroup", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-o", prevAdapter_.c_str(), "-j", "MASQUERADE", "-m", "comment", "--comment", kTag});
     }
-    removeRule({"windscribe_input", "-m", "cgroup", "--cgroup", CGroups::instance().netClassId(), "-j", "ACCEPT", "-m", "comment", "--comment", kTag});
-    removeRule({"windscribe_output", "-m", "cgroup", "--cgroup", CGroups::instance().netClassId(), "-j", "ACCEPT", "-m", "comment", "--comment", kTag});
+    removeRule({"windscribe_input", "-m", "cgroup", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-j", "ACCEPT", "-m", "comment", "--comment", kTag});
+    removeRule({"windscribe_output", "-m", "cgroup", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-j", "ACCEPT", "-m", "comment", "--comment", kTag});
 
     // v6
-    removeRule({"OUTPUT", "-t", "mangle", "-m", "cgroup", "--cgroup", CGroups::instance().netClassId(), "-j", "MARK", "--set-mark", CGroups::instance().mark(), "-m", "comment", "--comment", kTag}, true);
+    removeRule({"OUTPUT", "-t", "mangle", "-m", "cgroup", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-j", "MARK", "--set-mark", CGroups::instance().mark(), "-m", "comment", "--comment", kTag}, true);
     if (!prevAdapter_.empty()) {
-        removeRule({"POSTROUTING", "-t", "nat", "-m", "cgroup", "--cgroup", CGroups::instance().netClassId(), "-o", prevAdapter_.c_str(), "-j", "MASQUERADE", "-m", "comment", "--comment", kTag}, true);
+        removeRule({"POSTROUTING", "-t", "nat", "-m", "cgroup", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-o", prevAdapter_.c_str(), "-j", "MASQUERADE", "-m", "comment", "--comment", kTag}, true);
     }
-    removeRule({"windscribe_input", "-m", "cgroup", "--cgroup", CGroups::instance().netClassId(), "-j", "ACCEPT", "-m", "comment", "--comment", kTag}, true);
-    removeRule({"windscribe_output", "-m", "cgroup", "--cgroup", CGroups::instance().netClassId(), "-j", "ACCEPT", "-m", "comment", "--comment", kTag}, true);
+    removeRule({"windscribe_input", "-m", "cgroup", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-j", "ACCEPT", "-m", "comment", "--comment", kTag}, true);
+    removeRule({"windscribe_output", "-m", "cgroup", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-j", "ACCEPT", "-m", "comment", "--comment", kTag}, true);
 }
 
 void FirewallController::removeInclusiveAppRules()
 {
     // v4
-    removeRule({"OUTPUT", "-t", "mangle", "-m", "cgroup", "!", "--cgroup", CGroups::instance().netClassId(), "-j", "MARK", "--set-mark", CGroups::instance().mark(), "-m", "comment", "--comment", kTag});
+    removeRule({"OUTPUT", "-t", "mangle", "-m", "cgroup", "!", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-j", "MARK", "--set-mark", CGroups::instance().mark(), "-m", "comment", "--comment", kTag});
     if (!prevAdapter_.empty()) {
-        removeRule({"POSTROUTING", "-t", "nat", "-m", "cgroup", "!", "--cgroup", CGroups::instance().netClassId(), "-o", prevAdapter_.c_str(), "-j", "MASQUERADE", "-m", "comment", "--comment", kTag});
+        removeRule({"POSTROUTING", "-t", "nat", "-m", "cgroup", "!", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-o", prevAdapter_.c_str(), "-j", "MASQUERADE", "-m", "comment", "--comment", kTag});
     }
 
     // v6
-    removeRule({"OUTPUT", "-t", "mangle", "-m", "cgroup", "--cgroup", CGroups::instance().netClassId(), "-j", "DROP", "-m", "comment", "--comment", kTag}, true);
+    removeRule({"OUTPUT", "-t", "mangle", "-m", "cgroup", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-j", "DROP", "-m", "comment", "--comment", kTag}, true);
 }
 
 void FirewallController::setSplitTunnelIngressRules(const std::string &defaultAdapterIp)
@@ -187,33 +179,43 @@ void FirewallController::setSplitTunnelAppExceptions()
     if (splitTunnelExclude_) {
         removeInclusiveAppRules();
 
+        // the packets are not marked if the sockets of the excluded apps are marked on creation
+        const bool isMarkPackets = !CGroups::instance().isSocketMarking();
+
         // v4
-        addRule({"POSTROUTING",  "-t", "nat", "-m", "cgroup", "--cgroup", CGroups::instance().netClassId(), "-o", defaultAdapter_.c_str(), "-j", "MASQUERADE", "-m", "comment", "--comment", kTag});
-        addRule({"OUTPUT", "-t", "mangle", "-m", "cgroup", "--cgroup", CGroups::instance().netClassId(), "-j", "MARK", "--set-mark", CGroups::instance().mark(), "-m", "comment", "--comment", kTag}, false, true);
+        addRule({"POSTROUTING",  "-t", "nat", "-m", "cgroup", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-o", defaultAdapter_.c_str(), "-j", "MASQUERADE", "-m", "comment", "--comment", kTag});
+        if (isMarkPackets) {
+            addRule({"OUTPUT", "-t", "mangle", "-m", "cgroup", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-j", "MARK", "--set-mark", CGroups::instance().mark(), "-m", "comment", "--comment", kTag}, false, true);
+        }
 
         // v6
-        addRule({"POSTROUTING",  "-t", "nat", "-m", "cgroup", "--cgroup", CGroups::instance().netClassId(), "-o", defaultAdapter_.c_str(), "-j", "MASQUERADE", "-m", "comment", "--comment", kTag}, true);
-        addRule({"OUTPUT", "-t", "mangle", "-m", "cgroup", "--cgroup", CGroups::instance().netClassId(), "-j", "MARK", "--set-mark", CGroups::instance().mark(), "-m", "comment", "--comment", kTag}, true, true);
+        addRule({"POSTROUTING",  "-t", "nat", "-m", "cgroup", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-o", defaultAdapter_.c_str(), "-j", "MASQUERADE", "-m", "comment", "--comment", kTag}, true);
+        if (isMarkPackets) {
+            addRule({"OUTPUT", "-t", "mangle", "-m", "cgroup", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-j", "MARK", "--set-mark", CGroups::instance().mark(), "-m", "comment", "--comment", kTag}, true, true);
+        } else {
+            removeRule({"OUTPUT", "-t", "mangle", "-m", "cgroup", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-j", "MARK", "--set-mark", CGroups::instance().mark(), "-m", "comment", "--comment", kTag});
+            removeRule({"OUTPUT", "-t", "mangle", "-m", "cgroup", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-j", "MARK", "--set-mark", CGroups::instance().mark(), "-m", "comment", "--comment", kTag}, true);
+        }
 
         // allow packets from excluded apps, if firewall is on
         if (enabled()) {
             // v4
-            addRule({"windscribe_input", "-m", "cgroup", "--cgroup", CGroups::instance().netClassId(), "-j", "ACCEPT", "-m", "comment", "--comment", kTag});
-            addRule({"windscribe_output", "-m", "cgroup", "--cgroup", CGroups::instance().netClassId(), "-j", "ACCEPT", "-m", "comment", "--comment", kTag});
+            addRule({"windscribe_input", "-m", "cgroup", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-j", "ACCEPT", "-m", "comment", "--comment", kTag});
+            addRule({"windscribe_output", "-m", "cgroup", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-j", "ACCEPT", "-m", "comment", "--comment", kTag});
 
             // v6
-            addRule({"windscribe_input", "-m", "cgroup", "--cgroup", CGroups::instance().netClassId(), "-j", "ACCEPT", "-m", "comment", "--comment", kTag}, true);
-            addRule({"windscribe_output", "-m", "cgroup", "--cgroup", CGroups::instance().netClassId(), "-j", "ACCEPT", "-m", "comment", "--comment", kTag}, true);
+            addRule({"windscribe_input", "-m", "cgroup", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-j", "ACCEPT", "-m", "comment", "--comment", kTag}, true);
+            addRule({"windscribe_output", "-m", "cgroup", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-j", "ACCEPT", "-m", "comment", "--comment", kTag}, true);
         }
     } else {
         removeExclusiveAppRules();
 
         // v4
-        addRule({"POSTROUTING", "-t", "nat", "-m", "cgroup", "!", "--cgroup", CGroups::instance().netClassId(), "-o", defaultAdapter_.c_str(), "-j", "MASQUERADE", "-m", "comment", "--comment", kTag});
-        addRule({"OUTPUT", "-t", "mangle", "-m", "cgroup", "!", "--cgroup", CGroups::instance().netClassId(), "-j", "MARK", "--set-mark", CGroups::instance().mark(), "-m", "comment", "--comment", kTag}, false, true);
+        addRule({"POSTROUTING", "-t", "nat", "-m", "cgroup", "!", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-o", defaultAdapter_.c_str(), "-j", "MASQUERADE", "-m", "comment", "--comment", kTag});
+        addRule({"OUTPUT", "-t", "mangle", "-m", "cgroup", "!", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-j", "MARK", "--set-mark", CGroups::instance().mark(), "-m", "comment", "--comment", kTag}, false, true);
 
         // v6 -- We can't route IPv6 traffic into the v4 tunnel, so we drop IPv6 traffic for included apps
-        addRule({"OUTPUT", "-t", "mangle", "-m", "cgroup", "--cgroup", CGroups::instance().netClassId(), "-j", "DROP", "-m", "comment", "--comment", kTag}, true, true);
+        addRule({"OUTPUT", "-t", "mangle", "-m", "cgroup", CGroups::instance().iptablesMatchOption(), CGroups::instance().iptablesMatchValue(), "-j", "DROP", "-m", "comment", "--comment", kTag}, true, true);
 
         // For inclusive, allow all packets
         if (enabled()) {
@@ -287,6 +289,48 @@ void FirewallController::setSplitTunnelIpExceptions(const std::vector<std::strin
     splitTunnelIps_ = ips;
 }
 
+void FirewallController::updateSplitTunnelIpExceptions(const std::vector<std::string> &added, const std::vector<std::string> &removed)
+{
+    for (auto ip : removed) {
+        splitTunnelIps_.erase(std::remove(splitTunnelIps_.begin(), splitTunnelIps_.end(), ip), splitTunnelIps_.end());
+    }
+    for (auto ip : added) {
+        if (std::find(splitTunnelIps_.begin(), splitTunnelIps_.end(), ip) == splitTunnelIps_.end()) {
+            splitTunnelIps_.push_back(ip);
+        }
+    }
+
+    // otherwise the rules are added by the next setSplitTunnelIpExceptions()
+    if (!connected_ || !splitTunnelEnabled_ || !enabled()) {
+        return;
+    }
+
+    if (splitTunnelExclude_) {
+        for (auto ip : removed) {
+            removeRule({"windscribe_input", "-s", ip.c_str(), "-j", "ACCEPT", "-m", "comment", "--comment", kTag}, Utils::isValidIpv6Address(ip));
+            removeRule({"windscribe_output", "-d", ip.c_str(), "-j", "ACCEPT", "-m", "comment", "--comment", kTag}, Utils::isValidIpv6Address(ip));
+        }
+        for (auto ip : added) {
+            addRule({"windscribe_input", "-s", ip.c_str(), "-j", "ACCEPT", "-m", "comment", "--comment", kTag}, Utils::isValidIpv6Address(ip));
+            addRule({"windscribe_output", "-d", ip.c_str(), "-j", "ACCEPT", "-m", "comment", "--comment", kTag}, Utils::isValidIpv6Address(ip));
+        }
+    } else {
+        // only the IPv6 addresses of the inclusive mode have rules
+        for (auto ip : removed) {
+            if (Utils::isValidIpv6Address(ip)) {
+                removeRule({"windscribe_input", "-s", ip.c_str(), "-j", "DROP", "-m", "comment", "--comment", kTag}, true);
+                removeRule({"windscribe_output", "-d", ip.c_str(), "-j", "DROP", "-m", "comment", "--comment", kTag}, true);
+            }
+        }
+        for (auto ip : added) {
+            if (Utils::isValidIpv6Address(ip)) {
+                addRule({"windscribe_input", "-s", ip.c_str(), "-j", "DROP", "-m", "comment", "--comment", kTag}, true);
+                addRule({"windscribe_output", "-d", ip.c_str(), "-j", "DROP", "-m", "comment", "--comment", kTag}, true);
+            }
+        }
+    }
+}
+
 void FirewallController::addRule(const std::vector<std::string> &args, bool ipv6, bool append)
 {
     std::vector<std::string> checkArgs = args;
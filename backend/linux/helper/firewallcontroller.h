@@ -26,6 +26,8 @@ public:
         const std::string &adapter,
         const std::string &adapterIp);
     void setSplitTunnelIpExceptions(const std::vector<std::string> &ips);
+    // applies only the changes of the list
+    void updateSplitTunnelIpExceptions(const std::vector<std::string> &added, const std::vector<std::string> &removed);
 
 private:
     FirewallController();
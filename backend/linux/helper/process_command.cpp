@@ -342,12 +342,12 @@ CMD_ANSWER setMacAddress(boost::archive::text_iarchive &ia)
 #else
     std::string out;
     if (cmd.isWifi) {
-        Utils::executeCommand("nmcli", {"connection", "modify", cmd.network.c_str(), "wifi.cloned-mac-address", mac.c_str()}, &out);
+        Utils::executeCommand("nmcli", {"connection", "modify", cmd.network.c_str(), "wifi.cloned-mac-address", mac.c_str()}, &out, true, Utils::kCommandTimeoutMs);
     } else {
-        Utils::executeCommand("nmcli", {"connection", "modify", cmd.network.c_str(), "ethernet.cloned-mac-address", mac.c_str()}, &out);
+        Utils::executeCommand("nmcli", {"connection", "modify", cmd.network.c_str(), "ethernet.cloned-mac-address", mac.c_str()}, &out, true, Utils::kCommandTimeoutMs);
     }
     // restart the connection
-    Utils::executeCommand("nmcli", {"connection", "up", cmd.network.c_str()});
+    Utils::executeCommand("nmcli", {"connection", "up", cmd.network.c_str()}, nullptr, true, Utils::kCommandTimeoutMs);
 #endif
     answer.executed = 1;
     return answer;
@@ -367,9 +367,11 @@ CMD_ANSWER taskKill(boost::archive::text_iarchive &ia)
     } else if (cmd.target == kTargetOpenVpn) {
         spdlog::info("Killing OpenVPN processes");
         const std::vector<std::string> exes = Utils::getOpenVpnExeNames();
+        std::vector<std::string> cmds;
         for (auto exe : exes) {
-            Utils::executeCommand("pkill", {"-f", exe.c_str()});
+            cmds.push_back("pkill -f \"" + exe + "\"");
         }
+        Utils::executeCommands(cmds);
         answer.executed = 1;
     } else if (cmd.target == kTargetStunnel) {
         spdlog::info("Killing Stunnel processes");
@@ -409,6 +411,11 @@ CMD_ANSWER startCtrld(boost::archive::text_iarchive &ia)
         answer.executed = 0;
         return answer;
     }
+    if (cmd.listenPort == 0 || cmd.listenPort > 65535) {
+        spdlog::error("Invalid ctrld listen port: {}", cmd.listenPort);
+        answer.executed = 0;
+        return answer;
+    }
     for (const auto domain: cmd.domains) {
         if (!Utils::isValidDomain(domain)) {
             spdlog::error("Invalid domain: {}", domain);
@@ -420,7 +427,7 @@ CMD_ANSWER startCtrld(boost::archive::text_iarchive &ia)
     std::stringstream arguments;
     arguments << "run";
     arguments << " --daemon";
-    arguments << " --listen=127.0.0.1:53";
+    arguments << " --listen=127.0.0.1:" + std::to_string(cmd.listenPort);
     arguments << " --primary_upstream=" + cmd.upstream1;
     if (!cmd.upstream2.empty()) {
         arguments << " --secondary_upstream=" + cmd.upstream2;
@@ -0,0 +1,316 @@
+#include "process_executor.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <future>
+#include <spdlog/spdlog.h>
+
+extern char **environ;
+
+struct ProcessExecutor::Process
+{
+    Process(boost::asio::io_context &io_context)
+        : pipes{ boost::asio::posix::stream_descriptor(io_context), boost::asio::posix::stream_descriptor(io_context) },
+          timeoutTimer(io_context), reapTimer(io_context)
+    {
+    }
+
+    std::string cmdLine;
+    Options options;
+    Callback callback;
+
+    pid_t pid = -1;
+    // stdout and stderr
+    boost::asio::posix::stream_descriptor pipes[2];
+    std::string outputs[2];
+    char buffers[2][4096];
+    int openPipesCount = 0;
+
+    boost::asio::steady_timer timeoutTimer;
+    boost::asio::steady_timer reapTimer;
+    std::chrono::steady_clock::time_point startTime;
+    Result result;
+};
+
+namespace
+{
+// the executable name without the path, used as the statistics key
+std::string commandName(const std::string &cmdLine)
+{
+    const size_t begin = cmdLine.find_first_not_of(" \t\"");
+    if (begin == std::string::npos)
+        return std::string();
+    size_t end = cmdLine.find_first_of(" \t\"", begin);
+    if (end == std::string::npos)
+        end = cmdLine.size();
+    const std::string exe = cmdLine.substr(begin, end - begin);
+    const size_t slash = exe.rfind('/');
+    return slash == std::string::npos ? exe : exe.substr(slash + 1);
+}
+}
+
+ProcessExecutor::ProcessExecutor() : workGuard_(boost::asio::make_work_guard(io_context_)), runningCount_(0), finishedCount_(0)
+{
+    thread_ = std::thread([this]() { io_context_.run(); });
+}
+
+ProcessExecutor::~ProcessExecutor()
+{
+    workGuard_.reset();
+    io_context_.stop();
+    if (thread_.joinable())
+        thread_.join();
+}
+
+void ProcessExecutor::executeAsync(const std::string &cmdLine, const Options &options, Callback callback)
+{
+    auto process = std::make_shared<Process>(io_context_);
+    process->cmdLine = cmdLine;
+    process->options = options;
+    process->callback = std::move(callback);
+    boost::asio::post(io_context_, [this, process]() { enqueue(process); });
+}
+
+void ProcessExecutor::executeAsync(const std::string &cmdLine, const Options &options, boost::asio::io_context &callbackContext, Callback callback)
+{
+    executeAsync(cmdLine, options, [&callbackContext, callback](const Result &result) {
+        boost::asio::post(callbackContext, [callback, result]() { callback(result); });
+    });
+}
+
+ProcessExecutor::Result ProcessExecutor::execute(const std::string &cmdLine, const Options &options)
+{
+    // a blocking call from a callback would never finish
+    assert(!io_context_.get_executor().running_in_this_thread());
+
+    std::promise<Result> promise;
+    std::future<Result> future = promise.get_future();
+    executeAsync(cmdLine, options, [&promise](const Result &result) { promise.set_value(result); });
+    return future.get();
+}
+
+std::vector<ProcessExecutor::Result> ProcessExecutor::executeAll(const std::vector<std::string> &cmdLines, const Options &options)
+{
+    assert(!io_context_.get_executor().running_in_this_thread());
+
+    std::vector<std::promise<Result>> promises(cmdLines.size());
+    for (size_t i = 0; i < cmdLines.size(); ++i) {
+        executeAsync(cmdLines[i], options, [&promise = promises[i]](const Result &result) { promise.set_value(result); });
+    }
+
+    std::vector<Result> results;
+    results.reserve(cmdLines.size());
+    for (auto &promise : promises) {
+        results.push_back(promise.get_future().get());
+    }
+    return results;
+}
+
+void ProcessExecutor::logStatistics()
+{
+    std::lock_guard<std::mutex> locker(statisticsMutex_);
+    for (const auto &it : statistics_) {
+        const Statistics &s = it.second;
+        spdlog::debug("Process statistics: {} count={} failures={} timeouts={} avg={}ms max={}ms",
+                      it.first, s.count, s.failures, s.timeouts, s.count ? s.totalMs / (long long)s.count : 0, s.maxMs);
+    }
+}
+
+void ProcessExecutor::enqueue(const std::shared_ptr<Process> &process)
+{
+    if (process->options.isLongRunning) {
+        start(process);
+    } else {
+        pending_.push_back(process);
+        startPending();
+    }
+}
+
+void ProcessExecutor::startPending()
+{
+    while (!pending_.empty() && runningCount_ < kMaxConcurrentProcesses) {
+        std::shared_ptr<Process> process = pending_.front();
+        pending_.pop_front();
+        runningCount_++;
+        start(process);
+    }
+}
+
+void ProcessExecutor::start(const std::shared_ptr<Process> &process)
+{
+    process->startTime = std::chrono::steady_clock::now();
+
+    int fds[2][2];
+    if (pipe2(fds[0], O_CLOEXEC) != 0) {
+        spdlog::error("ProcessExecutor: pipe2() failed: {}", errno);
+        finish(process);
+        return;
+    }
+    if (pipe2(fds[1], O_CLOEXEC) != 0) {
+        spdlog::error("ProcessExecutor: pipe2() failed: {}", errno);
+        close(fds[0][0]);
+        close(fds[0][1]);
+        finish(process);
+        return;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, fds[0][1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, fds[1][1], STDERR_FILENO);
+
+    // own process group, so the timeout kills the whole pipeline of the shell
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    short flags = POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+#ifdef POSIX_SPAWN_USEVFORK
+    flags |= POSIX_SPAWN_USEVFORK;
+#endif
+    posix_spawnattr_setflags(&attr, flags);
+    posix_spawnattr_setpgroup(&attr, 0);
+    sigset_t signals;
+    sigemptyset(&signals);
+    posix_spawnattr_setsigmask(&attr, &signals);
+    sigaddset(&signals, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attr, &signals);
+
+    std::string cmd = process->cmdLine;
+    if (!process->options.cwd.empty())
+        cmd = "cd \"" + process->options.cwd + "\" && " + cmd;
+    char shell[] = "/bin/sh";
+    char shellArg[] = "-c";
+    char *argv[] = { shell, shellArg, &cmd[0], nullptr };
+
+    const int ret = posix_spawn(&process->pid, shell, &actions, &attr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    close(fds[0][1]);
+    close(fds[1][1]);
+
+    if (ret != 0) {
+        spdlog::error("ProcessExecutor: posix_spawn() failed: {}", ret);
+        close(fds[0][0]);
+        close(fds[1][0]);
+        finish(process);
+        return;
+    }
+
+    process->result.isStarted = true;
+    for (int i = 0; i < 2; ++i) {
+        process->pipes[i].assign(fds[i][0]);
+        process->openPipesCount++;
+        readPipe(process, i);
+    }
+
+    if (process->options.timeoutMs > 0) {
+        process->timeoutTimer.expires_after(std::chrono::milliseconds(process->options.timeoutMs));
+        process->timeoutTimer.async_wait([this, process](const boost::system::error_code &ec) {
+            if (!ec)
+                onTimeout(process);
+        });
+    }
+}
+
+void ProcessExecutor::readPipe(const std::shared_ptr<Process> &process, int ind)
+{
+    process->pipes[ind].async_read_some(boost::asio::buffer(process->buffers[ind]),
+        [this, process, ind](const boost::system::error_code &ec, std::size_t bytesRead) {
+            if (!ec) {
+                // the unused output is drained only, the daemons may write to it for hours
+                if (process->options.isCaptureOutput && (ind == 0 || process->options.appendFromStdErr)) {
+                    std::string &output = process->outputs[ind];
+                    output.append(process->buffers[ind], bytesRead);
+                    if (output.size() > process->options.maxOutputSize) {
+                        output.erase(0, output.size() - process->options.maxOutputSize);
+                        process->result.isOutputTruncated = true;
+                    }
+                }
+                readPipe(process, ind);
+                return;
+            }
+
+            // EOF, or the pipe was closed on timeout
+            boost::system::error_code ignored;
+            process->pipes[ind].close(ignored);
+            if (--process->openPipesCount == 0)
+                tryReap(process);
+        });
+}
+
+void ProcessExecutor::onTimeout(const std::shared_ptr<Process> &process)
+{
+    spdlog::error("ProcessExecutor: command timed out after {} ms: {}", process->options.timeoutMs, commandName(process->cmdLine));
+    process->result.isTimedOut = true;
+    kill(-process->pid, SIGKILL);
+    // the pipes may be inherited by the processes which left the group, don't wait for them
+    for (auto &pipe : process->pipes) {
+        boost::system::error_code ignored;
+        pipe.cancel(ignored);
+    }
+}
+
+void ProcessExecutor::tryReap(const std::shared_ptr<Process> &process)
+{
+    int status = 0;
+    const pid_t ret = waitpid(process->pid, &status, WNOHANG);
+    if (ret == 0) {
+        // the pipes are closed right before the exit, so this is short
+        process->reapTimer.expires_after(std::chrono::milliseconds(kReapIntervalMs));
+        process->reapTimer.async_wait([this, process](const boost::system::error_code &ec) {
+            if (!ec)
+                tryReap(process);
+        });
+        return;
+    }
+
+    if (ret == process->pid && !process->result.isTimedOut)
+        process->result.status = status;
+    finish(process);
+}
+
+void ProcessExecutor::finish(const std::shared_ptr<Process> &process)
+{
+    process->timeoutTimer.cancel();
+
+    Result &result = process->result;
+    result.output = std::move(process->outputs[0]);
+    if (process->options.appendFromStdErr)
+        result.output += process->outputs[1];
+
+    const long long durationMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - process->startTime).count();
+    if (!process->options.isLongRunning)
+        updateStatistics(process->cmdLine, result, durationMs);
+
+    if (process->callback)
+        process->callback(result);
+
+    if (!process->options.isLongRunning) {
+        runningCount_--;
+        startPending();
+    }
+}
+
+void ProcessExecutor::updateStatistics(const std::string &cmdLine, const Result &result, long long durationMs)
+{
+    bool isLog;
+    {
+        std::lock_guard<std::mutex> locker(statisticsMutex_);
+        Statistics &s = statistics_[commandName(cmdLine)];
+        s.count++;
+        if (result.isTimedOut)
+            s.timeouts++;
+        else if (!result.isStarted || result.status != 0)
+            s.failures++;
+        s.totalMs += durationMs;
+        if (durationMs > s.maxMs)
+            s.maxMs = durationMs;
+        isLog = (++finishedCount_ % kStatisticsLogInterval) == 0;
+    }
+
+    if (isLog)
+        logStatistics();
+}
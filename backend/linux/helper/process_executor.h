@@ -0,0 +1,99 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Runs the shell commands as child processes started with posix_spawn (vfork semantics, no copy of the helper's memory).
+// The pipes and the timeouts are served by an own boost::asio io_context thread, so the callers are not blocked
+// while the children run, and independent commands run concurrently up to kMaxConcurrentProcesses.
+// The long-running daemons (openvpn, wireguard-go, stunnel) are not counted against this limit.
+class ProcessExecutor
+{
+public:
+    static constexpr int kMaxConcurrentProcesses = 8;
+    static constexpr size_t kDefaultMaxOutputSize = 4 * 1024 * 1024;
+
+    struct Options
+    {
+        int timeoutMs = 0;                  // 0 means no timeout, the callers opt in for the commands which may hang
+        bool isCaptureOutput = true;        // the output is drained and discarded if false
+        bool appendFromStdErr = true;       // stderr output is appended after stdout
+        size_t maxOutputSize = kDefaultMaxOutputSize;   // per stream, only the last maxOutputSize bytes are kept
+        bool isLongRunning = false;
+        std::string cwd;
+    };
+
+    struct Result
+    {
+        bool isStarted = false;
+        bool isTimedOut = false;
+        bool isOutputTruncated = false;
+        int status = -1;                    // the wait status of the process, -1 if not started or timed out
+        std::string output;
+    };
+
+    typedef std::function<void(const Result &result)> Callback;
+
+    static ProcessExecutor &instance()
+    {
+        static ProcessExecutor e;
+        return e;
+    }
+
+    // the callback is invoked in the executor's thread and must not block
+    void executeAsync(const std::string &cmdLine, const Options &options, Callback callback);
+    // the callback is posted to the given io_context, e.g. the IPC server's one
+    void executeAsync(const std::string &cmdLine, const Options &options, boost::asio::io_context &callbackContext, Callback callback);
+
+    Result execute(const std::string &cmdLine, const Options &options);
+    // runs independent commands concurrently, the results are in the order of the commands
+    std::vector<Result> executeAll(const std::vector<std::string> &cmdLines, const Options &options);
+
+    void logStatistics();
+
+private:
+    ProcessExecutor();
+    ~ProcessExecutor();
+
+    struct Process;
+    struct Statistics
+    {
+        unsigned long count = 0;
+        unsigned long failures = 0;
+        unsigned long timeouts = 0;
+        long long totalMs = 0;
+        long long maxMs = 0;
+    };
+
+    void enqueue(const std::shared_ptr<Process> &process);
+    void startPending();
+    void start(const std::shared_ptr<Process> &process);
+    void readPipe(const std::shared_ptr<Process> &process, int ind);
+    void onTimeout(const std::shared_ptr<Process> &process);
+    void tryReap(const std::shared_ptr<Process> &process);
+    void finish(const std::shared_ptr<Process> &process);
+    void updateStatistics(const std::string &cmdLine, const Result &result, long long durationMs);
+
+    static constexpr int kReapIntervalMs = 5;
+    static constexpr unsigned long kStatisticsLogInterval = 100;
+
+    boost::asio::io_context io_context_;
+    boost::asio::executor_work_guard<boost::asio::io_context::executor_type> workGuard_;
+    std::thread thread_;
+
+    // accessed only in the executor's thread
+    std::deque<std::shared_ptr<Process>> pending_;
+    int runningCount_;
+
+    std::mutex statisticsMutex_;
+    std::map<std::string, Statistics> statistics_;
+    unsigned long finishedCount_;
+};
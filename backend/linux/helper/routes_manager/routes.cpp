@@ -31,20 +31,23 @@ void Routes::addWithInterface(const std::string &ip, const std::string &interfac
 
 void Routes::clear()
 {
+    // the routes are independent, so they are deleted concurrently
+    std::vector<std::string> cmds;
     for(auto const& rd: routes_)
     {
         if (rd.interface.empty())
         {
             std::string cmd = "ip route delete " + rd.ip + "/" + rd.mask + " via " + rd.gateway;
             spdlog::info("execute: {}", cmd);
-            Utils::executeCommand(cmd);
+            cmds.push_back(cmd);
         }
         else
         {
             std::string cmd = "ip route delete " + rd.ip + "/" + rd.mask + " dev " + rd.interface;
             spdlog::info("execute: {}", cmd);
-            Utils::executeCommand(cmd);
+            cmds.push_back(cmd);
         }
     }
+    Utils::executeCommands(cmds);
     routes_.clear();
 }
@@ -17,9 +17,9 @@
 
 #include "execute_cmd.h"
 #include "firewallcontroller.h"
+#include "helper_commands_serialize.h"
 #include "ipc/helper_security.h"
 #include "ovpn.h"
-#include "process_command.h"
 #include "utils.h"
 #include "utils/executable_signature/executable_signature.h"
 
@@ -41,7 +41,7 @@ Server::~Server()
     unlink(SOCK_PATH);
 }
 
-bool Server::readAndHandleCommand(socket_ptr sock, boost::asio::streambuf *buf, CMD_ANSWER &outCmdAnswer)
+bool Server::readCommand(socket_ptr sock, boost::asio::streambuf *buf, int &outCmdId, std::string &outPacket)
 {
     // not enough data for read command
     if (buf->size() < sizeof(int)*3) {
@@ -78,37 +78,43 @@ bool Server::readAndHandleCommand(socket_ptr sock, boost::asio::streambuf *buf,
         return false;
     }
 
-    std::vector<char> vector(length);
-    memcpy(&vector[0], bufPtr + headerSize, length);
-    std::string str(vector.begin(), vector.end());
-    std::istringstream stream(str);
-    outCmdAnswer = processCommand(cmdId, str);
-
+    outCmdId = cmdId;
+    outPacket.assign(bufPtr + headerSize, length);
     buf->consume(headerSize + length);
 
     return true;
 }
 
+void Server::handleNextCommand(socket_ptr sock, boost::shared_ptr<boost::asio::streambuf> buf)
+{
+    int cmdId;
+    std::string packet;
+    if (!readCommand(sock, buf.get(), cmdId, packet)) {
+        // goto receive next commands
+        boost::asio::async_read(*sock, *buf, boost::asio::transfer_at_least(1),
+                                boost::bind(&Server::receiveCmdHandle, this, sock, buf, _1, _2));
+        return;
+    }
+
+    // the command runs in the dispatcher's threads, so the other clients are served meanwhile;
+    // the answer is sent from the server thread and only then the next command of this client is handled
+    CommandDispatcher::instance().dispatch(cmdId, packet, [this, sock, buf](const CMD_ANSWER &cmdAnswer) {
+        boost::asio::post(service_, [this, sock, buf, cmdAnswer]() {
+            if (!sendAnswerCmd(sock, cmdAnswer)) {
+                spdlog::info("client app disconnected");
+                return;
+            }
+            handleNextCommand(sock, buf);
+        });
+    });
+}
+
 void Server::receiveCmdHandle(socket_ptr sock, boost::shared_ptr<boost::asio::streambuf> buf, const boost::system::error_code& ec, std::size_t bytes_transferred)
 {
     UNUSED(bytes_transferred);
 
     if (!ec.value()) {
-        // read and handle commands
-        while (true) {
-            CMD_ANSWER cmdAnswer;
-            if (!readAndHandleCommand(sock, buf.get(), cmdAnswer)) {
-                // goto receive next commands
-                boost::asio::async_read(*sock, *buf, boost::asio::transfer_at_least(1),
-                                        boost::bind(&Server::receiveCmdHandle, this, sock, buf, _1, _2));
-                break;
-            } else {
-                if (!sendAnswerCmd(sock, cmdAnswer)) {
-                    spdlog::info("client app disconnected");
-                    return;
-                }
-            }
-        }
+        handleNextCommand(sock, buf);
     } else {
         spdlog::info("client app disconnected");
     }
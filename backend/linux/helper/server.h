@@ -10,6 +10,7 @@
 #include <list>
 
 #include "../../posix_common/helper_commands.h"
+#include "command_dispatcher.h"
 #include "routes_manager/routes_manager.h"
 #include "wireguard/defaultroutemonitor.h"
 #include "wireguard/wireguardadapter.h"
@@ -28,7 +29,8 @@ private:
     boost::asio::io_service service_;
     boost::asio::local::stream_protocol::acceptor *acceptor_;
 
-    bool readAndHandleCommand(socket_ptr sock, boost::asio::streambuf *buf, CMD_ANSWER &outCmdAnswer);
+    bool readCommand(socket_ptr sock, boost::asio::streambuf *buf, int &outCmdId, std::string &outPacket);
+    void handleNextCommand(socket_ptr sock, boost::shared_ptr<boost::asio::streambuf> buf);
 
     void receiveCmdHandle(socket_ptr sock, boost::shared_ptr<boost::asio::streambuf> buf, const boost::system::error_code& ec, std::size_t bytes_transferred);
     void acceptHandler(const boost::system::error_code & ec, socket_ptr sock);
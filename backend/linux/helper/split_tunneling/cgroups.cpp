@@ -1,86 +1,494 @@
 #include "cgroups.h"
 
+#include <fcntl.h>
+#include <linux/bpf.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <spdlog/spdlog.h>
 #include "../utils.h"
 
-CGroups::CGroups()
+namespace
+{
+const char *kNetclsMountPoint = "/sys/fs/cgroup/net_cls";
+const char *kRtTablesFile = "/etc/iproute2/rt_tables";
+
+int bpf(int cmd, union bpf_attr *attr)
+{
+    return syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+
+// "ip" with the quoted args, for Utils::executeCommands()
+std::string ipCommand(const std::vector<std::string> &args)
+{
+    std::string cmdLine = "ip";
+    for (const auto &arg : args) {
+        cmdLine += " \"" + arg + "\"";
+    }
+    return cmdLine;
+}
+
+std::vector<std::string> split(const std::string &str, char delim)
+{
+    std::vector<std::string> tokens;
+    std::istringstream stream(str);
+    std::string token;
+    while (std::getline(stream, token, delim)) {
+        tokens.push_back(token);
+    }
+    return tokens;
+}
+}
+
+CGroups::CGroups() : isMountsRead_(false), isCgroup2_(false), isEnabled_(false),
+    procsFd_(-1), rootProcsFd_(-1), cgroupFd_(-1), bpfProgFd_(-1)
 {
 }
 
 CGroups::~CGroups()
 {
+    detachSocketMarkProgram();
+    if (procsFd_ >= 0) {
+        close(procsFd_);
+    }
+    if (rootProcsFd_ >= 0) {
+        close(rootProcsFd_);
+    }
+    if (cgroupFd_ >= 0) {
+        close(cgroupFd_);
+    }
 }
 
 bool CGroups::enable(CMD_SEND_CONNECT_STATUS &connectStatus, bool isAllowLanTraffic, bool isExclude)
 {
+    UNUSED(isAllowLanTraffic);
     spdlog::debug("cgroups enable");
 
-    std::string out;
+    std::lock_guard<std::mutex> locker(mutex_);
+    if (!prepareHierarchy()) {
+        return false;
+    }
 
-    int ret = Utils::executeCommand("/etc/windscribe/cgroups-up",
-                                    { mark_.c_str(),
-                                      connectStatus.defaultAdapter.gatewayIp,
-                                      connectStatus.defaultAdapter.adapterName,
-                                      connectStatus.vpnAdapter.gatewayIp,
-                                      connectStatus.vpnAdapter.adapterName,
-                                      connectStatus.remoteIp,
-                                      netClassId_.c_str(),
-                                      isAllowLanTraffic ? "allow": "disallow",
-                                      isExclude ? "exclusive": "inclusive"},
-                                    &out);
-    if (ret != 0) {
-        spdlog::error("cgroups-up script failed: {}", out);
+    // the routing tables are set up once per cgroup, they are flushed when the cgroup is removed
+    const bool isCreated = (access(cgroupDir().c_str(), F_OK) != 0);
+    if (!createCgroup()) {
         return false;
     }
+    if (isCreated) {
+        setupRoutingTables(connectStatus);
+    }
+    if (!isExclude) {
+        setupInclusiveRules();
+    }
 
+    // in the inclusive mode the sockets outside of the cgroup are marked, which can't be done from the cgroup
+    if (isCgroup2_ && isExclude) {
+        attachSocketMarkProgram();
+    } else {
+        detachSocketMarkProgram();
+    }
+
+    isEnabled_ = true;
     return true;
 }
 
 void CGroups::disable()
 {
+    std::lock_guard<std::mutex> locker(mutex_);
+    // the first call after the start cleans up what a previous instance of the helper may have left
+    if (!isEnabled_ && isMountsRead_) {
+        return;
+    }
     spdlog::debug("cgroups disable");
 
-    Utils::executeCommand("/etc/windscribe/cgroups-down");
+    readMounts();
+    clearRoutingTables();
+    detachSocketMarkProgram();
+    if (!root_.empty()) {
+        removeCgroup();
+    }
+    isEnabled_ = false;
 }
 
 void CGroups::addApp(pid_t pid)
 {
-    std::ofstream out;
-    out.open((findNetclsRoot() + "/windscribe/cgroup.procs").c_str());
-    out << pid;
-    out.close();
+    addApps({ pid });
+}
+
+void CGroups::addApps(const std::vector<pid_t> &pids)
+{
+    std::lock_guard<std::mutex> locker(mutex_);
+    if (procsFd_ < 0) {
+        return;
+    }
+
+    for (auto pid : pids) {
+        if (isCgroup2_ && originalCgroups_.find(pid) == originalCgroups_.end()) {
+            const std::string cgroup = cgroupOfPid(pid);
+            if (!cgroup.empty() && cgroup != "/" + cgroupName_) {
+                originalCgroups_[pid] = cgroup;
+            }
+        }
+        movePid(procsFd_, pid);
+    }
 }
 
 void CGroups::removeApp(pid_t pid)
 {
-    std::ofstream out;
-    out.open((findNetclsRoot() + "/cgroup.procs").c_str());
-    out << pid;
-    out.close();
+    removeApps({ pid });
+}
+
+void CGroups::removeApps(const std::vector<pid_t> &pids)
+{
+    std::lock_guard<std::mutex> locker(mutex_);
+    if (rootProcsFd_ < 0) {
+        return;
+    }
+
+    for (auto pid : pids) {
+        restorePid(pid);
+    }
+}
+
+std::string CGroups::iptablesMatchOption() const
+{
+    std::lock_guard<std::mutex> locker(mutex_);
+    return isCgroup2_ ? "--path" : "--cgroup";
+}
+
+std::string CGroups::iptablesMatchValue() const
+{
+    std::lock_guard<std::mutex> locker(mutex_);
+    return isCgroup2_ ? cgroupName_ : netClassId_;
+}
+
+bool CGroups::isSocketMarking() const
+{
+    std::lock_guard<std::mutex> locker(mutex_);
+    return bpfProgFd_ >= 0;
 }
 
-std::string CGroups::findNetclsRoot()
+void CGroups::readMounts()
 {
-    if (!net_cls_root_.empty()) {
-        return net_cls_root_;
+    if (isMountsRead_) {
+        return;
     }
+    isMountsRead_ = true;
 
-    std::string response;
+    // <id> <parent id> <major:minor> <root> <mount point> <options> [optional fields] - <fs type> <source> <super options>
+    std::ifstream file("/proc/self/mountinfo");
     std::string line;
+    while (std::getline(file, line)) {
+        const std::vector<std::string> fields = split(line, ' ');
+        size_t sep = 6;
+        while (sep < fields.size() && fields[sep] != "-") {
+            sep++;
+        }
+        if (fields.size() < 5 || sep + 3 >= fields.size()) {
+            continue;
+        }
+
+        const std::string &mountPoint = fields[4];
+        const std::string &fsType = fields[sep + 1];
+        if (fsType == "cgroup" && root_.empty()) {
+            const std::vector<std::string> options = split(fields[sep + 3], ',');
+            if (std::find(options.begin(), options.end(), "net_cls") != options.end()) {
+                root_ = mountPoint;
+            }
+        } else if (fsType == "cgroup2" && cgroup2Root_.empty()) {
+            cgroup2Root_ = mountPoint;
+        }
+    }
+
+    // the cgroup2 hierarchy is used only without net_cls, so our cgroup there is a leftover of a previous run
+    if (root_.empty() && !cgroup2Root_.empty() && access((cgroup2Root_ + "/" + cgroupName_).c_str(), F_OK) == 0) {
+        root_ = cgroup2Root_;
+        isCgroup2_ = true;
+    }
+    spdlog::debug("cgroups: net_cls root '{}', cgroup2 root '{}'", isCgroup2_ ? "" : root_, cgroup2Root_);
+}
+
+bool CGroups::prepareHierarchy()
+{
+    readMounts();
+    if (!root_.empty()) {
+        return true;
+    }
+
+    Utils::executeCommand("modprobe", {"cls_cgroup"});
+
+    // on some distros the path is a symlink to a cgroup2 directory
+    struct stat st;
+    if (lstat(kNetclsMountPoint, &st) == 0 && S_ISLNK(st.st_mode)) {
+        Utils::executeCommand("mount", {"-o", "remount,rw", "/sys/fs/cgroup"});
+        unlink(kNetclsMountPoint);
+    }
+    mkdir(kNetclsMountPoint, 0755);
+    if (mount("net_cls", kNetclsMountPoint, "cgroup", 0, "net_cls") == 0) {
+        root_ = kNetclsMountPoint;
+        isCgroup2_ = false;
+        return true;
+    }
+    spdlog::info("cgroups: could not mount net_cls ({}), trying cgroup2", strerror(errno));
+    rmdir(kNetclsMountPoint);
+
+    if (cgroup2Root_.empty()) {
+        spdlog::error("cgroups: neither net_cls nor cgroup2 is available");
+        return false;
+    }
+    root_ = cgroup2Root_;
+    isCgroup2_ = true;
+    return true;
+}
+
+bool CGroups::createCgroup()
+{
+    const std::string dir = cgroupDir();
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        spdlog::error("cgroups: could not create {}: {}", dir, strerror(errno));
+        return false;
+    }
+
+    if (!isCgroup2_) {
+        std::ofstream out(dir + "/net_cls.classid");
+        out << netClassId_;
+        if (!out) {
+            spdlog::error("cgroups: could not set the class id");
+            return false;
+        }
+    }
 
-    Utils::executeCommand("mount", { "-l", "-t", "cgroup" }, &response);
-    std::istringstream stream(response);
+    if (procsFd_ < 0) {
+        procsFd_ = open((dir + "/cgroup.procs").c_str(), O_WRONLY | O_CLOEXEC);
+    }
+    if (rootProcsFd_ < 0) {
+        rootProcsFd_ = open((root_ + "/cgroup.procs").c_str(), O_WRONLY | O_CLOEXEC);
+    }
+    if (isCgroup2_ && cgroupFd_ < 0) {
+        cgroupFd_ = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+    if (procsFd_ < 0 || rootProcsFd_ < 0) {
+        spdlog::error("cgroups: could not open cgroup.procs: {}", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void CGroups::removeCgroup()
+{
+    const std::string dir = cgroupDir();
+    if (rootProcsFd_ < 0) {
+        rootProcsFd_ = open((root_ + "/cgroup.procs").c_str(), O_WRONLY | O_CLOEXEC);
+    }
+
+    std::vector<pid_t> pids;
+    std::ifstream in(dir + "/cgroup.procs");
+    pid_t pid;
+    while (in >> pid) {
+        pids.push_back(pid);
+    }
+    in.close();
+
+    if (procsFd_ >= 0) {
+        close(procsFd_);
+        procsFd_ = -1;
+    }
+    if (cgroupFd_ >= 0) {
+        close(cgroupFd_);
+        cgroupFd_ = -1;
+    }
+
+    for (auto p : pids) {
+        restorePid(p);
+    }
+    originalCgroups_.clear();
+
+    if (rmdir(dir.c_str()) != 0 && errno != ENOENT) {
+        spdlog::error("cgroups: could not remove {}: {}", dir, strerror(errno));
+    }
+}
+
+void CGroups::setupRoutingTables(const CMD_SEND_CONNECT_STATUS &connectStatus)
+{
+    mkdir("/etc/iproute2", 0755);
+
+    std::string tables;
+    {
+        std::ifstream in(kRtTablesFile);
+        std::stringstream buf;
+        buf << in.rdbuf();
+        tables = buf.str();
+    }
+    std::ofstream out(kRtTablesFile, std::ios::app);
+    if (!tables.empty() && tables.back() != '\n') {
+        out << "\n";
+    }
+    if (tables.find("69 windscribe\n") == std::string::npos) {
+        out << "69 windscribe\n";
+    }
+    if (tables.find("70 windscribe_include") == std::string::npos) {
+        out << "70 windscribe_include\n";
+    }
+    out.close();
+
+    // independent of each other; some of them fail when a previous instance of the helper left them, which is fine
+    Utils::executeCommands({
+        // separate routing table for the packets with our mark
+        ipCommand({"rule", "add", "fwmark", mark_, "priority", "16384", "table", "windscribe"}),
+        ipCommand({"route", "add", "default", "via", connectStatus.defaultAdapter.gatewayIp, "dev", connectStatus.defaultAdapter.adapterName, "table", "windscribe"}),
+        ipCommand({"route", "add", "10.255.255.0/24", "dev", connectStatus.vpnAdapter.adapterName, "table", "windscribe"}),
+        // separate routing table for the packets that should always go into the tunnel
+        ipCommand({"route", "add", "default", "via", connectStatus.vpnAdapter.gatewayIp, "dev", connectStatus.vpnAdapter.adapterName, "table", "windscribe_include"}),
+        ipCommand({"route", "add", connectStatus.remoteIp, "dev", connectStatus.defaultAdapter.adapterName, "table", "windscribe_include"})
+    });
+}
+
+void CGroups::setupInclusiveRules()
+{
+    // allow the rules to consult the main routing table first, ignoring the /0 and /1 routes
+    Utils::executeCommand("ip", {"rule", "add", "priority", "16383", "table", "main", "suppress_prefixlength", "1"});
+
+    // the priority of the WireGuard rule, if it exists
+    std::string out;
+    Utils::executeCommand("ip", {"rule", "show"}, &out);
+    std::istringstream stream(out);
+    std::string line;
+    int priority = -1;
     while (std::getline(stream, line)) {
-        int pos = line.find("net_cls on ");
-        if (pos == std::string::npos) {
-            continue;
+        if (line.find("51820") != std::string::npos) {
+            priority = atoi(line.c_str());
+            break;
         }
-        // path is from after "net_cls on " until we see " type cgroup"
-        net_cls_root_ = line.substr(pos + 11, line.find(" type cgroup") - 11);
-        return net_cls_root_;
     }
-    return std::string();
+
+    if (priority > 0) {
+        // WireGuard uses the same rule mechanism, just adjust its rule
+        Utils::executeCommand("ip", {"rule", "add", "priority", std::to_string(priority - 1), "table", "main", "suppress_prefixlength", "0"});
+    } else {
+        // for the other protocols, remove the rule forcing the other traffic into the tunnel
+        Utils::executeCommand("ip", {"rule", "del", "priority", "16385", "table", "windscribe_include"});
+    }
 }
 
+void CGroups::clearRoutingTables()
+{
+    Utils::executeCommands({
+        ipCommand({"rule", "del", "priority", "16383", "table", "main", "suppress_prefixlength", "1"}),
+        ipCommand({"rule", "flush", "table", "windscribe"}),
+        ipCommand({"route", "flush", "table", "windscribe"}),
+        ipCommand({"rule", "flush", "table", "windscribe_include"}),
+        ipCommand({"route", "flush", "table", "windscribe_include"})
+    });
+}
+
+bool CGroups::attachSocketMarkProgram()
+{
+    if (bpfProgFd_ >= 0) {
+        return true;
+    }
+    if (cgroupFd_ < 0) {
+        return false;
+    }
+
+    // ((struct bpf_sock *)ctx)->mark = mark; return 1;
+    const __s32 mark = static_cast<__s32>(std::stoul(mark_, nullptr, 16));
+    struct bpf_insn insns[] = {
+        { BPF_ALU | BPF_MOV | BPF_K, BPF_REG_2, 0, 0, mark },
+        { BPF_STX | BPF_MEM | BPF_W, BPF_REG_1, BPF_REG_2, offsetof(struct bpf_sock, mark), 0 },
+        { BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, 1 },
+        { BPF_JMP | BPF_EXIT, 0, 0, 0, 0 },
+    };
+    const char license[] = "GPL";
+
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.prog_type = BPF_PROG_TYPE_CGROUP_SOCK;
+    attr.expected_attach_type = BPF_CGROUP_INET_SOCK_CREATE;
+    attr.insns = reinterpret_cast<__u64>(insns);
+    attr.insn_cnt = sizeof(insns) / sizeof(insns[0]);
+    attr.license = reinterpret_cast<__u64>(license);
+    int progFd = bpf(BPF_PROG_LOAD, &attr);
+    if (progFd < 0) {
+        spdlog::info("cgroups: could not load the socket mark program ({}), the packets are marked by iptables", strerror(errno));
+        return false;
+    }
+
+    memset(&attr, 0, sizeof(attr));
+    attr.target_fd = cgroupFd_;
+    attr.attach_bpf_fd = progFd;
+    attr.attach_type = BPF_CGROUP_INET_SOCK_CREATE;
+    if (bpf(BPF_PROG_ATTACH, &attr) != 0) {
+        spdlog::info("cgroups: could not attach the socket mark program ({}), the packets are marked by iptables", strerror(errno));
+        close(progFd);
+        return false;
+    }
+
+    bpfProgFd_ = progFd;
+    spdlog::debug("cgroups: the sockets are marked by the eBPF program");
+    return true;
+}
+
+void CGroups::detachSocketMarkProgram()
+{
+    if (bpfProgFd_ < 0) {
+        return;
+    }
+
+    if (cgroupFd_ >= 0) {
+        union bpf_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.target_fd = cgroupFd_;
+        attr.attach_bpf_fd = bpfProgFd_;
+        attr.attach_type = BPF_CGROUP_INET_SOCK_CREATE;
+        bpf(BPF_PROG_DETACH, &attr);
+    }
+    close(bpfProgFd_);
+    bpfProgFd_ = -1;
+}
+
+bool CGroups::movePid(int fd, pid_t pid)
+{
+    // one pid per write, the kernel doesn't accept a list
+    const std::string str = std::to_string(pid);
+    return write(fd, str.c_str(), str.size()) == static_cast<ssize_t>(str.size());
+}
+
+void CGroups::restorePid(pid_t pid)
+{
+    const auto it = originalCgroups_.find(pid);
+    if (it != originalCgroups_.end()) {
+        const std::string path = root_ + it->second + "/cgroup.procs";
+        originalCgroups_.erase(it);
+        int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            const bool isMoved = movePid(fd, pid);
+            close(fd);
+            if (isMoved) {
+                return;
+            }
+        }
+        // the original cgroup is gone
+    }
+    if (rootProcsFd_ >= 0) {
+        movePid(rootProcsFd_, pid);
+    }
+}
+
+std::string CGroups::cgroupOfPid(pid_t pid) const
+{
+    // the cgroup2 entry is "0::<path>"
+    std::ifstream in("/proc/" + std::to_string(pid) + "/cgroup");
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 3, "0::") == 0) {
+            return line.substr(3);
+        }
+    }
+    return std::string();
+}
@@ -1,8 +1,17 @@
 #pragma once
 
+#include <map>
+#include <mutex>
 #include <string>
+#include <vector>
 #include "../../../posix_common/helper_commands.h"
 
+// Manages the cgroup of the split tunneling apps without external scripts.
+// The net_cls v1 hierarchy is preferred since it classifies the sockets for the iptables rules by the class id.
+// If net_cls is not available, the cgroup2 hierarchy is used and the iptables rules match the cgroup path instead;
+// in the exclusive mode an eBPF program is attached to the cgroup to mark the sockets on creation, so the packets
+// do not need to be marked by iptables.
+// The cgroup.procs files are kept open while the cgroup exists, so moving a batch of pids costs one write per pid only.
 class CGroups
 {
 public:
@@ -16,19 +25,54 @@ public:
     void disable();
 
     void addApp(pid_t pid);
+    void addApps(const std::vector<pid_t> &pids);
     void removeApp(pid_t pid);
+    void removeApps(const std::vector<pid_t> &pids);
 
     std::string mark() const { return mark_; };
     std::string netClassId() const { return netClassId_; };
 
+    // the option and the value of the iptables cgroup match for the current hierarchy
+    std::string iptablesMatchOption() const;
+    std::string iptablesMatchValue() const;
+    // true if the sockets of the cgroup are marked by the eBPF program
+    bool isSocketMarking() const;
+
 private:
     const std::string mark_ = "0xdecafbad";
     const std::string netClassId_ = "0xcafecafe";
+    const std::string cgroupName_ = "windscribe";
+
+    mutable std::mutex mutex_;
+    bool isMountsRead_;
+    bool isCgroup2_;
+    std::string root_;
+    std::string cgroup2Root_;
 
-    std::string net_cls_root_;
+    bool isEnabled_;
+    int procsFd_;           // cgroup.procs of our cgroup
+    int rootProcsFd_;       // cgroup.procs of the hierarchy root
+    int cgroupFd_;          // our cgroup directory, the eBPF attach target
+    int bpfProgFd_;
+    // cgroup v2 only: the original cgroups of the moved pids, the pids are returned there
+    std::map<pid_t, std::string> originalCgroups_;
 
     CGroups();
     ~CGroups();
 
-    std::string findNetclsRoot();
+    void readMounts();
+    bool prepareHierarchy();
+    bool createCgroup();
+    void removeCgroup();
+    void setupRoutingTables(const CMD_SEND_CONNECT_STATUS &connectStatus);
+    void setupInclusiveRules();
+    void clearRoutingTables();
+
+    bool attachSocketMarkProgram();
+    void detachSocketMarkProgram();
+
+    bool movePid(int fd, pid_t pid);
+    void restorePid(pid_t pid);
+    std::string cgroupOfPid(pid_t pid) const;
+    std::string cgroupDir() const { return root_ + "/" + cgroupName_; }
 };
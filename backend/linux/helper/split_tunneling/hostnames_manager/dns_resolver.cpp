@@ -1,11 +1,13 @@
 #include "dns_resolver.h"
+#include <algorithm>
 #include <spdlog/spdlog.h>
 
 using namespace wsnet;
 
 DnsResolver::DnsResolver(std::function<void (std::map<std::string, HostInfo>)> resolveDomainsCallback) :
     resolveDomainsCallback_(resolveDomainsCallback),
-    work_(boost::asio::make_work_guard(io_service_))
+    work_(boost::asio::make_work_guard(io_service_)),
+    random_(std::random_device()())
 {
     if (!WSNet::initialize("", "", "", "", "", "", false, "en", "")) {
         spdlog::error("WSNet::initialize failed");
@@ -24,19 +26,34 @@ DnsResolver::~DnsResolver()
     WSNet::cleanup();
 }
 
+void DnsResolver::lookup(const std::string &hostname)
+{
+    using namespace std::placeholders;
+    auto request = WSNet::instance()->dnsResolver()->lookup(hostname, curRequestId_, std::bind(&DnsResolver::onDnsResolved, this, _1, _2, _3));
+    activeRequests_.insert(std::make_pair(curRequestId_, request));
+    curRequestId_++;
+}
+
 void DnsResolver::onDnsResolved(uint64_t requestId, const std::string &hostname, std::shared_ptr<wsnet::WSNetDnsRequestResult> result)
 {
     boost::asio::post(io_service_,[this, requestId, hostname, result] {
         auto request = activeRequests_.find(requestId);
         if (request == activeRequests_.end())
             return;
+        activeRequests_.erase(request);
 
         HostInfo hi;
         hi.hostname = hostname;
         hi.addresses = result->ips();
+        hi.ttl = result->ttl();
         hi.error = result->isError();
+
+        if (isTracking_) {
+            onRefreshed(hi);
+            return;
+        }
+
         results_[hostname] = hi;
-        activeRequests_.erase(request);
         if (activeRequests_.empty()) {
             // check if there were failed requests
             bool bWasFailedRequests = false;
@@ -52,6 +69,7 @@ void DnsResolver::onDnsResolved(uint64_t requestId, const std::string &hostname,
                 timer_->async_wait(std::bind(&DnsResolver::onTimer, this, std::placeholders::_1));
             } else {
                 resolveDomainsCallback_(results_);
+                startTracking();
             }
         }
     });
@@ -64,18 +82,68 @@ void DnsResolver::onTimer(const boost::system::error_code &error)
         // repeat failed requests if the timeout allows
         if (sinceHelper(startTime_).count() >= kMaxTimeoutMs) {
             resolveDomainsCallback_(results_);
+            startTracking();
         } else {
             for (const auto &it: results_) {
                 if (it.second.error) {
-                    using namespace std::placeholders;
-                    auto request = WSNet::instance()->dnsResolver()->lookup(it.first, curRequestId_, std::bind(&DnsResolver::onDnsResolved, this, _1, _2, _3));
-                    activeRequests_.insert(std::make_pair(curRequestId_, request));
+                    lookup(it.first);
                 }
             }
         }
     }
 }
 
+void DnsResolver::onRefreshed(const HostInfo &hi)
+{
+    auto it = results_.find(hi.hostname);
+    if (it == results_.end())
+        return;
+
+    if (hi.error) {
+        // keep the last known addresses, they are more likely to be right than nothing
+        spdlog::debug("DnsResolver: failed to refresh {}", hi.hostname);
+        scheduleRefresh(hi.hostname, kFailedRefreshS);
+        return;
+    }
+
+    std::vector<std::string> oldAddresses = it->second.addresses;
+    std::vector<std::string> newAddresses = hi.addresses;
+    std::sort(oldAddresses.begin(), oldAddresses.end());
+    std::sort(newAddresses.begin(), newAddresses.end());
+    const bool isChanged = it->second.error || oldAddresses != newAddresses;
+
+    it->second = hi;
+    scheduleRefresh(hi.hostname, hi.ttl);
+    if (isChanged) {
+        spdlog::debug("DnsResolver: the addresses of {} changed", hi.hostname);
+        resolveDomainsCallback_(results_);
+    }
+}
+
+void DnsResolver::startTracking()
+{
+    isTracking_ = true;
+    for (const auto &it : results_) {
+        scheduleRefresh(it.first, it.second.error ? kFailedRefreshS : it.second.ttl);
+    }
+}
+
+void DnsResolver::scheduleRefresh(const std::string &hostname, std::uint32_t intervalS)
+{
+    intervalS = std::clamp(intervalS, kMinRefreshS, kMaxRefreshS);
+    const int jitterMs = std::uniform_int_distribution<int>(0, kMaxJitterMs)(random_);
+
+    auto &timer = refreshTimers_[hostname];
+    if (!timer)
+        timer = std::make_unique<boost::asio::steady_timer>(io_service_);
+    timer->expires_after(std::chrono::seconds(intervalS) + std::chrono::milliseconds(jitterMs));
+    timer->async_wait([this, hostname](const boost::system::error_code &error) {
+        // the timer may have expired right before cancelAll()
+        if (error.value() == 0 && isTracking_ && refreshTimers_.find(hostname) != refreshTimers_.end())
+            lookup(hostname);
+    });
+}
+
 void DnsResolver::resolveDomains(const std::vector<std::string> &hostnames)
 {
     timer_.reset();
@@ -83,11 +151,11 @@ void DnsResolver::resolveDomains(const std::vector<std::string> &hostnames)
 
     boost::asio::post(io_service_, [this, hostnames] {
         startTime_ = std::chrono::steady_clock::now();
+        if (hostnames.empty())
+            return;
+        // all the lookups are in flight at once
         for (const auto &hostname : hostnames) {
-            using namespace std::placeholders;
-            auto request = WSNet::instance()->dnsResolver()->lookup(hostname, curRequestId_, std::bind(&DnsResolver::onDnsResolved, this, _1, _2, _3));
-            activeRequests_.insert(std::make_pair(curRequestId_, request));
-            curRequestId_++;
+            lookup(hostname);
         }
     });
 }
@@ -98,6 +166,10 @@ void DnsResolver::cancelAll()
         for (auto &request : activeRequests_)
             request.second->cancel();
         activeRequests_.clear();
+        for (auto &timer : refreshTimers_)
+            timer.second->cancel();
+        refreshTimers_.clear();
         results_.clear();
+        isTracking_ = false;
     });
 }
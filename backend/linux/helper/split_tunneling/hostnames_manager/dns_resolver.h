@@ -2,7 +2,9 @@
 
 #include <string>
 #include <map>
+#include <memory>
 #include <optional>
+#include <random>
 #include <wsnet/WSNet.h>
 #include <boost/asio.hpp>
 
@@ -17,6 +19,10 @@ auto sinceHelper(std::chrono::time_point<clock_t, duration_t> const& start)
     return std::chrono::duration_cast<result_t>(clock_t::now() - start);
 }
 
+// Resolves the hostnames concurrently and keeps tracking them: every hostname is resolved again when its DNS TTL
+// expires (with a jitter, so the hostnames with the same TTL are not refreshed at once).
+// The callback is called with all the results once the initial resolution is done, and then every time
+// the addresses of a hostname change.
 class DnsResolver
 {
 public:
@@ -25,6 +31,7 @@ public:
     {
         std::string hostname;
         std::vector<std::string> addresses;
+        std::uint32_t ttl = 0;  // seconds
         bool error = false;
     };
 
@@ -41,6 +48,12 @@ private:
     static constexpr int kMaxTimeoutMs = 10 * 1000;
     // time after which to repeat failed requests
     static constexpr int kRetryTimeoutMs = 500;
+    // the bounds of the refresh interval, regardless of the TTL
+    static constexpr std::uint32_t kMinRefreshS = 10;
+    static constexpr std::uint32_t kMaxRefreshS = 60 * 60;
+    // the refresh interval of the hostnames which failed to resolve
+    static constexpr std::uint32_t kFailedRefreshS = 60;
+    static constexpr int kMaxJitterMs = 2000;
 
     std::function<void(std::map<std::string, HostInfo>)> resolveDomainsCallback_;
     boost::asio::io_service io_service_;
@@ -52,9 +65,17 @@ private:
     std::map<uint64_t, std::shared_ptr<wsnet::WSNetCancelableCallback>> activeRequests_;
     std::map<std::string, HostInfo> results_;
 
+    // false until the initial resolution of all the hostnames is done
+    bool isTracking_ = false;
+    std::map<std::string, std::unique_ptr<boost::asio::steady_timer>> refreshTimers_;
+    std::mt19937 random_;
+
     std::chrono::time_point<std::chrono::steady_clock> startTime_;
 
+    void lookup(const std::string &hostname);
     void onDnsResolved(std::uint64_t requestId, const std::string &hostname, std::shared_ptr<wsnet::WSNetDnsRequestResult> result);
     void onTimer(const boost::system::error_code& error);
+    void onRefreshed(const HostInfo &hi);
+    void startTracking();
+    void scheduleRefresh(const std::string &hostname, std::uint32_t intervalS);
 };
-
@@ -1,6 +1,9 @@
 #include "hostnames_manager.h"
 
+#include <algorithm>
+#include <iterator>
 #include <spdlog/spdlog.h>
+#include "../../command_dispatcher.h"
 #include "../../firewallcontroller.h"
 
 HostnamesManager::HostnamesManager(): isEnabled_(false),
@@ -21,6 +24,8 @@ void HostnamesManager::enable(const std::string &gatewayIp)
         ipRoutes_.clear();
         ipRoutes_.setIps(gatewayIp_, ipsLatest_);
         FirewallController::instance().setSplitTunnelIpExceptions(ipsLatest_);
+        appliedIps_ = std::set<std::string>(ipsLatest_.begin(), ipsLatest_.end());
+        resolvedIps_.clear();
         isEnabled_ = true;
     }
 
@@ -37,6 +42,7 @@ void HostnamesManager::disable()
             return;
         }
         ipRoutes_.clear();
+        appliedIps_.clear();
         isEnabled_ = false;
     }
     dnsResolver_.cancelAll();
@@ -52,31 +58,57 @@ void HostnamesManager::setSettings(const std::vector<std::string> &ips, const st
 
 void HostnamesManager::dnsResolverCallback(std::map<std::string, DnsResolver::HostInfo> hostInfos)
 {
-    std::lock_guard<std::recursive_mutex> guard(mutex_);
-
-    std::vector<std::string> hostsIps;
+    std::set<std::string> resolvedIps;
 
     for (auto it = hostInfos.begin(); it != hostInfos.end(); ++it) {
         if (!it->second.error) {
-            for (const auto addr : it->second.addresses) {
+            for (const auto &addr : it->second.addresses) {
                 if (addr == "0.0.0.0") {
                     // ROBERT sometimes will give us an address of 0.0.0.0 for a 'blocked' resource.  This is not a valid address.
                     spdlog::debug("IpHostnamesManager::dnsResolverCallback(), Resolved : {}, IP: 0.0.0.0 (Ignored)", it->first);
                 } else {
-                    spdlog::debug("IpHostnamesManager::dnsResolverCallback(), Resolved : {}, IP: {}", it->first, addr);
-                    hostsIps.insert(hostsIps.end(), addr);
+                    spdlog::debug("IpHostnamesManager::dnsResolverCallback(), Resolved : {}, IP: {}, TTL: {}", it->first, addr, it->second.ttl);
+                    resolvedIps.insert(addr);
                 }
             }
-            hostsIps.insert(hostsIps.end(), it->second.addresses.begin(), it->second.addresses.end());
         } else {
             spdlog::debug("HostnamesManager::dnsResolverCallback(), Failed resolve : {}", it->first);
         }
     }
 
-    hostsIps.insert(hostsIps.end(), ipsLatest_.begin(), ipsLatest_.end());
+    {
+        std::lock_guard<std::recursive_mutex> guard(mutex_);
+        resolvedIps_ = std::move(resolvedIps);
+    }
+
+    // this is the resolver thread, the routes and the firewall are changed under the same domain locks as
+    // the helper commands take. The task applies the latest addresses, so the order of the tasks does not matter.
+    CommandDispatcher::instance().post(CommandDispatcher::kSplitTunneling | CommandDispatcher::kFirewall | CommandDispatcher::kRoutes,
+                                       [this]() { applyResolvedIps(); });
+}
+
+void HostnamesManager::applyResolvedIps()
+{
+    std::lock_guard<std::recursive_mutex> guard(mutex_);
+
+    if (!isEnabled_) {
+        return;
+    }
+
+    std::set<std::string> hostsIps(ipsLatest_.begin(), ipsLatest_.end());
+    hostsIps.insert(resolvedIps_.begin(), resolvedIps_.end());
 
-    if (isEnabled_) {
-        ipRoutes_.setIps(gatewayIp_, hostsIps);
-        FirewallController::instance().setSplitTunnelIpExceptions(hostsIps);
+    // the resolver calls back on every refresh that changed some addresses, apply only the difference
+    std::vector<std::string> added;
+    std::set_difference(hostsIps.begin(), hostsIps.end(), appliedIps_.begin(), appliedIps_.end(), std::back_inserter(added));
+    std::vector<std::string> removed;
+    std::set_difference(appliedIps_.begin(), appliedIps_.end(), hostsIps.begin(), hostsIps.end(), std::back_inserter(removed));
+    if (added.empty() && removed.empty()) {
+        return;
     }
+    spdlog::debug("HostnamesManager::applyResolvedIps(), {} addresses added, {} removed", added.size(), removed.size());
+
+    ipRoutes_.setIps(gatewayIp_, std::vector<std::string>(hostsIps.begin(), hostsIps.end()));
+    FirewallController::instance().updateSplitTunnelIpExceptions(added, removed);
+    appliedIps_ = std::move(hostsIps);
 }
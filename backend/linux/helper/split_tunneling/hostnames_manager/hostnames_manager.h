@@ -1,5 +1,6 @@
 #pragma once
 
+#include <set>
 #include "dns_resolver.h"
 #include "ip_routes.h"
 
@@ -25,7 +26,12 @@ private:
     std::vector<std::string> hostsLatest_;
 
     std::string gatewayIp_;
+    // the latest addresses of the hostnames from the resolver
+    std::set<std::string> resolvedIps_;
+    // the addresses currently applied to the routes and the firewall
+    std::set<std::string> appliedIps_;
 
     void dnsResolverCallback(std::map<std::string, DnsResolver::HostInfo> hostInfos);
+    void applyResolvedIps();
 };
 
@@ -24,11 +24,14 @@ void IpRoutes::setIps(const std::string &defaultRouteIp, const std::vector<std::
         }
     }
 
+    // the route commands of different addresses are independent, run them concurrently
+    std::vector<std::string> cmds;
+
     // delete routes
     for (auto ip = ipsDelete.begin(); ip != ipsDelete.end(); ++ip) {
         auto fr = activeRoutes_.find(*ip);
         if (fr != activeRoutes_.end()) {
-            deleteRoute(fr->second);
+            cmds.push_back(deleteRouteCmd(fr->second));
             activeRoutes_.erase(fr);
         }
     }
@@ -42,32 +45,42 @@ void IpRoutes::setIps(const std::string &defaultRouteIp, const std::vector<std::
             RouteDescr rd;
             rd.ip = *ip;
             rd.defaultRouteIp = defaultRouteIp;
-            addRoute(rd);
+            cmds.push_back(addRouteCmd(rd));
             activeRoutes_[*ip] = rd;
         }
     }
+
+    executeCmds(cmds);
 }
 
 void IpRoutes::clear()
 {
     std::lock_guard<std::recursive_mutex> guard(mutex_);
+    std::vector<std::string> cmds;
     for (auto it = activeRoutes_.begin(); it != activeRoutes_.end(); ++it) {
-        deleteRoute(it->second);
+        cmds.push_back(deleteRouteCmd(it->second));
     }
     activeRoutes_.clear();
+    executeCmds(cmds);
 }
 
-void IpRoutes::addRoute(const RouteDescr &rd)
+std::string IpRoutes::addRouteCmd(const RouteDescr &rd)
 {
-    std::string cmd = "ip route add " + rd.ip + " via " + rd.defaultRouteIp;
-    spdlog::info("cmd: {}", cmd);
+    return "ip route add " + rd.ip + " via " + rd.defaultRouteIp;
+}
 
-    Utils::executeCommand(cmd);
+std::string IpRoutes::deleteRouteCmd(const RouteDescr &rd)
+{
+    return "ip route del " + rd.ip + " via " + rd.defaultRouteIp;
 }
 
-void IpRoutes::deleteRoute(const RouteDescr &rd)
+void IpRoutes::executeCmds(const std::vector<std::string> &cmds)
 {
-    std::string cmd = "ip route del " + rd.ip + " via " + rd.defaultRouteIp;
-    spdlog::info("cmd: {}", cmd);
-    Utils::executeCommand(cmd);
+    if (cmds.empty()) {
+        return;
+    }
+    for (const auto &cmd : cmds) {
+        spdlog::info("cmd: {}", cmd);
+    }
+    Utils::executeCommands(cmds);
 }
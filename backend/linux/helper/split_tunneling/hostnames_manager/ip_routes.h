@@ -23,6 +23,7 @@ private:
 
     std::map<std::string, RouteDescr> activeRoutes_;
 
-    void addRoute(const RouteDescr &rd);
-    void deleteRoute(const RouteDescr &rd);
+    static std::string addRouteCmd(const RouteDescr &rd);
+    static std::string deleteRouteCmd(const RouteDescr &rd);
+    void executeCmds(const std::vector<std::string> &cmds);
 };
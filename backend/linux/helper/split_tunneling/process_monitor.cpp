@@ -93,17 +93,22 @@ ProcessMonitor::~ProcessMonitor()
 void ProcessMonitor::setApps(const std::vector<std::string> &apps)
 {
     if (isEnabled_) {
+        std::vector<std::string> added;
         for (auto app : apps) {
             if (std::find(apps_.begin(), apps_.end(), app) == apps_.end()) {
-                addApp(app);
+                added.push_back(app);
             }
         }
 
+        std::vector<std::string> removed;
         for (auto app : apps_) {
             if (std::find(apps.begin(), apps.end(), app) == apps.end()) {
-                removeApp(app);
+                removed.push_back(app);
             }
         }
+
+        addApps(added);
+        removeApps(removed);
     }
 
     apps_ = apps;
@@ -132,9 +137,7 @@ bool ProcessMonitor::enable()
         return false;
     }
 
-    for (auto app : apps_) {
-        addApp(app);
-    }
+    addApps(apps_);
     isEnabled_ = true;
     return true;
 }
@@ -152,23 +155,28 @@ void ProcessMonitor::disable()
     isEnabled_ = false;
 }
 
-void ProcessMonitor::addApp(const std::string &exe) {
-    spdlog::info("process monitor add app: {}", exe);
-    std::vector<pid_t> pids = findPids(exe);
-    for (auto pid : pids) {
-        CGroups::instance().addApp(pid);
+void ProcessMonitor::addApps(const std::vector<std::string> &exes) {
+    if (exes.empty()) {
+        return;
+    }
+    for (auto exe : exes) {
+        spdlog::info("process monitor add app: {}", exe);
     }
+    CGroups::instance().addApps(findPids(exes));
 }
 
-void ProcessMonitor::removeApp(const std::string &exe) {
-    spdlog::info("process monitor remove app: {}", exe);
-    std::vector<pid_t> pids = findPids(exe);
-    for (auto pid : pids) {
-        CGroups::instance().removeApp(pid);
+void ProcessMonitor::removeApps(const std::vector<std::string> &exes) {
+    if (exes.empty()) {
+        return;
+    }
+    for (auto exe : exes) {
+        spdlog::info("process monitor remove app: {}", exe);
     }
+    CGroups::instance().removeApps(findPids(exes));
 }
 
-std::vector<pid_t> ProcessMonitor::findPids(const std::string &exe)
+// one pass over /proc for all the apps
+std::vector<pid_t> ProcessMonitor::findPids(const std::vector<std::string> &exes)
 {
     std::vector<pid_t> pids;
 
@@ -184,7 +192,7 @@ std::vector<pid_t> ProcessMonitor::findPids(const std::string &exe)
     while ((ep = readdir(dp))) {
         // numeric directories are pids in /proc
         if (ep->d_type == DT_DIR && ep->d_name[0] >= '0' && ep->d_name[0] <= '9') {
-            if (compareCmd(std::stoi(ep->d_name), {exe})) {
+            if (compareCmd(std::stoi(ep->d_name), exes)) {
                 pids.push_back(std::stoi(ep->d_name));
             }
         }
@@ -30,9 +30,9 @@ private:
     ProcessMonitor();
     ~ProcessMonitor();
 
-    void addApp(const std::string &exe);
-    void removeApp(const std::string &exe);
-    std::vector<pid_t> findPids(const std::string &exe);
+    void addApps(const std::vector<std::string> &exes);
+    void removeApps(const std::vector<std::string> &exes);
+    std::vector<pid_t> findPids(const std::vector<std::string> &exes);
     std::string getCmdByPid(pid_t pid);
 
     void selfTest();
@@ -1,5 +1,5 @@
 #include "utils.h"
-#include "3rdparty/pstream.h"
+#include "process_executor.h"
 
 #include <arpa/inet.h>
 #include <cstring>
@@ -14,9 +14,8 @@
 namespace Utils
 {
 
-// based on 3rd party lib (http://pstreams.sourceforge.net/)
 int executeCommand(const std::string &cmd, const std::vector<std::string> &args,
-                   std::string *pOutputStr, bool appendFromStdErr)
+                   std::string *pOutputStr, bool appendFromStdErr, int timeoutMs)
 {
     std::string cmdLine = cmd;
 
@@ -30,33 +29,27 @@ int executeCommand(const std::string &cmd, const std::vector<std::string> &args,
         pOutputStr->clear();
     }
 
-    redi::ipstream proc(cmdLine, redi::pstreams::pstdout | redi::pstreams::pstderr);
-    std::string line;
-    // read child's stdout
-    while (std::getline(proc.out(), line)) {
-        if (pOutputStr) {
-            *pOutputStr += line + "\n";
-        }
-    }
-    // if reading stdout stopped at EOF then reset the state:
-    if (proc.eof() && proc.fail()) {
-        proc.clear();
-    }
-
-    if (appendFromStdErr) {
-        // read child's stderr
-        while (std::getline(proc.err(), line)) {
-            if (pOutputStr) {
-                *pOutputStr += line + "\n";
-            }
-        }
+    ProcessExecutor::Options options;
+    options.timeoutMs = timeoutMs;
+    options.isCaptureOutput = pOutputStr != nullptr;
+    options.appendFromStdErr = appendFromStdErr;
+    ProcessExecutor::Result result = ProcessExecutor::instance().execute(cmdLine, options);
+    if (pOutputStr) {
+        *pOutputStr = std::move(result.output);
     }
+    return result.status;
+}
 
-    proc.close();
-    if (proc.rdbuf()->exited()) {
-        return proc.rdbuf()->status();
+std::vector<int> executeCommands(const std::vector<std::string> &cmds)
+{
+    std::vector<int> statuses;
+    ProcessExecutor::Options options;
+    options.isCaptureOutput = false;
+    const std::vector<ProcessExecutor::Result> results = ProcessExecutor::instance().executeAll(cmds, options);
+    for (const auto &result : results) {
+        statuses.push_back(result.status);
     }
-    return 0;
+    return statuses;
 }
 
 
@@ -222,12 +215,12 @@ std::string normalizeAddress(const std::string &address)
 bool isMacAddressSpoofed(const std::string &network)
 {
     std::string output;
-    int ret = Utils::executeCommand("nmcli", {"-g", "802-11-wireless.cloned-mac-address", "connection", "show", network.c_str()}, &output);
+    int ret = Utils::executeCommand("nmcli", {"-g", "802-11-wireless.cloned-mac-address", "connection", "show", network.c_str()}, &output, true, Utils::kCommandTimeoutMs);
     spdlog::info("Wireless MAC for network: {}: {}", network, output);
     if (ret == 0 && !output.empty() && output.rfind("preserve", 0) == std::string::npos) {
         return true;
     }
-    ret = Utils::executeCommand("nmcli", {"-g", "802-3-ethernet.cloned-mac-address", "connection", "show", network.c_str()}, &output);
+    ret = Utils::executeCommand("nmcli", {"-g", "802-3-ethernet.cloned-mac-address", "connection", "show", network.c_str()}, &output, true, Utils::kCommandTimeoutMs);
     spdlog::info("Wired MAC for network: {}: {}", network.c_str(), output);
     if (ret == 0 && !output.empty() && output.rfind("preserve", 0) == std::string::npos) {
         return true;
@@ -320,7 +313,7 @@ bool resetMacAddresses(const std::string &ignoreNetwork)
     std::string output;
     std::string line;
     bool firstline = true;
-    Utils::executeCommand("nmcli", {"--fields", "state,name", "connection", "show"}, &output);
+    Utils::executeCommand("nmcli", {"--fields", "state,name", "connection", "show"}, &output, true, Utils::kCommandTimeoutMs);
 
     std::stringstream is(output);
     while (std::getline(is, line)) {
@@ -348,13 +341,13 @@ bool resetMacAddresses(const std::string &ignoreNetwork)
             continue;
         }
 
-        Utils::executeCommand("nmcli", {"connection", "modify", name.c_str(), "wifi.cloned-mac-address", "preserve"}, &output);
-        Utils::executeCommand("nmcli", {"connection", "modify", name.c_str(), "ethernet.cloned-mac-address", "preserve"}, &output);
+        Utils::executeCommand("nmcli", {"connection", "modify", name.c_str(), "wifi.cloned-mac-address", "preserve"}, &output, true, Utils::kCommandTimeoutMs);
+        Utils::executeCommand("nmcli", {"connection", "modify", name.c_str(), "ethernet.cloned-mac-address", "preserve"}, &output, true, Utils::kCommandTimeoutMs);
 
         spdlog::info("Reset MAC addresses: {} (state = {})", name, state);
 
         if (state == "activated") {
-            Utils::executeCommand("nmcli", {"connection", "up", name.c_str()});
+            Utils::executeCommand("nmcli", {"connection", "up", name.c_str()}, nullptr, true, Utils::kCommandTimeoutMs);
         }
     }
 #endif
@@ -10,10 +10,17 @@
 
 namespace Utils
 {
+    // for the commands which may hang, e.g. on an unresponsive NetworkManager
+    constexpr int kCommandTimeoutMs = 30000;
+
     // execute cmd with args and return output from stdout and stderror to pOutputStr (if pOutputStr != NULL)
+    // timeoutMs = 0 means no timeout, the process group is killed on timeout
     int executeCommand(const std::string &cmd,
                        const std::vector<std::string> &args = std::vector<std::string>(),
-                       std::string *pOutputStr = nullptr, bool appendFromStdErr = true);
+                       std::string *pOutputStr = nullptr, bool appendFromStdErr = true, int timeoutMs = 0);
+
+    // execute independent commands concurrently, returns the exit statuses in the order of the commands
+    std::vector<int> executeCommands(const std::vector<std::string> &cmds);
 
     // find case insensitive sub string in a given substring
     size_t findCaseInsensitive(std::string data, std::string toSearch, size_t pos = 0);
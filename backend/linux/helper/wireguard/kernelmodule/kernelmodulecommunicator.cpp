@@ -23,7 +23,7 @@ bool KernelModuleCommunicator::stop()
 #ifndef CLI_ONLY
     // Bring down utun420 via nmcli first, or NetworkManager/GNOME may throw up a scary looking "error".
     // This is a workaround for #996; this is not really our bug but it's a bad user experience otherwise.
-    Utils::executeCommand("nmcli", {"con", "down", deviceName_.c_str()});
+    Utils::executeCommand("nmcli", {"con", "down", deviceName_.c_str()}, nullptr, true, Utils::kCommandTimeoutMs);
 #endif
 
     wg_del_device(deviceName_.c_str());
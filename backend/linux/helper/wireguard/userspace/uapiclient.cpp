@@ -0,0 +1,231 @@
+#include "uapiclient.h"
+
+#include <charconv>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <spdlog/spdlog.h>
+
+namespace
+{
+template<typename T>
+T toValue(std::string_view str)
+{
+    T value = 0;
+    std::from_chars(str.data(), str.data() + str.size(), value);
+    return value;
+}
+}  // namespace
+
+UapiClient::UapiClient(const std::string &deviceName)
+    : path_("/var/run/wireguard/" + deviceName + ".sock"), socket_(-1), bufferPos_(0), bufferEnd_(0)
+{
+}
+
+UapiClient::~UapiClient()
+{
+    disconnect();
+}
+
+UapiClient::Status UapiClient::connect()
+{
+    if (socket_ >= 0)
+        return Status::OK;
+
+    Status status = Status::NO_ACCESS;
+    int attempt = 0;
+    do {
+        if (connectOnce(&status))
+            break;
+        if (status != Status::NO_SOCKET || socket_ >= 0)
+            break;
+        if (++attempt < kConnectionAttemptCount)
+            usleep(kConnectionBetweenWaitMs * 1000);
+    } while (attempt < kConnectionAttemptCount);
+    return socket_ >= 0 ? Status::OK : status;
+}
+
+void UapiClient::disconnect()
+{
+    if (socket_ >= 0) {
+        close(socket_);
+        socket_ = -1;
+    }
+    bufferPos_ = bufferEnd_ = 0;
+}
+
+bool UapiClient::get(DeviceStatus *status)
+{
+    if (socket_ < 0 || !writeAll("get=1\n\n"))
+        return false;
+
+    *status = DeviceStatus();
+    return readReply([status](std::string_view key, std::string_view value) {
+        if (key == "public_key") {
+            // starts the next peer section
+            status->peers.emplace_back();
+            status->peers.back().publicKey = value;
+        } else if (!status->peers.empty() && key == "endpoint") {
+            status->peers.back().endpoint = value;
+        } else if (!status->peers.empty() && key == "rx_bytes") {
+            status->peers.back().rxBytes = toValue<unsigned long long>(value);
+        } else if (!status->peers.empty() && key == "tx_bytes") {
+            status->peers.back().txBytes = toValue<unsigned long long>(value);
+        } else if (!status->peers.empty() && key == "last_handshake_time_sec") {
+            status->peers.back().lastHandshakeTimeSec = toValue<unsigned long long>(value);
+        } else if (!status->peers.empty() && key == "allowed_ip") {
+            status->peers.back().allowedIpsCount++;
+        } else if (key == "listen_port") {
+            status->isListening = true;
+            status->listenPort = toValue<uint16_t>(value);
+        } else if (key == "fwmark") {
+            status->fwmark = toValue<uint32_t>(value);
+        } else if (key == "errno") {
+            status->errorCode = toValue<unsigned int>(value);
+        }
+    });
+}
+
+bool UapiClient::set(const std::string &body, unsigned int *errorCode)
+{
+    if (socket_ < 0 || !writeAll("set=1\n" + body + "\n"))
+        return false;
+
+    unsigned int err = 0;
+    bool success = readReply([&err](std::string_view key, std::string_view value) {
+        if (key == "errno")
+            err = toValue<unsigned int>(value);
+    });
+    if (errorCode)
+        *errorCode = err;
+    return success;
+}
+
+bool UapiClient::connectOnce(Status *status)
+{
+    struct stat sbuf;
+    auto ret = stat(path_.c_str(), &sbuf);
+    if (ret < 0) {
+        // Socket is not available, don't attempt to reconnect.
+        *status = Status::NO_SOCKET;
+        return false;
+    }
+    if (!S_ISSOCK(sbuf.st_mode)) {
+        errno = EBADF;
+        spdlog::error("File is not a socket: {}", path_);
+        // Socket is bad, don't attempt to reconnect.
+        *status = Status::NO_ACCESS;
+        return false;
+    }
+
+    struct sockaddr_un addr;
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path_.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        spdlog::error("Failed to open the socket: {}", path_);
+        // Socket cannot be opened, don't attempt to reconnect.
+        *status = Status::NO_ACCESS;
+        return false;
+    }
+    ret = ::connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+    if (ret < 0) {
+        spdlog::error("Failed to connect to the socket: {}", path_);
+        bool do_retry = errno != EACCES;
+        if (errno == ECONNREFUSED)
+            unlink(path_.c_str());
+        close(fd);
+        // the caller retries if the socket is reported as not available yet
+        *status = do_retry ? Status::NO_SOCKET : Status::NO_ACCESS;
+        return false;
+    }
+
+    // the socket is non-blocking, the timeouts are handled with poll()
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    socket_ = fd;
+    bufferPos_ = bufferEnd_ = 0;
+    *status = Status::OK;
+    return true;
+}
+
+bool UapiClient::writeAll(const std::string &data)
+{
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t ret = send(socket_, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+        if (ret < 0) {
+            if ((errno == EAGAIN || errno == EWOULDBLOCK) && waitSocket(POLLOUT))
+                continue;
+            if (errno == EINTR)
+                continue;
+            spdlog::error("UapiClient: write to the socket failed: {}", errno);
+            disconnect();
+            return false;
+        }
+        written += static_cast<size_t>(ret);
+    }
+    return true;
+}
+
+bool UapiClient::waitSocket(short events)
+{
+    struct pollfd pfd = { socket_, events, 0 };
+    int ret;
+    do {
+        ret = poll(&pfd, 1, kIoTimeoutMs);
+    } while (ret < 0 && errno == EINTR);
+    return ret > 0;
+}
+
+bool UapiClient::readReply(const KeyValueHandler &handler)
+{
+    // the state machine: the key is collected until '=', the value until '\n', an empty line ends the reply
+    enum class State { kKey, kValue };
+    State state = State::kKey;
+    std::string key, value;
+
+    for (;;) {
+        if (bufferPos_ == bufferEnd_) {
+            ssize_t ret = recv(socket_, buffer_, kBufferSize, 0);
+            if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+                if (errno == EINTR || waitSocket(POLLIN))
+                    continue;
+                spdlog::error("UapiClient: timeout while reading the reply");
+                disconnect();
+                return false;
+            }
+            if (ret <= 0) {
+                // the connection was closed by the daemon
+                disconnect();
+                return false;
+            }
+            bufferPos_ = 0;
+            bufferEnd_ = static_cast<size_t>(ret);
+        }
+
+        while (bufferPos_ < bufferEnd_) {
+            const char c = buffer_[bufferPos_++];
+            if (c == '\n') {
+                if (state == State::kKey && key.empty())
+                    return true;
+                if (state == State::kValue)
+                    handler(key, value);
+                state = State::kKey;
+                key.clear();
+                value.clear();
+            } else if (state == State::kKey) {
+                if (c == '=')
+                    state = State::kValue;
+                else
+                    key.push_back(c);
+            } else {
+                value.push_back(c);
+            }
+        }
+    }
+}
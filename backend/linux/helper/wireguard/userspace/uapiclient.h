@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Client of the wireguard-go UAPI socket (https://www.wireguard.com/xplatform/).
+// Keeps one connection open for all the requests, reads the replies in chunks from a non-blocking socket and
+// parses them with a streaming key=value state machine, without building the whole reply first.
+class UapiClient
+{
+public:
+    enum class Status { OK, NO_SOCKET, NO_ACCESS };
+
+    struct PeerStats
+    {
+        std::string publicKey;
+        std::string endpoint;
+        unsigned long long rxBytes = 0;
+        unsigned long long txBytes = 0;
+        unsigned long long lastHandshakeTimeSec = 0;
+        unsigned int allowedIpsCount = 0;
+    };
+
+    struct DeviceStatus
+    {
+        unsigned int errorCode = 0;     // the errno value of the reply
+        bool isListening = false;       // listen_port is reported
+        uint16_t listenPort = 0;
+        uint32_t fwmark = 0;
+        std::vector<PeerStats> peers;
+    };
+
+    explicit UapiClient(const std::string &deviceName);
+    ~UapiClient();
+
+    // connects if not connected yet
+    Status connect();
+    void disconnect();
+    bool isConnected() const { return socket_ >= 0; }
+
+    // get=1 transaction
+    bool get(DeviceStatus *status);
+    // one set=1 transaction with all the "key=value\n" lines of the body sent in a single write
+    bool set(const std::string &body, unsigned int *errorCode);
+
+private:
+    static constexpr int kConnectionAttemptCount = 5;
+    static constexpr int kConnectionBetweenWaitMs = 100;
+    static constexpr int kIoTimeoutMs = 2000;
+    static constexpr size_t kBufferSize = 4096;
+
+    using KeyValueHandler = std::function<void(std::string_view key, std::string_view value)>;
+
+    bool connectOnce(Status *status);
+    bool writeAll(const std::string &data);
+    bool waitSocket(short events);
+    // parses the reply until the empty line, calls the handler for each key=value line
+    bool readReply(const KeyValueHandler &handler);
+
+    std::string path_;
+    int socket_;
+    char buffer_[kBufferSize];
+    size_t bufferPos_;
+    size_t bufferEnd_;
+};
@@ -3,141 +3,14 @@
 #include "../../../../posix_common/helper_commands.h"
 #include "../../execute_cmd.h"
 #include "../../utils.h"
-#include <codecvt>
-#include <regex>
-#include <type_traits>
-#include <boost/algorithm/string/trim.hpp>
-#include <sys/socket.h>
-#include <sys/stat.h>
 #include <sys/time.h>
-#include <sys/un.h>
 #include <spdlog/spdlog.h>
 
-namespace
+UapiClient::Status WireGuardGoCommunicator::connectUapi()
 {
-template<typename T>
-T stringToValueImpl(const std::string &str)
-{
-    return static_cast<T>(strtol(str.c_str(), nullptr, 10));
-}
-template<>
-unsigned long long stringToValueImpl(const std::string &str)
-{
-    return strtoull(str.c_str(), nullptr, 10);
-}
-template<typename T>
-typename std::enable_if<std::is_integral<T>::value, T>::type
-stringToValue(const std::string &str)
-{
-    return str.empty() ? T(0) : stringToValueImpl<T>(str);
-}
-}  // namespace
-
-WireGuardGoCommunicator::Connection::Connection(const std::string &deviceName)
-    : status_(Status::NO_ACCESS), socketHandle_(-1), fileHandle_(nullptr)
-{
-    struct sockaddr_un addr;
-    addr.sun_family = AF_UNIX;
-    snprintf(addr.sun_path, sizeof(addr.sun_path), "/var/run/wireguard/%s.sock",
-        deviceName.c_str());
-    int attempt = 0;
-    do {
-        if (connect(&addr))
-            break;
-        if (++attempt < CONNECTION_ATTEMPT_COUNT)
-            usleep(CONNECTION_BETWEEN_WAIT_MS * 1000);
-    } while (attempt < CONNECTION_ATTEMPT_COUNT);
-    if (socketHandle_ == -1)
-        return;
-    fileHandle_ = fdopen(socketHandle_, "r+");
-    if (!fileHandle_) {
-        if (socketHandle_ >= 0) {
-            close(socketHandle_);
-            socketHandle_ = -1;
-        }
-        return;
-    }
-    status_ = Status::OK;
-}
-
-WireGuardGoCommunicator::Connection::~Connection()
-{
-    if (fileHandle_)
-        fclose(fileHandle_);
-    if (socketHandle_ >= 0)
-        close(socketHandle_);
-}
-
-bool WireGuardGoCommunicator::Connection::getOutput(ResultMap *results_map) const
-{
-    if (!fileHandle_)
-        return false;
-    std::string output;
-    output.reserve(1024);
-    char prev = 0, c = 0;
-    for (;;) {
-        c = static_cast<char>(fgetc(fileHandle_));
-        if ((c == '\n' && prev == '\n') || feof(fileHandle_) || ferror(fileHandle_)) {
-            break;
-        }
-        prev = c;
-        output.push_back(c);
-    }
-    boost::trim(output);
-    if (output.empty())
-        return false;
-    if (results_map && !results_map->empty()) {
-        std::regex output_rx("(^|\n)(\\w+)=(\\w+)(?=\n|$)");
-        std::sregex_iterator it(output.begin(), output.end(), output_rx), end;
-        for (; it != end; ++it) {
-            if (it->size() != 4)
-                continue;
-            const auto &match = *it;
-            auto mapitem = results_map->find(match[2].str());
-            if (mapitem != results_map->end())
-                mapitem->second = match[3].str();
-        }
-    }
-    return true;
-}
-
-bool WireGuardGoCommunicator::Connection::connect(struct sockaddr_un *address)
-{
-    struct stat sbuf;
-    auto ret = stat(address->sun_path, &sbuf);
-    if (ret < 0) {
-        // Socket is not available, don't attempt to reconnect.
-        status_ = Status::NO_SOCKET;
-        return false;
-    }
-    if (!S_ISSOCK(sbuf.st_mode)) {
-        errno = EBADF;
-        spdlog::error("File is not a socket: {}", address->sun_path);
-        // Socket is bad, don't attempt to reconnect.
-        status_ = Status::NO_ACCESS;
-        return false;
-    }
-    socketHandle_ = socket(AF_UNIX, SOCK_STREAM, 0);
-    if (socketHandle_ < 0) {
-        spdlog::error("Failed to open the socket: {}", address->sun_path);
-        // Socket cannot be opened, don't attempt to reconnect.
-        status_ = Status::NO_ACCESS;
-        return false;
-    }
-    ret = ::connect(socketHandle_, reinterpret_cast<struct sockaddr *>(address), sizeof(*address));
-    if (ret < 0) {
-        spdlog::error("Failed to connect to the socket: {}", address->sun_path);
-        bool do_retry = errno != EACCES;
-        if (errno == ECONNREFUSED)
-            unlink(address->sun_path);
-        if (socketHandle_ >= 0) {
-            close(socketHandle_);
-            socketHandle_ = -1;
-        }
-        status_ = do_retry ? Status::NO_SOCKET : Status::NO_ACCESS;
-        return do_retry;
-    }
-    return true;
+    if (!uapi_)
+        return UapiClient::Status::NO_SOCKET;
+    return uapi_->connect();
 }
 
 bool WireGuardGoCommunicator::start(const std::string &deviceName)
@@ -162,11 +35,13 @@ bool WireGuardGoCommunicator::start(const std::string &deviceName)
     daemonCmdId_ = ExecuteCmd::instance().execute(fullCmd);
     deviceName_ = deviceName;
     executable_ = "windscribewireguard";
+    uapi_ = std::make_unique<UapiClient>(deviceName_);
     return true;
 }
 
 bool WireGuardGoCommunicator::stop()
 {
+    uapi_.reset();
     if (!deviceName_.empty()) {
         Utils::executeCommand("rm", {"-f", ("/var/run/wireguard/" + deviceName_ + ".sock").c_str()});
     }
@@ -181,51 +56,39 @@ bool WireGuardGoCommunicator::configure(const std::string &clientPrivateKey,
     const std::string &peerEndpoint, const std::vector<std::string> &allowedIps,
     uint32_t fwmark, uint16_t listenPort)
 {
-    Connection connection(deviceName_);
-    if (connection.getStatus() != Connection::Status::OK) {
+    if (connectUapi() != UapiClient::Status::OK) {
         spdlog::error("WireGuardGoCommunicator::configure(): no connection to daemon");
         return false;
     }
 
     // Setup listen port first, otherwise it would be silently ignored
     if (listenPort) {
-        fprintf(connection, "set=1\nlisten_port=%hu\n\n", listenPort);
-        fflush(connection);
-        // Check results.
-        Connection::ResultMap results{ std::make_pair("errno", "") };
-        bool success = connection.getOutput(&results);
-        if (success && stringToValue<int>(results["errno"]) != 0)
+        unsigned int err = 0;
+        bool success = uapi_->set("listen_port=" + std::to_string(listenPort) + "\n", &err);
+        if (success && err != 0)
             spdlog::error("Wireguard listen_port is not successful");
     }
 
-    // Send set command.
-    fputs("set=1\n", connection);
-    fprintf(connection,
-        "fwmark=%u\n"
-        "private_key=%s\n"
-        "replace_peers=true\n"
-        "public_key=%s\n"
-        "endpoint=%s\n"
-        "persistent_keepalive_interval=0\n",
-        fwmark, clientPrivateKey.c_str(), peerPublicKey.c_str(), peerEndpoint.c_str());
+    // Send the device, peer and allowed IPs configuration in one transaction.
+    std::string config;
+    config.reserve(512 + allowedIps.size() * 32);
+    config += "fwmark=" + std::to_string(fwmark) + "\n";
+    config += "private_key=" + clientPrivateKey + "\n";
+    config += "replace_peers=true\n";
+    config += "public_key=" + peerPublicKey + "\n";
+    config += "endpoint=" + peerEndpoint + "\n";
+    config += "persistent_keepalive_interval=0\n";
     if (!peerPresharedKey.empty())
-        fprintf(connection, "preshared_key=%s\n", peerPresharedKey.c_str());
-    fprintf(connection, "%s", "replace_allowed_ips=true\n");
+        config += "preshared_key=" + peerPresharedKey + "\n";
+    config += "replace_allowed_ips=true\n";
     for (const auto &ip : allowedIps)
-        fprintf(connection, "allowed_ip=%s\n", ip.c_str());
-    fputs("\n", connection);
-    fflush(connection);
+        config += "allowed_ip=" + ip + "\n";
 
     // Check results.
-    Connection::ResultMap results{ std::make_pair("errno", "") };
-    bool success = connection.getOutput(&results);
-    for (auto it = results.begin(); it != results.end(); ++it)
-        {
-            spdlog::debug("{} = {}", it->first, it->second);
-        }
-    if (success)
-        success = stringToValue<int>(results["errno"]) == 0;
-    return success;
+    unsigned int err = 0;
+    bool success = uapi_->set(config, &err);
+    spdlog::debug("errno = {}", err);
+    return success && err == 0;
 }
 
 unsigned long WireGuardGoCommunicator::getStatus(unsigned int *errorCode,
@@ -240,63 +103,54 @@ unsigned long WireGuardGoCommunicator::getStatus(unsigned int *errorCode,
         return kWgStateError;
     }
 
-    Connection connection(deviceName_);
-    const auto connection_status = connection.getStatus();
-    if (connection_status != Connection::Status::OK) {
-        if (connection.getStatus() == Connection::Status::NO_SOCKET)
+    const auto connection_status = connectUapi();
+    if (connection_status != UapiClient::Status::OK) {
+        if (connection_status == UapiClient::Status::NO_SOCKET)
             return kWgStateStarting;
         if (errorCode)
             *errorCode = static_cast<unsigned int>(errno);
         return kWgStateError;
     }
 
-    // Send get command.
-    fputs("get=1\n\n", connection);
-    fflush(connection);
-
-    Connection::ResultMap results{
-        std::make_pair("errno", ""),
-        std::make_pair("listen_port", ""),
-        std::make_pair("public_key", ""),
-        std::make_pair("rx_bytes", ""),
-        std::make_pair("tx_bytes", ""),
-        std::make_pair("last_handshake_time_sec", "")
-    };
-    bool success = connection.getOutput(&results);
+    // Send get command, the kept connection may have been closed by the daemon so reconnect once.
+    UapiClient::DeviceStatus status;
+    bool success = uapi_->get(&status);
+    if (!success && uapi_->connect() == UapiClient::Status::OK)
+        success = uapi_->get(&status);
     if (!success)
         return kWgStateStarting;
 
     // Check for errors.
-    const auto errno_value = stringToValue<unsigned int>(results["errno"]);
-    if (errno_value != 0) {
+    if (status.errorCode != 0) {
         if (errorCode)
-            *errorCode = errno_value;
+            *errorCode = status.errorCode;
         return kWgStateError;
     }
 
     // Check if not yet listening.
-    if (results["listen_port"].empty())
+    if (!status.isListening)
         return kWgStateStarting;
 
     // Check for handshake.
-    if (stringToValue<unsigned long long>(results["last_handshake_time_sec"]) > 0) {
+    const UapiClient::PeerStats *peer = status.peers.empty() ? nullptr : &status.peers.front();
+    if (peer && peer->lastHandshakeTimeSec > 0) {
         struct timeval tv;
         int rc = gettimeofday(&tv, NULL);
-        if (rc || tv.tv_sec - stringToValue<unsigned long long>(results["last_handshake_time_sec"]) > 180)
+        if (rc || tv.tv_sec - peer->lastHandshakeTimeSec > 180)
         {
             spdlog::info("Time since last handshake time exceeded 3 minutes, disconnecting");
             return kWgStateError;
         }
 
         if (bytesReceived)
-            *bytesReceived = stringToValue<unsigned long long>(results["rx_bytes"]);
+            *bytesReceived = peer->rxBytes;
         if (bytesTransmitted)
-            *bytesTransmitted = stringToValue<unsigned long long>(results["tx_bytes"]);
+            *bytesTransmitted = peer->txBytes;
         return kWgStateActive;
     }
 
     // If endpoint is set, we are connecting, otherwise simply listening.
-    if (!results["public_key"].empty())
+    if (peer && !peer->publicKey.empty())
         return kWgStateConnecting;
     return kWgStateListening;
 }
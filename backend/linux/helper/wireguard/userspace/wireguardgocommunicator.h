@@ -1,10 +1,12 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "../iwireguardcommunicator.h"
+#include "uapiclient.h"
 
 class WireGuardGoCommunicator: public IWireGuardCommunicator
 {
@@ -27,28 +29,11 @@ public:
         unsigned long long *bytesTransmitted);
 
 private:
-    class Connection
-    {
-    public:
-        enum class Status { OK, NO_SOCKET, NO_ACCESS };
-        using ResultMap = std::map<std::string, std::string>;
-
-        explicit Connection(const std::string &deviceName);
-        ~Connection();
-        bool getOutput(ResultMap *results_map) const;
-        Status getStatus() const { return status_; }
-        operator FILE*() const { return fileHandle_; }
-    private:
-        bool connect(struct sockaddr_un *address);
-
-        static constexpr int CONNECTION_ATTEMPT_COUNT = 5;
-        static constexpr int CONNECTION_BETWEEN_WAIT_MS = 100;
-        Status status_;
-        int socketHandle_;
-        FILE *fileHandle_;
-    };
-
     std::string deviceName_;
     std::string executable_;
     unsigned long daemonCmdId_;
+    std::unique_ptr<UapiClient> uapi_;
+
+    // connects to the daemon on demand, the connection is kept between the calls
+    UapiClient::Status connectUapi();
 };
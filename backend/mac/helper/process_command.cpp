@@ -363,8 +363,10 @@ CMD_ANSWER setFirewallRules(boost::archive::text_iarchive &ia)
 
     if (FirewallController::instance().enable(cmd.rules, cmd.table, cmd.group)) {
         answer.executed = 1;
+        answer.exitCode = 0;
     } else {
         answer.executed = 0;
+        answer.exitCode = 1;
     }
     return answer;
 }
@@ -488,6 +490,11 @@ CMD_ANSWER startCtrld(boost::archive::text_iarchive &ia)
         answer.executed = 0;
         return answer;
     }
+    if (cmd.listenPort == 0 || cmd.listenPort > 65535) {
+        spdlog::error("Invalid ctrld listen port: {}", cmd.listenPort);
+        answer.executed = 0;
+        return answer;
+    }
     for (const auto domain: cmd.domains) {
         if (!Utils::isValidDomain(domain)) {
             spdlog::error("Invalid domain: {}", domain);
@@ -499,7 +506,7 @@ CMD_ANSWER startCtrld(boost::archive::text_iarchive &ia)
     std::stringstream arguments;
     arguments << "run";
     arguments << " --daemon";
-    arguments << " --listen=127.0.0.1:53";
+    arguments << " --listen=127.0.0.1:" + std::to_string(cmd.listenPort);
     arguments << " --primary_upstream=" + cmd.upstream1;
     if (!cmd.upstream2.empty()) {
         arguments << " --secondary_upstream=" + cmd.upstream2;
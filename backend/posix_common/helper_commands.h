@@ -166,6 +166,7 @@ struct CMD_START_CTRLD {
     std::string upstream1;
     std::string upstream2;
     std::vector<std::string> domains;
+    unsigned int listenPort;
     bool isCreateLog;
 };
 
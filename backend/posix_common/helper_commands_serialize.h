@@ -107,6 +107,7 @@ void serialize(Archive &ar, CMD_START_CTRLD &a, const unsigned int version)
     ar & a.upstream1;
     ar & a.upstream2;
     ar & a.domains;
+    ar & a.listenPort;
     ar & a.isCreateLog;
 }
 
@@ -109,6 +109,9 @@ void Backend::init()
     connect(engine_, &Engine::helperSplitTunnelingStartFailed, this, &Backend::helperSplitTunnelingStartFailed);
     connect(engine_, &Engine::autoEnableAntiCensorship, this, &Backend::onEngineAutoEnableAntiCensorship);
     connect(engine_, &Engine::connectionIdChanged, this, &Backend::connectionIdChanged);
+    connect(locationsModelManager_, &gui_locations::LocationsModelManager::priorityLocationsChanged, this, [this](const QVector<LocationID> &locations) {
+        engine_->setPriorityLocations(locations);
+    });
     threadEngine_->start(QThread::LowPriority);
 }
 
@@ -395,7 +398,7 @@ void Backend::onEngineInitFinished(ENGINE_INIT_RET_CODE retCode, bool isCanLogin
         connect(engine_->getLocationsModel(), &locationsmodel::LocationsModel::locationsUpdated, this,  &Backend::onEngineLocationsModelItemsUpdated);
         connect(engine_->getLocationsModel(), &locationsmodel::LocationsModel::bestLocationUpdated, this, &Backend::onEngineLocationsModelBestLocationUpdated);
         connect(engine_->getLocationsModel(), &locationsmodel::LocationsModel::customConfigsLocationsUpdated, this, &Backend::onEngineLocationsModelCustomConfigItemsUpdated);
-        connect(engine_->getLocationsModel(), &locationsmodel::LocationsModel::locationPingTimeChanged, this, &Backend::onEngineLocationsModelPingChangedChanged);
+        connect(engine_->getLocationsModel(), &locationsmodel::LocationsModel::locationsPingTimeChanged, this, &Backend::onEngineLocationsModelPingChangedChanged);
 
         preferences_.setEngineSettings(engineSettings);
         // WiFi sharing supported state
@@ -654,9 +657,9 @@ void Backend::onEngineLocationsModelCustomConfigItemsUpdated(QSharedPointer<type
     locationsModelManager_->updateCustomConfigLocation(*item);
 }
 
-void Backend::onEngineLocationsModelPingChangedChanged(const LocationID &id, PingTime timeMs)
+void Backend::onEngineLocationsModelPingChangedChanged(const QHash<LocationID, PingTime> &pingTimes)
 {
-    locationsModelManager_->changeConnectionSpeed(id, timeMs);
+    locationsModelManager_->changeConnectionSpeeds(pingTimes);
 }
 
 void Backend::onEngineMacAddrSpoofingChanged(const types::EngineSettings &engineSettings)
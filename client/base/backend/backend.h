@@ -169,7 +169,7 @@ private slots:
     void onEngineLocationsModelItemsUpdated(const LocationID &bestLocation, const QString &staticIpDeviceName, QSharedPointer< QVector<types::Location> > items);
     void onEngineLocationsModelBestLocationUpdated(const LocationID &bestLocation);
     void onEngineLocationsModelCustomConfigItemsUpdated(QSharedPointer<types::Location> item);
-    void onEngineLocationsModelPingChangedChanged(const LocationID &id, PingTime timeMs);
+    void onEngineLocationsModelPingChangedChanged(const QHash<LocationID, PingTime> &pingTimes);
 
     void onEngineMacAddrSpoofingChanged(const types::EngineSettings &engineSettings);
     void onEngineSendUserWarning(USER_WARNING_TYPE userWarningType);
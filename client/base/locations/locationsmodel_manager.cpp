@@ -36,6 +36,13 @@ LocationsModelManager::LocationsModelManager(QObject *parent) : QObject(parent)
 
     customConfigsProxyModel_ = new CustomConfgisProxyModel(this);
     customConfigsProxyModel_->setSourceModel(sortedCitiesProxyModel_);
+
+    priorityLocationsTimer_.setSingleShot(true);
+    priorityLocationsTimer_.setInterval(UPDATE_PRIORITY_LOCATIONS_PERIOD);
+    connect(&priorityLocationsTimer_, &QTimer::timeout, this, &LocationsModelManager::onPriorityLocationsTimer);
+    connect(favoriteCitiesProxyModel_, &QAbstractItemModel::rowsInserted, &priorityLocationsTimer_, qOverload<>(&QTimer::start));
+    connect(favoriteCitiesProxyModel_, &QAbstractItemModel::rowsRemoved, &priorityLocationsTimer_, qOverload<>(&QTimer::start));
+    connect(favoriteCitiesProxyModel_, &QAbstractItemModel::modelReset, &priorityLocationsTimer_, qOverload<>(&QTimer::start));
 }
 
 void LocationsModelManager::updateLocations(const LocationID &bestLocation, const QVector<types::Location> &locations)
@@ -63,9 +70,12 @@ void LocationsModelManager::updateCustomConfigLocation(const types::Location &lo
 }
 
 // since the connection speed change can be called quite often, we limit this processing to once every 0.5 second
-void LocationsModelManager::changeConnectionSpeed(LocationID id, PingTime speed)
+void LocationsModelManager::changeConnectionSpeeds(const QHash<LocationID, PingTime> &speeds)
 {
-    connectionSpeeds_[id] = speed;
+    for (auto it = speeds.constBegin(); it != speeds.constEnd(); ++it)
+    {
+        connectionSpeeds_[it.key()] = it.value();
+    }
     if (!timer_.isActive())
     {
         timer_.start(UPDATE_CONNECTION_SPEED_PERIOD);
@@ -202,12 +212,29 @@ void LocationsModelManager::saveFavoriteLocations()
     locationsModel_->saveFavoriteLocations();
 }
 
-void LocationsModelManager::onChangeConnectionSpeedTimer()
+void LocationsModelManager::setVisibleLocations(const QVector<LocationID> &locations)
 {
-    for (QHash<LocationID, PingTime>::const_iterator it = connectionSpeeds_.constBegin(); it != connectionSpeeds_.constEnd(); ++it)
-    {
-        locationsModel_->changeConnectionSpeed(it.key(), it.value());
+    if (visibleLocations_ != locations) {
+        visibleLocations_ = locations;
+        priorityLocationsTimer_.start();
+    }
+}
+
+void LocationsModelManager::onPriorityLocationsTimer()
+{
+    QSet<LocationID> locations(visibleLocations_.cbegin(), visibleLocations_.cend());
+    for (int i = 0; i < favoriteCitiesProxyModel_->rowCount(); ++i)
+        locations.insert(qvariant_cast<LocationID>(favoriteCitiesProxyModel_->index(i, 0).data(kLocationId)));
+
+    if (priorityLocations_ != locations) {
+        priorityLocations_ = locations;
+        emit priorityLocationsChanged(QVector<LocationID>(locations.cbegin(), locations.cend()));
     }
+}
+
+void LocationsModelManager::onChangeConnectionSpeedTimer()
+{
+    locationsModel_->changeConnectionSpeeds(connectionSpeeds_);
     connectionSpeeds_.clear();
     timer_.stop();
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QSet>
 #include <QTimer>
 
 #include "model/locationsmodel.h"
@@ -19,7 +20,7 @@ public:
     void updateBestLocation(const LocationID &bestLocation);
     void updateCustomConfigLocation(const types::Location &location);
     void updateDeviceName(const QString &staticIpDeviceName);
-    void changeConnectionSpeed(LocationID id, PingTime speed);
+    void changeConnectionSpeeds(const QHash<LocationID, PingTime> &speeds);
     void setLocationOrder(ORDER_LOCATION_TYPE orderLocationType);
     void setFreeSessionStatus(bool isFreeSessionStatus);
 
@@ -43,11 +44,17 @@ public:
 
     void saveFavoriteLocations();
 
+    // the locations currently shown in a list view; together with the favorites they make the priority locations
+    void setVisibleLocations(const QVector<LocationID> &locations);
+
 signals:
     void deviceNameChanged(const QString &deviceName);
+    // the visible and favorite locations, their nodes are pinged first by the engine
+    void priorityLocationsChanged(const QVector<LocationID> &locations);
 
 private slots:
     void onChangeConnectionSpeedTimer();
+    void onPriorityLocationsTimer();
 
 private:
     LocationsModel *locationsModel_;
@@ -63,6 +70,11 @@ private:
     const int UPDATE_CONNECTION_SPEED_PERIOD = 500;    // 0.5 sec
     QTimer timer_;
     QHash<LocationID, PingTime> connectionSpeeds_;
+
+    const int UPDATE_PRIORITY_LOCATIONS_PERIOD = 1000;    // 1 sec
+    QTimer priorityLocationsTimer_;
+    QVector<LocationID> visibleLocations_;
+    QSet<LocationID> priorityLocations_;
 };
 
 } //namespace gui_locations
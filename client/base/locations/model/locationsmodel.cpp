@@ -190,37 +190,68 @@ void LocationsModel::updateCustomConfigLocation(const types::Location &location)
 
 void LocationsModel::changeConnectionSpeed(LocationID id, PingTime speed)
 {
-    auto it = mapLocations_.find(id.toTopLevelLocation());
-    if (it != mapLocations_.end())
+    QHash<LocationID, PingTime> speeds;
+    speeds[id] = speed;
+    changeConnectionSpeeds(speeds);
+}
+
+void LocationsModel::changeConnectionSpeeds(const QHash<LocationID, PingTime> &speeds)
+{
+    QMap<int, QPair<int, int> > changedCities;   // location index -> the range of the changed cities
+    bool isBestLocationChanged = false;
+
+    for (auto itSpeed = speeds.constBegin(); itSpeed != speeds.constEnd(); ++itSpeed)
     {
-        int ind = locations_.indexOf(it.value());
-        WS_ASSERT(ind != -1);
-        if (ind != -1)
+        const LocationID &id = itSpeed.key();
+        auto it = mapLocations_.find(id.toTopLevelLocation());
+        if (it != mapLocations_.end())
         {
-            for (int c = 0; c < it.value()->location().cities.size(); ++c)
+            int ind = locations_.indexOf(it.value());
+            WS_ASSERT(ind != -1);
+            if (ind != -1)
             {
-                if (it.value()->location().cities[c].id == id)
+                for (int c = 0; c < it.value()->location().cities.size(); ++c)
                 {
-                    it.value()->setPingTimeForCity(c, speed);
-                    QModelIndex locationModelInd = index(ind, 0);
-                    emit dataChanged(locationModelInd, locationModelInd, QList<int>() << kPingTime);
-                    QModelIndex cityModelInd = index(c, 0, locationModelInd);
-                    emit dataChanged(cityModelInd, cityModelInd, QList<int>() << kPingTime);
-                    break;
+                    if (it.value()->location().cities[c].id == id)
+                    {
+                        it.value()->setPingTimeForCity(c, itSpeed.value());
+                        auto itRange = changedCities.find(ind);
+                        if (itRange == changedCities.end())
+                        {
+                            changedCities.insert(ind, qMakePair(c, c));
+                        }
+                        else
+                        {
+                            itRange->first = qMin(itRange->first, c);
+                            itRange->second = qMax(itRange->second, c);
+                        }
+                        break;
+                    }
                 }
             }
         }
-    }
 
-    if (locations_.size() > 0)
-    {
-        // update speed for best location
-        if (!id.isCustomConfigsLocation() && !id.isStaticIpsLocation() && locations_[0]->location().id == id.apiLocationToBestLocation())
+        if (locations_.size() > 0)
         {
-            locations_[0]->setPingTimeForCity(0, speed);
-            emit dataChanged(index(0, 0), index(0, 0), QList<int>() << kPingTime);
+            // update speed for best location
+            if (!id.isCustomConfigsLocation() && !id.isStaticIpsLocation() && locations_[0]->location().id == id.apiLocationToBestLocation())
+            {
+                locations_[0]->setPingTimeForCity(0, itSpeed.value());
+                isBestLocationChanged = true;
+            }
         }
     }
+
+    for (auto it = changedCities.constBegin(); it != changedCities.constEnd(); ++it)
+    {
+        QModelIndex locationModelInd = index(it.key(), 0);
+        emit dataChanged(locationModelInd, locationModelInd, QList<int>() << kPingTime);
+        emit dataChanged(index(it->first, 0, locationModelInd), index(it->second, 0, locationModelInd), QList<int>() << kPingTime);
+    }
+    if (isBestLocationChanged)
+    {
+        emit dataChanged(index(0, 0), index(0, 0), QList<int>() << kPingTime);
+    }
 }
 
 void LocationsModel::setFreeSessionStatus(bool isFreeSessionStatus)
@@ -47,6 +47,8 @@ public:
     void updateBestLocation(const LocationID &bestLocation);
     void updateCustomConfigLocation(const types::Location &location);
     void changeConnectionSpeed(LocationID id, PingTime speed);
+    // applies all the speeds at once, dataChanged is emitted once per location for its changed cities
+    void changeConnectionSpeeds(const QHash<LocationID, PingTime> &speeds);
     void setFreeSessionStatus(bool isFreeSessionStatus);
 
     int columnCount(const QModelIndex &parent = QModelIndex()) const override;
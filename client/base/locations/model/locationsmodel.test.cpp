@@ -2,6 +2,7 @@
 #include "locationsmodel.test.h"
 #include "types/locationid.h"
 #include "locations/locationsmodel_roles.h"
+#include "locationssearchindex.h"
 
 void TestLocationsModel::init()
 {
@@ -200,6 +201,33 @@ void TestLocationsModel::testConnectionSpeed()
     }
 }
 
+void TestLocationsModel::testConnectionSpeeds()
+{
+    bestLocation_ = LocationID::createApiLocationId(65, "Dallas", "BBQ").apiLocationToBestLocation();
+    locationsModel_->updateBestLocation(bestLocation_);
+
+    QSignalSpy spyChanged(locationsModel_.get(), &QAbstractItemModel::dataChanged);
+    QHash<LocationID, PingTime> speeds;
+    speeds[LocationID::createApiLocationId(65, "Dallas", "BBQ")] = 500;
+    speeds[LocationID::createApiLocationId(65, "Atlanta", "Piedmont")] = 300;
+    locationsModel_->changeConnectionSpeeds(speeds);
+    // the country, the range of its cities and the best location
+    QCOMPARE(spyChanged.count(), 3);
+
+    {
+        QModelIndex ind = locationsModel_->getIndexByLocationId(LocationID::createApiLocationId(65, "Dallas", "BBQ"));
+        QVERIFY(ind.data(gui_locations::kPingTime).toInt() == 500);
+    }
+    {
+        QModelIndex ind = locationsModel_->getIndexByLocationId(LocationID::createApiLocationId(65, "Atlanta", "Piedmont"));
+        QVERIFY(ind.data(gui_locations::kPingTime).toInt() == 300);
+    }
+    {
+        QModelIndex ind = locationsModel_->getBestLocationIndex();
+        QVERIFY(ind.data(gui_locations::kPingTime).toInt() == 500);
+    }
+}
+
 void TestLocationsModel::testAddDeleteCountry()
 {
     QFile file(":data/tests/locationsmodel/deleted_locations.json");
@@ -455,6 +483,49 @@ bool TestLocationsModel::isCitiesModelEqualTo(const QVector<types::Location> &lo
     return handledCount == cities.size();
 }
 
+void TestLocationsModel::testSearchIndex()
+{
+    QCOMPARE(gui_locations::LocationsSearchIndex::normalize("São Paulo"), QString("sao paulo"));
+
+    gui_locations::LocationsSearchIndex searchIndex;
+    searchIndex.build(locationsModel_.get());
+
+    searchIndex.setFilter("dall");
+    QVERIFY(searchIndex.isAccepted(LocationID::createTopApiLocationId(65)));
+    QVERIFY(searchIndex.isAccepted(LocationID::createApiLocationId(65, "Dallas", "BBQ")));
+    QVERIFY(!searchIndex.isAccepted(LocationID::createApiLocationId(65, "Atlanta", "Piedmont")));
+    QVERIFY(!searchIndex.isAccepted(LocationID::createTopApiLocationId(1)));
+    QCOMPARE(searchIndex.sortGroup(LocationID::createTopApiLocationId(65)), 1);
+    QCOMPARE(searchIndex.sortGroup(LocationID::createApiLocationId(65, "Dallas", "BBQ")), 1);
+
+    // narrowing the previous filter
+    searchIndex.setFilter("DALLAS - B");
+    QVERIFY(searchIndex.isAccepted(LocationID::createApiLocationId(65, "Dallas", "BBQ")));
+    QVERIFY(!searchIndex.isAccepted(LocationID::createApiLocationId(65, "Dallas", "Ranch")));
+
+    // the country name matches, so all its cities are accepted
+    searchIndex.setFilter("austria");
+    QVERIFY(searchIndex.isAccepted(LocationID::createTopApiLocationId(69)));
+    QVERIFY(searchIndex.isAccepted(LocationID::createApiLocationId(69, "Vienna", "Hofburg")));
+    QVERIFY(searchIndex.isAccepted(LocationID::createApiLocationId(69, "Vienna", "Boltzmann")));
+    QCOMPARE(searchIndex.sortGroup(LocationID::createTopApiLocationId(69)), 0);
+    QCOMPARE(searchIndex.sortGroup(LocationID::createApiLocationId(69, "Vienna", "Hofburg")), 2);
+
+    searchIndex.setFilter("Montréal");
+    QVERIFY(searchIndex.isAccepted(LocationID::createApiLocationId(7, "Montreal", "Expo 67")));
+    QVERIFY(!searchIndex.isAccepted(LocationID::createApiLocationId(7, "Toronto", "The 6")));
+
+    searchIndex.setFilter("xyzq");
+    QVERIFY(!searchIndex.isAccepted(LocationID::createTopApiLocationId(65)));
+
+    // the filter is kept through a rebuild
+    searchIndex.invalidate();
+    searchIndex.setFilter("pe");
+    searchIndex.build(locationsModel_.get());
+    QVERIFY(searchIndex.isAccepted(LocationID::createTopApiLocationId(112)));
+    QCOMPARE(searchIndex.sortGroup(LocationID::createTopApiLocationId(112)), 0);
+}
+
 QTEST_MAIN(TestLocationsModel)
 
 
@@ -20,11 +20,13 @@ private slots:
     void testBestLocation();
     void testCustomConfig();
     void testConnectionSpeed();
+    void testConnectionSpeeds();
     void testAddDeleteCountry();
     void testAddDeleteCity();
     void testChangedOrder();
     void testChangedCaptions();
     void testFreeSessionStatusChange();
+    void testSearchIndex();
 
 private:
     QVector<types::Location> testOriginal_;
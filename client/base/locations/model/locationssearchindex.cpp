@@ -0,0 +1,177 @@
+#include "locationssearchindex.h"
+#include <algorithm>
+#include <numeric>
+#include "../locationsmodel_roles.h"
+
+namespace gui_locations {
+
+LocationsSearchIndex::LocationsSearchIndex() : isValid_(false)
+{
+}
+
+void LocationsSearchIndex::invalidate()
+{
+    isValid_ = false;
+}
+
+void LocationsSearchIndex::build(const QAbstractItemModel *model)
+{
+    entries_.clear();
+    trigrams_.clear();
+
+    for (int i = 0; i < model->rowCount(); ++i) {
+        const QModelIndex mi = model->index(i, 0);
+        const LocationID lid = qvariant_cast<LocationID>(mi.data(kLocationId));
+        if (lid.isStaticIpsLocation() || lid.isCustomConfigsLocation())
+            continue;
+
+        const QString name = normalize(mi.data().toString());
+        const QString countryCode = normalize(mi.data(kCountryCode).toString());
+        const int country = entries_.size();
+        addEntry(lid, -1, QStringList() << name << countryCode, name, countryCode);
+
+        for (int c = 0; c < model->rowCount(mi); ++c) {
+            const QModelIndex childMi = model->index(c, 0, mi);
+            addEntry(qvariant_cast<LocationID>(childMi.data(kLocationId)), country, QStringList() << normalize(childMi.data().toString()),
+                     normalize(childMi.data(kName).toString()), normalize(childMi.data(kNick).toString()));
+        }
+    }
+
+    isValid_ = true;
+    // the previous matches are stale
+    const QString filter = filter_;
+    filter_.clear();
+    setFilter(filter);
+}
+
+void LocationsSearchIndex::setFilter(const QString &filter)
+{
+    const QString normalizedFilter = normalize(filter);
+    if (normalizedFilter == filter_ && !normalizedFilter.isEmpty())
+        return;
+
+    if (!isValid_ || normalizedFilter.isEmpty()) {
+        filter_ = normalizedFilter;
+        matches_.clear();
+        accepted_.clear();
+        sortGroups_.clear();
+        return;
+    }
+
+    QVector<int> candidates;
+    if (!filter_.isEmpty() && normalizedFilter.contains(filter_)) {
+        // narrowing, the new matches are a subset of the previous ones
+        candidates = matches_;
+    } else if (normalizedFilter.size() >= 3) {
+        candidates = candidatesByTrigrams(normalizedFilter);
+    } else {
+        candidates.resize(entries_.size());
+        std::iota(candidates.begin(), candidates.end(), 0);
+    }
+
+    filter_ = normalizedFilter;
+    matches_.clear();
+    for (int ind : std::as_const(candidates)) {
+        if (entries_[ind].text.contains(filter_))
+            matches_ << ind;
+    }
+    updateResults();
+}
+
+bool LocationsSearchIndex::isAccepted(const LocationID &lid) const
+{
+    return accepted_.contains(lid);
+}
+
+int LocationsSearchIndex::sortGroup(const LocationID &lid) const
+{
+    return sortGroups_.value(lid, 2);
+}
+
+QString LocationsSearchIndex::normalize(const QString &str)
+{
+    // the diacritics become separate combining marks after the decomposition
+    const QString decomposed = str.normalized(QString::NormalizationForm_KD);
+    QString result;
+    result.reserve(decomposed.size());
+    for (const QChar &c : decomposed) {
+        if (c.category() != QChar::Mark_NonSpacing)
+            result.append(c);
+    }
+    return result.toCaseFolded();
+}
+
+void LocationsSearchIndex::addEntry(const LocationID &lid, int country, const QStringList &texts, const QString &prefixText1, const QString &prefixText2)
+{
+    const int ind = entries_.size();
+    Entry entry { lid, country, texts.join('\n'), prefixText1, prefixText2 };
+
+    if (entry.text.size() >= 3) {
+        QSet<quint64> entryTrigrams;
+        for (int i = 0; i + 3 <= entry.text.size(); ++i)
+            entryTrigrams.insert(trigram(entry.text.constData() + i));
+        // the entries are added in order, so the lists stay sorted
+        for (quint64 t : std::as_const(entryTrigrams))
+            trigrams_[t] << ind;
+    }
+    entries_ << entry;
+}
+
+QVector<int> LocationsSearchIndex::candidatesByTrigrams(const QString &filter) const
+{
+    QVector<const QVector<int> *> lists;
+    for (int i = 0; i + 3 <= filter.size(); ++i) {
+        auto it = trigrams_.constFind(trigram(filter.constData() + i));
+        if (it == trigrams_.constEnd())
+            return QVector<int>();
+        lists << &it.value();
+    }
+
+    // intersect starting from the shortest list
+    std::sort(lists.begin(), lists.end(), [](const QVector<int> *a, const QVector<int> *b) { return a->size() < b->size(); });
+    QVector<int> result = *lists.first();
+    for (int i = 1; i < lists.size() && !result.isEmpty(); ++i) {
+        QVector<int> intersection;
+        std::set_intersection(result.cbegin(), result.cend(), lists[i]->cbegin(), lists[i]->cend(), std::back_inserter(intersection));
+        result = intersection;
+    }
+    return result;
+}
+
+void LocationsSearchIndex::updateResults()
+{
+    accepted_.clear();
+    sortGroups_.clear();
+
+    QSet<int> matchedCountries;
+    for (int ind : std::as_const(matches_)) {
+        const Entry &entry = entries_[ind];
+        accepted_.insert(entry.lid);
+        if (entry.country == -1) {
+            matchedCountries.insert(ind);
+            if (entry.prefixText1.startsWith(filter_) || entry.prefixText2.startsWith(filter_))
+                sortGroups_[entry.lid] = 0;
+        } else {
+            const LocationID &countryLid = entries_[entry.country].lid;
+            accepted_.insert(countryLid);
+            if (entry.prefixText1.startsWith(filter_) || entry.prefixText2.startsWith(filter_)) {
+                sortGroups_[entry.lid] = 1;
+                if (sortGroups_.value(countryLid, 2) > 1)
+                    sortGroups_[countryLid] = 1;
+            }
+        }
+    }
+
+    // all the cities of the matched countries
+    for (int i = 0; i < entries_.size(); ++i) {
+        if (entries_[i].country != -1 && matchedCountries.contains(entries_[i].country))
+            accepted_.insert(entries_[i].lid);
+    }
+}
+
+quint64 LocationsSearchIndex::trigram(const QChar *c)
+{
+    return (quint64(c[0].unicode()) << 32) | (quint64(c[1].unicode()) << 16) | quint64(c[2].unicode());
+}
+
+} //namespace gui_locations
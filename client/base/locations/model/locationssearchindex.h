@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include "types/locationid.h"
+
+namespace gui_locations {
+
+// Search index for filtering the locations by a search string.
+// The names, nicknames and country codes are stored case-folded and without diacritics, so "sao" finds "São Paulo".
+// The substring lookup goes through a trigram index, and if the new filter extends the previous one (typing),
+// only the previous matches are checked.
+// The index is built from LocationsModel lazily and must be invalidated when the model texts change.
+class LocationsSearchIndex
+{
+public:
+    LocationsSearchIndex();
+
+    void invalidate();
+    bool isValid() const { return isValid_; }
+    void build(const QAbstractItemModel *model);
+
+    void setFilter(const QString &filter);
+
+    // a country is accepted if it or any of its cities matches, a city if it or its country matches
+    bool isAccepted(const LocationID &lid) const;
+    // 0 - the country name or code starts with the filter, 1 - the city name or nickname starts with the filter
+    // (for a country: any of its cities), 2 - other
+    int sortGroup(const LocationID &lid) const;
+
+    static QString normalize(const QString &str);
+
+private:
+    struct Entry
+    {
+        LocationID lid;
+        int country;            // the index of the country entry for a city, -1 for a country
+        QString text;           // all the searchable texts separated by '\n'
+        QString prefixText1;    // the name
+        QString prefixText2;    // the country code or the nickname
+    };
+
+    bool isValid_;
+    QVector<Entry> entries_;
+    QHash<quint64, QVector<int>> trigrams_;    // sorted entry indexes by trigram
+
+    QString filter_;
+    QVector<int> matches_;                      // entry indexes matching filter_
+    QSet<LocationID> accepted_;
+    QHash<LocationID, int> sortGroups_;
+
+    void addEntry(const LocationID &lid, int country, const QStringList &texts, const QString &prefixText1, const QString &prefixText2);
+    QVector<int> candidatesByTrigrams(const QString &filter) const;
+    void updateResults();
+
+    static quint64 trigram(const QChar *c);
+};
+
+} //namespace gui_locations
@@ -22,10 +22,29 @@ void SortedLocationsProxyModel::setFilter(const QString &filter)
 {
     if (filter != filter_) {
         filter_ = filter;
+        searchIndex_.setFilter(filter_);
         invalidate();
     }
 }
 
+void SortedLocationsProxyModel::setSourceModel(QAbstractItemModel *sourceModel)
+{
+    for (const auto &connection : std::as_const(sourceConnections_))
+        disconnect(connection);
+    sourceConnections_.clear();
+    searchIndex_.invalidate();
+
+    // connected before QSortFilterProxyModel does, so the index is invalidated before the rows are re-filtered
+    if (sourceModel) {
+        auto invalidateIndex = [this]() { searchIndex_.invalidate(); };
+        sourceConnections_ << connect(sourceModel, &QAbstractItemModel::modelReset, this, invalidateIndex);
+        sourceConnections_ << connect(sourceModel, &QAbstractItemModel::rowsInserted, this, invalidateIndex);
+        sourceConnections_ << connect(sourceModel, &QAbstractItemModel::rowsRemoved, this, invalidateIndex);
+        sourceConnections_ << connect(sourceModel, &QAbstractItemModel::dataChanged, this, &SortedLocationsProxyModel::onSourceDataChanged);
+    }
+    QSortFilterProxyModel::setSourceModel(sourceModel);
+}
+
 bool SortedLocationsProxyModel::lessThan(const QModelIndex &left, const QModelIndex &right) const
 {
     if (orderLocationsType_ == ORDER_LOCATION_BY_GEOGRAPHY) {
@@ -52,36 +71,23 @@ bool SortedLocationsProxyModel::filterAcceptsRow(int source_row, const QModelInd
         return true;
 
     //  filtering by search string
-    if (!source_parent.isValid()) {   // country
-        QModelIndex mi = sourceModel()->index(source_row, 0, source_parent);
-        if (mi.data().toString().contains(filter_, Qt::CaseInsensitive) ||
-            mi.data(kCountryCode).toString().contains(filter_, Qt::CaseInsensitive))
-        {
-            return true;
-        }
-
-        for (int i = 0; i < sourceModel()->rowCount(mi); ++i) {
-            QModelIndex childMi = sourceModel()->index(i, 0, mi);
-            if (childMi.data().toString().contains(filter_, Qt::CaseInsensitive)) {
-                return true;
-            }
-        }
-
-    } else {    // city
-        if (source_parent.data().toString().contains(filter_, Qt::CaseInsensitive) ||
-            source_parent.data(kCountryCode).toString().contains(filter_, Qt::CaseInsensitive))
-        {
-            return true;
-        }
-
-        QModelIndex childMi = sourceModel()->index(source_row, 0, source_parent);
-        if (childMi.data().toString().contains(filter_, Qt::CaseInsensitive)) {
-            return true;
-        }
-    }
+    ensureSearchIndex();
+    return searchIndex_.isAccepted(lid);
+}
 
-    return false;
+void SortedLocationsProxyModel::onSourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QList<int> &roles)
+{
+    Q_UNUSED(topLeft);
+    Q_UNUSED(bottomRight);
+    // e.g. the ping times change often, they do not affect the search
+    if (roles.isEmpty() || roles.contains(Qt::DisplayRole) || roles.contains(kName) || roles.contains(kNick) || roles.contains(kCountryCode))
+        searchIndex_.invalidate();
+}
 
+void SortedLocationsProxyModel::ensureSearchIndex() const
+{
+    if (!searchIndex_.isValid())
+        searchIndex_.build(sourceModel());
 }
 
 bool SortedLocationsProxyModel::lessThanByGeography(const QModelIndex &left, const QModelIndex &right) const
@@ -173,26 +179,11 @@ int SortedLocationsProxyModel::getSortGroup(const QModelIndex &index) const
         return 0;
     }
 
-    LocationID lid = qvariant_cast<LocationID>(sourceModel()->data(index, kLocationId));
-    if (lid.isTopLevelLocation()) {
-        // If it's a country and the country name or code starts with the filter, it goes first
-        if (sourceModel()->data(index).toString().startsWith(filter_, Qt::CaseInsensitive) || sourceModel()->data(index, kCountryCode).toString().startsWith(filter_, Qt::CaseInsensitive)) {
-            return 0;
-        }
-
-        // Otherwise, if any of its children starts with the filter, it goes next
-        for (int i = 0; i < sourceModel()->rowCount(index); ++i) {
-            QModelIndex childIndex = sourceModel()->index(i, 0, index);
-            int childGroup = getSortGroup(childIndex);
-            if (childGroup < 2) {
-                return childGroup;
-            }
-        }
-    } else if (sourceModel()->data(index, kNick).toString().startsWith(filter_, Qt::CaseInsensitive) || sourceModel()->data(index, kName).toString().startsWith(filter_, Qt::CaseInsensitive)) {
-        return 1;
-    }
+    // If it's a country and the country name or code starts with the filter, it goes first.
+    // Otherwise, if any of its children starts with the filter, it goes next.
     // Did not match any beginning of any filter, so it goes last
-    return 2;
+    ensureSearchIndex();
+    return searchIndex_.sortGroup(qvariant_cast<LocationID>(sourceModel()->data(index, kLocationId)));
 }
 
 } //namespace gui_locations
@@ -2,11 +2,12 @@
 
 #include <QSortFilterProxyModel>
 #include "types/enums.h"
+#include "../locationssearchindex.h"
 
 namespace gui_locations {
 
 // The model that sorts LocationsModel depending on the selected sorting algorithm
-// Also supports the possibility of filtration if the filter string is set
+// Also supports the possibility of filtration if the filter string is set (through LocationsSearchIndex)
 class SortedLocationsProxyModel : public QSortFilterProxyModel
 {
     Q_OBJECT
@@ -14,6 +15,7 @@ public:
     explicit SortedLocationsProxyModel(QObject *parent = nullptr);
     void setLocationOrder(ORDER_LOCATION_TYPE orderLocationType);
     void setFilter(const QString &filter);
+    void setSourceModel(QAbstractItemModel *sourceModel) override;
 
 protected:
     bool lessThan(const QModelIndex &left, const QModelIndex &right) const override;
@@ -22,6 +24,11 @@ protected:
 private:
     ORDER_LOCATION_TYPE orderLocationsType_;
     QString filter_;
+    mutable LocationsSearchIndex searchIndex_;   // built on demand in the filtering
+    QList<QMetaObject::Connection> sourceConnections_;
+
+    void onSourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QList<int> &roles);
+    void ensureSearchIndex() const;
 
     bool lessThanByGeography(const QModelIndex &left, const QModelIndex &right) const;
     bool lessThanByAlphabetically(const QModelIndex &left, const QModelIndex &right) const;
@@ -34,6 +34,7 @@ const QString WS_USE_PQ_ALGORITHMS = WS_PREFIX + "use-post-quantum-algorithms";
 
 const QString WS_STEALTH_EXTRA_TLS_PADDING = WS_PREFIX + "stealth-extra-tls-padding";
 const QString WS_API_EXTRA_TLS_PADDING = WS_PREFIX + "api-extra-tls-padding";
+const QString WS_STEALTH_EXTERNAL_TUNNEL = WS_PREFIX + "stealth-external-tunnel";
 const QString WS_WG_UDP_STUFFING = WS_PREFIX + "wireguard-udp-stuffing";
 
 const QString WS_SERVERLIST_COUNTRY_OVERRIDE = WS_PREFIX + "serverlist-country-override";
@@ -283,6 +284,11 @@ bool ExtraConfig::getAPIExtraTLSPadding()
     return getFlagFromExtraConfigLines(WS_API_EXTRA_TLS_PADDING);
 }
 
+bool ExtraConfig::getStealthExternalTunnel()
+{
+    return getFlagFromExtraConfigLines(WS_STEALTH_EXTERNAL_TUNNEL);
+}
+
 bool ExtraConfig::getWireGuardUdpStuffing()
 {
     return getFlagFromExtraConfigLines(WS_WG_UDP_STUFFING);
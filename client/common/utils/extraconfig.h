@@ -55,6 +55,8 @@ public:
     bool getUsePQAlgorithms();
     bool getStealthExtraTLSPadding();
     bool getAPIExtraTLSPadding();
+    // use the windscribewstunnel process instead of the in-engine tunnel for the stealth and wstunnel protocols
+    bool getStealthExternalTunnel();
 
     bool getWireGuardVerboseLogging();
     bool getWireGuardUdpStuffing();
@@ -1,85 +1,193 @@
 #include "availableport.h"
 #include <QObject>
+#include <QThreadPool>
+#include <map>
+#include <mutex>
+#include <vector>
 
 #ifdef Q_OS_WIN
     #include <winsock2.h>
     #include <ws2tcpip.h>
 #elif defined(Q_OS_MACOS) || defined(Q_OS_LINUX)
+    #include <arpa/inet.h>
+    #include <fcntl.h>
     #include <netdb.h>
+    #include <netinet/in.h>
+    #include <string.h>
+    #include <sys/socket.h>
     #include <unistd.h>
 #endif
 
-unsigned int AvailablePort::getAvailablePort(unsigned int defaultPort)
-{
+namespace {
+
 #ifdef Q_OS_WIN
-    struct addrinfo *result = NULL;
-    struct addrinfo hints;
+typedef SOCKET SocketHandle;
+const SocketHandle kInvalidSocket = INVALID_SOCKET;
+void closeSocket(SocketHandle sock) { closesocket(sock); }
+#else
+typedef int SocketHandle;
+const SocketHandle kInvalidSocket = -1;
+void closeSocket(SocketHandle sock) { close(sock); }
+#endif
 
-    ZeroMemory(&hints, sizeof(hints));
-    hints.ai_family = AF_UNSPEC;
-    hints.ai_socktype = SOCK_STREAM;
-    hints.ai_protocol = IPPROTO_TCP;
+// binds a socket of the type (SOCK_STREAM or SOCK_DGRAM) to the port, or to an ephemeral one if the port is 0
+// a TCP socket is not listening, so no connections are accepted on it
+SocketHandle bindSocket(int type, unsigned int &port)
+{
+    SocketHandle sock = socket(AF_INET, type, type == SOCK_STREAM ? IPPROTO_TCP : IPPROTO_UDP);
+    if (sock == kInvalidSocket)
+        return kInvalidSocket;
 
-    int iResult = getaddrinfo("127.0.0.1", 0, &hints, &result);
-    if ( iResult != 0 )
-    {
-        return defaultPort;
+    // the child processes must not inherit the reserved ports
+#ifdef Q_OS_WIN
+    SetHandleInformation((HANDLE)sock, HANDLE_FLAG_INHERIT, 0);
+    // otherwise another socket with SO_REUSEADDR can still bind the port
+    BOOL exclusive = TRUE;
+    setsockopt(sock, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, (const char *)&exclusive, sizeof(exclusive));
+#else
+    fcntl(sock, F_SETFD, FD_CLOEXEC);
+#endif
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+#ifdef Q_OS_WIN
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+#else
+    addr.sin_addr.s_addr = INADDR_ANY;
+#endif
+    addr.sin_port = htons(port);
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        closeSocket(sock);
+        return kInvalidSocket;
     }
 
-    SOCKET sock = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
-    if (sock == INVALID_SOCKET)
-    {
-        freeaddrinfo(result);
-        return defaultPort;
+#ifdef Q_OS_WIN
+    int len = sizeof(addr);
+#else
+    socklen_t len = sizeof(addr);
+#endif
+    if (getsockname(sock, (struct sockaddr *)&addr, &len) != 0) {
+        closeSocket(sock);
+        return kInvalidSocket;
     }
+    port = ntohs(addr.sin_port);
+    return sock;
+}
 
-    iResult = bind( sock, result->ai_addr, (int)result->ai_addrlen);
-    if (iResult == SOCKET_ERROR)
+class PortPool
+{
+public:
+    static PortPool &instance()
     {
-        freeaddrinfo(result);
-        closesocket(sock);
-        return defaultPort;
+        static PortPool pp;
+        return pp;
     }
-    struct sockaddr_in foo;
-    int len = sizeof(struct sockaddr);
-    int retPort = -1;
-    if (getsockname(sock, (struct sockaddr *) &foo, &len) != SOCKET_ERROR)
+
+    unsigned int reserve(unsigned int defaultPort)
     {
-        retPort = ntohs(foo.sin_port);
+        std::unique_lock<std::mutex> locker(mutex_);
+        Port port;
+        if (!warmPorts_.empty()) {
+            port = warmPorts_.back();
+            warmPorts_.pop_back();
+        } else {
+            port.sock = bindSocket(SOCK_STREAM, port.port);
+        }
+        startRefill();
+        if (port.sock == kInvalidSocket)
+            return defaultPort;
+        reservedPorts_[port.port] = port;
+        return port.port;
     }
 
-    freeaddrinfo(result);
-    closesocket(sock);
-    return retPort;
-#elif defined(Q_OS_MACOS) || defined(Q_OS_LINUX)
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-    if  (sock < 0)
+    unsigned int reserveUdpAndTcp(unsigned int defaultPort)
     {
+        std::unique_lock<std::mutex> locker(mutex_);
+        // the ephemeral UDP port may be taken for TCP, then another one is tried
+        for (int i = 0; i < kUdpAndTcpAttempts; ++i) {
+            Port port;
+            port.udpSock = bindSocket(SOCK_DGRAM, port.port);
+            if (port.udpSock == kInvalidSocket)
+                break;
+            port.sock = bindSocket(SOCK_STREAM, port.port);
+            if (port.sock != kInvalidSocket) {
+                reservedPorts_[port.port] = port;
+                return port.port;
+            }
+            closeSocket(port.udpSock);
+        }
         return defaultPort;
     }
 
-    struct sockaddr_in serv_addr;
-    memset(&serv_addr, 0, sizeof(serv_addr));
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_addr.s_addr = INADDR_ANY;
-    serv_addr.sin_port = 0;
-    if (bind(sock, (struct sockaddr *) &serv_addr, sizeof(serv_addr)) < 0)
+    void release(unsigned int port)
     {
-        close(sock);
-        return defaultPort;
+        std::unique_lock<std::mutex> locker(mutex_);
+        auto it = reservedPorts_.find(port);
+        if (it != reservedPorts_.end()) {
+            closeSocket(it->second.sock);
+            if (it->second.udpSock != kInvalidSocket)
+                closeSocket(it->second.udpSock);
+            reservedPorts_.erase(it);
+        }
     }
 
-    socklen_t len = sizeof(serv_addr);
-    if (getsockname(sock, (struct sockaddr *)&serv_addr, &len) == -1)
+private:
+    static constexpr size_t kWarmPortsCount = 4;
+    static constexpr int kUdpAndTcpAttempts = 8;
+
+    struct Port
     {
-        close(sock);
-        return defaultPort;
+        unsigned int port = 0;
+        SocketHandle sock = kInvalidSocket;
+        SocketHandle udpSock = kInvalidSocket;
+    };
+
+    std::mutex mutex_;
+    std::vector<Port> warmPorts_;
+    std::map<unsigned int, Port> reservedPorts_;
+    bool isRefilling_ = false;
+
+    // must be called with the mutex locked
+    void startRefill()
+    {
+        if (isRefilling_ || warmPorts_.size() >= kWarmPortsCount)
+            return;
+        isRefilling_ = true;
+        QThreadPool::globalInstance()->start([this]() {
+            std::vector<Port> ports;
+            {
+                std::unique_lock<std::mutex> locker(mutex_);
+                ports.resize(kWarmPortsCount - warmPorts_.size());
+            }
+            for (Port &port : ports)
+                port.sock = bindSocket(SOCK_STREAM, port.port);
+
+            std::unique_lock<std::mutex> locker(mutex_);
+            for (const Port &port : ports) {
+                if (port.sock != kInvalidSocket)
+                    warmPorts_.push_back(port);
+            }
+            isRefilling_ = false;
+        });
     }
+};
 
-    unsigned int retPort = ntohs(serv_addr.sin_port);
-    close (sock);
-    return retPort;
-#endif
+} // namespace
+
+unsigned int AvailablePort::reservePort(unsigned int defaultPort)
+{
+    return PortPool::instance().reserve(defaultPort);
+}
+
+unsigned int AvailablePort::reserveUdpAndTcpPort(unsigned int defaultPort)
+{
+    return PortPool::instance().reserveUdpAndTcp(defaultPort);
+}
+
+void AvailablePort::releasePort(unsigned int port)
+{
+    PortPool::instance().release(port);
 }
 
 bool AvailablePort::isPortBusy(const QString &ip, unsigned int port)
@@ -2,9 +2,18 @@
 
 #include <QString>
 
+// Local ports for the helper processes (openvpn management, stunnel, wstunnel, ctrld).
+// A port is reserved by keeping a socket of the engine bound to it, so another application cannot take it
+// between the choice of the port and the start of the process. The reservation is released right before
+// the process binds the port. A few ports are kept reserved in advance and the pool is refilled in the background.
 class AvailablePort
 {
 public:
-    static unsigned int getAvailablePort(unsigned int defaultPort);
+    // defaultPort is returned if no port can be reserved
+    static unsigned int reservePort(unsigned int defaultPort);
+    // the same for a process that listens on both UDP and TCP (ctrld), the port is held for both protocols
+    static unsigned int reserveUdpAndTcpPort(unsigned int defaultPort);
+    // must be called right before the process that listens on the port is started, no-op if the port is not reserved
+    static void releasePort(unsigned int port);
     static bool isPortBusy(const QString &ip, unsigned int port);
 };
@@ -11,6 +11,7 @@
 #include "engine/crossplatformobjectfactory.h"
 #include "testvpntunnel.h"
 #include "engine/wireguardconfig/getwireguardconfig.h"
+#include "engine/wireguardconfig/wireguardconfigcache.h"
 
 #include "utils/ws_assert.h"
 #include "utils/utils.h"
@@ -1043,6 +1044,11 @@ void ConnectionManager::doConnectPart2()
         {
             qCInfo(LOG_CONNECTION) << "Requesting WireGuard config for hostname =" << currentConnectionDescr_.hostname;
             QString deviceId = (isStaticIpsLocation() ? GetDeviceId::instance().getDeviceId() : QString());
+            if (deviceId.isEmpty() && wireGuardConfigCache_ && wireGuardConfigCache_->take(currentConnectionDescr_.hostname, wireGuardConfig_)) {
+                qCInfo(LOG_CONNECTION) << "Using the prefetched WireGuard config";
+                doConnectPart3();
+                return;
+            }
             getWireGuardConfig(currentConnectionDescr_.hostname, false, deviceId);
             return;
         }
@@ -1452,6 +1458,11 @@ void ConnectionManager::onWireGuardKeyLimitUserResponse(bool deleteOldestKey)
     }
 }
 
+void ConnectionManager::setWireGuardConfigCache(WireGuardConfigCache *cache)
+{
+    wireGuardConfigCache_ = cache;
+}
+
 void ConnectionManager::setPacketSize(types::PacketSize ps)
 {
     packetSize_ = ps;
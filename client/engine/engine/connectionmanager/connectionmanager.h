@@ -31,6 +31,7 @@ class IKEv2Connection;
 class TestVPNTunnel;
 enum class WireGuardConfigRetCode;
 class GetWireGuardConfig;
+class WireGuardConfigCache;
 
 // manage openvpn connection, reconnects, sleep mode, network change, automatic/manual connection mode
 
@@ -76,6 +77,8 @@ public:
     api_responses::StaticIpPortsVector getStatisIps();
 
     void onWireGuardKeyLimitUserResponse(bool deleteOldestKey);
+    // the prefetched WireGuard configs are used instead of the API requests if available
+    void setWireGuardConfigCache(WireGuardConfigCache *cache);
 
     void setMss(int mss);
     void setPacketSize(types::PacketSize ps);
@@ -212,6 +215,7 @@ private:
 
     WireGuardConfig wireGuardConfig_;
     GetWireGuardConfig *getWireGuardConfig_ = nullptr;
+    WireGuardConfigCache *wireGuardConfigCache_ = nullptr;
 
     AdapterGatewayInfo defaultAdapterInfo_;
     AdapterGatewayInfo vpnAdapterInfo_;
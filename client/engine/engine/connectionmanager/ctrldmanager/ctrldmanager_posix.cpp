@@ -4,10 +4,18 @@
 #include <QStandardPaths>
 #include "utils/log/categories.h"
 #include "utils/ws_assert.h"
+#include "../availableport.h"
 
 CtrldManager_posix::CtrldManager_posix(QObject *parent, IHelper *helper, bool isCreateLog) : ICtrldManager(parent, isCreateLog), helper_(helper), bProcessStarted_(false)
 {
     listenIp_ = "127.0.0.1";    // default listen ip for ctrld utility
+#ifdef Q_OS_MACOS
+    // binding the privileged ports is not restricted on macOS
+    dnsStubCache_ = new DnsStubCache(this);
+    connect(dnsStubCache_, &DnsStubCache::upstreamUnreachable, this, &CtrldManager_posix::onDnsStubCacheUpstreamUnreachable);
+#else
+    dnsStubCache_ = nullptr;
+#endif
 }
 
 CtrldManager_posix::~CtrldManager_posix()
@@ -19,9 +27,28 @@ bool CtrldManager_posix::runProcess(const QString &upstream1, const QString &ups
 {
     WS_ASSERT(!bProcessStarted_);
 
-    if (helper_->startCtrld(addWsSuffix(upstream1), addWsSuffix(upstream2), domains, isCreateLog_)) {
+    upstream1_ = upstream1;
+    upstream2_ = upstream2;
+    domains_ = domains;
+
+    unsigned int ctrldPort = kDnsPort;
+    if (dnsStubCache_) {
+        ctrldPort = AvailablePort::reserveUdpAndTcpPort(kDefaultCtrldPort);
+        if (!dnsStubCache_->start(QHostAddress(listenIp_), kDnsPort, QHostAddress(listenIp_), ctrldPort)) {
+            qCInfo(LOG_CTRLD) << "DNS stub cache is not available, ctrld will listen on port" << kDnsPort;
+            AvailablePort::releasePort(ctrldPort);
+            ctrldPort = kDnsPort;
+        }
+    }
+
+    // the reserved port is freed for ctrld right before it starts
+    if (ctrldPort != kDnsPort)
+        AvailablePort::releasePort(ctrldPort);
+    if (helper_->startCtrld(addWsSuffix(upstream1), addWsSuffix(upstream2), domains, ctrldPort, isCreateLog_)) {
         bProcessStarted_ = true;
-        qCInfo(LOG_CTRLD) << "ctrld started";
+        qCInfo(LOG_CTRLD) << "ctrld started on port" << ctrldPort;
+    } else if (dnsStubCache_) {
+        dnsStubCache_->stop();
     }
     return bProcessStarted_;
 }
@@ -31,6 +58,8 @@ void CtrldManager_posix::killProcess()
     if (bProcessStarted_) {
         bProcessStarted_ = false;
         helper_->stopCtrld();
+        if (dnsStubCache_)
+            dnsStubCache_->stop();
         qCInfo(LOG_CTRLD) << "ctrld stopped";
     }
 }
@@ -39,3 +68,20 @@ QString CtrldManager_posix::listenIp() const
 {
     return listenIp_;
 }
+
+void CtrldManager_posix::onDnsStubCacheUpstreamUnreachable()
+{
+    if (!bProcessStarted_)
+        return;
+
+    // ctrld could not bind its port, it takes port 53 from the stub cache
+    qCWarning(LOG_CTRLD) << "ctrld is not reachable behind the DNS stub cache, restarting it on port" << kDnsPort;
+    dnsStubCache_->stop();
+    helper_->stopCtrld();
+    if (helper_->startCtrld(addWsSuffix(upstream1_), addWsSuffix(upstream2_), domains_, kDnsPort, isCreateLog_)) {
+        qCInfo(LOG_CTRLD) << "ctrld started on port" << kDnsPort;
+    } else {
+        bProcessStarted_ = false;
+        qCCritical(LOG_CTRLD) << "ctrld failed to restart on port" << kDnsPort;
+    }
+}
@@ -2,6 +2,7 @@
 
 #include "ictrldmanager.h"
 #include "engine/helper/ihelper.h"
+#include "dnsstubcache.h"
 
 class CtrldManager_posix : public ICtrldManager
 {
@@ -14,10 +15,22 @@ public:
     void killProcess();
     QString listenIp() const;
 
+private slots:
+    void onDnsStubCacheUpstreamUnreachable();
+
 private:
+    static constexpr quint16 kDnsPort = 53;
+    static constexpr unsigned int kDefaultCtrldPort = 53530;
+
     IHelper *helper_;
     bool bProcessStarted_;
     QString listenIp_;
+    QString upstream1_;
+    QString upstream2_;
+    QStringList domains_;
+    // in front of ctrld on macOS; nullptr on Linux, where the engine is not root and cannot listen on port 53,
+    // so ctrld listens on it directly
+    DnsStubCache *dnsStubCache_;
 
     QString getAvailableIp();
 };
@@ -8,7 +8,8 @@
 #include "utils/executable_signature/executable_signature.h"
 
 
-CtrldManager_win::CtrldManager_win(QObject *parent, bool isCreateLog) : ICtrldManager(parent, isCreateLog), bProcessStarted_(false)
+CtrldManager_win::CtrldManager_win(QObject *parent, bool isCreateLog) : ICtrldManager(parent, isCreateLog), bProcessStarted_(false),
+    ctrldPort_(kDnsPort)
 {
     process_ = new QProcess(this);
     connect(process_, &QProcess::started, this, &CtrldManager_win::onProcessStarted);
@@ -20,6 +21,8 @@ CtrldManager_win::CtrldManager_win(QObject *parent, bool isCreateLog) : ICtrldMa
     ctrldExePath_ = QCoreApplication::applicationDirPath() + "/windscribectrld.exe";
     logPath_ = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/ctrld.log";
     listenIp_ = "127.0.0.1";    // default listen ip for ctrld utility
+    dnsStubCache_ = new DnsStubCache(this);
+    connect(dnsStubCache_, &DnsStubCache::upstreamUnreachable, this, &CtrldManager_win::onDnsStubCacheUpstreamUnreachable);
 }
 
 CtrldManager_win::~CtrldManager_win()
@@ -41,33 +44,50 @@ bool CtrldManager_win::runProcess(const QString &upstream1, const QString &upstr
         return false;
     }
 
+    ctrldPort_ = AvailablePort::reserveUdpAndTcpPort(kDefaultCtrldPort);
+    if (!dnsStubCache_->start(QHostAddress(ip), kDnsPort, QHostAddress(ip), ctrldPort_)) {
+        qCInfo(LOG_CTRLD) << "DNS stub cache is not available, ctrld will listen on port" << kDnsPort;
+        AvailablePort::releasePort(ctrldPort_);
+        ctrldPort_ = kDnsPort;
+    }
+
     inputArr_.clear();
     bProcessStarted_ = true;
-    QStringList args;
 
-    args << "run";
-    args << "--listen=" + ip + ":53";
-    args << "--primary_upstream=" + addWsSuffix(upstream1);
+    ctrldArgs_.clear();
+    ctrldArgs_ << "--primary_upstream=" + addWsSuffix(upstream1);
     if (!upstream2.isEmpty()) {
-        args << "--secondary_upstream=" + addWsSuffix(upstream2);
+        ctrldArgs_ << "--secondary_upstream=" + addWsSuffix(upstream2);
         if (!domains.isEmpty()) {
-            args << "--domains=" + domains.join(',');
+            ctrldArgs_ << "--domains=" + domains.join(',');
         }
     }
     if (isCreateLog_) {
-        args << "--log" << logPath_;
-        args << "-vv";
+        ctrldArgs_ << "--log" << logPath_;
+        ctrldArgs_ << "-vv";
     }
-    process_->start(ctrldExePath_, args);
+    startProcess();
     return true;
 }
 
+void CtrldManager_win::startProcess()
+{
+    QStringList args;
+    args << "run";
+    args << "--listen=" + listenIp_ + ":" + QString::number(ctrldPort_);
+    args << ctrldArgs_;
+    // the reserved port is freed for ctrld right before it starts
+    AvailablePort::releasePort(ctrldPort_);
+    process_->start(ctrldExePath_, args);
+}
+
 void CtrldManager_win::killProcess()
 {
     if (bProcessStarted_) {
         bProcessStarted_ = false;
         process_->close();
         process_->waitForFinished(-1);
+        dnsStubCache_->stop();
         qCInfo(LOG_CTRLD) << "ctrld stopped";
     }
 }
@@ -79,7 +99,7 @@ QString CtrldManager_win::listenIp() const
 
 void CtrldManager_win::onProcessStarted()
 {
-    qCInfo(LOG_CTRLD) << "ctrld started on " << listenIp_ + ":53";
+    qCInfo(LOG_CTRLD) << "ctrld started on " << listenIp_ + ":" + QString::number(ctrldPort_);
 }
 
 void CtrldManager_win::onProcessFinished()
@@ -90,6 +110,25 @@ void CtrldManager_win::onProcessFinished()
     }
 }
 
+void CtrldManager_win::onDnsStubCacheUpstreamUnreachable()
+{
+    if (!bProcessStarted_)
+        return;
+
+    // ctrld could not bind its port, it takes port 53 from the stub cache
+    qCWarning(LOG_CTRLD) << "ctrld is not reachable behind the DNS stub cache, restarting it on port" << kDnsPort;
+    dnsStubCache_->stop();
+    // no "ctrld finished" log for the restart
+    bProcessStarted_ = false;
+    process_->close();
+    process_->waitForFinished(-1);
+
+    ctrldPort_ = kDnsPort;
+    inputArr_.clear();
+    bProcessStarted_ = true;
+    startProcess();
+}
+
 void CtrldManager_win::onReadyReadStandardOutput()
 {
     inputArr_.append(process_->readAll());
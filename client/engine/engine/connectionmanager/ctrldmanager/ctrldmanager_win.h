@@ -2,6 +2,7 @@
 
 #include <QProcess>
 #include "ictrldmanager.h"
+#include "dnsstubcache.h"
 
 class CtrldManager_win : public ICtrldManager
 {
@@ -19,15 +20,24 @@ private slots:
     void onProcessFinished();
     void onReadyReadStandardOutput();
     void onProcessErrorOccurred(QProcess::ProcessError error);
+    void onDnsStubCacheUpstreamUnreachable();
 
 private:
+    static constexpr quint16 kDnsPort = 53;
+    static constexpr unsigned int kDefaultCtrldPort = 53530;
+
     QProcess *process_;
     QString ctrldExePath_;
     QString logPath_;
     bool bProcessStarted_;
     QString listenIp_;
+    unsigned int ctrldPort_;
+    QStringList ctrldArgs_;     // without --listen
     QByteArray inputArr_;
+    // in front of ctrld, which listens on another port then
+    DnsStubCache *dnsStubCache_;
 
+    void startProcess();
     QString getNextStringFromInputBuffer(bool &bSuccess, int &outSize);
     QString getAvailableIp();
 };
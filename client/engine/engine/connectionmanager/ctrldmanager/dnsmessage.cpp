@@ -0,0 +1,201 @@
+#include "dnsmessage.h"
+
+namespace DnsMessage {
+
+namespace {
+
+constexpr quint16 kTypeSoa = 6;
+constexpr quint16 kTypeOpt = 41;
+
+constexpr quint8 kFlagQr = 0x80;
+constexpr quint8 kFlagTc = 0x02;
+constexpr quint8 kFlagRd = 0x01;
+constexpr quint8 kFlagCd = 0x10;
+constexpr quint16 kEdnsFlagDo = 0x8000;
+
+quint16 read16(const QByteArray &data, int offset)
+{
+    return (quint16(quint8(data[offset])) << 8) | quint8(data[offset + 1]);
+}
+
+quint32 read32(const QByteArray &data, int offset)
+{
+    return (quint32(read16(data, offset)) << 16) | read16(data, offset + 2);
+}
+
+void write16(QByteArray &data, int offset, quint16 value)
+{
+    data[offset] = char(value >> 8);
+    data[offset + 1] = char(value & 0xFF);
+}
+
+// moves pos past the name, follows no compression pointers (the name ends at the pointer)
+bool skipName(const QByteArray &data, int &pos, bool isCompressionAllowed)
+{
+    while (pos < data.size()) {
+        const quint8 len = quint8(data[pos]);
+        if (len == 0) {
+            pos++;
+            return true;
+        }
+        if ((len & 0xC0) == 0xC0) {
+            if (!isCompressionAllowed || pos + 2 > data.size())
+                return false;
+            pos += 2;
+            return true;
+        }
+        if (len & 0xC0)
+            return false;
+        pos += 1 + len;
+    }
+    return false;
+}
+
+// the question must be the first one and uncompressed, returns the size of the question section
+int parseQuestion(const QByteArray &data)
+{
+    int pos = kHeaderSize;
+    if (!skipName(data, pos, false) || pos + 4 > data.size())
+        return -1;
+    return pos + 4 - kHeaderSize;
+}
+
+} // namespace
+
+bool parseQuery(const QByteArray &data, Query &query)
+{
+    if (data.size() < kHeaderSize)
+        return false;
+
+    const quint8 flags1 = quint8(data[2]);
+    const quint8 flags2 = quint8(data[3]);
+    // a query with the standard opcode and a single question, no answers
+    if ((flags1 & kFlagQr) || (flags1 & 0x78) || read16(data, 4) != 1 || read16(data, 6) != 0 || read16(data, 8) != 0)
+        return false;
+
+    const int questionSize = parseQuestion(data);
+    if (questionSize == -1)
+        return false;
+
+    query.id = read16(data, 0);
+    query.question = data.mid(kHeaderSize, questionSize);
+    query.isEdns = false;
+    query.isDnssecOk = false;
+    query.maxResponseSize = kMaxUdpSizeWithoutEdns;
+
+    // the additional section may contain only the OPT record
+    int pos = kHeaderSize + questionSize;
+    const quint16 additionalCount = read16(data, 10);
+    for (int i = 0; i < additionalCount; ++i) {
+        if (!skipName(data, pos, true) || pos + 10 > data.size())
+            return false;
+        const quint16 type = read16(data, pos);
+        const quint16 rdLength = read16(data, pos + 8);
+        if (type == kTypeOpt) {
+            query.isEdns = true;
+            query.maxResponseSize = qMax(read16(data, pos + 2), kMaxUdpSizeWithoutEdns);
+            query.isDnssecOk = read16(data, pos + 6) & kEdnsFlagDo;
+        }
+        pos += 10 + rdLength;
+        if (pos > data.size())
+            return false;
+    }
+
+    // the label lengths are below 'A', so only the name letters are affected
+    query.key = query.question.left(questionSize - 4).toLower() + query.question.right(4);
+    query.key.append(char(flags1 & kFlagRd));
+    query.key.append(char(flags2 & kFlagCd));
+    query.key.append(char(query.isEdns));
+    query.key.append(char(query.isDnssecOk));
+    return true;
+}
+
+bool parseResponse(const QByteArray &data, Response &response)
+{
+    if (data.size() < kHeaderSize)
+        return false;
+
+    const quint8 flags1 = quint8(data[2]);
+    if (!(flags1 & kFlagQr) || read16(data, 4) != 1)
+        return false;
+
+    const int questionSize = parseQuestion(data);
+    if (questionSize == -1)
+        return false;
+
+    response.rcode = quint8(data[3]) & 0x0F;
+    response.isTruncated = flags1 & kFlagTc;
+    response.question = data.mid(kHeaderSize, questionSize);
+    response.answerCount = read16(data, 6);
+    response.minAnswerTtl = 0;
+    response.negativeTtl = -1;
+    response.ttlOffsets.clear();
+
+    const int authorityCount = read16(data, 8);
+    const int recordsCount = response.answerCount + authorityCount + read16(data, 10);
+    int pos = kHeaderSize + questionSize;
+    for (int i = 0; i < recordsCount; ++i) {
+        if (!skipName(data, pos, true) || pos + 10 > data.size())
+            return false;
+        const quint16 type = read16(data, pos);
+        const quint32 ttl = read32(data, pos + 4);
+        const quint16 rdLength = read16(data, pos + 8);
+        if (pos + 10 + rdLength > data.size())
+            return false;
+
+        // the OPT "TTL" is the extended rcode and flags
+        if (type != kTypeOpt)
+            response.ttlOffsets << pos + 4;
+
+        if (i < response.answerCount) {
+            if (i == 0 || ttl < response.minAnswerTtl)
+                response.minAnswerTtl = ttl;
+        } else if (i < response.answerCount + authorityCount && type == kTypeSoa && rdLength >= 20) {
+            const quint32 minimum = read32(data, pos + 10 + rdLength - 4);
+            response.negativeTtl = qMin(ttl, minimum);
+        }
+        pos += 10 + rdLength;
+    }
+    return true;
+}
+
+bool isSameQuestion(const QByteArray &question1, const QByteArray &question2)
+{
+    if (question1.size() != question2.size() || question1.size() < 5)
+        return false;
+    const int nameSize = question1.size() - 4;
+    return question1.right(4) == question2.right(4) && question1.left(nameSize).compare(question2.left(nameSize), Qt::CaseInsensitive) == 0;
+}
+
+quint16 id(const QByteArray &data)
+{
+    return data.size() >= 2 ? read16(data, 0) : 0;
+}
+
+void setId(QByteArray &data, quint16 id)
+{
+    write16(data, 0, id);
+}
+
+void setTtl(QByteArray &data, int offset, quint32 ttl)
+{
+    write16(data, offset, quint16(ttl >> 16));
+    write16(data, offset + 2, quint16(ttl & 0xFFFF));
+}
+
+quint32 ttl(const QByteArray &data, int offset)
+{
+    return read32(data, offset);
+}
+
+QByteArray truncated(const QByteArray &response, int questionSize)
+{
+    QByteArray result = response.left(kHeaderSize + questionSize);
+    result[2] = char(quint8(result[2]) | kFlagTc);
+    write16(result, 6, 0);
+    write16(result, 8, 0);
+    write16(result, 10, 0);
+    return result;
+}
+
+} // namespace DnsMessage
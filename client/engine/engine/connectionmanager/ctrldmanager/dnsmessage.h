@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QByteArray>
+#include <QVector>
+
+// Minimal DNS wire format parsing for DnsStubCache (RFC 1035, EDNS RFC 6891, negative caching RFC 2308).
+// Only what the cache needs: the question, the flags, the record TTLs and the EDNS OPT record.
+namespace DnsMessage {
+
+constexpr int kHeaderSize = 12;
+constexpr quint16 kMaxUdpSizeWithoutEdns = 512;
+
+constexpr quint8 kRcodeNoError = 0;
+constexpr quint8 kRcodeNxDomain = 3;
+
+struct Query
+{
+    quint16 id = 0;
+    QByteArray question;        // the raw question section (name, type, class) as the client sent it
+    QByteArray key;             // the cache key: the lowercase question, RD/CD flags and the EDNS state
+    bool isEdns = false;
+    bool isDnssecOk = false;
+    quint16 maxResponseSize = kMaxUdpSizeWithoutEdns;
+};
+
+struct Response
+{
+    quint8 rcode = 0;
+    bool isTruncated = false;
+    QByteArray question;
+    int answerCount = 0;
+    quint32 minAnswerTtl = 0;
+    qint64 negativeTtl = -1;    // min(SOA TTL, SOA MINIMUM) from the authority section, -1 if there is no SOA
+    QVector<int> ttlOffsets;    // the offsets of the TTL fields of all the records except OPT
+};
+
+// false if the message is not a standard query with a single question
+bool parseQuery(const QByteArray &data, Query &query);
+// false if the message is not a well-formed response with a single question
+bool parseResponse(const QByteArray &data, Response &response);
+
+// the names are compared case-insensitively, the clients may randomize the case (DNS 0x20)
+bool isSameQuestion(const QByteArray &question1, const QByteArray &question2);
+
+quint16 id(const QByteArray &data);
+void setId(QByteArray &data, quint16 id);
+void setTtl(QByteArray &data, int offset, quint32 ttl);
+quint32 ttl(const QByteArray &data, int offset);
+
+// the header and the question only with the TC flag, so the client retries over TCP
+QByteArray truncated(const QByteArray &response, int questionSize);
+
+} // namespace DnsMessage
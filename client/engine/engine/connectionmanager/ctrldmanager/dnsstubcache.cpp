@@ -0,0 +1,321 @@
+#include "dnsstubcache.h"
+#include <QNetworkDatagram>
+#include <QRandomGenerator>
+#include <QTcpSocket>
+#include "utils/log/categories.h"
+#include "utils/ws_assert.h"
+
+DnsStubCache::DnsStubCache(QObject *parent) : QObject(parent), upstreamPort_(0), isUpstreamAnswered_(false), unansweredCount_(0), hitsCount_(0), missesCount_(0), prefetchesCount_(0)
+{
+    listenSocket_ = new QUdpSocket(this);
+    connect(listenSocket_, &QUdpSocket::readyRead, this, &DnsStubCache::onListenSocketReadyRead);
+    upstreamSocket_ = new QUdpSocket(this);
+    connect(upstreamSocket_, &QUdpSocket::readyRead, this, &DnsStubCache::onUpstreamSocketReadyRead);
+    tcpServer_ = new QTcpServer(this);
+    connect(tcpServer_, &QTcpServer::newConnection, this, &DnsStubCache::onNewTcpConnection);
+
+    timeoutTimer_.setInterval(1000);
+    connect(&timeoutTimer_, &QTimer::timeout, this, &DnsStubCache::onTimeoutTimer);
+    elapsedTimer_.start();
+}
+
+DnsStubCache::~DnsStubCache()
+{
+    stop();
+}
+
+bool DnsStubCache::start(const QHostAddress &listenAddress, quint16 listenPort, const QHostAddress &upstreamAddress, quint16 upstreamPort)
+{
+    WS_ASSERT(!isStarted());
+
+    // the same port for UDP and TCP
+    if (!listenSocket_->bind(listenAddress, listenPort) || !tcpServer_->listen(listenAddress, listenSocket_->localPort())) {
+        qCInfo(LOG_CTRLD) << "DNS stub cache cannot listen on" << listenAddress.toString() << listenPort << listenSocket_->errorString();
+        stop();
+        return false;
+    }
+    const QHostAddress anyAddress = upstreamAddress.protocol() == QAbstractSocket::IPv6Protocol ? QHostAddress::AnyIPv6 : QHostAddress::AnyIPv4;
+    if (!upstreamSocket_->bind(anyAddress, 0)) {
+        qCCritical(LOG_CTRLD) << "DNS stub cache cannot bind the upstream socket" << upstreamSocket_->errorString();
+        stop();
+        return false;
+    }
+
+    upstreamAddress_ = upstreamAddress;
+    upstreamPort_ = upstreamPort;
+    isUpstreamAnswered_ = false;
+    unansweredCount_ = 0;
+    hitsCount_ = 0;
+    missesCount_ = 0;
+    prefetchesCount_ = 0;
+    qCInfo(LOG_CTRLD) << "DNS stub cache started on" << listenAddress.toString() << listenSocket_->localPort()
+                      << "upstream" << upstreamAddress.toString() << upstreamPort;
+    return true;
+}
+
+void DnsStubCache::stop()
+{
+    if (isStarted()) {
+        qCInfo(LOG_CTRLD) << "DNS stub cache stopped, hits:" << hitsCount_ << "misses:" << missesCount_ << "prefetches:" << prefetchesCount_;
+    }
+
+    listenSocket_->close();
+    upstreamSocket_->close();
+    tcpServer_->close();
+    const auto connections = tcpServer_->findChildren<QTcpSocket *>(QString(), Qt::FindDirectChildrenOnly);
+    for (QTcpSocket *socket : connections) {
+        socket->abort();
+        socket->deleteLater();
+    }
+
+    timeoutTimer_.stop();
+    pending_.clear();
+    pendingByKey_.clear();
+    cache_.clear();
+}
+
+bool DnsStubCache::isStarted() const
+{
+    return listenSocket_->state() == QAbstractSocket::BoundState;
+}
+
+quint16 DnsStubCache::listenPort() const
+{
+    return listenSocket_->localPort();
+}
+
+qint64 DnsStubCache::nowMs() const
+{
+    return elapsedTimer_.elapsed();
+}
+
+void DnsStubCache::onListenSocketReadyRead()
+{
+    while (listenSocket_->hasPendingDatagrams()) {
+        const QNetworkDatagram datagram = listenSocket_->receiveDatagram();
+        const QByteArray data = datagram.data();
+        if (!datagram.isValid() || data.size() < DnsMessage::kHeaderSize)
+            continue;
+
+        Client client;
+        client.address = datagram.senderAddress();
+        client.port = datagram.senderPort();
+
+        DnsMessage::Query query;
+        if (!DnsMessage::parseQuery(data, query)) {
+            // not a regular query, relay it as is without caching
+            client.id = DnsMessage::id(data);
+            client.maxResponseSize = 0xFFFF;
+            sendUpstream(QByteArray(), QByteArray(), data, &client);
+            continue;
+        }
+
+        client.id = query.id;
+        client.question = query.question;
+        client.maxResponseSize = query.maxResponseSize;
+        if (answerFromCache(query.key, client)) {
+            hitsCount_++;
+            continue;
+        }
+
+        missesCount_++;
+        auto it = pendingByKey_.constFind(query.key);
+        if (it != pendingByKey_.constEnd()) {
+            // the same query is already in flight, answer with its response
+            pending_[it.value()].clients << client;
+            continue;
+        }
+        sendUpstream(query.key, query.question, data, &client);
+    }
+}
+
+void DnsStubCache::onUpstreamSocketReadyRead()
+{
+    while (upstreamSocket_->hasPendingDatagrams()) {
+        const QNetworkDatagram datagram = upstreamSocket_->receiveDatagram();
+        if (!datagram.isValid() || datagram.senderAddress() != upstreamAddress_ || datagram.senderPort() != upstreamPort_)
+            continue;
+
+        isUpstreamAnswered_ = true;
+        const QByteArray data = datagram.data();
+        auto it = pending_.find(DnsMessage::id(data));
+        if (it == pending_.end())
+            continue;
+
+        const Pending pending = it.value();
+        pending_.erase(it);
+
+        if (!pending.key.isEmpty()) {
+            pendingByKey_.remove(pending.key);
+            DnsMessage::Response response;
+            if (!DnsMessage::parseResponse(data, response) || !DnsMessage::isSameQuestion(response.question, pending.question)) {
+                qCDebug(LOG_CTRLD) << "DNS stub cache dropped an invalid upstream response";
+                continue;
+            }
+            addToCache(pending.key, pending.query, data, response);
+        }
+
+        for (const Client &client : pending.clients)
+            sendToClient(client, data);
+    }
+}
+
+void DnsStubCache::onNewTcpConnection()
+{
+    while (QTcpSocket *client = tcpServer_->nextPendingConnection()) {
+        QTcpSocket *upstream = new QTcpSocket(client);
+        connect(upstream, &QTcpSocket::connected, client, [client, upstream]() {
+            connect(client, &QTcpSocket::readyRead, upstream, [client, upstream]() { upstream->write(client->readAll()); });
+            upstream->write(client->readAll());
+        });
+        connect(upstream, &QTcpSocket::readyRead, client, [client, upstream]() { client->write(upstream->readAll()); });
+        connect(upstream, &QTcpSocket::disconnected, client, &QTcpSocket::disconnectFromHost);
+        connect(upstream, &QTcpSocket::errorOccurred, client, &QTcpSocket::disconnectFromHost);
+        // the upstream socket is a child of the client one
+        connect(client, &QTcpSocket::disconnected, client, &QTcpSocket::deleteLater);
+        upstream->connectToHost(upstreamAddress_, upstreamPort_);
+    }
+}
+
+void DnsStubCache::onTimeoutTimer()
+{
+    // the clients retry by themselves
+    const qint64 now = nowMs();
+    bool isUnreachable = false;
+    for (auto it = pending_.begin(); it != pending_.end(); ) {
+        if (now - it->sentTimeMs >= kUpstreamTimeoutMs) {
+            if (!it->key.isEmpty())
+                pendingByKey_.remove(it->key);
+            it = pending_.erase(it);
+            if (!isUpstreamAnswered_ && ++unansweredCount_ == kMaxUnansweredQueries)
+                isUnreachable = true;
+        } else {
+            ++it;
+        }
+    }
+    if (pending_.isEmpty())
+        timeoutTimer_.stop();
+
+    // last, the receiver may stop the cache
+    if (isUnreachable) {
+        qCWarning(LOG_CTRLD) << "DNS stub cache got no response from the upstream" << upstreamAddress_.toString() << upstreamPort_;
+        emit upstreamUnreachable();
+    }
+}
+
+void DnsStubCache::sendUpstream(const QByteArray &key, const QByteArray &question, const QByteArray &query, const Client *client)
+{
+    if (pending_.size() >= kMaxPendingQueries)
+        return;
+
+    quint16 id;
+    do {
+        id = QRandomGenerator::global()->generate() & 0xFFFF;
+    } while (pending_.contains(id));
+
+    Pending pending;
+    pending.key = key;
+    pending.question = question;
+    pending.query = query;
+    if (client)
+        pending.clients << *client;
+    pending.sentTimeMs = nowMs();
+    pending_[id] = pending;
+    if (!key.isEmpty())
+        pendingByKey_[key] = id;
+
+    QByteArray upstreamQuery = query;
+    DnsMessage::setId(upstreamQuery, id);
+    upstreamSocket_->writeDatagram(upstreamQuery, upstreamAddress_, upstreamPort_);
+    if (!timeoutTimer_.isActive())
+        timeoutTimer_.start();
+}
+
+void DnsStubCache::sendToClient(const Client &client, const QByteArray &response)
+{
+    QByteArray data = response;
+    DnsMessage::setId(data, client.id);
+    if (!client.question.isEmpty()) {
+        // keep the name case of this client's query
+        data.replace(DnsMessage::kHeaderSize, client.question.size(), client.question);
+        if (data.size() > client.maxResponseSize)
+            data = DnsMessage::truncated(data, client.question.size());
+    }
+    listenSocket_->writeDatagram(data, client.address, client.port);
+}
+
+bool DnsStubCache::answerFromCache(const QByteArray &key, const Client &client)
+{
+    auto it = cache_.find(key);
+    if (it == cache_.end())
+        return false;
+
+    const quint32 elapsed = (nowMs() - it->storedTimeMs) / 1000;
+    if (elapsed >= it->ttl) {
+        cache_.erase(it);
+        return false;
+    }
+
+    it->hits++;
+    QByteArray response = it->response;
+    for (int i = 0; i < it->ttlOffsets.size(); ++i)
+        DnsMessage::setTtl(response, it->ttlOffsets[i], it->ttls[i] > elapsed ? it->ttls[i] - elapsed : 0);
+    sendToClient(client, response);
+
+    if (it->hits >= kPrefetchMinHits && it->ttl >= kPrefetchMinTtl && (it->ttl - elapsed) * 10 <= it->ttl && !pendingByKey_.contains(key)) {
+        prefetchesCount_++;
+        const QByteArray query = it->query;
+        sendUpstream(key, client.question, query, nullptr);
+    }
+    return true;
+}
+
+void DnsStubCache::addToCache(const QByteArray &key, const QByteArray &query, const QByteArray &data, const DnsMessage::Response &response)
+{
+    if (response.isTruncated)
+        return;
+
+    quint32 ttl = 0;
+    if (response.rcode == DnsMessage::kRcodeNoError && response.answerCount > 0)
+        ttl = qMin(response.minAnswerTtl, kMaxTtl);
+    else if ((response.rcode == DnsMessage::kRcodeNxDomain || response.rcode == DnsMessage::kRcodeNoError) && response.negativeTtl >= 0)
+        ttl = qMin(quint32(response.negativeTtl), kMaxNegativeTtl);
+    // SERVFAIL and the others are not cached, a prefetched entry stays until it expires
+    if (ttl == 0)
+        return;
+
+    auto it = cache_.find(key);
+    if (it == cache_.end()) {
+        if (cache_.size() >= kMaxCacheEntries)
+            evictFromCache();
+        it = cache_.insert(key, Entry());
+        it->hits = 0;
+    }
+    // the hits of a refreshed entry are kept, so a hot name stays prefetched
+    it->response = data;
+    it->ttlOffsets = response.ttlOffsets;
+    it->ttls.clear();
+    for (int offset : response.ttlOffsets)
+        it->ttls << DnsMessage::ttl(data, offset);
+    it->query = query;
+    it->ttl = ttl;
+    it->storedTimeMs = nowMs();
+}
+
+void DnsStubCache::evictFromCache()
+{
+    const qint64 now = nowMs();
+    auto earliest = cache_.end();
+    for (auto it = cache_.begin(); it != cache_.end(); ) {
+        const qint64 expiration = it->storedTimeMs + qint64(it->ttl) * 1000;
+        if (expiration <= now) {
+            it = cache_.erase(it);
+            continue;
+        }
+        if (earliest == cache_.end() || expiration < earliest->storedTimeMs + qint64(earliest->ttl) * 1000)
+            earliest = it;
+        ++it;
+    }
+    if (cache_.size() >= kMaxCacheEntries && earliest != cache_.end())
+        cache_.erase(earliest);
+}
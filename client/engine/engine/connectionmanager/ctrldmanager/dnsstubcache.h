@@ -0,0 +1,110 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QHostAddress>
+#include <QObject>
+#include <QTcpServer>
+#include <QTimer>
+#include <QUdpSocket>
+#include <QVector>
+#include "dnsmessage.h"
+
+// Caching DNS forwarder on a local address in front of the upstream resolver (ctrld), so the repeated lookups
+// do not go through ctrld and the tunnel every time.
+// UDP: the responses are cached by the question and the EDNS state of the query, with the positive TTL taken from
+// the answers and the negative one from the SOA record (RFC 2308). Identical queries in flight are sent upstream once,
+// and the names queried often are refreshed in the background shortly before they expire.
+// TCP: the connections are relayed to the upstream as is, for the clients retrying the truncated responses.
+class DnsStubCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DnsStubCache(QObject *parent);
+    virtual ~DnsStubCache();
+
+    // listenPort = 0 for any available port
+    bool start(const QHostAddress &listenAddress, quint16 listenPort, const QHostAddress &upstreamAddress, quint16 upstreamPort);
+    void stop();
+    bool isStarted() const;
+    quint16 listenPort() const;
+
+signals:
+    // emitted once if the first kMaxUnansweredQueries queries sent upstream time out, nothing listens on the upstream port
+    void upstreamUnreachable();
+
+protected:
+    // monotonic milliseconds, the tests move it forward to expire the entries
+    virtual qint64 nowMs() const;
+
+private slots:
+    void onListenSocketReadyRead();
+    void onUpstreamSocketReadyRead();
+    void onNewTcpConnection();
+    void onTimeoutTimer();
+
+private:
+    static constexpr int kMaxCacheEntries = 4096;
+    static constexpr quint32 kMaxTtl = 3600;
+    static constexpr quint32 kMaxNegativeTtl = 300;
+    static constexpr int kMaxPendingQueries = 1024;
+    static constexpr qint64 kUpstreamTimeoutMs = 5000;
+    static constexpr int kMaxUnansweredQueries = 3;
+    // prefetch the entries hit at least kPrefetchMinHits times, in the last 10% of their TTL
+    static constexpr int kPrefetchMinHits = 2;
+    static constexpr quint32 kPrefetchMinTtl = 10;
+
+    struct Client
+    {
+        QHostAddress address;
+        quint16 port;
+        quint16 id;
+        QByteArray question;
+        quint16 maxResponseSize;
+    };
+
+    struct Pending
+    {
+        QByteArray key;         // empty for the queries that are not cached
+        QByteArray question;
+        QByteArray query;       // as sent upstream, for the prefetch
+        QVector<Client> clients;
+        qint64 sentTimeMs;
+    };
+
+    struct Entry
+    {
+        QByteArray response;
+        QVector<int> ttlOffsets;
+        QVector<quint32> ttls;  // the original TTLs of the records
+        QByteArray query;       // for the prefetch
+        quint32 ttl;
+        qint64 storedTimeMs;
+        int hits;
+    };
+
+    QUdpSocket *listenSocket_;
+    QUdpSocket *upstreamSocket_;
+    QTcpServer *tcpServer_;
+    QTimer timeoutTimer_;
+    QElapsedTimer elapsedTimer_;
+
+    QHostAddress upstreamAddress_;
+    quint16 upstreamPort_;
+    bool isUpstreamAnswered_;
+    int unansweredCount_;
+
+    QHash<QByteArray, Entry> cache_;
+    QHash<quint16, Pending> pending_;           // by the upstream query id
+    QHash<QByteArray, quint16> pendingByKey_;
+
+    quint64 hitsCount_;
+    quint64 missesCount_;
+    quint64 prefetchesCount_;
+
+    void sendUpstream(const QByteArray &key, const QByteArray &question, const QByteArray &query, const Client *client);
+    void sendToClient(const Client &client, const QByteArray &response);
+    bool answerFromCache(const QByteArray &key, const Client &client);
+    void addToCache(const QByteArray &key, const QByteArray &query, const QByteArray &data, const DnsMessage::Response &response);
+    void evictFromCache();
+};
@@ -0,0 +1,371 @@
+#include <QtTest>
+#include "dnsstubcache.test.h"
+#include "dnsstubcache.h"
+#include "dnsmessage.h"
+
+// the tests move the clock of the cache forward instead of waiting for the TTLs
+class TestableDnsStubCache : public DnsStubCache
+{
+public:
+    explicit TestableDnsStubCache(QObject *parent) : DnsStubCache(parent) {}
+    qint64 offsetMs = 0;
+
+protected:
+    qint64 nowMs() const override { return DnsStubCache::nowMs() + offsetMs; }
+};
+
+namespace {
+
+void append16(QByteArray &data, quint16 value)
+{
+    data.append(char(value >> 8));
+    data.append(char(value & 0xFF));
+}
+
+void append32(QByteArray &data, quint32 value)
+{
+    append16(data, quint16(value >> 16));
+    append16(data, quint16(value & 0xFFFF));
+}
+
+void set16(QByteArray &data, int offset, quint16 value)
+{
+    data[offset] = char(value >> 8);
+    data[offset + 1] = char(value & 0xFF);
+}
+
+// -1 if the data is too short, so a missing response fails the comparisons instead of crashing
+int read16(const QByteArray &data, int offset)
+{
+    if (offset + 2 > data.size())
+        return -1;
+    return (int(quint8(data[offset])) << 8) | quint8(data[offset + 1]);
+}
+
+int rcode(const QByteArray &data)
+{
+    return read16(data, 2) == -1 ? -1 : read16(data, 2) & 0x0F;
+}
+
+bool isTruncated(const QByteArray &data)
+{
+    return read16(data, 2) != -1 && (read16(data, 2) & 0x0200);
+}
+
+QByteArray makeQuery(quint16 id, const QByteArray &name, quint16 type = 1, quint16 ednsUdpSize = 0)
+{
+    QByteArray data;
+    append16(data, id);
+    append16(data, 0x0100);     // RD
+    append16(data, 1);
+    append16(data, 0);
+    append16(data, 0);
+    append16(data, ednsUdpSize ? 1 : 0);
+    for (const QByteArray &label : name.split('.')) {
+        data.append(char(label.size()));
+        data.append(label);
+    }
+    data.append('\0');
+    append16(data, type);
+    append16(data, 1);
+    if (ednsUdpSize) {
+        data.append('\0');
+        append16(data, 41);
+        append16(data, ednsUdpSize);
+        append32(data, 0);
+        append16(data, 0);
+    }
+    return data;
+}
+
+// the answer section goes right after the question, the EDNS OPT record of the query is dropped
+QByteArray makeResponse(const QByteArray &query, quint8 rcode, int addressCount, int soaCount, quint32 ttl)
+{
+    int questionEnd = DnsMessage::kHeaderSize;
+    while (query[questionEnd] != 0)
+        questionEnd += quint8(query[questionEnd]) + 1;
+    questionEnd += 5;
+
+    QByteArray data = query.left(questionEnd);
+    data[2] = char(0x81);       // QR, RD
+    data[3] = char(0x80 | rcode);
+    set16(data, 6, addressCount);
+    set16(data, 8, soaCount);
+    set16(data, 10, 0);
+    for (int i = 0; i < addressCount; ++i) {
+        append16(data, 0xC00C);
+        append16(data, 1);
+        append16(data, 1);
+        append32(data, ttl);
+        append16(data, 4);
+        append32(data, 0x0A000001 + i);
+    }
+    for (int i = 0; i < soaCount; ++i) {
+        append16(data, 0xC00C);
+        append16(data, 6);
+        append16(data, 1);
+        append32(data, ttl);
+        append16(data, 22);
+        data.append('\0');      // mname
+        data.append('\0');      // rname
+        append32(data, 1);      // serial
+        append32(data, 3600);   // refresh
+        append32(data, 600);    // retry
+        append32(data, 86400);  // expire
+        append32(data, 30);     // minimum
+    }
+    return data;
+}
+
+} // namespace
+
+void TestDnsStubCache::init()
+{
+    upstreamQueries_.clear();
+    upstreamAddressCount_ = 1;
+
+    upstream_ = new QUdpSocket(this);
+    QVERIFY(upstream_->bind(QHostAddress::LocalHost, 0));
+    connect(upstream_, &QUdpSocket::readyRead, this, [this]() {
+        while (upstream_->hasPendingDatagrams()) {
+            const QNetworkDatagram datagram = upstream_->receiveDatagram();
+            upstreamQueries_ << datagram;
+            if (upstreamAddressCount_ != -2)
+                replyFromUpstream(datagram);
+        }
+    });
+
+    stubCache_ = new TestableDnsStubCache(this);
+    QVERIFY(stubCache_->start(QHostAddress::LocalHost, 0, QHostAddress::LocalHost, upstream_->localPort()));
+
+    client_ = new QUdpSocket(this);
+    QVERIFY(client_->bind(QHostAddress::LocalHost, 0));
+}
+
+void TestDnsStubCache::cleanup()
+{
+    delete client_;
+    delete stubCache_;
+    delete upstream_;
+}
+
+void TestDnsStubCache::replyFromUpstream(const QNetworkDatagram &query)
+{
+    QByteArray response;
+    if (upstreamAddressCount_ > 0)
+        response = makeResponse(query.data(), DnsMessage::kRcodeNoError, upstreamAddressCount_, 0, 60);
+    else if (upstreamAddressCount_ == 0)
+        response = makeResponse(query.data(), DnsMessage::kRcodeNxDomain, 0, 1, 120);
+    else
+        response = makeResponse(query.data(), 2, 0, 0, 0);
+    upstream_->writeDatagram(query.makeReply(response));
+}
+
+QByteArray TestDnsStubCache::exchange(const QByteArray &query)
+{
+    client_->writeDatagram(query, QHostAddress::LocalHost, stubCache_->listenPort());
+    // the event loop must run, the stub and the fake upstream are in this thread
+    if (!QTest::qWaitFor([this]() { return client_->hasPendingDatagrams(); }, 3000))
+        return QByteArray();
+    return client_->receiveDatagram().data();
+}
+
+void TestDnsStubCache::testParseQuery()
+{
+    DnsMessage::Query query1, query2, query3;
+    QVERIFY(DnsMessage::parseQuery(makeQuery(1, "Example.COM"), query1));
+    QVERIFY(DnsMessage::parseQuery(makeQuery(2, "example.com"), query2));
+    QCOMPARE(query1.id, quint16(1));
+    QCOMPARE(query1.key, query2.key);
+    QVERIFY(!query1.isEdns);
+    QCOMPARE(query1.maxResponseSize, DnsMessage::kMaxUdpSizeWithoutEdns);
+
+    // the EDNS state and the type are a part of the key
+    QVERIFY(DnsMessage::parseQuery(makeQuery(3, "example.com", 1, 1232), query3));
+    QVERIFY(query3.isEdns);
+    QCOMPARE(query3.maxResponseSize, quint16(1232));
+    QVERIFY(query1.key != query3.key);
+    QVERIFY(DnsMessage::parseQuery(makeQuery(4, "example.com", 28), query3));
+    QVERIFY(query1.key != query3.key);
+
+    // a response is not a query
+    QVERIFY(!DnsMessage::parseQuery(makeResponse(makeQuery(5, "example.com"), 0, 1, 0, 60), query3));
+    QVERIFY(!DnsMessage::parseQuery(QByteArray("\x00\x01", 2), query3));
+}
+
+void TestDnsStubCache::testPositiveCaching()
+{
+    QByteArray response = exchange(makeQuery(0x1111, "example.com"));
+    QCOMPARE(read16(response, 0), 0x1111);
+    QCOMPARE(read16(response, 6), 1);
+    QCOMPARE(upstreamQueriesCount(), 1);
+
+    // the name case of the second query is kept in the answer
+    const QByteArray query = makeQuery(0x2222, "EXAMPLE.com");
+    response = exchange(query);
+    QCOMPARE(read16(response, 0), 0x2222);
+    QCOMPARE(read16(response, 6), 1);
+    QCOMPARE(response.mid(DnsMessage::kHeaderSize, 13), query.mid(DnsMessage::kHeaderSize, 13));
+    QCOMPARE(upstreamQueriesCount(), 1);
+
+    DnsMessage::Response parsed;
+    QVERIFY(DnsMessage::parseResponse(response, parsed));
+    QVERIFY(parsed.minAnswerTtl <= 60);
+
+    // another type is another entry
+    exchange(makeQuery(0x3333, "example.com", 28));
+    QCOMPARE(upstreamQueriesCount(), 2);
+}
+
+void TestDnsStubCache::testNegativeCaching()
+{
+    upstreamAddressCount_ = 0;
+    QByteArray response = exchange(makeQuery(1, "missing.example.com"));
+    QCOMPARE(rcode(response), int(DnsMessage::kRcodeNxDomain));
+    response = exchange(makeQuery(2, "missing.example.com"));
+    QCOMPARE(rcode(response), int(DnsMessage::kRcodeNxDomain));
+    QCOMPARE(upstreamQueriesCount(), 1);
+
+    // the TTL is the SOA minimum
+    DnsMessage::Response parsed;
+    QVERIFY(DnsMessage::parseResponse(response, parsed));
+    QCOMPARE(parsed.negativeTtl, qint64(30));
+}
+
+void TestDnsStubCache::testServfailNotCached()
+{
+    upstreamAddressCount_ = -1;
+    exchange(makeQuery(1, "broken.example.com"));
+    exchange(makeQuery(2, "broken.example.com"));
+    QCOMPARE(upstreamQueriesCount(), 2);
+}
+
+void TestDnsStubCache::testCoalescing()
+{
+    upstreamAddressCount_ = -2;
+    QUdpSocket client2;
+    QVERIFY(client2.bind(QHostAddress::LocalHost, 0));
+    client_->writeDatagram(makeQuery(0x0A0A, "slow.example.com"), QHostAddress::LocalHost, stubCache_->listenPort());
+    client2.writeDatagram(makeQuery(0x0B0B, "slow.example.com"), QHostAddress::LocalHost, stubCache_->listenPort());
+    client_->writeDatagram(makeQuery(0x0C0C, "slow.example.com"), QHostAddress::LocalHost, stubCache_->listenPort());
+    QTRY_COMPARE(upstreamQueriesCount(), 1);
+    QTest::qWait(100);
+    QCOMPARE(upstreamQueriesCount(), 1);
+
+    upstreamAddressCount_ = 1;
+    replyFromUpstream(upstreamQueries_.first());
+    QTRY_VERIFY(client2.hasPendingDatagrams());
+    QCOMPARE(read16(client2.receiveDatagram().data(), 0), 0x0B0B);
+    QTRY_VERIFY(client_->hasPendingDatagrams());
+    QCOMPARE(read16(client_->receiveDatagram().data(), 0), 0x0A0A);
+    QTRY_VERIFY(client_->hasPendingDatagrams());
+    QCOMPARE(read16(client_->receiveDatagram().data(), 0), 0x0C0C);
+}
+
+void TestDnsStubCache::testEdnsTruncation()
+{
+    // 40 A records do not fit into 512 bytes
+    upstreamAddressCount_ = 40;
+    QByteArray response = exchange(makeQuery(1, "big.example.com", 1, 4096));
+    QCOMPARE(read16(response, 6), 40);
+    QVERIFY(!isTruncated(response));
+
+    // the same EDNS state with a smaller but sufficient buffer is answered from the cache
+    response = exchange(makeQuery(2, "big.example.com", 1, 1232));
+    QCOMPARE(read16(response, 6), 40);
+    QCOMPARE(upstreamQueriesCount(), 1);
+
+    // a client without EDNS is another entry, and the response over 512 bytes is truncated for it
+    response = exchange(makeQuery(3, "big.example.com"));
+    QCOMPARE(upstreamQueriesCount(), 2);
+    QVERIFY(isTruncated(response));
+    QCOMPARE(read16(response, 6), 0);
+}
+
+void TestDnsStubCache::testPrefetch()
+{
+    // the fake upstream answers with the TTL of 60 seconds
+    exchange(makeQuery(1, "hot.example.com"));
+    exchange(makeQuery(2, "hot.example.com"));
+    QCOMPARE(upstreamQueriesCount(), 1);
+
+    // past 90% of the TTL a name queried often is answered from the cache and refreshed in the background
+    stubCache_->offsetMs = 55 * 1000;
+    upstreamAddressCount_ = -2;
+    QByteArray response = exchange(makeQuery(3, "hot.example.com"));
+    QCOMPARE(read16(response, 0), 3);
+    DnsMessage::Response parsed;
+    QVERIFY(DnsMessage::parseResponse(response, parsed));
+    QVERIFY(parsed.minAnswerTtl <= 5);
+    QTRY_COMPARE(upstreamQueriesCount(), 2);
+
+    // only one refresh is in flight
+    response = exchange(makeQuery(4, "hot.example.com"));
+    QCOMPARE(read16(response, 0), 4);
+    QTest::qWait(100);
+    QCOMPARE(upstreamQueriesCount(), 2);
+
+    // the refreshed entry outlives the original one
+    upstreamAddressCount_ = 1;
+    replyFromUpstream(upstreamQueries_.last());
+    QTest::qWait(100);
+    stubCache_->offsetMs = 100 * 1000;
+    response = exchange(makeQuery(5, "hot.example.com"));
+    QCOMPARE(read16(response, 6), 1);
+    QVERIFY(DnsMessage::parseResponse(response, parsed));
+    QVERIFY(parsed.minAnswerTtl > 5);
+    QCOMPARE(upstreamQueriesCount(), 2);
+}
+
+void TestDnsStubCache::testNoPrefetchForColdEntry()
+{
+    exchange(makeQuery(1, "cold.example.com"));
+
+    // the first hit, in the last 10% of the TTL
+    stubCache_->offsetMs = 55 * 1000;
+    const QByteArray response = exchange(makeQuery(2, "cold.example.com"));
+    QCOMPARE(read16(response, 6), 1);
+    QTest::qWait(100);
+    QCOMPARE(upstreamQueriesCount(), 1);
+
+    // expired
+    stubCache_->offsetMs = 61 * 1000;
+    exchange(makeQuery(3, "cold.example.com"));
+    QCOMPARE(upstreamQueriesCount(), 2);
+}
+
+void TestDnsStubCache::testUpstreamUnreachable()
+{
+    QSignalSpy unreachableSpy(stubCache_, &DnsStubCache::upstreamUnreachable);
+    upstreamAddressCount_ = -2;
+    for (int i = 0; i < 3; ++i)
+        client_->writeDatagram(makeQuery(i + 1, "name" + QByteArray::number(i) + ".example.com"), QHostAddress::LocalHost, stubCache_->listenPort());
+    QTRY_COMPARE(upstreamQueriesCount(), 3);
+
+    stubCache_->offsetMs = 6000;
+    QTRY_COMPARE(unreachableSpy.count(), 1);
+
+    // once per start
+    client_->writeDatagram(makeQuery(4, "name4.example.com"), QHostAddress::LocalHost, stubCache_->listenPort());
+    QTRY_COMPARE(upstreamQueriesCount(), 4);
+    stubCache_->offsetMs = 12000;
+    QTest::qWait(1500);
+    QCOMPARE(unreachableSpy.count(), 1);
+}
+
+void TestDnsStubCache::testUpstreamAnsweredBefore()
+{
+    QSignalSpy unreachableSpy(stubCache_, &DnsStubCache::upstreamUnreachable);
+    exchange(makeQuery(1, "name.example.com"));
+
+    // the upstream is there, the timeouts are for the network to sort out
+    upstreamAddressCount_ = -2;
+    for (int i = 0; i < 3; ++i)
+        client_->writeDatagram(makeQuery(i + 2, "name" + QByteArray::number(i) + ".example.com"), QHostAddress::LocalHost, stubCache_->listenPort());
+    QTRY_COMPARE(upstreamQueriesCount(), 4);
+    stubCache_->offsetMs = 6000;
+    QTest::qWait(1500);
+    QCOMPARE(unreachableSpy.count(), 0);
+}
+
+QTEST_MAIN(TestDnsStubCache)
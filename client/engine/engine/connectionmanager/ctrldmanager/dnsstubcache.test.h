@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QNetworkDatagram>
+#include <QObject>
+#include <QTest>
+#include <QUdpSocket>
+#include <QVector>
+
+class TestableDnsStubCache;
+
+// tests for class DnsStubCache with a fake upstream resolver on the loopback
+class TestDnsStubCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void testParseQuery();
+    void testPositiveCaching();
+    void testNegativeCaching();
+    void testServfailNotCached();
+    void testCoalescing();
+    void testEdnsTruncation();
+    void testPrefetch();
+    void testNoPrefetchForColdEntry();
+    void testUpstreamUnreachable();
+    void testUpstreamAnsweredBefore();
+
+private:
+    TestableDnsStubCache *stubCache_ = nullptr;
+    QUdpSocket *upstream_ = nullptr;
+    QUdpSocket *client_ = nullptr;
+    QVector<QNetworkDatagram> upstreamQueries_;
+    // the fake upstream answers with this many A records, 0 - NXDOMAIN with a SOA record, -1 - SERVFAIL, -2 - no answer
+    int upstreamAddressCount_ = 1;
+
+    int upstreamQueriesCount() const { return upstreamQueries_.size(); }
+    void replyFromUpstream(const QNetworkDatagram &query);
+    QByteArray exchange(const QByteArray &query);
+};
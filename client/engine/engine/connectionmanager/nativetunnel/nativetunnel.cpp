@@ -0,0 +1,76 @@
+#include "nativetunnel.h"
+#include <QSslSocket>
+#include "nativetunnelserver.h"
+#include "utils/ws_assert.h"
+
+NativeTunnel::NativeTunnel(QObject *parent) : QObject(parent), listenPort_(0), generation_(0)
+{
+    thread_ = new QThread(this);
+    server_ = new NativeTunnelServer;
+    server_->moveToThread(thread_);
+    connect(server_, &NativeTunnelServer::started, this, &NativeTunnel::onServerStarted);
+    connect(thread_, &QThread::finished, server_, &QObject::deleteLater);
+    thread_->start();
+}
+
+NativeTunnel::~NativeTunnel()
+{
+    stop();
+    thread_->quit();
+    thread_->wait();
+}
+
+bool NativeTunnel::isSupported()
+{
+    return QSslSocket::supportsSsl();
+}
+
+bool NativeTunnel::start(Type type, const QString &hostname, quint16 port, quint16 listenPort)
+{
+    WS_ASSERT(!isStarted());
+
+    // binding the loopback port does not block, so waiting for the tunnel thread is short
+    const quint64 generation = ++generation_;
+    quint16 boundPort = 0;
+    QMetaObject::invokeMethod(server_, [&]() {
+        boundPort = server_->listen(generation, type == Type::kWebSocket, hostname, port, listenPort);
+    }, Qt::BlockingQueuedConnection);
+    listenPort_ = boundPort;
+    return isStarted();
+}
+
+void NativeTunnel::stop()
+{
+    if (!isStarted())
+        return;
+
+    listenPort_ = 0;
+    ++generation_;
+    QMetaObject::invokeMethod(server_, [this]() { server_->close(); }, Qt::BlockingQueuedConnection);
+}
+
+bool NativeTunnel::isStarted() const
+{
+    return listenPort_ != 0;
+}
+
+quint16 NativeTunnel::listenPort() const
+{
+    return listenPort_;
+}
+
+quint64 NativeTunnel::bytesSent() const
+{
+    return server_->bytesSent();
+}
+
+quint64 NativeTunnel::bytesReceived() const
+{
+    return server_->bytesReceived();
+}
+
+void NativeTunnel::onServerStarted(quint64 generation)
+{
+    if (isStarted() && generation == generation_)
+        emit started();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QObject>
+#include <QThread>
+
+class NativeTunnelServer;
+
+// In-process replacement of the windscribewstunnel process for the stealth and wstunnel protocols.
+// Listens on the loopback for the OpenVPN TCP connection and relays it to the server in TLS (kTls), or in WebSocket
+// binary frames over TLS (kWebSocket). Each local connection gets its own server connection, so an OpenVPN reconnect
+// works as with the external process.
+// The relay runs in its own thread: the owner is the engine thread, which blocks in the helper calls.
+// The server certificate is not verified, as with the external process: the TLS layer is for the obfuscation only,
+// OpenVPN authenticates the server itself.
+class NativeTunnel : public QObject
+{
+    Q_OBJECT
+public:
+    enum class Type { kTls, kWebSocket };
+
+    explicit NativeTunnel(QObject *parent);
+    virtual ~NativeTunnel();
+
+    static bool isSupported();
+
+    // the listener is bound when start() returns true, started() is queued to the thread of the tunnel object
+    bool start(Type type, const QString &hostname, quint16 port, quint16 listenPort);
+    // the listen port is free when stop() returns, a started() still queued is dropped
+    void stop();
+    bool isStarted() const;
+    quint16 listenPort() const;
+
+    quint64 bytesSent() const;
+    quint64 bytesReceived() const;
+
+signals:
+    void started();
+
+private slots:
+    void onServerStarted(quint64 generation);
+
+private:
+    QThread *thread_;
+    NativeTunnelServer *server_;
+    quint16 listenPort_;
+    // incremented by each start() and stop(), the started() of an earlier listener does not match it
+    quint64 generation_;
+};
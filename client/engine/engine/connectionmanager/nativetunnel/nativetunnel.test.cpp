@@ -0,0 +1,299 @@
+#include <QtTest>
+#include <QCryptographicHash>
+#include <QRandomGenerator>
+#include <QSharedPointer>
+#include <QSslSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include "nativetunnel.test.h"
+#include "nativetunnel.h"
+#include "websocketframer.h"
+
+// the TLS echo server, with the WebSocket handshake and framing if isWebSocket
+class EchoServer : public QTcpServer
+{
+public:
+    enum Mode { kEcho, kReject, kCloseAfterHandshake };
+
+    EchoServer(const QSslCertificate &certificate, const QSslKey &privateKey, bool isWebSocket, Mode mode = kEcho)
+        : certificate_(certificate), privateKey_(privateKey), isWebSocket_(isWebSocket), mode_(mode)
+    {
+    }
+
+    QByteArray requestPath;
+    bool isPongReceived = false;
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override
+    {
+        QSslSocket *socket = new QSslSocket(this);
+        if (!socket->setSocketDescriptor(socketDescriptor)) {
+            delete socket;
+            return;
+        }
+        socket->setLocalCertificate(certificate_);
+        socket->setPrivateKey(privateKey_);
+
+        QSharedPointer<Connection> connection(new Connection());
+        connect(socket, &QSslSocket::encrypted, socket, [this, socket]() {
+            if (!isWebSocket_ && mode_ == kCloseAfterHandshake)
+                socket->disconnectFromHost();
+        });
+        connect(socket, &QSslSocket::readyRead, socket, [this, socket, connection]() { onReadyRead(socket, *connection); });
+        connect(socket, &QSslSocket::disconnected, socket, &QObject::deleteLater);
+        socket->startServerEncryption();
+    }
+
+private:
+    struct Connection
+    {
+        QByteArray request;
+        bool isUpgraded = false;
+        WebSocketFramer framer;
+    };
+
+    QSslCertificate certificate_;
+    QSslKey privateKey_;
+    bool isWebSocket_;
+    Mode mode_;
+
+    void onReadyRead(QSslSocket *socket, Connection &connection)
+    {
+        const QByteArray data = socket->readAll();
+        if (!isWebSocket_) {
+            socket->write(data);
+            return;
+        }
+
+        if (connection.isUpgraded) {
+            connection.framer.append(data);
+        } else {
+            connection.request += data;
+            const int headersEnd = connection.request.indexOf("\r\n\r\n");
+            if (headersEnd == -1)
+                return;
+
+            const QList<QByteArray> lines = connection.request.left(headersEnd).split('\n');
+            requestPath = lines.first().split(' ').value(1);
+            if (mode_ == kReject) {
+                socket->write("HTTP/1.1 403 Forbidden\r\nContent-Length: 0\r\n\r\n");
+                socket->disconnectFromHost();
+                return;
+            }
+
+            QByteArray key;
+            for (const QByteArray &line : lines) {
+                if (line.toLower().startsWith("sec-websocket-key:"))
+                    key = line.mid(18).trimmed();
+            }
+            const QByteArray accept = QCryptographicHash::hash(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11", QCryptographicHash::Sha1).toBase64();
+            socket->write("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: " + accept + "\r\n\r\n");
+            // the tunnel must answer it
+            socket->write(WebSocketFramer::encode(WebSocketFramer::kPing, "ping", false));
+            connection.isUpgraded = true;
+            connection.framer.append(connection.request.mid(headersEnd + 4));
+        }
+
+        WebSocketFramer::Frame frame;
+        while (connection.framer.next(frame)) {
+            if (frame.opcode == WebSocketFramer::kBinary)
+                socket->write(WebSocketFramer::encode(WebSocketFramer::kBinary, frame.payload, false));
+            else if (frame.opcode == WebSocketFramer::kPong)
+                isPongReceived = frame.payload == "ping";
+        }
+    }
+};
+
+void TestNativeTunnel::initTestCase()
+{
+    if (!NativeTunnel::isSupported())
+        QSKIP("No TLS backend available");
+
+    QFile certificateFile(":data/tests/nativetunnel/cert.pem");
+    QVERIFY(certificateFile.open(QIODevice::ReadOnly));
+    certificate_ = QSslCertificate(certificateFile.readAll(), QSsl::Pem);
+    QVERIFY(!certificate_.isNull());
+
+    QFile keyFile(":data/tests/nativetunnel/key.pem");
+    QVERIFY(keyFile.open(QIODevice::ReadOnly));
+    privateKey_ = QSslKey(keyFile.readAll(), QSsl::Rsa, QSsl::Pem);
+    QVERIFY(!privateKey_.isNull());
+}
+
+void TestNativeTunnel::testWebSocketFramer_data()
+{
+    QTest::addColumn<int>("size");
+    QTest::addColumn<bool>("isMasked");
+
+    // the 7, 16 and 64 bit length encodings
+    for (int size : { 0, 125, 126, 65535, 65536 }) {
+        QTest::addRow("%d masked", size) << size << true;
+        QTest::addRow("%d unmasked", size) << size << false;
+    }
+}
+
+void TestNativeTunnel::testWebSocketFramer()
+{
+    QFETCH(int, size);
+    QFETCH(bool, isMasked);
+
+    QByteArray payload(size, Qt::Uninitialized);
+    for (int i = 0; i < size; ++i)
+        payload[i] = char(i * 31);
+
+    const QByteArray encoded = WebSocketFramer::encode(WebSocketFramer::kBinary, payload, isMasked);
+    const int headerSize = 2 + (size < 126 ? 0 : (size <= 0xFFFF ? 2 : 8)) + (isMasked ? 4 : 0);
+    QCOMPARE(encoded.size(), headerSize + size);
+
+    // fed in small pieces, followed by another frame
+    const QByteArray stream = encoded + WebSocketFramer::encode(WebSocketFramer::kPing, "abc", isMasked);
+    WebSocketFramer framer;
+    QVector<WebSocketFramer::Frame> frames;
+    WebSocketFramer::Frame frame;
+    for (int i = 0; i < stream.size(); i += 7) {
+        framer.append(stream.mid(i, 7));
+        while (framer.next(frame))
+            frames << frame;
+    }
+
+    QVERIFY(!framer.isError());
+    QCOMPARE(frames.size(), 2);
+    QCOMPARE(frames[0].opcode, int(WebSocketFramer::kBinary));
+    QVERIFY(frames[0].isFinal);
+    QVERIFY(frames[0].payload == payload);
+    QCOMPARE(frames[1].opcode, int(WebSocketFramer::kPing));
+    QCOMPARE(frames[1].payload, QByteArray("abc"));
+}
+
+void TestNativeTunnel::testWebSocketFramerOversized()
+{
+    QByteArray header;
+    header.append(char(0x82));
+    header.append(char(127));
+    header.append(QByteArray::fromHex("0000000100000000"));
+
+    WebSocketFramer framer;
+    framer.append(header);
+    WebSocketFramer::Frame frame;
+    QVERIFY(!framer.next(frame));
+    QVERIFY(framer.isError());
+}
+
+void TestNativeTunnel::testTlsEcho()
+{
+    EchoServer server(certificate_, privateKey_, false);
+    checkEcho(&server, false, 1);
+    // larger than the pending limits of the relay
+    checkEcho(&server, false, 3 * 1024 * 1024);
+}
+
+void TestNativeTunnel::testWebSocketEcho()
+{
+    EchoServer server(certificate_, privateKey_, true);
+    checkEcho(&server, true, 1);
+    checkEcho(&server, true, 3 * 1024 * 1024);
+    QCOMPARE(server.requestPath, QByteArray("/tcp/127.0.0.1/1194"));
+    QTRY_VERIFY(server.isPongReceived);
+}
+
+void TestNativeTunnel::testWebSocketRejected()
+{
+    EchoServer server(certificate_, privateKey_, true, EchoServer::kReject);
+    QVERIFY(server.listen(QHostAddress::LocalHost, 0));
+
+    NativeTunnel tunnel(nullptr);
+    QVERIFY(tunnel.start(NativeTunnel::Type::kWebSocket, "127.0.0.1", server.serverPort(), 0));
+
+    QTcpSocket client;
+    client.connectToHost(QHostAddress::LocalHost, tunnel.listenPort());
+    QVERIFY(client.waitForConnected(3000));
+    client.write("data");
+    QTRY_COMPARE_WITH_TIMEOUT(client.state(), QAbstractSocket::UnconnectedState, 5000);
+    QCOMPARE(client.readAll(), QByteArray());
+    QCOMPARE(tunnel.bytesReceived(), quint64(0));
+}
+
+void TestNativeTunnel::testServerClose()
+{
+    EchoServer server(certificate_, privateKey_, false, EchoServer::kCloseAfterHandshake);
+    QVERIFY(server.listen(QHostAddress::LocalHost, 0));
+
+    NativeTunnel tunnel(nullptr);
+    QVERIFY(tunnel.start(NativeTunnel::Type::kTls, "127.0.0.1", server.serverPort(), 0));
+
+    QTcpSocket client;
+    client.connectToHost(QHostAddress::LocalHost, tunnel.listenPort());
+    QVERIFY(client.waitForConnected(3000));
+    QTRY_COMPARE_WITH_TIMEOUT(client.state(), QAbstractSocket::UnconnectedState, 5000);
+
+    // the next OpenVPN connection attempt goes through the same tunnel
+    QVERIFY(tunnel.isStarted());
+    client.connectToHost(QHostAddress::LocalHost, tunnel.listenPort());
+    QVERIFY(client.waitForConnected(3000));
+    QTRY_COMPARE_WITH_TIMEOUT(client.state(), QAbstractSocket::UnconnectedState, 5000);
+}
+
+void TestNativeTunnel::checkEcho(EchoServer *server, bool isWebSocket, int size)
+{
+    if (!server->isListening())
+        QVERIFY(server->listen(QHostAddress::LocalHost, 0));
+
+    NativeTunnel tunnel(nullptr);
+    QSignalSpy startedSpy(&tunnel, &NativeTunnel::started);
+    QVERIFY(tunnel.start(isWebSocket ? NativeTunnel::Type::kWebSocket : NativeTunnel::Type::kTls, "127.0.0.1", server->serverPort(), 0));
+    // the listener is ready when start() returns, started() comes from the tunnel thread
+    QVERIFY(tunnel.listenPort() != 0);
+    QTRY_COMPARE(startedSpy.count(), 1);
+
+    QTcpSocket client;
+    client.connectToHost(QHostAddress::LocalHost, tunnel.listenPort());
+    QVERIFY(client.waitForConnected(3000));
+
+    QByteArray data(size, Qt::Uninitialized);
+    for (int i = 0; i < size; ++i)
+        data[i] = char(QRandomGenerator::global()->bounded(256));
+    client.write(data);
+
+    // the event loop must run, the echo server is in this thread
+    QByteArray received;
+    QTest::qWaitFor([&]() {
+        received += client.readAll();
+        return received.size() >= size;
+    }, 20000);
+    QCOMPARE(received.size(), size);
+    QVERIFY(received == data);
+    QTRY_COMPARE(tunnel.bytesSent(), quint64(size));
+    QTRY_COMPARE(tunnel.bytesReceived(), quint64(size));
+}
+
+void TestNativeTunnel::testStopBeforeStarted()
+{
+    NativeTunnel tunnel(nullptr);
+    QSignalSpy startedSpy(&tunnel, &NativeTunnel::started);
+    QVERIFY(tunnel.start(NativeTunnel::Type::kTls, "127.0.0.1", 443, 0));
+    const quint16 listenPort = tunnel.listenPort();
+    tunnel.stop();
+    QVERIFY(!tunnel.isStarted());
+
+    // the port is free for the next start, the queued started() of the stopped tunnel is dropped
+    QTcpServer server;
+    QVERIFY(server.listen(QHostAddress::LocalHost, listenPort));
+    QTest::qWait(100);
+    QCOMPARE(startedSpy.count(), 0);
+}
+
+void TestNativeTunnel::testRestartBeforeStarted()
+{
+    NativeTunnel tunnel(nullptr);
+    QSignalSpy startedSpy(&tunnel, &NativeTunnel::started);
+    QVERIFY(tunnel.start(NativeTunnel::Type::kTls, "127.0.0.1", 443, 0));
+    tunnel.stop();
+    QVERIFY(tunnel.start(NativeTunnel::Type::kTls, "127.0.0.1", 443, 0));
+
+    // only the started() of the current listener is emitted
+    QTRY_COMPARE(startedSpy.count(), 1);
+    QTest::qWait(100);
+    QCOMPARE(startedSpy.count(), 1);
+}
+
+QTEST_MAIN(TestNativeTunnel)
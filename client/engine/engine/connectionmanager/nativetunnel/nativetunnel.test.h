@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QObject>
+#include <QSslCertificate>
+#include <QSslKey>
+#include <QTest>
+
+class EchoServer;
+
+// tests for class NativeTunnel with the TLS and WebSocket echo servers on the loopback
+class TestNativeTunnel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void testWebSocketFramer_data();
+    void testWebSocketFramer();
+    void testWebSocketFramerOversized();
+    void testTlsEcho();
+    void testWebSocketEcho();
+    void testWebSocketRejected();
+    void testServerClose();
+    void testStopBeforeStarted();
+    void testRestartBeforeStarted();
+
+private:
+    QSslCertificate certificate_;
+    QSslKey privateKey_;
+
+    // sends the data through the tunnel to the echo server and checks what comes back
+    void checkEcho(EchoServer *server, bool isWebSocket, int size);
+};
@@ -0,0 +1,249 @@
+#include "nativetunnelconnection.h"
+#include <QCryptographicHash>
+#include <QRandomGenerator>
+#include <QTimer>
+#include "utils/log/categories.h"
+
+namespace {
+
+// the same target as the windscribewstunnel process requests, the server forwards it to its OpenVPN TCP port
+const char *kWebSocketPath = "/tcp/127.0.0.1/1194";
+const char *kWebSocketGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+constexpr int kMaxHandshakeResponseSize = 16 * 1024;
+constexpr int kCloseTimeoutMs = 5000;
+
+}
+
+NativeTunnelConnection::NativeTunnelConnection(QObject *parent, QTcpSocket *localSocket, bool isWebSocket, const QString &hostname, quint16 port,
+                                               Counters &counters)
+    : QObject(parent), localSocket_(localSocket), isWebSocket_(isWebSocket), hostname_(hostname), port_(port), counters_(counters),
+      state_(kConnecting), isClosedEmitted_(false)
+{
+    // the local data waits in the socket until the server connection is ready
+    localSocket_->setParent(this);
+    localSocket_->setReadBufferSize(kMaxPendingBytes);
+    connect(localSocket_, &QTcpSocket::readyRead, this, &NativeTunnelConnection::onLocalReadyRead);
+    connect(localSocket_, &QTcpSocket::bytesWritten, this, &NativeTunnelConnection::onRemoteReadyRead);
+    connect(localSocket_, &QTcpSocket::disconnected, this, &NativeTunnelConnection::onSocketDisconnected);
+    connect(localSocket_, &QTcpSocket::errorOccurred, this, &NativeTunnelConnection::onSocketError);
+
+    remoteSocket_ = new QSslSocket(this);
+    remoteSocket_->setReadBufferSize(kMaxPendingBytes);
+    remoteSocket_->setPeerVerifyMode(QSslSocket::VerifyNone);
+    remoteSocket_->setProtocol(QSsl::TlsV1_2OrLater);
+    remoteSocket_->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    connect(remoteSocket_, &QSslSocket::encrypted, this, &NativeTunnelConnection::onRemoteEncrypted);
+    connect(remoteSocket_, &QSslSocket::readyRead, this, &NativeTunnelConnection::onRemoteReadyRead);
+    connect(remoteSocket_, &QSslSocket::bytesWritten, this, &NativeTunnelConnection::onLocalReadyRead);
+    connect(remoteSocket_, &QSslSocket::disconnected, this, &NativeTunnelConnection::onSocketDisconnected);
+    connect(remoteSocket_, &QSslSocket::errorOccurred, this, &NativeTunnelConnection::onSocketError);
+    remoteSocket_->connectToHostEncrypted(hostname_, port_);
+}
+
+void NativeTunnelConnection::close()
+{
+    if (state_ == kClosed)
+        return;
+
+    if (state_ == kRelaying && isWebSocket_ && remoteSocket_->state() == QAbstractSocket::ConnectedState) {
+        // the normal closure status code
+        remoteSocket_->write(WebSocketFramer::encode(WebSocketFramer::kClose, QByteArray::fromHex("03e8"), true));
+    }
+    state_ = kClosed;
+
+    // the pending data is still written before the sockets are disconnected, unless the peers do not read it in time
+    QTimer::singleShot(kCloseTimeoutMs, this, [this]() {
+        localSocket_->abort();
+        remoteSocket_->abort();
+        checkClosed();
+    });
+    localSocket_->disconnectFromHost();
+    if (remoteSocket_->state() == QAbstractSocket::ConnectedState)
+        remoteSocket_->disconnectFromHost();
+    else
+        remoteSocket_->abort();
+    checkClosed();
+}
+
+void NativeTunnelConnection::onRemoteEncrypted()
+{
+    if (state_ != kConnecting)
+        return;
+
+    if (isWebSocket_) {
+        state_ = kWebSocketHandshake;
+        sendWebSocketHandshake();
+    } else {
+        state_ = kRelaying;
+        relayLocalToRemote(false);
+    }
+}
+
+void NativeTunnelConnection::onRemoteReadyRead()
+{
+    if (state_ == kWebSocketHandshake) {
+        if (!processWebSocketHandshake()) {
+            close();
+            return;
+        }
+    }
+    if (state_ == kRelaying)
+        relayRemoteToLocal(false);
+}
+
+void NativeTunnelConnection::onLocalReadyRead()
+{
+    if (state_ == kRelaying)
+        relayLocalToRemote(false);
+}
+
+void NativeTunnelConnection::onSocketDisconnected()
+{
+    if (state_ == kClosed) {
+        checkClosed();
+        return;
+    }
+
+    // pass on what is left from the disconnected side
+    if (state_ == kRelaying) {
+        if (sender() == remoteSocket_)
+            relayRemoteToLocal(true);
+        else
+            relayLocalToRemote(true);
+    }
+    close();
+}
+
+void NativeTunnelConnection::onSocketError()
+{
+    QAbstractSocket *socket = qobject_cast<QAbstractSocket *>(sender());
+    if (socket->error() == QAbstractSocket::RemoteHostClosedError) {
+        // handled in onSocketDisconnected
+        return;
+    }
+    if (state_ != kClosed) {
+        qCWarning(LOG_WSTUNNEL) << "Native tunnel" << (socket == remoteSocket_ ? "server" : "local") << "connection error:" << socket->errorString();
+        close();
+    }
+}
+
+void NativeTunnelConnection::sendWebSocketHandshake()
+{
+    QByteArray key(16, Qt::Uninitialized);
+    QRandomGenerator::global()->fillRange(reinterpret_cast<quint32 *>(key.data()), key.size() / sizeof(quint32));
+    webSocketKey_ = key.toBase64();
+
+    QByteArray request;
+    request += "GET " + QByteArray(kWebSocketPath) + " HTTP/1.1\r\n";
+    request += "Host: " + hostname_.toUtf8() + ":" + QByteArray::number(port_) + "\r\n";
+    request += "Upgrade: websocket\r\n";
+    request += "Connection: Upgrade\r\n";
+    request += "Sec-WebSocket-Key: " + webSocketKey_ + "\r\n";
+    request += "Sec-WebSocket-Version: 13\r\n";
+    request += "\r\n";
+    remoteSocket_->write(request);
+}
+
+bool NativeTunnelConnection::processWebSocketHandshake()
+{
+    handshakeResponse_ += remoteSocket_->readAll();
+    const int headersEnd = handshakeResponse_.indexOf("\r\n\r\n");
+    if (headersEnd == -1) {
+        if (handshakeResponse_.size() > kMaxHandshakeResponseSize) {
+            qCWarning(LOG_WSTUNNEL) << "Native tunnel: the WebSocket handshake response is too large";
+            return false;
+        }
+        return true;
+    }
+
+    const QList<QByteArray> lines = handshakeResponse_.left(headersEnd).split('\n');
+    const QList<QByteArray> statusLine = lines.first().trimmed().split(' ');
+    if (statusLine.size() < 2 || !statusLine[0].startsWith("HTTP/1.") || statusLine[1] != "101") {
+        qCWarning(LOG_WSTUNNEL) << "Native tunnel: the WebSocket upgrade is rejected:" << lines.first().trimmed();
+        return false;
+    }
+
+    const QByteArray expectedAccept = QCryptographicHash::hash(webSocketKey_ + kWebSocketGuid, QCryptographicHash::Sha1).toBase64();
+    bool isAccepted = false;
+    for (int i = 1; i < lines.size(); ++i) {
+        const int colon = lines[i].indexOf(':');
+        if (colon != -1 && lines[i].left(colon).trimmed().toLower() == "sec-websocket-accept")
+            isAccepted = lines[i].mid(colon + 1).trimmed() == expectedAccept;
+    }
+    if (!isAccepted) {
+        qCWarning(LOG_WSTUNNEL) << "Native tunnel: invalid Sec-WebSocket-Accept in the WebSocket handshake response";
+        return false;
+    }
+
+    // the server may send the first frames right after the response
+    framer_.append(handshakeResponse_.mid(headersEnd + 4));
+    handshakeResponse_.clear();
+    webSocketKey_.clear();
+    state_ = kRelaying;
+    processWebSocketFrames();
+    relayLocalToRemote(false);
+    return true;
+}
+
+void NativeTunnelConnection::relayLocalToRemote(bool isDraining)
+{
+    while (localSocket_->bytesAvailable() > 0 && (isDraining || remoteSocket_->bytesToWrite() < kMaxPendingBytes)) {
+        const QByteArray data = localSocket_->read(kChunkSize);
+        counters_.bytesSent += data.size();
+        if (isWebSocket_)
+            remoteSocket_->write(WebSocketFramer::encode(WebSocketFramer::kBinary, data, true));
+        else
+            remoteSocket_->write(data);
+    }
+}
+
+void NativeTunnelConnection::relayRemoteToLocal(bool isDraining)
+{
+    while (state_ == kRelaying && remoteSocket_->bytesAvailable() > 0 && (isDraining || localSocket_->bytesToWrite() < kMaxPendingBytes)) {
+        const QByteArray data = remoteSocket_->read(kChunkSize);
+        if (isWebSocket_) {
+            framer_.append(data);
+            processWebSocketFrames();
+        } else {
+            counters_.bytesReceived += data.size();
+            localSocket_->write(data);
+        }
+    }
+}
+
+void NativeTunnelConnection::processWebSocketFrames()
+{
+    WebSocketFramer::Frame frame;
+    while (state_ == kRelaying && framer_.next(frame)) {
+        switch (frame.opcode) {
+        case WebSocketFramer::kBinary:
+        case WebSocketFramer::kContinuation:
+        case WebSocketFramer::kText:
+            counters_.bytesReceived += frame.payload.size();
+            localSocket_->write(frame.payload);
+            break;
+        case WebSocketFramer::kPing:
+            remoteSocket_->write(WebSocketFramer::encode(WebSocketFramer::kPong, frame.payload, true));
+            break;
+        case WebSocketFramer::kClose:
+            close();
+            break;
+        default:
+            break;
+        }
+    }
+    if (framer_.isError()) {
+        qCWarning(LOG_WSTUNNEL) << "Native tunnel: invalid WebSocket frame from the server";
+        close();
+    }
+}
+
+void NativeTunnelConnection::checkClosed()
+{
+    if (isClosedEmitted_)
+        return;
+    if (localSocket_->state() == QAbstractSocket::UnconnectedState && remoteSocket_->state() == QAbstractSocket::UnconnectedState) {
+        isClosedEmitted_ = true;
+        emit closed();
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <QObject>
+#include <QSslSocket>
+#include <QTcpSocket>
+#include "websocketframer.h"
+
+// One relayed connection of NativeTunnel: the local (OpenVPN) socket and the TLS socket to the server.
+// Reading from a socket is paused while the other one has more than kMaxPendingBytes to write.
+class NativeTunnelConnection : public QObject
+{
+    Q_OBJECT
+public:
+    // updated in the tunnel thread, read from the owner thread
+    struct Counters
+    {
+        std::atomic<quint64> bytesSent = 0;
+        std::atomic<quint64> bytesReceived = 0;
+    };
+
+    // the connection takes the ownership of the local socket
+    explicit NativeTunnelConnection(QObject *parent, QTcpSocket *localSocket, bool isWebSocket, const QString &hostname, quint16 port,
+                                    Counters &counters);
+    // closes both sockets, closed() is emitted when they are disconnected
+    void close();
+
+signals:
+    void closed();
+
+private slots:
+    void onRemoteEncrypted();
+    void onRemoteReadyRead();
+    void onLocalReadyRead();
+    void onSocketDisconnected();
+    void onSocketError();
+
+private:
+    static constexpr qint64 kMaxPendingBytes = 1024 * 1024;
+    static constexpr qint64 kChunkSize = 64 * 1024;
+
+    enum State { kConnecting, kWebSocketHandshake, kRelaying, kClosed };
+
+    QTcpSocket *localSocket_;
+    QSslSocket *remoteSocket_;
+    bool isWebSocket_;
+    QString hostname_;
+    quint16 port_;
+    Counters &counters_;
+    State state_;
+    bool isClosedEmitted_;
+
+    QByteArray webSocketKey_;
+    QByteArray handshakeResponse_;
+    WebSocketFramer framer_;
+
+    void sendWebSocketHandshake();
+    bool processWebSocketHandshake();
+    // isDraining: the socket is disconnected, pass on all its data regardless of the other side
+    void relayLocalToRemote(bool isDraining);
+    void relayRemoteToLocal(bool isDraining);
+    void processWebSocketFrames();
+    void checkClosed();
+};
@@ -0,0 +1,48 @@
+#include "nativetunnelserver.h"
+#include "utils/log/categories.h"
+
+NativeTunnelServer::NativeTunnelServer(QObject *parent) : QObject(parent), isWebSocket_(false), port_(0)
+{
+    server_ = new QTcpServer(this);
+    connect(server_, &QTcpServer::newConnection, this, &NativeTunnelServer::onNewConnection);
+}
+
+quint16 NativeTunnelServer::listen(quint64 generation, bool isWebSocket, const QString &hostname, quint16 port, quint16 listenPort)
+{
+    isWebSocket_ = isWebSocket;
+    hostname_ = hostname;
+    port_ = port;
+    counters_.bytesSent = 0;
+    counters_.bytesReceived = 0;
+
+    if (!server_->listen(QHostAddress::LocalHost, listenPort)) {
+        qCWarning(LOG_WSTUNNEL) << "Native tunnel cannot listen on port" << listenPort << server_->errorString();
+        return 0;
+    }
+    qCInfo(LOG_WSTUNNEL) << "Native tunnel listening on port" << server_->serverPort() << "for" << hostname << port
+                         << (isWebSocket ? "(WebSocket)" : "(TLS)");
+    emit started(generation);
+    return server_->serverPort();
+}
+
+void NativeTunnelServer::close()
+{
+    if (!server_->isListening())
+        return;
+
+    server_->close();
+    const QList<NativeTunnelConnection *> connections = findChildren<NativeTunnelConnection *>(Qt::FindDirectChildrenOnly);
+    for (NativeTunnelConnection *connection : connections)
+        delete connection;
+    qCInfo(LOG_WSTUNNEL) << "Native tunnel stopped, sent" << bytesSent() << "bytes, received" << bytesReceived() << "bytes";
+}
+
+void NativeTunnelServer::onNewConnection()
+{
+    while (server_->hasPendingConnections()) {
+        QTcpSocket *socket = server_->nextPendingConnection();
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        NativeTunnelConnection *connection = new NativeTunnelConnection(this, socket, isWebSocket_, hostname_, port_, counters_);
+        connect(connection, &NativeTunnelConnection::closed, connection, &QObject::deleteLater);
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QObject>
+#include <QTcpServer>
+#include "nativetunnelconnection.h"
+
+// The loopback listener and the relayed connections of NativeTunnel, lives in the thread of the tunnel.
+class NativeTunnelServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit NativeTunnelServer(QObject *parent = nullptr);
+
+    // returns the bound port, 0 on failure; started(generation) is emitted on success
+    quint16 listen(quint64 generation, bool isWebSocket, const QString &hostname, quint16 port, quint16 listenPort);
+    // closes the listener and drops the connections without waiting for the pending data
+    void close();
+
+    quint64 bytesSent() const { return counters_.bytesSent; }
+    quint64 bytesReceived() const { return counters_.bytesReceived; }
+
+signals:
+    void started(quint64 generation);
+
+private slots:
+    void onNewConnection();
+
+private:
+    QTcpServer *server_;
+    bool isWebSocket_;
+    QString hostname_;
+    quint16 port_;
+    NativeTunnelConnection::Counters counters_;
+};
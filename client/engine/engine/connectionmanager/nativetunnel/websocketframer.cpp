@@ -0,0 +1,98 @@
+#include "websocketframer.h"
+#include <QRandomGenerator>
+
+QByteArray WebSocketFramer::encode(int opcode, const QByteArray &payload, bool isMasked)
+{
+    const quint64 size = payload.size();
+    QByteArray frame;
+    frame.reserve(size + 14);
+    frame.append(char(0x80 | opcode));
+
+    const char maskBit = isMasked ? char(0x80) : 0;
+    if (size < 126) {
+        frame.append(char(maskBit | size));
+    } else if (size <= 0xFFFF) {
+        frame.append(char(maskBit | 126));
+        frame.append(char(size >> 8));
+        frame.append(char(size & 0xFF));
+    } else {
+        frame.append(char(maskBit | 127));
+        for (int i = 7; i >= 0; --i)
+            frame.append(char((size >> (i * 8)) & 0xFF));
+    }
+
+    if (!isMasked) {
+        frame.append(payload);
+        return frame;
+    }
+
+    const quint32 mask = QRandomGenerator::global()->generate();
+    const char maskBytes[4] = { char(mask >> 24), char(mask >> 16), char(mask >> 8), char(mask) };
+    frame.append(maskBytes, 4);
+    const int start = frame.size();
+    frame.append(payload);
+    char *data = frame.data() + start;
+    for (quint64 i = 0; i < size; ++i)
+        data[i] ^= maskBytes[i & 3];
+    return frame;
+}
+
+void WebSocketFramer::append(const QByteArray &data)
+{
+    // drop the parsed frames before growing the buffer
+    if (offset_ > 0) {
+        buffer_.remove(0, offset_);
+        offset_ = 0;
+    }
+    buffer_.append(data);
+}
+
+bool WebSocketFramer::next(Frame &frame)
+{
+    if (isError_)
+        return false;
+
+    const int available = buffer_.size() - offset_;
+    if (available < 2)
+        return false;
+
+    const quint8 *header = reinterpret_cast<const quint8 *>(buffer_.constData() + offset_);
+    const bool isMasked = header[1] & 0x80;
+    quint64 size = header[1] & 0x7F;
+    int headerSize = 2;
+    if (size == 126) {
+        if (available < 4)
+            return false;
+        size = (quint64(header[2]) << 8) | header[3];
+        headerSize = 4;
+    } else if (size == 127) {
+        if (available < 10)
+            return false;
+        size = 0;
+        for (int i = 0; i < 8; ++i)
+            size = (size << 8) | header[2 + i];
+        headerSize = 10;
+    }
+    if (size > kMaxFrameSize) {
+        isError_ = true;
+        return false;
+    }
+
+    const int maskOffset = headerSize;
+    if (isMasked)
+        headerSize += 4;
+    if (quint64(available) < headerSize + size)
+        return false;
+
+    frame.opcode = header[0] & 0x0F;
+    frame.isFinal = header[0] & 0x80;
+    frame.payload = buffer_.mid(offset_ + headerSize, size);
+    if (isMasked) {
+        const quint8 *mask = header + maskOffset;
+        char *data = frame.payload.data();
+        for (quint64 i = 0; i < size; ++i)
+            data[i] ^= mask[i & 3];
+    }
+    offset_ += headerSize + size;
+    return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QByteArray>
+
+// WebSocket framing (RFC 6455) for NativeTunnel: the client frames are masked, the server frames are not,
+// but both are accepted by the parser.
+class WebSocketFramer
+{
+public:
+    enum Opcode {
+        kContinuation = 0x0,
+        kText = 0x1,
+        kBinary = 0x2,
+        kClose = 0x8,
+        kPing = 0x9,
+        kPong = 0xA
+    };
+
+    struct Frame
+    {
+        int opcode;
+        bool isFinal;
+        QByteArray payload;
+    };
+
+    static QByteArray encode(int opcode, const QByteArray &payload, bool isMasked);
+
+    void append(const QByteArray &data);
+    // false if there is no complete frame yet or on an error
+    bool next(Frame &frame);
+    bool isError() const { return isError_; }
+
+private:
+    static constexpr quint64 kMaxFrameSize = 16 * 1024 * 1024;
+
+    QByteArray buffer_;
+    int offset_ = 0;        // the start of the unparsed data in buffer_
+    bool isError_ = false;
+};
@@ -7,6 +7,7 @@
 #include "utils/utils.h"
 #include "types/enums.h"
 #include "availableport.h"
+#include "openvpnmanagementparser.h"
 #include "engine/openvpnversioncontroller.h"
 #include "utils/ipvalidation.h"
 
@@ -157,6 +158,8 @@ IHelper::ExecuteError OpenVPNConnection::runOpenVPN(unsigned int port, const typ
 
     qCInfo(LOG_CONNECTION) << "OpenVPN version:" << OpenVpnVersionController::instance().getOpenVpnVersion();
 
+    // the management port stays reserved until openvpn is about to bind it
+    AvailablePort::releasePort(port);
     return helper_->executeOpenVPN(config_, port, httpProxy, httpPort, socksProxy, socksPort, outCmdId, isCustomConfig);
 }
 
@@ -200,7 +203,7 @@ void OpenVPNConnection::onKillControllerTimer()
 
 void OpenVPNConnection::funcRunOpenVPN()
 {
-    stateVariables_.openVpnPort = AvailablePort::getAvailablePort(DEFAULT_PORT);
+    stateVariables_.openVpnPort = AvailablePort::reservePort(DEFAULT_PORT);
 
     stateVariables_.elapsedTimer.start();
 
@@ -318,36 +321,45 @@ void OpenVPNConnection::handleRead(const boost::system::error_code &err, size_t
         std::string resultLine;
         std::getline(is, resultLine);
 
-        QString serverReply = QString::fromStdString(resultLine).trimmed();
+        using Message = OpenVPNManagementParser::Message;
+        const OpenVPNManagementParser::Result parsed = OpenVPNManagementParser::parse(resultLine);
+        const Message message = parsed.message;
+
+        // the byte counters are handled without converting the line to QString
+        QString serverReply;
+        if (message != Message::kByteCount)
+        {
+            serverReply = QString::fromStdString(resultLine).trimmed();
+        }
 
         boost::system::error_code write_error;
         // skip log out BYTECOUNT
-        if (!serverReply.contains(">BYTECOUNT:", Qt::CaseInsensitive))
+        if (!parsed.isContainsByteCount)
         {
             qCInfo(LOG_OPENVPN) << serverReply;
         }
-        if (serverReply.contains("HOLD:Waiting for hold release", Qt::CaseInsensitive))
+        if (message == Message::kHoldWaitingForRelease)
         {
             boost::asio::write(*stateVariables_.socket, boost::asio::buffer("state on all\n"), boost::asio::transfer_all(), write_error);
         }
-        else if (serverReply.startsWith("END") && stateVariables_.bWasStateNotification)
+        else if (parsed.isStartsWithEnd && stateVariables_.bWasStateNotification)
         {
             boost::asio::write(*stateVariables_.socket, boost::asio::buffer("log on\n"), boost::asio::transfer_all(), write_error);
         }
-        else if (serverReply.contains("SUCCESS: real-time state notification set to ON", Qt::CaseInsensitive))
+        else if (message == Message::kStateNotificationOn)
         {
             stateVariables_.bWasStateNotification = true;
             stateVariables_.isAcceptSigTermCommand_ = true;
         }
-        else if (serverReply.contains("SUCCESS: real-time log notification set to ON", Qt::CaseInsensitive))
+        else if (message == Message::kLogNotificationOn)
         {
             boost::asio::write(*stateVariables_.socket, boost::asio::buffer("bytecount 1\n"), boost::asio::transfer_all(), write_error);
         }
-        else if (serverReply.contains("SUCCESS: bytecount interval changed", Qt::CaseInsensitive))
+        else if (message == Message::kBytecountIntervalChanged)
         {
             boost::asio::write(*stateVariables_.socket, boost::asio::buffer("hold release\n"), boost::asio::transfer_all(), write_error);
         }
-        else if (serverReply.contains("PASSWORD:Need 'Auth' username/password", Qt::CaseInsensitive))
+        else if (message == Message::kNeedAuthUsernamePassword)
         {
             if (!username_.isEmpty())
             {
@@ -360,7 +372,7 @@ void OpenVPNConnection::handleRead(const boost::system::error_code &err, size_t
                 emit requestUsername();
             }
         }
-        else if (serverReply.contains("PASSWORD:Need 'Private Key' password", Qt::CaseInsensitive))
+        else if (message == Message::kNeedPrivateKeyPassword)
         {
             if (!privKeyPassword_.isEmpty())
             {
@@ -373,19 +385,19 @@ void OpenVPNConnection::handleRead(const boost::system::error_code &err, size_t
                 emit requestPrivKeyPassword();
             }
         }
-        else if (serverReply.contains("PASSWORD:Need 'HTTP Proxy' username/password", Qt::CaseInsensitive))
+        else if (message == Message::kNeedHttpProxyUsernamePassword)
         {
             char message[1024];
             snprintf(message, 1024, "username \"HTTP Proxy\" %s\n", proxySettings_.getUsername().toUtf8().data());
             boost::asio::write(*stateVariables_.socket, boost::asio::buffer(message,strlen(message)), boost::asio::transfer_all(), write_error);
         }
-        else if (serverReply.contains("'HTTP Proxy' username entered, but not yet verified", Qt::CaseInsensitive))
+        else if (message == Message::kHttpProxyUsernameEntered)
         {
             char message[1024];
             snprintf(message, 1024, "password \"HTTP Proxy\" %s\n", proxySettings_.getPassword().toUtf8().data());
             boost::asio::write(*stateVariables_.socket, boost::asio::buffer(message, strlen(message)), boost::asio::transfer_all(), write_error);
         }
-        else if (serverReply.contains("'Auth' username entered, but not yet verified", Qt::CaseInsensitive))
+        else if (message == Message::kAuthUsernameEntered)
         {
             if (!password_.isEmpty())
             {
@@ -404,7 +416,7 @@ void OpenVPNConnection::handleRead(const boost::system::error_code &err, size_t
                 emit requestPassword();
             }
         }
-        else if (serverReply.contains("PASSWORD:Verification Failed: 'Auth'", Qt::CaseInsensitive))
+        else if (message == Message::kAuthVerificationFailed)
         {
             emit error(CONNECT_ERROR::AUTH_ERROR);
             if (!stateVariables_.bSigTermSent)
@@ -414,7 +426,7 @@ void OpenVPNConnection::handleRead(const boost::system::error_code &err, size_t
                 stateVariables_.bSigTermSent = true;
             }
         }
-        else if (serverReply.contains("FATAL:Error: private key password verification failed", Qt::CaseInsensitive))
+        else if (message == Message::kPrivateKeyPasswordVerificationFailed)
         {
             emit error(CONNECT_ERROR::PRIV_KEY_PASSWORD_ERROR);
             if (!stateVariables_.bSigTermSent)
@@ -424,8 +436,7 @@ void OpenVPNConnection::handleRead(const boost::system::error_code &err, size_t
                 stateVariables_.bSigTermSent = true;
             }
         }
-        else if (serverReply.contains("There are no TAP-Windows", Qt::CaseInsensitive) && serverReply.contains("Wintun",Qt::CaseInsensitive) &&
-                 serverReply.contains("adapters on this system.",Qt::CaseInsensitive))
+        else if (message == Message::kNoTunTapAdapters)
         {
             if (!stateVariables_.bTapErrorEmited)
             {
@@ -439,146 +450,125 @@ void OpenVPNConnection::handleRead(const boost::system::error_code &err, size_t
                 }
             }
         }
-        else if (serverReply.startsWith(">BYTECOUNT:", Qt::CaseInsensitive))
+        else if (message == Message::kByteCount)
         {
-            QStringList pars = serverReply.split(":");
-            if (pars.count() > 1)
+            quint64 l1 = parsed.bytesIn;
+            quint64 l2 = parsed.bytesOut;
+            if (stateVariables_.bFirstCalcStat)
             {
-                QStringList pars2 = pars[1].split(",");
-                if (pars2.count() == 2)
-                {
-                    quint64 l1 = pars2[0].toULongLong();
-                    quint64 l2 = pars2[1].toULongLong();
-                    if (stateVariables_.bFirstCalcStat)
-                    {
-                        stateVariables_.prevBytesRcved = l1;
-                        stateVariables_.prevBytesXmited = l2;
-                        emit statisticsUpdated(stateVariables_.prevBytesRcved, stateVariables_.prevBytesXmited, false);
-                        stateVariables_.bFirstCalcStat = false;
-                    }
-                    else
-                    {
-                        emit statisticsUpdated(l1 - stateVariables_.prevBytesRcved, l2 - stateVariables_.prevBytesXmited, false);
-                        stateVariables_.prevBytesRcved = l1;
-                        stateVariables_.prevBytesXmited = l2;
-                    }
-                }
+                stateVariables_.prevBytesRcved = l1;
+                stateVariables_.prevBytesXmited = l2;
+                emit statisticsUpdated(stateVariables_.prevBytesRcved, stateVariables_.prevBytesXmited, false);
+                stateVariables_.bFirstCalcStat = false;
+            }
+            else
+            {
+                emit statisticsUpdated(l1 - stateVariables_.prevBytesRcved, l2 - stateVariables_.prevBytesXmited, false);
+                stateVariables_.prevBytesRcved = l1;
+                stateVariables_.prevBytesXmited = l2;
             }
         }
-        else if (serverReply.startsWith(">STATE:", Qt::CaseInsensitive))
+        else if (message == Message::kStateConnectedSuccess)
         {
-            if (serverReply.contains("CONNECTED,SUCCESS", Qt::CaseInsensitive))
-            {
 #ifdef Q_OS_WIN
-                AdapterGatewayInfo windscribeAdapter = AdapterUtils_win::getConnectedAdapterInfo(QString::fromWCharArray(kOpenVPNAdapterIdentifier));
-                if (!windscribeAdapter.isEmpty())
-                {
-                    if (connectionAdapterInfo_.adapterIp() != windscribeAdapter.adapterIp())
-                    {
-                        qCCritical(LOG_CONNECTION) << "Error: Adapter IP detected from openvpn log not equal to the adapter IP from AdapterUtils_win::getWindscribeConnectedAdapterInfo()";
-                        WS_ASSERT(false);
-                    }
-                    connectionAdapterInfo_.setAdapterName(windscribeAdapter.adapterName());
-                    connectionAdapterInfo_.setAdapterIp(windscribeAdapter.adapterIp());
-                    connectionAdapterInfo_.setDnsServers(windscribeAdapter.dnsServers());
-                    connectionAdapterInfo_.setIfIndex(windscribeAdapter.ifIndex());
-                }
-                else
+            AdapterGatewayInfo windscribeAdapter = AdapterUtils_win::getConnectedAdapterInfo(QString::fromWCharArray(kOpenVPNAdapterIdentifier));
+            if (!windscribeAdapter.isEmpty())
+            {
+                if (connectionAdapterInfo_.adapterIp() != windscribeAdapter.adapterIp())
                 {
-                    qCCritical(LOG_CONNECTION) << "Can't detect connected Windscribe adapter";
+                    qCCritical(LOG_CONNECTION) << "Error: Adapter IP detected from openvpn log not equal to the adapter IP from AdapterUtils_win::getWindscribeConnectedAdapterInfo()";
+                    WS_ASSERT(false);
                 }
+                connectionAdapterInfo_.setAdapterName(windscribeAdapter.adapterName());
+                connectionAdapterInfo_.setAdapterIp(windscribeAdapter.adapterIp());
+                connectionAdapterInfo_.setDnsServers(windscribeAdapter.dnsServers());
+                connectionAdapterInfo_.setIfIndex(windscribeAdapter.ifIndex());
+            }
+            else
+            {
+                qCCritical(LOG_CONNECTION) << "Can't detect connected Windscribe adapter";
+            }
 #endif
 
-                QString remoteIp;
-                if (parseConnectedSuccessReply(serverReply, remoteIp))
-                {
-                    connectionAdapterInfo_.setRemoteIp(remoteIp);
-                }
-                else
-                {
-                    qCCritical(LOG_CONNECTION) << "Can't parse CONNECTED,SUCCESS control message";
-                }
-                setCurrentState(STATUS_CONNECTED);
-                emit connected(connectionAdapterInfo_);
-            }
-            else if (serverReply.contains("CONNECTED,ERROR", Qt::CaseInsensitive))
+            QString remoteIp;
+            if (parseConnectedSuccessReply(serverReply, remoteIp))
             {
-                setCurrentState(STATUS_CONNECTED);
-                emit error(CONNECT_ERROR::CONNECTED_ERROR);
+                connectionAdapterInfo_.setRemoteIp(remoteIp);
             }
-            else if (serverReply.contains("RECONNECTING", Qt::CaseInsensitive))
+            else
             {
-                stateVariables_.isAcceptSigTermCommand_ = false;
-                stateVariables_.bWasStateNotification = false;
-                setCurrentState(STATUS_CONNECTED_TO_SOCKET);
-                emit reconnecting();
+                qCCritical(LOG_CONNECTION) << "Can't parse CONNECTED,SUCCESS control message";
             }
+            setCurrentState(STATUS_CONNECTED);
+            emit connected(connectionAdapterInfo_);
         }
-        else if (serverReply.startsWith(">LOG:", Qt::CaseInsensitive))
+        else if (message == Message::kStateConnectedError)
         {
-            bool bContainsUDPWord = serverReply.contains("UDP", Qt::CaseInsensitive);
-            if (bContainsUDPWord && serverReply.contains("No buffer space available (WSAENOBUFS) (code=10055)", Qt::CaseInsensitive))
-            {
-                emit error(CONNECT_ERROR::UDP_CANT_ASSIGN);
-            }
-            else if (bContainsUDPWord && serverReply.contains("No Route to Host (WSAEHOSTUNREACH) (code=10065)", Qt::CaseInsensitive))
-            {
-                emit error(CONNECT_ERROR::UDP_CANT_ASSIGN);
-            }
-            else if (bContainsUDPWord && serverReply.contains("Can't assign requested address (code=49)", Qt::CaseInsensitive))
-            {
-                emit error(CONNECT_ERROR::UDP_CANT_ASSIGN);
-            }
-            else if (bContainsUDPWord && serverReply.contains("No buffer space available (code=55)", Qt::CaseInsensitive))
-            {
-                emit error(CONNECT_ERROR::UDP_NO_BUFFER_SPACE);
-            }
-            else if (bContainsUDPWord && serverReply.contains("Network is down (code=50)", Qt::CaseInsensitive))
-            {
-                emit error(CONNECT_ERROR::UDP_NETWORK_DOWN);
-            }
-            else if (serverReply.contains("write_wintun", Qt::CaseInsensitive) && serverReply.contains("head/tail value is over capacity", Qt::CaseInsensitive))
-            {
-                emit error(CONNECT_ERROR::WINTUN_OVER_CAPACITY);
-            }
-            else if (serverReply.contains("TCP:", Qt::CaseInsensitive) && serverReply.contains("failed", Qt::CaseInsensitive))
-            {
-                emit error(CONNECT_ERROR::TCP_ERROR);
-            }
-            else if (serverReply.contains("Initialization Sequence Completed With Errors", Qt::CaseInsensitive))
-            {
-                emit error(CONNECT_ERROR::INITIALIZATION_SEQUENCE_COMPLETED_WITH_ERRORS);
-            }
+            setCurrentState(STATUS_CONNECTED);
+            emit error(CONNECT_ERROR::CONNECTED_ERROR);
+        }
+        else if (message == Message::kStateReconnecting)
+        {
+            stateVariables_.isAcceptSigTermCommand_ = false;
+            stateVariables_.bWasStateNotification = false;
+            setCurrentState(STATUS_CONNECTED_TO_SOCKET);
+            emit reconnecting();
+        }
+        else if (message == Message::kLogUdpCantAssign)
+        {
+            emit error(CONNECT_ERROR::UDP_CANT_ASSIGN);
+        }
+        else if (message == Message::kLogUdpNoBufferSpace)
+        {
+            emit error(CONNECT_ERROR::UDP_NO_BUFFER_SPACE);
+        }
+        else if (message == Message::kLogUdpNetworkDown)
+        {
+            emit error(CONNECT_ERROR::UDP_NETWORK_DOWN);
+        }
+        else if (message == Message::kLogWintunOverCapacity)
+        {
+            emit error(CONNECT_ERROR::WINTUN_OVER_CAPACITY);
+        }
+        else if (message == Message::kLogTcpError)
+        {
+            emit error(CONNECT_ERROR::TCP_ERROR);
+        }
+        else if (message == Message::kLogInitializationCompletedWithErrors)
+        {
+            emit error(CONNECT_ERROR::INITIALIZATION_SEQUENCE_COMPLETED_WITH_ERRORS);
+        }
 #if defined (Q_OS_MACOS) || defined (Q_OS_LINUX)
-            else if (serverReply.contains("device", Qt::CaseInsensitive) && serverReply.contains("opened", Qt::CaseInsensitive))
+        else if (message == Message::kLogDeviceOpened)
+        {
+            QString deviceName;
+            if (parseDeviceOpenedReply(serverReply, deviceName))
             {
-                QString deviceName;
-                if (parseDeviceOpenedReply(serverReply, deviceName))
-                {
-                    connectionAdapterInfo_.setAdapterName(deviceName);
-                }
+                connectionAdapterInfo_.setAdapterName(deviceName);
             }
+        }
 #endif
-            else if (serverReply.contains("PUSH: Received control message:", Qt::CaseInsensitive))
+        else if (message == Message::kLogPushReply)
+        {
+            bool isRedirectDefaultGateway = true;
+            if (!parsePushReply(serverReply, connectionAdapterInfo_, isRedirectDefaultGateway))
             {
-                bool isRedirectDefaultGateway = true;
-                if (!parsePushReply(serverReply, connectionAdapterInfo_, isRedirectDefaultGateway))
-                {
-                    qCCritical(LOG_CONNECTION) << "Can't parse PUSH Received control message";
-                }
+                qCCritical(LOG_CONNECTION) << "Can't parse PUSH Received control message";
+            }
 
-                if (isRedirectDefaultGateway)
-                {
-                    // We are going to set up the default gateway, so firewall is allowed after
-                    // we have connected (unless the current custom config explicitly forbits this).
-                    isAllowFirewallAfterCustomConfigConnection_ = true;
-                }
-            } else if (serverReply.contains("write UDP: Unknown error (code=10065)") || serverReply.contains("write UDP: Unknown error (code=10054)")) {
-                // These errors indicate socket was closed or otherwise unavailable for writing.
-                setCurrentStateAndEmitDisconnected(STATUS_DISCONNECTED);
+            if (isRedirectDefaultGateway)
+            {
+                // We are going to set up the default gateway, so firewall is allowed after
+                // we have connected (unless the current custom config explicitly forbits this).
+                isAllowFirewallAfterCustomConfigConnection_ = true;
             }
         }
-        else if (serverReply.contains(">FATAL:All wintun adapters on this system are currently in use", Qt::CaseInsensitive))
+        else if (message == Message::kLogUdpWriteError)
+        {
+            // These errors indicate socket was closed or otherwise unavailable for writing.
+            setCurrentStateAndEmitDisconnected(STATUS_DISCONNECTED);
+        }
+        else if (message == Message::kWintunFatalError)
         {
             emit error(CONNECT_ERROR::WINTUN_FATAL_ERROR);
         }
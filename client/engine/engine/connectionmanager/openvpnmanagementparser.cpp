@@ -0,0 +1,322 @@
+#include "openvpnmanagementparser.h"
+
+#include <QtGlobal>
+#include <array>
+#include <queue>
+
+namespace {
+
+// the patterns are lowercase, the matching is case-insensitive
+enum Pattern {
+    kPatHold,
+    kPatStateNotificationOn,
+    kPatLogNotificationOn,
+    kPatBytecountIntervalChanged,
+    kPatNeedAuth,
+    kPatNeedPrivateKey,
+    kPatNeedHttpProxy,
+    kPatHttpProxyUsernameEntered,
+    kPatAuthUsernameEntered,
+    kPatAuthVerificationFailed,
+    kPatPrivateKeyVerificationFailed,
+    kPatNoTapWindows,
+    kPatWintun,
+    kPatAdaptersOnThisSystem,
+    kPatByteCount,
+    kPatConnectedSuccess,
+    kPatConnectedError,
+    kPatReconnecting,
+    kPatUdp,
+    kPatUdpNoBufferSpaceWin,
+    kPatUdpNoRouteToHostWin,
+    kPatUdpCantAssignAddress,
+    kPatUdpNoBufferSpace,
+    kPatUdpNetworkDown,
+    kPatWriteWintun,
+    kPatOverCapacity,
+    kPatTcp,
+    kPatFailed,
+    kPatInitializationCompletedWithErrors,
+    kPatDevice,
+    kPatOpened,
+    kPatPushReply,
+    kPatWriteUdpError10065,
+    kPatWriteUdpError10054,
+    kPatWintunFatal,
+    kPatCount
+};
+
+constexpr std::array<std::string_view, kPatCount> kPatterns = {
+    "hold:waiting for hold release",
+    "success: real-time state notification set to on",
+    "success: real-time log notification set to on",
+    "success: bytecount interval changed",
+    "password:need 'auth' username/password",
+    "password:need 'private key' password",
+    "password:need 'http proxy' username/password",
+    "'http proxy' username entered, but not yet verified",
+    "'auth' username entered, but not yet verified",
+    "password:verification failed: 'auth'",
+    "fatal:error: private key password verification failed",
+    "there are no tap-windows",
+    "wintun",
+    "adapters on this system.",
+    ">bytecount:",
+    "connected,success",
+    "connected,error",
+    "reconnecting",
+    "udp",
+    "no buffer space available (wsaenobufs) (code=10055)",
+    "no route to host (wsaehostunreach) (code=10065)",
+    "can't assign requested address (code=49)",
+    "no buffer space available (code=55)",
+    "network is down (code=50)",
+    "write_wintun",
+    "head/tail value is over capacity",
+    "tcp:",
+    "failed",
+    "initialization sequence completed with errors",
+    "device",
+    "opened",
+    "push: received control message:",
+    "write udp: unknown error (code=10065)",
+    "write udp: unknown error (code=10054)",
+    ">fatal:all wintun adapters on this system are currently in use",
+};
+static_assert(kPatCount <= 64, "the matched patterns are stored in a 64-bit mask");
+
+inline char toLowerAscii(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+bool startsWithNoCase(std::string_view str, std::string_view prefix)
+{
+    if (str.size() < prefix.size())
+        return false;
+    for (size_t i = 0; i < prefix.size(); ++i) {
+        if (toLowerAscii(str[i]) != prefix[i])
+            return false;
+    }
+    return true;
+}
+
+std::string_view trimmed(std::string_view str)
+{
+    auto isSpace = [](char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f'; };
+    while (!str.empty() && isSpace(str.front()))
+        str.remove_prefix(1);
+    while (!str.empty() && isSpace(str.back()))
+        str.remove_suffix(1);
+    return str;
+}
+
+} // namespace
+
+// The goto function is completed with the failure links, so the matching is a single table lookup per character.
+// The alphabet is reduced to the characters used in the patterns, all the others map to the class 0.
+class OpenVPNManagementParser::Automaton
+{
+public:
+    Automaton()
+    {
+        charClass_.fill(0);
+        classesCount_ = 1;
+        for (const auto &pattern : kPatterns) {
+            for (char c : pattern) {
+                unsigned char uc = static_cast<unsigned char>(c);
+                if (charClass_[uc] == 0) {
+                    charClass_[uc] = classesCount_;
+                    if (c >= 'a' && c <= 'z')
+                        charClass_[static_cast<unsigned char>(c - 'a' + 'A')] = classesCount_;
+                    classesCount_++;
+                }
+            }
+        }
+
+        // trie
+        constexpr std::uint32_t kNoState = UINT32_MAX;
+        next_.assign(classesCount_, kNoState);
+        output_.assign(1, 0);
+        for (int p = 0; p < kPatCount; ++p) {
+            std::uint32_t state = 0;
+            for (char c : kPatterns[p]) {
+                std::uint32_t &next = next_[state * classesCount_ + charClass_[static_cast<unsigned char>(c)]];
+                if (next == kNoState) {
+                    next = static_cast<std::uint32_t>(output_.size());
+                    next_.resize(next_.size() + classesCount_, kNoState);
+                    output_.push_back(0);
+                }
+                state = next_[state * classesCount_ + charClass_[static_cast<unsigned char>(c)]];
+            }
+            output_[state] |= (1ull << p);
+        }
+
+        // failure links (BFS)
+        std::vector<std::uint32_t> fail(output_.size(), 0);
+        std::queue<std::uint32_t> queue;
+        for (std::uint32_t c = 0; c < classesCount_; ++c) {
+            std::uint32_t &next = next_[c];
+            if (next == kNoState) {
+                next = 0;
+            } else {
+                fail[next] = 0;
+                queue.push(next);
+            }
+        }
+        while (!queue.empty()) {
+            std::uint32_t state = queue.front();
+            queue.pop();
+            output_[state] |= output_[fail[state]];
+            for (std::uint32_t c = 0; c < classesCount_; ++c) {
+                std::uint32_t &next = next_[state * classesCount_ + c];
+                std::uint32_t failNext = next_[fail[state] * classesCount_ + c];
+                if (next == kNoState) {
+                    next = failNext;
+                } else {
+                    fail[next] = failNext;
+                    queue.push(next);
+                }
+            }
+        }
+    }
+
+    std::uint64_t match(std::string_view str) const
+    {
+        std::uint64_t mask = 0;
+        std::uint32_t state = 0;
+        for (char c : str) {
+            state = next_[state * classesCount_ + charClass_[static_cast<unsigned char>(c)]];
+            mask |= output_[state];
+        }
+        return mask;
+    }
+
+private:
+    std::array<std::uint32_t, 256> charClass_;
+    std::uint32_t classesCount_;
+    std::vector<std::uint32_t> next_;
+    std::vector<std::uint64_t> output_;
+};
+
+const OpenVPNManagementParser::Automaton &OpenVPNManagementParser::automaton()
+{
+    static const Automaton automaton;
+    return automaton;
+}
+
+OpenVPNManagementParser::Result OpenVPNManagementParser::parse(std::string_view line)
+{
+    Result result;
+    line = trimmed(line);
+
+    // fast path for the most frequent message, the counters can't contain any of the other patterns
+    constexpr std::string_view kByteCountPrefix = ">bytecount:";
+    if (startsWithNoCase(line, kByteCountPrefix) && parseByteCount(line.substr(kByteCountPrefix.size()), result.bytesIn, result.bytesOut)) {
+        result.message = Message::kByteCount;
+        result.isContainsByteCount = true;
+        return result;
+    }
+
+    const std::uint64_t mask = automaton().match(line);
+    auto has = [mask](Pattern p) { return (mask & (1ull << p)) != 0; };
+
+    result.isStartsWithEnd = line.substr(0, 3) == "END";
+    result.isContainsByteCount = has(kPatByteCount);
+
+    // the order of the checks defines the priority of the messages
+    if (has(kPatHold))
+        result.message = Message::kHoldWaitingForRelease;
+    else if (has(kPatStateNotificationOn))
+        result.message = Message::kStateNotificationOn;
+    else if (has(kPatLogNotificationOn))
+        result.message = Message::kLogNotificationOn;
+    else if (has(kPatBytecountIntervalChanged))
+        result.message = Message::kBytecountIntervalChanged;
+    else if (has(kPatNeedAuth))
+        result.message = Message::kNeedAuthUsernamePassword;
+    else if (has(kPatNeedPrivateKey))
+        result.message = Message::kNeedPrivateKeyPassword;
+    else if (has(kPatNeedHttpProxy))
+        result.message = Message::kNeedHttpProxyUsernamePassword;
+    else if (has(kPatHttpProxyUsernameEntered))
+        result.message = Message::kHttpProxyUsernameEntered;
+    else if (has(kPatAuthUsernameEntered))
+        result.message = Message::kAuthUsernameEntered;
+    else if (has(kPatAuthVerificationFailed))
+        result.message = Message::kAuthVerificationFailed;
+    else if (has(kPatPrivateKeyVerificationFailed))
+        result.message = Message::kPrivateKeyPasswordVerificationFailed;
+    else if (has(kPatNoTapWindows) && has(kPatWintun) && has(kPatAdaptersOnThisSystem))
+        result.message = Message::kNoTunTapAdapters;
+    else if (startsWithNoCase(line, kByteCountPrefix)) {
+        // the counters were not parsed by the fast path
+        result.message = Message::kNone;
+    }
+    else if (startsWithNoCase(line, ">state:")) {
+        if (has(kPatConnectedSuccess))
+            result.message = Message::kStateConnectedSuccess;
+        else if (has(kPatConnectedError))
+            result.message = Message::kStateConnectedError;
+        else if (has(kPatReconnecting))
+            result.message = Message::kStateReconnecting;
+        else
+            result.message = Message::kState;
+    }
+    else if (startsWithNoCase(line, ">log:")) {
+        const bool isUdp = has(kPatUdp);
+        if (isUdp && (has(kPatUdpNoBufferSpaceWin) || has(kPatUdpNoRouteToHostWin) || has(kPatUdpCantAssignAddress)))
+            result.message = Message::kLogUdpCantAssign;
+        else if (isUdp && has(kPatUdpNoBufferSpace))
+            result.message = Message::kLogUdpNoBufferSpace;
+        else if (isUdp && has(kPatUdpNetworkDown))
+            result.message = Message::kLogUdpNetworkDown;
+        else if (has(kPatWriteWintun) && has(kPatOverCapacity))
+            result.message = Message::kLogWintunOverCapacity;
+        else if (has(kPatTcp) && has(kPatFailed))
+            result.message = Message::kLogTcpError;
+        else if (has(kPatInitializationCompletedWithErrors))
+            result.message = Message::kLogInitializationCompletedWithErrors;
+#if defined (Q_OS_MACOS) || defined (Q_OS_LINUX)
+        else if (has(kPatDevice) && has(kPatOpened))
+            result.message = Message::kLogDeviceOpened;
+#endif
+        else if (has(kPatPushReply))
+            result.message = Message::kLogPushReply;
+        // these two are matched case-sensitively
+        else if ((has(kPatWriteUdpError10065) && line.find("write UDP: Unknown error (code=10065)") != std::string_view::npos) ||
+                 (has(kPatWriteUdpError10054) && line.find("write UDP: Unknown error (code=10054)") != std::string_view::npos))
+            result.message = Message::kLogUdpWriteError;
+        else
+            result.message = Message::kLog;
+    }
+    else if (has(kPatWintunFatal))
+        result.message = Message::kWintunFatalError;
+
+    return result;
+}
+
+bool OpenVPNManagementParser::parseByteCount(std::string_view str, std::uint64_t &outIn, std::uint64_t &outOut)
+{
+    // the format is "<bytes_in>,<bytes_out>"
+    std::uint64_t values[2] = { 0, 0 };
+    int ind = 0;
+    bool hasDigits = false;
+    for (char c : str) {
+        if (c >= '0' && c <= '9') {
+            values[ind] = values[ind] * 10 + static_cast<std::uint64_t>(c - '0');
+            hasDigits = true;
+        } else if (c == ',' && ind == 0 && hasDigits) {
+            ind = 1;
+            hasDigits = false;
+        } else {
+            return false;
+        }
+    }
+    if (ind != 1 || !hasDigits)
+        return false;
+
+    outIn = values[0];
+    outOut = values[1];
+    return true;
+}
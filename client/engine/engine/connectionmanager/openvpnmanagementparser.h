@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Classifies the lines received from the OpenVPN management interface.
+// All the known messages are matched case-insensitively in a single pass over the line with an Aho-Corasick
+// automaton which is built once. The byte counters are parsed in place without allocations.
+class OpenVPNManagementParser
+{
+public:
+    enum class Message {
+        kNone,
+        kHoldWaitingForRelease,
+        kStateNotificationOn,
+        kLogNotificationOn,
+        kBytecountIntervalChanged,
+        kNeedAuthUsernamePassword,
+        kNeedPrivateKeyPassword,
+        kNeedHttpProxyUsernamePassword,
+        kHttpProxyUsernameEntered,
+        kAuthUsernameEntered,
+        kAuthVerificationFailed,
+        kPrivateKeyPasswordVerificationFailed,
+        kNoTunTapAdapters,
+        kByteCount,
+        kStateConnectedSuccess,
+        kStateConnectedError,
+        kStateReconnecting,
+        kState,
+        kLogUdpCantAssign,
+        kLogUdpNoBufferSpace,
+        kLogUdpNetworkDown,
+        kLogWintunOverCapacity,
+        kLogTcpError,
+        kLogInitializationCompletedWithErrors,
+        kLogDeviceOpened,
+        kLogPushReply,
+        kLogUdpWriteError,
+        kLog,
+        kWintunFatalError
+    };
+
+    struct Result
+    {
+        Message message = Message::kNone;
+        bool isStartsWithEnd = false;       // the "END" line of a multi-line reply
+        bool isContainsByteCount = false;   // such lines are not logged
+        std::uint64_t bytesIn = 0;          // valid for Message::kByteCount
+        std::uint64_t bytesOut = 0;
+    };
+
+    // the line may have the surrounding whitespaces
+    static Result parse(std::string_view line);
+
+private:
+    class Automaton;
+    static const Automaton &automaton();
+    static bool parseByteCount(std::string_view str, std::uint64_t &outIn, std::uint64_t &outOut);
+};
@@ -0,0 +1,104 @@
+#include <QtTest>
+#include "openvpnmanagementparser.test.h"
+#include "openvpnmanagementparser.h"
+
+using Message = OpenVPNManagementParser::Message;
+
+void TestOpenVPNManagementParser::initTestCase()
+{
+    QFile file(":data/tests/openvpnmanagement/transcript.txt");
+    file.open(QIODevice::ReadOnly);
+    QVERIFY(file.isOpen());
+    while (!file.atEnd()) {
+        // keep the line endings, the parser must trim them as the real socket reader does not
+        transcript_.push_back(file.readLine().toStdString());
+    }
+    QVERIFY(!transcript_.empty());
+}
+
+void TestOpenVPNManagementParser::testMessages()
+{
+    QCOMPARE(OpenVPNManagementParser::parse(">HOLD:Waiting for hold release:0").message, Message::kHoldWaitingForRelease);
+    QCOMPARE(OpenVPNManagementParser::parse("SUCCESS: real-time state notification set to ON").message, Message::kStateNotificationOn);
+    QCOMPARE(OpenVPNManagementParser::parse("success: REAL-TIME log notification set to on").message, Message::kLogNotificationOn);
+    QCOMPARE(OpenVPNManagementParser::parse(">PASSWORD:Need 'Auth' username/password").message, Message::kNeedAuthUsernamePassword);
+    QCOMPARE(OpenVPNManagementParser::parse(">PASSWORD:Need 'HTTP Proxy' username/password").message, Message::kNeedHttpProxyUsernamePassword);
+    QCOMPARE(OpenVPNManagementParser::parse(">PASSWORD:Verification Failed: 'Auth'").message, Message::kAuthVerificationFailed);
+    QCOMPARE(OpenVPNManagementParser::parse(">STATE:1700000002,CONNECTED,ERROR,10.111.0.23,185.232.22.10,443,,").message, Message::kStateConnectedError);
+    QCOMPARE(OpenVPNManagementParser::parse(">STATE:1700000001,WAIT,,,,,,").message, Message::kState);
+    QCOMPARE(OpenVPNManagementParser::parse(">LOG:1,W,write UDP: No buffer space available (code=55)").message, Message::kLogUdpNoBufferSpace);
+    QCOMPARE(OpenVPNManagementParser::parse(">LOG:1,N,Initialization Sequence Completed With Errors").message, Message::kLogInitializationCompletedWithErrors);
+    QCOMPARE(OpenVPNManagementParser::parse(">LOG:1,W,write UDP: Unknown error (code=10054)").message, Message::kLogUdpWriteError);
+    // matched case-sensitively
+    QCOMPARE(OpenVPNManagementParser::parse(">LOG:1,W,write udp: unknown error (code=10054)").message, Message::kLog);
+    QCOMPARE(OpenVPNManagementParser::parse(">FATAL:All wintun adapters on this system are currently in use").message, Message::kWintunFatalError);
+    QCOMPARE(OpenVPNManagementParser::parse("There are no TAP-Windows, Wintun or ovpn-dco adapters on this system.").message, Message::kNoTunTapAdapters);
+    QCOMPARE(OpenVPNManagementParser::parse(">INFO:OpenVPN Management Interface Version 5").message, Message::kNone);
+
+    // a message in the log line has the priority over the log line type
+    QCOMPARE(OpenVPNManagementParser::parse(">LOG:1,,PASSWORD:Need 'Private Key' password").message, Message::kNeedPrivateKeyPassword);
+
+    OpenVPNManagementParser::Result end = OpenVPNManagementParser::parse("END\r\n");
+    QVERIFY(end.isStartsWithEnd);
+    QCOMPARE(end.message, Message::kNone);
+}
+
+void TestOpenVPNManagementParser::testByteCount()
+{
+    OpenVPNManagementParser::Result r = OpenVPNManagementParser::parse(">BYTECOUNT:18446744073709551615,0\r");
+    QCOMPARE(r.message, Message::kByteCount);
+    QVERIFY(r.isContainsByteCount);
+    QCOMPARE(r.bytesIn, 18446744073709551615ull);
+    QCOMPARE(r.bytesOut, 0ull);
+
+    r = OpenVPNManagementParser::parse(">bytecount:12,34");
+    QCOMPARE(r.message, Message::kByteCount);
+    QCOMPARE(r.bytesIn, 12ull);
+    QCOMPARE(r.bytesOut, 34ull);
+
+    r = OpenVPNManagementParser::parse(">BYTECOUNT:12");
+    QCOMPARE(r.message, Message::kNone);
+    QVERIFY(r.isContainsByteCount);
+
+    r = OpenVPNManagementParser::parse(">BYTECOUNT:12,x");
+    QCOMPARE(r.message, Message::kNone);
+}
+
+void TestOpenVPNManagementParser::testTranscript()
+{
+    int byteCounts = 0, connected = 0, reconnecting = 0, pushReplies = 0, tcpErrors = 0, devicesOpened = 0;
+    for (const auto &line : transcript_) {
+        switch (OpenVPNManagementParser::parse(line).message) {
+        case Message::kByteCount: byteCounts++; break;
+        case Message::kStateConnectedSuccess: connected++; break;
+        case Message::kStateReconnecting: reconnecting++; break;
+        case Message::kLogPushReply: pushReplies++; break;
+        case Message::kLogTcpError: tcpErrors++; break;
+        case Message::kLogDeviceOpened: devicesOpened++; break;
+        default: break;
+        }
+    }
+    QCOMPARE(byteCounts, 19);
+    QCOMPARE(connected, 2);
+    QCOMPARE(reconnecting, 1);
+    QCOMPARE(pushReplies, 1);
+    QCOMPARE(tcpErrors, 1);
+#if defined (Q_OS_MACOS) || defined (Q_OS_LINUX)
+    QCOMPARE(devicesOpened, 1);
+#else
+    QCOMPARE(devicesOpened, 0);
+#endif
+}
+
+void TestOpenVPNManagementParser::benchmarkTranscriptReplay()
+{
+    std::uint64_t bytes = 0;
+    QBENCHMARK {
+        for (const auto &line : transcript_) {
+            bytes += OpenVPNManagementParser::parse(line).bytesIn;
+        }
+    }
+    QVERIFY(bytes > 0);
+}
+
+QTEST_MAIN(TestOpenVPNManagementParser)
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <QObject>
+#include <QTest>
+#include <string>
+#include <vector>
+
+// tests for class OpenVPNManagementParser and the replay benchmark on a recorded management interface transcript
+class TestOpenVPNManagementParser : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void testMessages();
+    void testByteCount();
+    void testTranscript();
+    void benchmarkTranscriptReplay();
+
+private:
+    std::vector<std::string> transcript_;
+};
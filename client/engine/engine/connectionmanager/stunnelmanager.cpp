@@ -13,6 +13,9 @@
 StunnelManager::StunnelManager(QObject *parent, IHelper *helper)
   : QObject(parent), helper_(helper), port_(0), bProcessStarted_(false)
 {
+    nativeTunnel_ = new NativeTunnel(this);
+    connect(nativeTunnel_, &NativeTunnel::started, this, &StunnelManager::stunnelStarted);
+
 #if defined Q_OS_WIN
     process_ = new QProcess(this);
     connect(process_, &QProcess::started, this, &StunnelManager::onProcessStarted);
@@ -34,6 +37,18 @@ bool StunnelManager::runProcess(const QString &hostname, unsigned int port, bool
 {
     bool ret = false;
 
+    // the in-engine tunnel unless the extra TLS padding is needed, only the external process can add it
+    if (!isExtraPadding && !ExtraConfig::instance().getStealthExternalTunnel() && NativeTunnel::isSupported()) {
+        AvailablePort::releasePort(port_);
+        ret = nativeTunnel_->start(NativeTunnel::Type::kTls, hostname, port, port_);
+        if (ret) {
+            qCInfo(LOG_BASIC) << "stunnel started in the engine on port " << port_;
+        } else {
+            qCWarning(LOG_BASIC) << "stunnel failed to start in the engine";
+        }
+        return ret;
+    }
+
 #if defined(Q_OS_WIN)
     ExecutableSignature sigCheck;
     if (!sigCheck.verify(stunnelExePath_.toStdWString())) {
@@ -53,11 +68,14 @@ bool StunnelManager::runProcess(const QString &hostname, unsigned int port, bool
         args << "--extraTlsPadding";
     }
 
+    // the reserved port is freed for stunnel right before it starts
+    AvailablePort::releasePort(port_);
     process_->start(stunnelExePath_, args);
     ret = true;
 #else
     Helper_posix *helper_posix = dynamic_cast<Helper_posix *>(helper_);
 
+    AvailablePort::releasePort(port_);
     ret = !helper_posix->startStunnel(hostname, port, port_, isExtraPadding);
     if (ret) {
         emit stunnelStarted();
@@ -74,6 +92,7 @@ bool StunnelManager::runProcess(const QString &hostname, unsigned int port, bool
 
 void StunnelManager::killProcess()
 {
+    nativeTunnel_->stop();
 #if defined(Q_OS_WIN)
     if (bProcessStarted_) {
         process_->close();
@@ -83,13 +102,15 @@ void StunnelManager::killProcess()
     Helper_posix *helper_posix = dynamic_cast<Helper_posix *>(helper_);
     helper_posix->executeTaskKill(kTargetStunnel);
 #endif
+    AvailablePort::releasePort(port_);
     bProcessStarted_ = false;
     qCInfo(LOG_BASIC) << "stunnel stopped";
 }
 
 unsigned int StunnelManager::getPort()
 {
-    port_ = AvailablePort::getAvailablePort(kDefaultPort);
+    AvailablePort::releasePort(port_);
+    port_ = AvailablePort::reservePort(kDefaultPort);
     return port_;
 }
 
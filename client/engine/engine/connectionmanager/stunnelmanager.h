@@ -3,6 +3,7 @@
 #include <QObject>
 #include <QProcess>
 #include "engine/helper/ihelper.h"
+#include "nativetunnel/nativetunnel.h"
 
 class StunnelManager : public QObject
 {
@@ -30,6 +31,7 @@ private:
     static constexpr unsigned int kDefaultPort = 1194;
 
     IHelper *helper_;
+    NativeTunnel *nativeTunnel_;
     unsigned int port_;
     bool bProcessStarted_;
     QString path_;
@@ -8,11 +8,15 @@
 #include "engine/helper/helper_posix.h"
 #endif
 #include "utils/executable_signature/executable_signature.h"
+#include "utils/extraconfig.h"
 
 
 WstunnelManager::WstunnelManager(QObject *parent, IHelper *helper)
   : QObject(parent), helper_(helper), bProcessStarted_(false), port_(0)
 {
+    nativeTunnel_ = new NativeTunnel(this);
+    connect(nativeTunnel_, &NativeTunnel::started, this, &WstunnelManager::wstunnelStarted);
+
 #if defined Q_OS_WIN
     process_ = new QProcess(this);
     connect(process_, &QProcess::started, this, &WstunnelManager::onProcessStarted);
@@ -33,6 +37,19 @@ WstunnelManager::~WstunnelManager()
 bool WstunnelManager::runProcess(const QString &hostname, unsigned int port)
 {
     bool ret = false;
+
+    // the in-engine tunnel unless the external process is forced in the advanced parameters
+    if (!ExtraConfig::instance().getStealthExternalTunnel() && NativeTunnel::isSupported()) {
+        AvailablePort::releasePort(port_);
+        ret = nativeTunnel_->start(NativeTunnel::Type::kWebSocket, hostname, port, port_);
+        if (ret) {
+            qCInfo(LOG_BASIC) << "wstunnel started in the engine on port " << port_;
+        } else {
+            qCWarning(LOG_BASIC) << "wstunnel failed to start in the engine";
+        }
+        return ret;
+    }
+
 #if defined(Q_OS_WIN)
     ExecutableSignature sigCheck;
     if (!sigCheck.verify(wstunnelExePath_.toStdWString()))
@@ -47,10 +64,13 @@ bool WstunnelManager::runProcess(const QString &hostname, unsigned int port)
     args << "--listenAddress" << addr;
     args << "--remoteAddress" << hostaddr;
     args << "--logFilePath" << "";
+    // the reserved port is freed for wstunnel right before it starts
+    AvailablePort::releasePort(port_);
     process_->start(wstunnelExePath_, args);
     ret = true;
 #else
     Helper_posix *helper_posix = dynamic_cast<Helper_posix *>(helper_);
+    AvailablePort::releasePort(port_);
     ret = !helper_posix->startWstunnel(hostname, port, port_);
     if (ret) {
         emit wstunnelStarted();
@@ -68,6 +88,7 @@ bool WstunnelManager::runProcess(const QString &hostname, unsigned int port)
 
 void WstunnelManager::killProcess()
 {
+    nativeTunnel_->stop();
 #if defined(Q_OS_WIN)
     if (bProcessStarted_)
     {
@@ -78,13 +99,15 @@ void WstunnelManager::killProcess()
     Helper_posix *helper_posix = dynamic_cast<Helper_posix *>(helper_);
     helper_posix->executeTaskKill(kTargetWStunnel);
 #endif
+    AvailablePort::releasePort(port_);
     bProcessStarted_ = false;
     qCInfo(LOG_BASIC) << "wstunnel stopped";
 }
 
 unsigned int WstunnelManager::getPort()
 {
-    port_ = AvailablePort::getAvailablePort(kDefaultPort);
+    AvailablePort::releasePort(port_);
+    port_ = AvailablePort::reservePort(kDefaultPort);
     return port_;
 }
 
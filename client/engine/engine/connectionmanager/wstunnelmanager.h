@@ -3,6 +3,7 @@
 #include <QObject>
 #include <QProcess>
 #include "engine/helper/ihelper.h"
+#include "nativetunnel/nativetunnel.h"
 
 class WstunnelManager : public QObject
 {
@@ -30,6 +31,7 @@ private:
     static constexpr unsigned int kDefaultPort = 1194;
 
     IHelper *helper_;
+    NativeTunnel *nativeTunnel_;
     QProcess *process_;
     QString wstunnelExePath_;
     bool bProcessStarted_;
@@ -1,5 +1,7 @@
 #include "customconfigs.h"
+#include <QCryptographicHash>
 #include <QDir>
+#include <QFile>
 #include "utils/log/categories.h"
 #include "parseovpnconfigline.h"
 #include "ovpncustomconfig.h"
@@ -7,10 +9,17 @@
 
 namespace customconfigs {
 
-CustomConfigs::CustomConfigs(QObject *parent) : QObject(parent), dirWatcher_(NULL)
+CustomConfigs::CustomConfigs(QObject *parent) : QObject(parent), dirWatcher_(NULL), generation_(0), pendingFiles_(0)
 {
 }
 
+CustomConfigs::~CustomConfigs()
+{
+    // the parsing jobs post their results to this object
+    threadPool_.clear();
+    threadPool_.waitForDone();
+}
+
 void CustomConfigs::changeDir(const QString &path)
 {
     if (dirWatcher_)
@@ -27,13 +36,13 @@ void CustomConfigs::changeDir(const QString &path)
         return;
     }
 
+    cache_.clear();
     if (!path.isEmpty())
     {
         dirWatcher_ = new CustomConfigsDirWatcher(this, path);
         connect(dirWatcher_, &CustomConfigsDirWatcher::dirChanged, this, &CustomConfigs::onDirectoryChanged);
     }
     parseDir();
-    emit changed();
 }
 
 QVector<QSharedPointer<const ICustomConfig> > CustomConfigs::getConfigs()
@@ -45,28 +54,114 @@ void CustomConfigs::onDirectoryChanged()
 {
     qDebug(LOG_CUSTOM_OVPN) << "custom_configs directory is changed";
     parseDir();
-    emit changed();
 }
 
 void CustomConfigs::parseDir()
+{
+    generation_++;
+    pendingFiles_ = 0;
+
+    QHash<QString, CacheEntry> cache;
+    QVector<QPair<QString, CacheEntry>> filesToParse;
+    if (dirWatcher_)
+    {
+        const QStringList fileList = dirWatcher_->curFiles();
+        for (const QString &filename : fileList)
+        {
+            const QString filepath = dirWatcher_->curDir() + "/" + filename;
+            const QFileInfo fi(filepath);
+            const CacheEntry prevEntry = cache_.value(filepath);
+            if (!prevEntry.config.isNull() && prevEntry.modified == fi.lastModified() && prevEntry.size == fi.size())
+                cache.insert(filepath, prevEntry);
+            else
+                filesToParse << qMakePair(filepath, prevEntry);
+        }
+    }
+    // the removed files are dropped from the cache, the changed ones are added back when parsed
+    cache_ = cache;
+
+    if (filesToParse.isEmpty())
+    {
+        updateConfigs();
+        emit changed();
+        return;
+    }
+
+    qDebug(LOG_CUSTOM_OVPN) << "parsing" << filesToParse.count() << "custom config files of" << cache_.count() + filesToParse.count();
+    pendingFiles_ = filesToParse.count();
+    const quint64 generation = generation_;
+    for (const auto &file : std::as_const(filesToParse))
+    {
+        const QString filepath = file.first;
+        const CacheEntry prevEntry = file.second;
+        threadPool_.start([this, generation, filepath, prevEntry]() {
+            const CacheEntry entry = parseFile(filepath, prevEntry);
+            QMetaObject::invokeMethod(this, [this, generation, filepath, entry]() {
+                onFileParsed(generation, filepath, entry);
+            });
+        });
+    }
+}
+
+void CustomConfigs::onFileParsed(quint64 generation, const QString &filepath, const CacheEntry &entry)
+{
+    // the directory has changed again, the file will be parsed by the latest parseDir() if it still needs to be
+    if (generation != generation_)
+        return;
+
+    cache_.insert(filepath, entry);
+    if (--pendingFiles_ == 0)
+    {
+        updateConfigs();
+        emit changed();
+    }
+}
+
+void CustomConfigs::updateConfigs()
 {
     configs_.clear();
 
     if (!dirWatcher_)
         return;
 
-    QStringList fileList = dirWatcher_->curFiles();
+    // keep the order of the files in the directory
+    const QStringList fileList = dirWatcher_->curFiles();
     for (const QString &filename : fileList)
     {
-        QString filepath = dirWatcher_->curDir() + "/" + filename;
-        QSharedPointer<const ICustomConfig> config = makeCustomConfigFromFile(filepath);
-        if (!config.isNull())
+        auto it = cache_.constFind(dirWatcher_->curDir() + "/" + filename);
+        if (it != cache_.constEnd() && !it->config.isNull())
         {
-            configs_ << config;
+            configs_ << it->config;
         }
     }
 }
 
+// called in the thread pool
+CustomConfigs::CacheEntry CustomConfigs::parseFile(const QString &filepath, const CacheEntry &prevEntry)
+{
+    CacheEntry entry;
+    const QFileInfo fi(filepath);
+    entry.modified = fi.lastModified();
+    entry.size = fi.size();
+
+    QFile file(filepath);
+    if (file.open(QIODevice::ReadOnly))
+    {
+        entry.hash = QCryptographicHash::hash(file.readAll(), QCryptographicHash::Sha256);
+    }
+
+    // only the modification time has changed, the content is the same
+    if (!entry.hash.isEmpty() && entry.hash == prevEntry.hash && !prevEntry.config.isNull())
+    {
+        entry.config = prevEntry.config;
+    }
+    else
+    {
+        entry.config = makeCustomConfigFromFile(filepath);
+    }
+    return entry;
+}
+
 QSharedPointer<const ICustomConfig> CustomConfigs::makeCustomConfigFromFile(const QString &filepath)
 {
     QFileInfo fi(filepath);
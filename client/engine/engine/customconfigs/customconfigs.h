@@ -1,7 +1,10 @@
 #pragma once
 
+#include <QDateTime>
+#include <QHash>
 #include <QObject>
 #include <QSharedPointer>
+#include <QThreadPool>
 #include <QVector>
 #include "icustomconfig.h"
 #include "customconfigsdirwatcher.h"
@@ -9,11 +12,14 @@
 namespace customconfigs {
 
 // parse custom configs directory, make ovpn configs location
+// The parsed configs are cached by (mtime, size, content hash), so only the new or changed files are parsed.
+// The parsing is done in the thread pool, the changed() signal is emitted when all the files are parsed.
 class CustomConfigs : public QObject
 {
     Q_OBJECT
 public:
     explicit CustomConfigs(QObject *parent);
+    ~CustomConfigs();
 
     void changeDir(const QString &path);
     QVector<QSharedPointer<const ICustomConfig>> getConfigs();
@@ -25,12 +31,28 @@ private slots:
     void onDirectoryChanged();
 
 private:
+    struct CacheEntry
+    {
+        QDateTime modified;
+        qint64 size = -1;
+        QByteArray hash;
+        QSharedPointer<const ICustomConfig> config;
+    };
+
     void parseDir();
+    void onFileParsed(quint64 generation, const QString &filepath, const CacheEntry &entry);
+    void updateConfigs();
 
-    QSharedPointer<const ICustomConfig> makeCustomConfigFromFile(const QString &filepath);
+    static CacheEntry parseFile(const QString &filepath, const CacheEntry &prevEntry);
+    static QSharedPointer<const ICustomConfig> makeCustomConfigFromFile(const QString &filepath);
 
     CustomConfigsDirWatcher *dirWatcher_;
     QVector<QSharedPointer<const ICustomConfig>> configs_;
+
+    QHash<QString, CacheEntry> cache_;     // by the file path
+    QThreadPool threadPool_;
+    quint64 generation_;                    // incremented on every parseDir(), the results of the previous ones are only cached
+    int pendingFiles_;
 };
 
 } //namespace customconfigs
@@ -1,6 +1,7 @@
 #include "customconfigsdirwatcher.h"
 
 #include <QDir>
+#include <QSet>
 #include <QStandardPaths>
 #include "utils/log/logger.h"
 
@@ -34,8 +35,13 @@ void CustomConfigsDirWatcher::onDirectoryChanged(const QString & /*path*/)
     checkFiles(true, false);
 }
 
-void CustomConfigsDirWatcher::onFileChanged(const QString & /*path*/)
+void CustomConfigsDirWatcher::onFileChanged(const QString &path)
 {
+    // the watch is dropped if the file was replaced (e.g. saved by an editor via rename), restore it
+    if (QFileInfo::exists(path) && !dirWatcher_.files().contains(path))
+    {
+        dirWatcher_.addPath(path);
+    }
     checkFiles(true, true);
 }
 
@@ -46,12 +52,6 @@ void CustomConfigsDirWatcher::onEmitTimer()
 
 void CustomConfigsDirWatcher::checkFiles(bool bWithEmitSignal, bool bFileChanged)
 {
-    // remove prev files from watch paths
-    for (const QString &filename : qAsConst(curFiles_))
-    {
-        dirWatcher_.removePath(path_ + "/" + filename);
-    }
-
     QDir dir(path_);
     QStringList filters;
     filters << "*.ovpn" << "*.conf";
@@ -67,8 +67,23 @@ void CustomConfigsDirWatcher::checkFiles(bool bWithEmitSignal, bool bFileChanged
             continue;
         }
         newFileList << filename;
+    }
 
-        dirWatcher_.addPath(path_ + "/" + filename);
+    // only the added and removed files change the watched paths
+    const QSet<QString> prevFiles(curFiles_.begin(), curFiles_.end());
+    const QSet<QString> newFiles(newFileList.begin(), newFileList.end());
+    for (const QString &filename : prevFiles - newFiles)
+    {
+        dirWatcher_.removePath(path_ + "/" + filename);
+    }
+    QStringList addedPaths;
+    for (const QString &filename : newFiles - prevFiles)
+    {
+        addedPaths << path_ + "/" + filename;
+    }
+    if (!addedPaths.isEmpty())
+    {
+        dirWatcher_.addPaths(addedPaths);
     }
 
     if ((!bFileChanged && newFileList != curFiles_) || bFileChanged)
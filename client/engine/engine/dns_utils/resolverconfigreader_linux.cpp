@@ -0,0 +1,227 @@
+#include "resolverconfigreader_linux.h"
+
+#include <QDBusArgument>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusVariant>
+#include <QFile>
+#include <QFileInfo>
+#include <QHostAddress>
+#include <QMutexLocker>
+#include <QtEndian>
+
+#include <net/if.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "utils/log/categories.h"
+
+namespace {
+
+const char *kResolvedService = "org.freedesktop.resolve1";
+const char *kResolvedPath = "/org/freedesktop/resolve1";
+const char *kNetworkManagerService = "org.freedesktop.NetworkManager";
+const char *kNetworkManagerDnsPath = "/org/freedesktop/NetworkManager/DnsManager";
+const char *kPropertiesInterface = "org.freedesktop.DBus.Properties";
+
+constexpr int kDbusTimeoutMs = 1000;
+
+bool isTunnelInterface(const QString &name)
+{
+    return name.startsWith("tun") || name.startsWith("utun");
+}
+
+// Properties.Get without starting the service if it is not running
+QVariant getDbusProperty(const QString &service, const QString &path, const QString &interface, const QString &property)
+{
+    QDBusMessage msg = QDBusMessage::createMethodCall(service, path, kPropertiesInterface, "Get");
+    msg << interface << property;
+    msg.setAutoStartService(false);
+    const QDBusMessage reply = QDBusConnection::systemBus().call(msg, QDBus::Block, kDbusTimeoutMs);
+    if (reply.type() != QDBusMessage::ReplyMessage || reply.arguments().isEmpty())
+        return QVariant();
+    return reply.arguments().first().value<QDBusVariant>().variant();
+}
+
+} // namespace
+
+ResolverConfigReader::ResolverConfigReader(QObject *parent) : QObject(parent),
+    isCacheValid_(false), isWatching_(false), inotifyFd_(-1), inotifyNotifier_(nullptr)
+{
+    initWatchers();
+}
+
+ResolverConfigReader::~ResolverConfigReader()
+{
+    if (inotifyFd_ >= 0)
+        close(inotifyFd_);
+}
+
+QStringList ResolverConfigReader::dnsServers()
+{
+    QMutexLocker locker(&mutex_);
+    if (isCacheValid_)
+        return cachedServers_;
+
+    QStringList servers = readFromResolved();
+    if (servers.isEmpty())
+        servers = readFromNetworkManager();
+    if (servers.isEmpty())
+        servers = readFromResolvConf();
+    if (servers.isEmpty())
+        qCWarning(LOG_FIREWALL_CONTROLLER) << "Can't get OS default DNS list: neither systemd-resolved nor NetworkManager nor resolv.conf provide it";
+
+    servers.removeDuplicates();
+    cachedServers_ = servers;
+    // without the watchers a change can't be detected, so the servers are read every time
+    isCacheValid_ = isWatching_;
+    return servers;
+}
+
+void ResolverConfigReader::onConfigurationChanged()
+{
+    QMutexLocker locker(&mutex_);
+    isCacheValid_ = false;
+}
+
+void ResolverConfigReader::onInotifyActivated()
+{
+    alignas(struct inotify_event) char buf[4096];
+    bool isChanged = false;
+    ssize_t len;
+    while ((len = read(inotifyFd_, buf, sizeof(buf))) > 0) {
+        for (char *ptr = buf; ptr < buf + len; ) {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(ptr);
+            if (event->len > 0 && watchedFileNames_.contains(QString::fromLocal8Bit(event->name)))
+                isChanged = true;
+            if (event->mask & IN_Q_OVERFLOW)
+                isChanged = true;
+            ptr += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    if (isChanged)
+        onConfigurationChanged();
+}
+
+QStringList ResolverConfigReader::readFromResolved() const
+{
+    // a(iiay): the interface index (0 for the global servers), the address family and the address bytes
+    const QVariant value = getDbusProperty(kResolvedService, kResolvedPath, "org.freedesktop.resolve1.Manager", "DNS");
+    if (!value.canConvert<QDBusArgument>())
+        return QStringList();
+
+    QStringList servers;
+    const QDBusArgument arg = value.value<QDBusArgument>();
+    arg.beginArray();
+    while (!arg.atEnd()) {
+        int ifIndex = 0;
+        int family = 0;
+        QByteArray address;
+        arg.beginStructure();
+        arg >> ifIndex >> family >> address;
+        arg.endStructure();
+
+        if (ifIndex > 0) {
+            char ifName[IF_NAMESIZE] = {};
+            if (if_indextoname(ifIndex, ifName) && isTunnelInterface(ifName))
+                continue;
+        }
+
+        if (family == AF_INET && address.size() == 4) {
+            servers << QHostAddress(qFromBigEndian<quint32>(address.constData())).toString();
+        } else if (family == AF_INET6 && address.size() == 16) {
+            servers << QHostAddress(reinterpret_cast<const quint8 *>(address.constData())).toString();
+        }
+    }
+    arg.endArray();
+    return servers;
+}
+
+QStringList ResolverConfigReader::readFromNetworkManager() const
+{
+    // aa{sv}: one map per interface with the "nameservers" and "interface" keys among others
+    const QVariant value = getDbusProperty(kNetworkManagerService, kNetworkManagerDnsPath, "org.freedesktop.NetworkManager.DnsManager", "Configuration");
+    if (!value.canConvert<QDBusArgument>())
+        return QStringList();
+
+    QStringList servers;
+    const QDBusArgument arg = value.value<QDBusArgument>();
+    arg.beginArray();
+    while (!arg.atEnd()) {
+        QVariantMap config;
+        arg >> config;
+        if (isTunnelInterface(config.value("interface").toString()))
+            continue;
+        servers << config.value("nameservers").toStringList();
+    }
+    arg.endArray();
+    return servers;
+}
+
+QStringList ResolverConfigReader::readFromResolvConf() const
+{
+    // the systemd-resolved file lists the upstream servers instead of its local stub
+    const QStringList files = { "/run/systemd/resolve/resolv.conf", "/etc/resolv.conf" };
+    for (const QString &fileName : files) {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+            continue;
+
+        QStringList servers;
+        while (!file.atEnd()) {
+            const QByteArray line = file.readLine().simplified();
+            if (!line.startsWith("nameserver "))
+                continue;
+            QString server = QString::fromLatin1(line.mid(11));
+            // strip the IPv6 zone index, if any
+            const int ind = server.indexOf('%');
+            if (ind > 0)
+                server.truncate(ind);
+            if (!QHostAddress(server).isNull())
+                servers << server;
+        }
+        if (!servers.isEmpty())
+            return servers;
+    }
+    return QStringList();
+}
+
+void ResolverConfigReader::initWatchers()
+{
+    QDBusConnection bus = QDBusConnection::systemBus();
+    if (bus.isConnected()) {
+        bus.connect(kResolvedService, kResolvedPath, kPropertiesInterface, "PropertiesChanged", this, SLOT(onConfigurationChanged()));
+        bus.connect(kNetworkManagerService, kNetworkManagerDnsPath, kPropertiesInterface, "PropertiesChanged", this, SLOT(onConfigurationChanged()));
+    }
+
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd_ < 0) {
+        qCWarning(LOG_FIREWALL_CONTROLLER) << "Can't watch the resolver configuration, the DNS servers will not be cached";
+        return;
+    }
+
+    // the files are usually replaced with rename(), so their directories are watched
+    watchedFileNames_ << "resolv.conf" << "stub-resolv.conf";
+    addInotifyWatch("/etc");
+    addInotifyWatch("/run/systemd/resolve");
+    addInotifyWatch("/run/NetworkManager");
+    // /etc/resolv.conf is often a symlink to one of the files above or to a file of another resolver manager
+    const QFileInfo resolvConf("/etc/resolv.conf");
+    if (resolvConf.isSymLink()) {
+        const QFileInfo target(resolvConf.symLinkTarget());
+        addInotifyWatch(target.absolutePath());
+        watchedFileNames_ << target.fileName();
+    }
+    watchedFileNames_.removeDuplicates();
+
+    inotifyNotifier_ = new QSocketNotifier(inotifyFd_, QSocketNotifier::Read, this);
+    connect(inotifyNotifier_, &QSocketNotifier::activated, this, &ResolverConfigReader::onInotifyActivated);
+    isWatching_ = true;
+}
+
+void ResolverConfigReader::addInotifyWatch(const QString &dir)
+{
+    inotify_add_watch(inotifyFd_, dir.toLocal8Bit().constData(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+}
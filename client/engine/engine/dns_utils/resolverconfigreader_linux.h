@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QMutex>
+#include <QObject>
+#include <QSocketNotifier>
+#include <QStringList>
+
+// Reads the OS default DNS servers without starting any processes:
+// systemd-resolved over D-Bus, then NetworkManager over D-Bus, then the resolv.conf files.
+// The result is cached until the resolver configuration changes, which is detected with the D-Bus PropertiesChanged
+// signals of both services and inotify watches on the resolv.conf locations.
+// The object must be created in a thread with an event loop, the servers can be requested from any thread.
+class ResolverConfigReader : public QObject
+{
+    Q_OBJECT
+public:
+    static ResolverConfigReader &instance()
+    {
+        static ResolverConfigReader r;
+        return r;
+    }
+
+    QStringList dnsServers();
+
+private slots:
+    void onConfigurationChanged();
+    void onInotifyActivated();
+
+private:
+    explicit ResolverConfigReader(QObject *parent = nullptr);
+    ~ResolverConfigReader();
+
+    QStringList readFromResolved() const;
+    QStringList readFromNetworkManager() const;
+    QStringList readFromResolvConf() const;
+
+    void initWatchers();
+    void addInotifyWatch(const QString &dir);
+
+    QMutex mutex_;
+    bool isCacheValid_;
+    QStringList cachedServers_;
+    bool isWatching_;
+
+    int inotifyFd_;
+    QSocketNotifier *inotifyNotifier_;
+    QStringList watchedFileNames_;
+};
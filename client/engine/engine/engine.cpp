@@ -29,6 +29,7 @@
 #include "getdeviceid.h"
 #include "openvpnversioncontroller.h"
 #include "apiresources/apiutils.h"
+#include "locationsmodel/mutablelocationinfo.h"
 
 #ifdef Q_OS_WIN
     #include <Objbase.h>
@@ -60,6 +61,7 @@ Engine::Engine() : QObject(nullptr),
     helper_(nullptr),
     firewallController_(nullptr),
     connectionManager_(nullptr),
+    wireGuardConfigCache_(nullptr),
     connectStateController_(nullptr),
     vpnShareController_(nullptr),
     emergencyController_(nullptr),
@@ -358,6 +360,16 @@ void Engine::speedRating(int rating, const QString &localExternalIp)
     }
 }
 
+void Engine::setPriorityLocations(const QVector<LocationID> &locations)
+{
+    QMutexLocker locker(&mutex_);
+    if (bInitialized_) {
+        QMetaObject::invokeMethod(this, [this, locations]() {
+            locationsModel_->setPriorityLocations(locations);
+        });
+    }
+}
+
 void Engine::emergencyConnectClick()
 {
     QMutexLocker locker(&mutex_);
@@ -684,9 +696,14 @@ void Engine::initPart2()
     connect(connectionManager_, &ConnectionManager::protocolStatusChanged, this, &Engine::protocolStatusChanged);
     connect(connectionManager_, &ConnectionManager::connectionEnded, this, &Engine::onConnectionManagerConnectionEnded);
 
+    wireGuardConfigCache_ = new WireGuardConfigCache(this, connectStateController_);
+    connectionManager_->setWireGuardConfigCache(wireGuardConfigCache_);
+
     locationsModel_ = new locationsmodel::LocationsModel(this, connectStateController_, networkDetectionManager_);
     connect(locationsModel_, &locationsmodel::LocationsModel::whitelistLocationsIpsChanged, this, &Engine::onLocationsModelWhitelistIpsChanged);
     connect(locationsModel_, &locationsmodel::LocationsModel::whitelistCustomConfigsIpsChanged, this, &Engine::onLocationsModelWhitelistCustomConfigIpsChanged);
+    connect(locationsModel_, &locationsmodel::LocationsModel::locationsUpdated, this, &Engine::onLocationsModelBestLocationUpdated);
+    connect(locationsModel_, &locationsmodel::LocationsModel::bestLocationUpdated, this, &Engine::onLocationsModelBestLocationUpdated);
 
     vpnShareController_ = new VpnShareController(this, helper_);
     connect(vpnShareController_, &VpnShareController::connectedWifiUsersChanged, this, &Engine::wifiSharingStateChanged);
@@ -953,6 +970,14 @@ void Engine::connectClickImpl(const LocationID &locationId, const types::Connect
     locationId_ = locationId;
     connectionSettingsOverride_ = connectionSettings;
 
+    if (locationId_.isValid() && !locationId_.isCustomConfigsLocation() && !locationId_.isStaticIpsLocation()) {
+        recentLocations_.removeAll(locationId_);
+        recentLocations_.prepend(locationId_);
+        while (recentLocations_.size() > kMaxRecentLocations)
+            recentLocations_.removeLast();
+        updateWireGuardConfigCacheHostnames();
+    }
+
     // if connected, then first disconnect
     if (!connectionManager_->isDisconnected())
     {
@@ -1073,6 +1098,9 @@ void Engine::logoutImplAfterDisconnect(bool keepFirewallOn)
     }
 
     GetWireGuardConfig::removeWireGuardSettings();
+    recentLocations_.clear();
+    updateWireGuardConfigCacheHostnames();
+    wireGuardConfigCache_->clear();
     if (!keepFirewallOn)
     {
         firewallController_->firewallOff();
@@ -1274,6 +1302,7 @@ void Engine::setSettingsImpl(const types::EngineSettings &engineSettings)
     }
 
     keepAliveManager_->setEnabled(engineSettings_.isKeepAliveEnabled());
+    updateWireGuardConfigCacheHostnames();
 
     WSNet::instance()->serverAPI()->setApiResolutionsSettings(engineSettings_.apiResolutionSettings().getIsAutomatic(), engineSettings_.apiResolutionSettings().getManualAddress().toStdString());
     updateProxySettings();
@@ -1736,7 +1765,9 @@ void Engine::detectAppropriatePacketSizeImpl()
         qCDebug(LOG_PACKET_SIZE) << "Detecting appropriate packet size";
         runningPacketDetection_ = true;
         emit packetSizeDetectionStateChanged(true, false);
-        packetSizeController_->detectAppropriatePacketSize(HardcodedSettings::instance().windscribeHost());
+        types::NetworkInterface networkInterface;
+        networkDetectionManager_->getCurrentNetworkInterface(networkInterface);
+        packetSizeController_->detectAppropriatePacketSize(HardcodedSettings::instance().windscribeHost(), networkInterface.networkOrSsid);
     }
     else
     {
@@ -2024,6 +2055,12 @@ void Engine::onLocationsModelWhitelistIpsChanged(const QStringList &ips)
     updateFirewallSettings();
 }
 
+void Engine::onLocationsModelBestLocationUpdated(const LocationID &bestLocation)
+{
+    bestLocationId_ = bestLocation;
+    updateWireGuardConfigCacheHostnames();
+}
+
 void Engine::onLocationsModelWhitelistCustomConfigIpsChanged(const QStringList &ips)
 {
     firewallExceptions_.setCustomConfigPingIps(ips);
@@ -2339,11 +2376,41 @@ void Engine::updateServerLocations(const api_responses::ServerList &serverLocati
     qCDebug(LOG_BASIC) << "Servers locations changed";
     auto locations = serverLocations.locations();
     ApiUtils::mergeWindflixLocations(locations);
+    // the prefetched WireGuard configs may refer to the changed nodes
+    wireGuardConfigCache_->clear();
     locationsModel_->setApiLocations(locations, staticIps);
     locationsModel_->setCustomConfigLocations(customConfigs_->getConfigs());
     checkForceDisconnectNode(serverLocations.forceDisconnectNodes());
 }
 
+void Engine::updateWireGuardConfigCacheHostnames()
+{
+    QStringList hostnames;
+
+    types::NetworkInterface networkInterface;
+    networkDetectionManager_->getCurrentNetworkInterface(networkInterface);
+    const types::ConnectionSettings connectionSettings = engineSettings_.connectionSettingsForNetworkInterface(networkInterface.networkOrSsid);
+    if (isLoggedIn_ && (connectionSettings.isAutomatic() || connectionSettings.protocol().isWireGuardProtocol())) {
+        QVector<LocationID> locations;
+        if (bestLocationId_.isValid())
+            locations << bestLocationId_;
+        locations << recentLocations_;
+
+        for (const LocationID &id : std::as_const(locations)) {
+            QSharedPointer<locationsmodel::MutableLocationInfo> mli = qSharedPointerDynamicCast<locationsmodel::MutableLocationInfo>(locationsModel_->getMutableLocationInfoById(id));
+            if (mli.isNull())
+                continue;
+            for (int i = 0; i < mli->nodesCount(); ++i) {
+                const QString hostname = mli->getHostnameForNode(i);
+                if (!hostnames.contains(hostname))
+                    hostnames << hostname;
+            }
+        }
+    }
+
+    wireGuardConfigCache_->setHostnames(hostnames);
+}
+
 void Engine::updateFirewallSettings()
 {
     if (firewallController_->firewallActualState()) {
@@ -12,6 +12,7 @@
 #include "api_responses/notification.h"
 #include "locationsmodel/enginelocationsmodel.h"
 #include "connectionmanager/connectionmanager.h"
+#include "wireguardconfig/wireguardconfigcache.h"
 #include "connectstatecontroller/connectstatecontroller.h"
 #include "engine/vpnshare/vpnsharecontroller.h"
 #include "engine/emergencycontroller/emergencycontroller.h"
@@ -91,6 +92,9 @@ public:
 
     void speedRating(int rating, const QString &localExternalIp);  //rate current connection(0 - down, 1 - up)
 
+    // the locations visible in the GUI or favorite, their nodes are pinged first
+    void setPriorityLocations(const QVector<LocationID> &locations);
+
     void updateCurrentInternetConnectivity();
 
     // emergency connect functions
@@ -284,6 +288,7 @@ private slots:
     void onCustomConfigsChanged();
 
     void onLocationsModelWhitelistIpsChanged(const QStringList &ips);
+    void onLocationsModelBestLocationUpdated(const LocationID &bestLocation);
     void onLocationsModelWhitelistCustomConfigIpsChanged(const QStringList &ips);
 
     void onNetworkOnlineStateChange(bool isOnline);
@@ -318,6 +323,7 @@ private:
     IHelper *helper_;
     FirewallController *firewallController_;
     ConnectionManager *connectionManager_;
+    WireGuardConfigCache *wireGuardConfigCache_;
     ConnectStateController *connectStateController_;
     VpnShareController *vpnShareController_;
     EmergencyController *emergencyController_;
@@ -361,6 +367,11 @@ private:
     LocationID locationId_;
     QString locationName_;
 
+    // the locations for which the WireGuard configs are prefetched
+    static constexpr int kMaxRecentLocations = 2;
+    LocationID bestLocationId_;
+    QVector<LocationID> recentLocations_;
+
     QString lastConnectingHostname_;
     types::Protocol lastConnectingProtocol_;
 
@@ -376,6 +387,7 @@ private:
     void loginImpl(bool isUseAuthHash, const QString &username, const QString &password, const QString &code2fa);
     void updateServerLocations(const api_responses::ServerList &serverLocations, const api_responses::StaticIps &staticIps);
     void updateFirewallSettings();
+    void updateWireGuardConfigCacheHostnames();
 
     void addCustomRemoteIpToFirewallIfNeed();
     void doConnect(bool bEmitAuthError);
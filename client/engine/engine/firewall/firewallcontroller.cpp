@@ -3,21 +3,29 @@
 
 FirewallController::FirewallController(QObject *parent) : QObject(parent),
     latestAllowLanTraffic_(false), latestEnabledState_(false),
-    bInitialized_(false), bStateChanged_(false)
+    bInitialized_(false), bStateChanged_(false), bOnlyIpsChanged_(false)
 {
 }
 
 bool FirewallController::firewallOn(const QString &connectingIp, const QSet<QString> &ips, bool bAllowLanTraffic, bool bIsCustomConfig)
 {
+    bOnlyIpsChanged_ = false;
+    addedIps_.clear();
+    removedIps_.clear();
     if (!bInitialized_) {
         bStateChanged_ = true;
         bInitialized_ = true;
     } else {
-        bStateChanged_ = (latestEnabledState_ != true ||
-                          latestConnectingIp_ != connectingIp ||
-                          latestIps_ != ips ||
-                          latestAllowLanTraffic_ != bAllowLanTraffic ||
-                          latestIsCustomConfig_ != bIsCustomConfig);
+        const bool bOtherStateChanged = (latestEnabledState_ != true ||
+                                         latestConnectingIp_ != connectingIp ||
+                                         latestAllowLanTraffic_ != bAllowLanTraffic ||
+                                         latestIsCustomConfig_ != bIsCustomConfig);
+        bStateChanged_ = bOtherStateChanged || latestIps_ != ips;
+        if (bStateChanged_ && !bOtherStateChanged) {
+            bOnlyIpsChanged_ = true;
+            addedIps_ = ips - latestIps_;
+            removedIps_ = latestIps_ - ips;
+        }
     }
     latestConnectingIp_ = connectingIp;
     latestIps_ = ips;
@@ -29,6 +37,7 @@ bool FirewallController::firewallOn(const QString &connectingIp, const QSet<QStr
 
 bool FirewallController::firewallOff()
 {
+    bOnlyIpsChanged_ = false;
     if (!bInitialized_) {
         bStateChanged_ = true;
         bInitialized_ = true;
@@ -61,3 +70,8 @@ bool FirewallController::isStateChanged()
 {
     return bStateChanged_;
 }
+
+bool FirewallController::isOnlyIpsChanged()
+{
+    return bOnlyIpsChanged_;
+}
@@ -29,6 +29,8 @@ public:
 
 protected:
     bool isStateChanged();
+    // true if the firewall stays on and only the allowed ips changed, the changes are in addedIps_ and removedIps_
+    bool isOnlyIpsChanged();
 
     QString latestConnectingIp_;
     QSet<QString> latestIps_;
@@ -38,4 +40,7 @@ protected:
     api_responses::StaticIpPortsVector latestStaticIpPorts_;
     bool bInitialized_;
     bool bStateChanged_;
+    bool bOnlyIpsChanged_;
+    QSet<QString> addedIps_;
+    QSet<QString> removedIps_;
 };
@@ -9,6 +9,14 @@
 #include "utils/ipvalidation.h"
 #include "utils/log/categories.h"
 
+namespace {
+// the exception ips are either single addresses or prefixes
+QString toCidr(const QString &ip)
+{
+    return ip.contains('/') ? ip : ip + "/32";
+}
+}
+
 FirewallController_linux::FirewallController_linux(QObject *parent, IHelper *helper) :
     FirewallController(parent), forceUpdateInterfaceToSkip_(false), comment_("Windscribe client rule")
 {
@@ -24,6 +32,13 @@ bool FirewallController_linux::firewallOn(const QString &connectingIp, const QSe
     QMutexLocker locker(&mutex_);
     FirewallController::firewallOn(connectingIp, ips, bAllowLanTraffic, bIsCustomConfig);
     if (isStateChanged()) {
+        if (isOnlyIpsChanged() && !forceUpdateInterfaceToSkip_ && firewallActualState()) {
+            qCInfo(LOG_FIREWALL_CONTROLLER) << "firewall ips changed, added:" << addedIps_.count() << "removed:" << removedIps_.count();
+            if (updateIpsImpl(addedIps_, removedIps_)) {
+                return true;
+            }
+            // the rules diverged from the expected ones, rebuild them
+        }
         qCInfo(LOG_FIREWALL_CONTROLLER) << "firewall enabled with ips count:" << ips.count() + 1;
         return firewallOnImpl(connectingIp, ips, bAllowLanTraffic, bIsCustomConfig, latestStaticIpPorts_);
     } else if (forceUpdateInterfaceToSkip_) {
@@ -108,6 +123,8 @@ bool FirewallController_linux::firewallOnImpl(const QString &connectingIp, const
         rules << "*filter\n";
         rules << ":windscribe_input - [0:0]\n";
         rules << ":windscribe_output - [0:0]\n";
+        rules << ":windscribe_ips_input - [0:0]\n";
+        rules << ":windscribe_ips_output - [0:0]\n";
 
         if (!bExists) {
             rules << "-I INPUT -j windscribe_input -m comment --comment \"" + comment_ + "\"\n";
@@ -168,9 +185,12 @@ bool FirewallController_linux::firewallOnImpl(const QString &connectingIp, const
             rules << "-A windscribe_output -d " + connectingIp + "/32 -j ACCEPT -m mark --mark 51820 -m comment --comment \"" + comment_ + "\"\n";
         }
 
+        // the exception ips are in own chains, so their changes are applied without rebuilding the rest of the rules
+        rules << "-A windscribe_input -j windscribe_ips_input -m comment --comment \"" + comment_ + "\"\n";
+        rules << "-A windscribe_output -j windscribe_ips_output -m comment --comment \"" + comment_ + "\"\n";
         for (const auto &i : ips) {
-            rules << "-A windscribe_input -s " + i + "/32 -j ACCEPT -m comment --comment \"" + comment_ + "\"\n";
-            rules << "-A windscribe_output -d " + i + "/32 -j ACCEPT -m comment --comment \"" + comment_ + "\"\n";
+            rules << "-A windscribe_ips_input -s " + toCidr(i) + " -j ACCEPT -m comment --comment \"" + comment_ + "\"\n";
+            rules << "-A windscribe_ips_output -d " + toCidr(i) + " -j ACCEPT -m comment --comment \"" + comment_ + "\"\n";
         }
 
         // drop filter for the hotspot adapter in the disconnected state
@@ -248,6 +268,27 @@ bool FirewallController_linux::firewallOnImpl(const QString &connectingIp, const
     return true;
 }
 
+bool FirewallController_linux::updateIpsImpl(const QSet<QString> &addedIps, const QSet<QString> &removedIps)
+{
+    QStringList rules;
+    rules << "*filter\n";
+    for (const auto &i : removedIps) {
+        rules << "-D windscribe_ips_input -s " + toCidr(i) + " -j ACCEPT -m comment --comment \"" + comment_ + "\"\n";
+        rules << "-D windscribe_ips_output -d " + toCidr(i) + " -j ACCEPT -m comment --comment \"" + comment_ + "\"\n";
+    }
+    for (const auto &i : addedIps) {
+        rules << "-A windscribe_ips_input -s " + toCidr(i) + " -j ACCEPT -m comment --comment \"" + comment_ + "\"\n";
+        rules << "-A windscribe_ips_output -d " + toCidr(i) + " -j ACCEPT -m comment --comment \"" + comment_ + "\"\n";
+    }
+    rules << "COMMIT\n";
+
+    bool ret = helper_->setFirewallRules(kIpv4, "", "", rules.join("\n"));
+    if (!ret) {
+        qCWarning(LOG_FIREWALL_CONTROLLER) << "Could not update v4 firewall ips:" << ret;
+    }
+    return ret;
+}
+
 // Extract rules from iptables with comment.If modifyForDelete == true, then replace commands for delete.
 QStringList FirewallController_linux::getWindscribeRules(const QString &comment, bool modifyForDelete, bool isIPv6)
 {
@@ -301,6 +342,11 @@ void FirewallController_linux::removeWindscribeRules(const QString &comment, boo
         if (rules[ind].contains("COMMIT") && curTable.contains("*filter")) {
             rules.insert(ind, "-X windscribe_input");
             rules.insert(ind + 1, "-X windscribe_output");
+            // the rules set by the previous versions have no ips chains
+            if (!isIPv6 && rules.filter("windscribe_ips_input").count() > 0) {
+                rules.insert(ind + 2, "-X windscribe_ips_input");
+                rules.insert(ind + 3, "-X windscribe_ips_output");
+            }
             break;
         }
     }
@@ -30,6 +30,7 @@ private:
     QString comment_;
 
     bool firewallOnImpl(const QString &connectingIp, const QSet<QString> &ips, bool bAllowLanTraffic, bool bIsCustomConfig, const api_responses::StaticIpPortsVector &ports);
+    bool updateIpsImpl(const QSet<QString> &addedIps, const QSet<QString> &removedIps);
     QStringList getWindscribeRules(const QString &comment, bool modifyForDelete, bool isIPv6);
     void removeWindscribeRules(const QString &comment, bool isIPv6);
     QStringList getLocalAddresses(const QString iface) const;
@@ -1,6 +1,7 @@
 #include "firewallexceptions.h"
-#include "uniqueiplist.h"
 #include <QThread>
+#include <algorithm>
+#include <iterator>
 #include "utils/ws_assert.h"
 #include "utils/hardcodedsettings.h"
 #include "utils/log/categories.h"
@@ -8,15 +9,15 @@
 
 void FirewallExceptions::setHostIPs(const QSet<QString> &hostIPs)
 {
-    hostIPs_ = hostIPs;
+    setSource(kHostIps, QStringList(hostIPs.begin(), hostIPs.end()));
 }
 
 void FirewallExceptions::setProxyIP(const types::ProxySettings &proxySettings)
 {
     if (proxySettings.option() == PROXY_OPTION_NONE) {
-        proxyIP_.clear();
+        setSource(kProxy, QStringList());
     } else if (proxySettings.option() == PROXY_OPTION_HTTP || proxySettings.option() == PROXY_OPTION_SOCKS) {
-        proxyIP_ = proxySettings.address();
+        setSource(kProxy, QStringList() << proxySettings.address());
     } else {
         WS_ASSERT(false);
     }
@@ -26,6 +27,7 @@ void FirewallExceptions::setCustomRemoteIp(const QString &remoteIP, bool &bChang
 {
     if (remoteIP_ != remoteIP) {
         remoteIP_ = remoteIP;
+        setSource(kRemoteIp, QStringList() << remoteIP_);
         bChanged = true;
     } else {
         bChanged = false;
@@ -46,6 +48,7 @@ void FirewallExceptions::setDNSServers(const QStringList &ips, bool &bChanged)
 {
     if (dnsIps_ != ips) {
         dnsIps_ = ips;
+        setSource(kDnsServers, dnsIps_);
         bChanged = true;
     } else {
         bChanged = false;
@@ -59,90 +62,42 @@ void FirewallExceptions::setDnsPolicy(DNS_POLICY_TYPE dnsPolicy)
 
 void FirewallExceptions::setLocationsPingIps(const QStringList &listIps)
 {
-    locationsPingIPs_ = listIps;
+    setSource(kLocationsPingIps, listIps);
 }
 
 void FirewallExceptions::setCustomConfigPingIps(const QStringList &listIps)
 {
-    customConfigsPingIPs_ = listIps;
+    setSource(kCustomConfigsPingIps, listIps);
 }
 
 QSet<QString> FirewallExceptions::getIPAddressesForFirewall() const
 {
     //WS_ASSERT(QApplication::instance()->thread() == QThread::currentThread());
 
-    UniqueIpList ipList;
-    ipList.add("127.0.0.1");
-
-    // add dns servers
-    if (dnsPolicyType_ == DNS_TYPE_OS_DEFAULT) {
-        std::vector<std::wstring> listDns = DnsUtils::getOSDefaultDnsServers();
-        for (std::vector<std::wstring>::iterator it = listDns.begin(); it != listDns.end(); ++it) {
-            ipList.add(QString::fromStdWString(*it));
-        }
-    } else if (dnsPolicyType_ == DNS_TYPE_OPEN_DNS) {
-        for (const QString &s : HardcodedSettings::instance().openDns()) {
-            ipList.add(s);
-        }
-    } else if (dnsPolicyType_ == DNS_TYPE_CLOUDFLARE) {
-        for (const QString &s : HardcodedSettings::instance().cloudflareDns()) {
-            ipList.add(s);
-        }
-    } else if (dnsPolicyType_ == DNS_TYPE_GOOGLE) {
-        for (const QString &s : HardcodedSettings::instance().googleDns()) {
-            ipList.add(s);
-        }
-    } else if (dnsPolicyType_ == DNS_TYPE_CONTROLD) {
-        for (const QString &s : HardcodedSettings::instance().controldDns()) {
-            ipList.add(s);
-        }
-    }
+    updateDnsPolicySource();
 
-    // we should always add ControlD DNS servers because the ctrld-utility uses them
-    for (const QString &s : HardcodedSettings::instance().controldDns()) {
-        ipList.add(s);
+    if (isCacheValid_ && std::equal(std::begin(generations_), std::end(generations_), std::begin(cachedGenerations_))) {
+        return cachedIps_;
     }
 
-    for (const QString &s : hostIPs_) {
-        if (!s.isEmpty()) {
-            ipList.add(s);
-        }
-    }
-
-    if (!proxyIP_.isEmpty()) {
-        ipList.add(proxyIP_);
-    }
-
-    if (!remoteIP_.isEmpty()) {
-        ipList.add(remoteIP_);
-    }
-
-    for (const QString &s : dnsIps_)
-            ipList.add(s);
-
-    for (const QString &sl : locationsPingIPs_) {
-        if (!sl.isEmpty()) {
-            ipList.add(sl);
-        }
-    }
-
-    for (const QString &sl : customConfigsPingIPs_) {
-        if (!sl.isEmpty()) {
-            ipList.add(sl);
-        }
+    IpPrefixSet ipList;
+    ipList.add("127.0.0.1");
+    for (const IpPrefixSet &source : sources_) {
+        ipList.add(source);
     }
 
-    return ipList.get();
+    cachedIps_ = ipList.ipv4Prefixes();
+    std::copy(std::begin(generations_), std::end(generations_), std::begin(cachedGenerations_));
+    isCacheValid_ = true;
+    return cachedIps_;
 }
 
 QSet<QString> FirewallExceptions::getIPAddressesForFirewallForConnectedState() const
 {
-    UniqueIpList ipList;
+    IpPrefixSet ipList;
     ipList.add("127.0.0.1");
-    if (!remoteIP_.isEmpty()) {
-        ipList.add(remoteIP_);
-    }
-    return ipList.get();
+    ipList.add(sources_[kRemoteIp]);
+    return ipList.ipv4Prefixes();
 }
 
 const QString& FirewallExceptions::connectingIp() const
@@ -150,7 +105,47 @@ const QString& FirewallExceptions::connectingIp() const
     return connectingIp_;
 }
 
-FirewallExceptions::FirewallExceptions(): dnsPolicyType_(DNS_TYPE_OPEN_DNS)
+void FirewallExceptions::setSource(Source source, const IpPrefixSet &ips) const
 {
+    if (sources_[source] != ips) {
+        sources_[source] = ips;
+        generations_[source]++;
+    }
+}
 
+void FirewallExceptions::setSource(Source source, const QStringList &ips) const
+{
+    IpPrefixSet set;
+    set.add(ips);
+    setSource(source, set);
+}
+
+void FirewallExceptions::updateDnsPolicySource() const
+{
+    QStringList ips;
+    if (dnsPolicyType_ == DNS_TYPE_OS_DEFAULT) {
+        std::vector<std::wstring> listDns = DnsUtils::getOSDefaultDnsServers();
+        for (std::vector<std::wstring>::iterator it = listDns.begin(); it != listDns.end(); ++it) {
+            ips << QString::fromStdWString(*it);
+        }
+    } else if (dnsPolicyType_ == DNS_TYPE_OPEN_DNS) {
+        ips << HardcodedSettings::instance().openDns();
+    } else if (dnsPolicyType_ == DNS_TYPE_CLOUDFLARE) {
+        ips << HardcodedSettings::instance().cloudflareDns();
+    } else if (dnsPolicyType_ == DNS_TYPE_GOOGLE) {
+        ips << HardcodedSettings::instance().googleDns();
+    } else if (dnsPolicyType_ == DNS_TYPE_CONTROLD) {
+        ips << HardcodedSettings::instance().controldDns();
+    }
+
+    // we should always add ControlD DNS servers because the ctrld-utility uses them
+    ips << HardcodedSettings::instance().controldDns();
+
+    setSource(kDnsPolicy, ips);
+}
+
+FirewallExceptions::FirewallExceptions(): dnsPolicyType_(DNS_TYPE_OPEN_DNS), isCacheValid_(false)
+{
+    std::fill(std::begin(generations_), std::end(generations_), 0);
+    std::fill(std::begin(cachedGenerations_), std::end(cachedGenerations_), 0);
 }
@@ -1,8 +1,12 @@
 #pragma once
 
 #include <QSharedPointer>
+#include "ipprefixset.h"
 #include "types/proxysettings.h"
 
+// Collects the addresses which are allowed by the firewall from several sources.
+// Every source keeps its own parsed prefix set and a generation counter, which changes only when the addresses
+// of the source actually change, so the merged list is rebuilt only after a real change.
 class FirewallExceptions
 {
 public:
@@ -20,19 +24,37 @@ public:
     void setLocationsPingIps(const QStringList &listIps);
     void setCustomConfigPingIps(const QStringList &listIps);
 
+    // the firewall backends are IPv4 only, so the IPv6 addresses are not returned
     QSet<QString> getIPAddressesForFirewall() const;
     QSet<QString> getIPAddressesForFirewallForConnectedState() const;
 
     const QString& connectingIp() const;
 
 private:
-    QSet<QString> hostIPs_;
-    QString proxyIP_;
+    enum Source {
+        kHostIps,
+        kProxy,
+        kRemoteIp,
+        kDnsServers,
+        kDnsPolicy,
+        kLocationsPingIps,
+        kCustomConfigsPingIps,
+        kSourcesCount
+    };
+
     QString remoteIP_;
-    QStringList locationsPingIPs_;
-    QStringList customConfigsPingIPs_;
     QString connectingIp_;
     QStringList dnsIps_;
     DNS_POLICY_TYPE dnsPolicyType_;
 
+    // the DNS policy source depends on the OS settings, so it is refreshed on every request
+    mutable IpPrefixSet sources_[kSourcesCount];
+    mutable quint64 generations_[kSourcesCount];
+    mutable quint64 cachedGenerations_[kSourcesCount];
+    mutable QSet<QString> cachedIps_;
+    mutable bool isCacheValid_;
+
+    void setSource(Source source, const IpPrefixSet &ips) const;
+    void setSource(Source source, const QStringList &ips) const;
+    void updateDnsPolicySource() const;
 };
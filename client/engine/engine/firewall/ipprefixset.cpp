@@ -0,0 +1,202 @@
+#include "ipprefixset.h"
+
+#include <QHostAddress>
+#include <algorithm>
+#include "utils/ipvalidation.h"
+
+IpPrefixSet::IpPrefixSet() : isCollapsed_(true)
+{
+}
+
+bool IpPrefixSet::add(const QString &addressOrPrefix)
+{
+    const QString str = addressOrPrefix.trimmed();
+    const bool isPrefix = str.contains('/');
+    if (isPrefix ? !IpValidation::isIpCidr(str) : !IpValidation::isIpAddress(str))
+        return false;
+
+    QPair<QHostAddress, int> subnet;
+    if (isPrefix) {
+        subnet = QHostAddress::parseSubnet(str);
+    } else {
+        subnet.first = QHostAddress(str);
+        subnet.second = subnet.first.protocol() == QAbstractSocket::IPv4Protocol ? 32 : 128;
+    }
+    if (subnet.first.isNull() || subnet.second < 0)
+        return false;
+
+    Range range;
+    if (subnet.first.protocol() == QAbstractSocket::IPv4Protocol) {
+        range.first.lo = subnet.first.toIPv4Address();
+        const Address hostBits = lowBitsMask(32 - subnet.second);
+        range.first.lo &= ~hostBits.lo;
+        range.last.lo = range.first.lo | hostBits.lo;
+        v4_ << range;
+    } else {
+        const Q_IPV6ADDR addr = subnet.first.toIPv6Address();
+        for (int i = 0; i < 8; ++i) {
+            range.first.hi = (range.first.hi << 8) | addr[i];
+            range.first.lo = (range.first.lo << 8) | addr[i + 8];
+        }
+        const Address hostBits = lowBitsMask(128 - subnet.second);
+        range.first.hi &= ~hostBits.hi;
+        range.first.lo &= ~hostBits.lo;
+        range.last.hi = range.first.hi | hostBits.hi;
+        range.last.lo = range.first.lo | hostBits.lo;
+        v6_ << range;
+    }
+    isCollapsed_ = false;
+    return true;
+}
+
+void IpPrefixSet::add(const QStringList &list)
+{
+    for (const QString &s : list) {
+        if (!s.isEmpty())
+            add(s);
+    }
+}
+
+void IpPrefixSet::add(const IpPrefixSet &other)
+{
+    if (other.isEmpty())
+        return;
+    v4_ << other.v4_;
+    v6_ << other.v6_;
+    isCollapsed_ = false;
+}
+
+void IpPrefixSet::clear()
+{
+    v4_.clear();
+    v6_.clear();
+    isCollapsed_ = true;
+}
+
+bool IpPrefixSet::isEmpty() const
+{
+    return v4_.isEmpty() && v6_.isEmpty();
+}
+
+QSet<QString> IpPrefixSet::ipv4Prefixes() const
+{
+    collapse();
+    return toPrefixes(v4_, false);
+}
+
+QSet<QString> IpPrefixSet::ipv6Prefixes() const
+{
+    collapse();
+    return toPrefixes(v6_, true);
+}
+
+bool IpPrefixSet::operator==(const IpPrefixSet &other) const
+{
+    collapse();
+    other.collapse();
+    auto isEqual = [](const QVector<Range> &a, const QVector<Range> &b) {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const Range &r1, const Range &r2) {
+            return r1.first == r2.first && r1.last == r2.last;
+        });
+    };
+    return isEqual(v4_, other.v4_) && isEqual(v6_, other.v6_);
+}
+
+void IpPrefixSet::collapse() const
+{
+    if (isCollapsed_)
+        return;
+    collapse(v4_, 32);
+    collapse(v6_, 128);
+    isCollapsed_ = true;
+}
+
+// sort the ranges and merge the overlapping and adjacent ones
+void IpPrefixSet::collapse(QVector<Range> &ranges, int bits)
+{
+    if (ranges.size() < 2)
+        return;
+
+    std::sort(ranges.begin(), ranges.end(), [](const Range &a, const Range &b) { return a.first < b.first; });
+    const Address max = maxValue(bits);
+    int last = 0;
+    for (int i = 1; i < ranges.size(); ++i) {
+        Range &cur = ranges[last];
+        // no overflow: next() is not called for the maximum address
+        if (cur.last == max || ranges[i].first <= next(cur.last)) {
+            if (cur.last < ranges[i].last)
+                cur.last = ranges[i].last;
+        } else {
+            ranges[++last] = ranges[i];
+        }
+    }
+    ranges.resize(last + 1);
+}
+
+// split every range into the largest aligned blocks
+QSet<QString> IpPrefixSet::toPrefixes(const QVector<Range> &ranges, bool isIpv6)
+{
+    const int bits = isIpv6 ? 128 : 32;
+    QSet<QString> result;
+    for (const Range &range : ranges) {
+        Address start = range.first;
+        while (true) {
+            int hostBits = bits;
+            Address mask;
+            for (; hostBits > 0; --hostBits) {
+                mask = lowBitsMask(hostBits);
+                const bool isAligned = (start.hi & mask.hi) == 0 && (start.lo & mask.lo) == 0;
+                if (isAligned && Address{ start.hi | mask.hi, start.lo | mask.lo } <= range.last)
+                    break;
+            }
+            if (hostBits == 0)
+                mask = Address();
+
+            QHostAddress address;
+            if (isIpv6) {
+                Q_IPV6ADDR addr;
+                for (int i = 0; i < 8; ++i) {
+                    addr[i] = static_cast<quint8>(start.hi >> (56 - 8 * i));
+                    addr[i + 8] = static_cast<quint8>(start.lo >> (56 - 8 * i));
+                }
+                address.setAddress(addr);
+            } else {
+                address.setAddress(static_cast<quint32>(start.lo));
+            }
+            result << (hostBits == 0 ? address.toString() : address.toString() + "/" + QString::number(bits - hostBits));
+
+            const Address blockLast{ start.hi | mask.hi, start.lo | mask.lo };
+            if (blockLast == range.last)
+                break;
+            start = next(blockLast);
+        }
+    }
+    return result;
+}
+
+IpPrefixSet::Address IpPrefixSet::lowBitsMask(int count)
+{
+    Address mask;
+    if (count >= 128) {
+        mask.hi = mask.lo = ~0ULL;
+    } else if (count >= 64) {
+        mask.lo = ~0ULL;
+        mask.hi = count == 64 ? 0 : (~0ULL >> (128 - count));
+    } else if (count > 0) {
+        mask.lo = ~0ULL >> (64 - count);
+    }
+    return mask;
+}
+
+IpPrefixSet::Address IpPrefixSet::next(const Address &a)
+{
+    Address result = a;
+    if (++result.lo == 0)
+        ++result.hi;
+    return result;
+}
+
+IpPrefixSet::Address IpPrefixSet::maxValue(int bits)
+{
+    return lowBitsMask(bits);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+// A set of IPv4/IPv6 addresses and prefixes kept in binary form.
+// Duplicates, contained and adjacent prefixes are collapsed into the minimal list of CIDRs,
+// e.g. 10.0.0.0/25 + 10.0.0.128/25 -> 10.0.0.0/24, so the firewall gets as few rules as possible.
+class IpPrefixSet
+{
+public:
+    IpPrefixSet();
+
+    // accepts "1.2.3.4", "1.2.3.0/24", "::1", "2001:db8::/32"; returns false for an invalid string
+    bool add(const QString &addressOrPrefix);
+    void add(const QStringList &list);
+    void add(const IpPrefixSet &other);
+    void clear();
+    bool isEmpty() const;
+
+    // the collapsed prefixes, a single address is returned without the prefix length
+    QSet<QString> ipv4Prefixes() const;
+    QSet<QString> ipv6Prefixes() const;
+
+    bool operator==(const IpPrefixSet &other) const;
+    bool operator!=(const IpPrefixSet &other) const { return !(*this == other); }
+
+private:
+    // 128-bit unsigned integer, the IPv4 addresses use the low 32 bits
+    struct Address
+    {
+        quint64 hi = 0;
+        quint64 lo = 0;
+
+        bool operator<(const Address &other) const { return hi < other.hi || (hi == other.hi && lo < other.lo); }
+        bool operator==(const Address &other) const { return hi == other.hi && lo == other.lo; }
+        bool operator<=(const Address &other) const { return !(other < *this); }
+    };
+
+    struct Range
+    {
+        Address first;
+        Address last;
+    };
+
+    mutable QVector<Range> v4_;
+    mutable QVector<Range> v6_;
+    mutable bool isCollapsed_;
+
+    void collapse() const;
+    static void collapse(QVector<Range> &ranges, int bits);
+    static QSet<QString> toPrefixes(const QVector<Range> &ranges, bool isIpv6);
+    static Address lowBitsMask(int count);
+    static Address next(const Address &a);
+    static Address maxValue(int bits);
+};
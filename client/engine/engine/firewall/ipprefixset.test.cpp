@@ -0,0 +1,125 @@
+#include <QtTest>
+#include "ipprefixset.test.h"
+#include "ipprefixset.h"
+
+void TestIpPrefixSet::testInvalid()
+{
+    IpPrefixSet set;
+    QVERIFY(!set.add("1.2.3"));
+    QVERIFY(!set.add("1.2.3.4/33"));
+    QVERIFY(!set.add("2001:db8::/129"));
+    QVERIFY(!set.add("windscribe.com"));
+    QVERIFY(set.isEmpty());
+
+    set.add(QStringList() << "" << "10.0.0.1" << "bad");
+    QCOMPARE(set.ipv4Prefixes(), QSet<QString>({ "10.0.0.1" }));
+    QVERIFY(set.ipv6Prefixes().isEmpty());
+}
+
+void TestIpPrefixSet::testSingleAddress()
+{
+    IpPrefixSet set;
+    QVERIFY(set.add("192.168.1.1"));
+    QVERIFY(set.add(" 192.168.1.3 "));
+    // a single address is returned without the prefix length
+    QCOMPARE(set.ipv4Prefixes(), QSet<QString>({ "192.168.1.1", "192.168.1.3" }));
+}
+
+void TestIpPrefixSet::testDuplicatesAndContained()
+{
+    IpPrefixSet set;
+    set.add(QStringList() << "1.2.3.4" << "1.2.3.4" << "1.2.3.0/24" << "1.2.3.128/25");
+    QCOMPARE(set.ipv4Prefixes(), QSet<QString>({ "1.2.3.0/24" }));
+
+    // the host bits of a prefix are ignored
+    IpPrefixSet hostBits;
+    hostBits.add("10.0.0.5/24");
+    QCOMPARE(hostBits.ipv4Prefixes(), QSet<QString>({ "10.0.0.0/24" }));
+}
+
+void TestIpPrefixSet::testAdjacent()
+{
+    IpPrefixSet set;
+    set.add(QStringList() << "10.0.0.128/25" << "10.0.0.0/25");
+    QCOMPARE(set.ipv4Prefixes(), QSet<QString>({ "10.0.0.0/24" }));
+
+    set.add(QStringList() << "10.0.1.0/24");
+    QCOMPARE(set.ipv4Prefixes(), QSet<QString>({ "10.0.0.0/23" }));
+
+    // adjacent, but the merged range is not aligned to a single prefix
+    IpPrefixSet unaligned;
+    unaligned.add(QStringList() << "10.0.0.128/25" << "10.0.1.0/25");
+    QCOMPARE(unaligned.ipv4Prefixes(), QSet<QString>({ "10.0.0.128/25", "10.0.1.0/25" }));
+
+    // a gap between the prefixes
+    IpPrefixSet gap;
+    gap.add(QStringList() << "10.0.0.0/25" << "10.0.1.0/25");
+    QCOMPARE(gap.ipv4Prefixes(), QSet<QString>({ "10.0.0.0/25", "10.0.1.0/25" }));
+}
+
+void TestIpPrefixSet::testUnaligned()
+{
+    IpPrefixSet set;
+    set.add(QStringList() << "10.0.0.3" << "10.0.0.1" << "10.0.0.2");
+    QCOMPARE(set.ipv4Prefixes(), QSet<QString>({ "10.0.0.1", "10.0.0.2/31" }));
+
+    // 10.0.0.1 - 10.0.0.10
+    IpPrefixSet range;
+    for (int i = 1; i <= 10; ++i)
+        range.add("10.0.0." + QString::number(i));
+    QCOMPARE(range.ipv4Prefixes(), QSet<QString>({ "10.0.0.1", "10.0.0.2/31", "10.0.0.4/30", "10.0.0.8/31", "10.0.0.10" }));
+}
+
+void TestIpPrefixSet::testBounds()
+{
+    IpPrefixSet all;
+    all.add(QStringList() << "128.0.0.0/1" << "0.0.0.0/1");
+    QCOMPARE(all.ipv4Prefixes(), QSet<QString>({ "0.0.0.0/0" }));
+
+    // the maximum address must not overflow
+    IpPrefixSet max;
+    max.add(QStringList() << "255.255.255.255" << "255.255.255.254" << "255.255.255.0/24");
+    QCOMPARE(max.ipv4Prefixes(), QSet<QString>({ "255.255.255.0/24" }));
+
+    IpPrefixSet maxV6;
+    maxV6.add(QStringList() << "::/1" << "8000::/1" << "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff");
+    QCOMPARE(maxV6.ipv6Prefixes(), QSet<QString>({ "::/0" }));
+}
+
+void TestIpPrefixSet::testIpv6()
+{
+    IpPrefixSet set;
+    set.add(QStringList() << "2001:db8:8000::/33" << "2001:db8::/33" << "::1" << "10.0.0.1");
+    QCOMPARE(set.ipv6Prefixes(), QSet<QString>({ "2001:db8::/32", "::1" }));
+    QCOMPARE(set.ipv4Prefixes(), QSet<QString>({ "10.0.0.1" }));
+
+    // merging across the 64-bit halves of the address
+    IpPrefixSet halves;
+    halves.add(QStringList() << "2001:db8:0:0:8000::/65" << "2001:db8::/65");
+    QCOMPARE(halves.ipv6Prefixes(), QSet<QString>({ "2001:db8::/64" }));
+
+    IpPrefixSet carry;
+    carry.add(QStringList() << "2001:db8:0:1::" << "2001:db8::ffff:ffff:ffff:fffe/127");
+    QCOMPARE(carry.ipv6Prefixes(), QSet<QString>({ "2001:db8::ffff:ffff:ffff:fffe/127", "2001:db8:0:1::" }));
+}
+
+void TestIpPrefixSet::testEquality()
+{
+    IpPrefixSet a;
+    a.add(QStringList() << "10.0.0.0/25" << "10.0.0.128/25" << "2001:db8::1");
+    IpPrefixSet b;
+    b.add(QStringList() << "2001:db8::1" << "10.0.0.0/24" << "10.0.0.7");
+    QVERIFY(a == b);
+
+    b.add("10.0.1.0/24");
+    QVERIFY(a != b);
+
+    IpPrefixSet c;
+    c.add(a);
+    QVERIFY(c == a);
+    c.clear();
+    QVERIFY(c.isEmpty());
+    QVERIFY(c != a);
+}
+
+QTEST_MAIN(TestIpPrefixSet)
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <QObject>
+#include <QTest>
+
+// tests for class IpPrefixSet
+class TestIpPrefixSet : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testInvalid();
+    void testSingleAddress();
+    void testDuplicatesAndContained();
+    void testAdjacent();
+    void testUnaligned();
+    void testBounds();
+    void testIpv6();
+    void testEquality();
+};
@@ -377,7 +377,7 @@ bool Helper_posix::getWireGuardStatus(types::WireGuardStatus *status)
     return true;
 }
 
-bool Helper_posix::startCtrld(const QString &upstream1, const QString &upstream2, const QStringList &domains, bool isCreateLog)
+bool Helper_posix::startCtrld(const QString &upstream1, const QString &upstream2, const QStringList &domains, unsigned int listenPort, bool isCreateLog)
 {
     QMutexLocker locker(&mutex_);
 
@@ -394,6 +394,7 @@ bool Helper_posix::startCtrld(const QString &upstream1, const QString &upstream2
         domainsList.push_back(domain.toStdString());
     }
     cmd.domains = domainsList;
+    cmd.listenPort = listenPort;
     cmd.isCreateLog = isCreateLog;
 
     std::stringstream stream;
@@ -541,7 +542,8 @@ bool Helper_posix::setFirewallRules(CmdIpVersion version, const QString &table,
     boost::archive::text_oarchive oa(stream, boost::archive::no_header);
     oa << cmd;
 
-    return runCommand(HELPER_CMD_SET_FIREWALL_RULES, stream.str(), answer);
+    // the helper reports the status of the rules restore in the exit code
+    return runCommand(HELPER_CMD_SET_FIREWALL_RULES, stream.str(), answer) && answer.exitCode == 0;
 }
 
 bool Helper_posix::getFirewallRules(CmdIpVersion version, const QString &table, const QString &group, QString &rules)
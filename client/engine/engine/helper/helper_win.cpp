@@ -290,7 +290,7 @@ bool Helper_win::getWireGuardStatus(types::WireGuardStatus *status)
     return mpr.success;
 }
 
-bool Helper_win::startCtrld(const QString &upstream1, const QString &upstream2, const QStringList &domains, bool isCreateLog)
+bool Helper_win::startCtrld(const QString &upstream1, const QString &upstream2, const QStringList &domains, unsigned int listenPort, bool isCreateLog)
 {
     // Nothing to do.
     return true;
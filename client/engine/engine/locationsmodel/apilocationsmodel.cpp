@@ -40,7 +40,7 @@ void ApiLocationsModel::setLocations(const QVector<api_responses::Location> &loc
             api_responses::Group group = l.getGroup(i);
             // Ping with Curl by hostname was introduced later, so the ping hostname may be empty when updating the program from an older version.
             if (!group.getPingHost().isEmpty()) {
-                ips << PingIpInfo { group.getPingIp(), group.getPingHost(), group.getCity(), group.getNick(), wsnet::PingType::kHttp };
+                ips << PingIpInfo { group.getPingIp(), group.getPingHost(), group.getCity(), group.getNick(), wsnet::PingType::kHttp, l.getName() };
             }
         }
     }
@@ -49,11 +49,13 @@ void ApiLocationsModel::setLocations(const QVector<api_responses::Location> &loc
     for (int i = 0; i < staticIps_.getIpsCount(); ++i) {
         const api_responses::StaticIpDescr &sid = staticIps_.getIp(i);
         if (!sid.getPingHost().isEmpty()) {
-            ips << PingIpInfo { sid.getPingIp(), sid.getPingHost(), sid.name, "staticIP", wsnet::PingType::kHttp };
+            // the static IPs are grouped by country, as the regular locations
+            ips << PingIpInfo { sid.getPingIp(), sid.getPingHost(), sid.name, "staticIP", wsnet::PingType::kHttp, "staticIP/" + sid.countryCode };
         }
     }
 
     pingManager_.updateIps(ips);
+    updatePriorityIps();
     sendLocationsUpdated();
 }
 
@@ -142,17 +144,48 @@ QSharedPointer<BaseLocationInfo> ApiLocationsModel::getMutableLocationInfoById(c
     return NULL;
 }
 
-void ApiLocationsModel::onPingInfoChanged(const QString &ip, int timems)
+void ApiLocationsModel::setPriorityLocations(const QVector<LocationID> &locations)
+{
+    const QSet<LocationID> priorityLocations(locations.cbegin(), locations.cend());
+    if (priorityLocations == priorityLocations_)
+        return;
+    priorityLocations_ = priorityLocations;
+    updatePriorityIps();
+}
+
+void ApiLocationsModel::updatePriorityIps()
+{
+    QSet<QString> ips;
+    if (!priorityLocations_.isEmpty()) {
+        for (const api_responses::Location &l : locations_) {
+            for (int i = 0; i < l.groupsCount(); ++i) {
+                const api_responses::Group group = l.getGroup(i);
+                if (priorityLocations_.contains(LocationID::createApiLocationId(l.getId(), group.getCity(), group.getNick())))
+                    ips.insert(group.getPingIp());
+            }
+        }
+        for (int i = 0; i < staticIps_.getIpsCount(); ++i) {
+            const api_responses::StaticIpDescr &sid = staticIps_.getIp(i);
+            if (priorityLocations_.contains(LocationID::createStaticIpsLocationId(sid.cityName, sid.staticIp)))
+                ips.insert(sid.getPingIp());
+        }
+    }
+    pingManager_.setPriorityIps(ips);
+}
+
+void ApiLocationsModel::onPingInfoChanged(const QHash<QString, PingTime> &pings)
 {
     if (pingManager_.isAllNodesHaveCurIteration()) {
         detectBestLocation(true);
     }
 
+    QHash<LocationID, PingTime> pingTimes;
     for (const api_responses::Location &l : locations_) {
         for (int i = 0; i < l.groupsCount(); ++i) {
             const api_responses::Group group = l.getGroup(i);
-            if (group.getPingIp() == ip) {
-                emit locationPingTimeChanged(LocationID::createApiLocationId(l.getId(), group.getCity(), group.getNick()), timems);
+            auto it = pings.constFind(group.getPingIp());
+            if (it != pings.constEnd()) {
+                pingTimes[LocationID::createApiLocationId(l.getId(), group.getCity(), group.getNick())] = it.value();
             }
         }
     }
@@ -160,12 +193,16 @@ void ApiLocationsModel::onPingInfoChanged(const QString &ip, int timems)
     if (staticIps_.getIpsCount() > 0) {
         for (int i = 0; i < staticIps_.getIpsCount(); ++i) {
             const api_responses::StaticIpDescr &sid = staticIps_.getIp(i);
-            if (sid.getPingIp() == ip) {
-                emit locationPingTimeChanged(LocationID::createStaticIpsLocationId(sid.cityName, sid.staticIp), timems);
-                break;
+            auto it = pings.constFind(sid.getPingIp());
+            if (it != pings.constEnd()) {
+                pingTimes[LocationID::createStaticIpsLocationId(sid.cityName, sid.staticIp)] = it.value();
             }
         }
     }
+
+    if (!pingTimes.isEmpty()) {
+        emit locationsPingTimeChanged(pingTimes);
+    }
 }
 
 void ApiLocationsModel::detectBestLocation(bool isAllNodesInDisconnectedState)
@@ -2,6 +2,7 @@
 
 #include <QObject>
 #include <QHash>
+#include <QSet>
 
 #include "baselocationinfo.h"
 #include "bestlocation.h"
@@ -33,10 +34,13 @@ public:
 
     QSharedPointer<BaseLocationInfo> getMutableLocationInfoById(const LocationID &locationId);
 
+    // the locations visible in the GUI or favorite, their nodes are pinged first and more often
+    void setPriorityLocations(const QVector<LocationID> &locations);
+
 signals:
     void locationsUpdated( const LocationID &bestLocation, const QString &staticIpDeviceName, QSharedPointer<QVector<types::Location> > locations);
     void locationsUpdatedCliOnly(const LocationID &bestLocation, QSharedPointer<QVector<types::Location> > locations);
-    void locationPingTimeChanged(const LocationID &id, PingTime timeMs);
+    void locationsPingTimeChanged(const QHash<LocationID, PingTime> &pingTimes);
     void bestLocationUpdated( const LocationID &bestLocation);
     void whitelistIpsChanged(const QStringList &ips);
 
@@ -44,19 +48,21 @@ signals:
     //void customOvpnConfgsIpsChanged(const QStringList &ips);
 
 private slots:
-    void onPingInfoChanged(const QString &ip, int timems);
+    void onPingInfoChanged(const QHash<QString, PingTime> &pings);
 
 private:
     QVector<api_responses::Location> locations_;
     api_responses::StaticIps staticIps_;
     BestLocation bestLocation_;
     PingManager pingManager_;
+    QSet<LocationID> priorityLocations_;
 
 private:
     void detectBestLocation(bool isAllNodesInDisconnectedState);
     BestAndAllLocations generateLocationsUpdated();
     void sendLocationsUpdated();
     void whitelistIps();
+    void updatePriorityIps();
 
     bool isChanged(const QVector<api_responses::Location> &locations, const api_responses::StaticIps &staticIps);
 };
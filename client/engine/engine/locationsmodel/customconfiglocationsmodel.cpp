@@ -101,15 +101,28 @@ QSharedPointer<BaseLocationInfo> CustomConfigLocationsModel::getMutableLocationI
     return NULL;
 }
 
-void CustomConfigLocationsModel::onPingInfoChanged(const QString &ip, int timems)
+void CustomConfigLocationsModel::onPingInfoChanged(const QHash<QString, PingTime> &pings)
 {
+    QHash<LocationID, PingTime> pingTimes;
     for (auto it = pingInfos_.begin(); it != pingInfos_.end(); ++it)
     {
-        if (it->setPingTime(ip, timems))
+        bool isChanged = false;
+        for (auto itPing = pings.constBegin(); itPing != pings.constEnd(); ++itPing)
         {
-            emit locationPingTimeChanged(LocationID::createCustomConfigLocationId(it->customConfig->filename()), it->getPing());
+            if (it->setPingTime(itPing.key(), itPing.value()))
+            {
+                isChanged = true;
+            }
+        }
+        if (isChanged)
+        {
+            pingTimes[LocationID::createCustomConfigLocationId(it->customConfig->filename())] = it->getPing();
         }
     }
+    if (!pingTimes.isEmpty())
+    {
+        emit locationsPingTimeChanged(pingTimes);
+    }
 }
 
 void CustomConfigLocationsModel::onDnsRequestFinished(const QString &hostname, std::shared_ptr<wsnet::WSNetDnsRequestResult> result)
@@ -131,7 +144,9 @@ void CustomConfigLocationsModel::onDnsRequestFinished(const QString &hostname, s
                     ipItem.pingTime = pingManager_.getPing(ipItem.ip);
                     remoteIt->ips << ipItem;
 
-                    emit locationPingTimeChanged(LocationID::createCustomConfigLocationId(it->customConfig->filename()), it->getPing());
+                    QHash<LocationID, PingTime> pingTimes;
+                    pingTimes[LocationID::createCustomConfigLocationId(it->customConfig->filename())] = it->getPing();
+                    emit locationsPingTimeChanged(pingTimes);
                 }
             }
         }
@@ -171,13 +186,13 @@ void CustomConfigLocationsModel::startPingAndWhitelistIps()
                 for (auto ipIt = remoteIt->ips.begin(); ipIt != remoteIt->ips.end(); ++ipIt)
                 {
                     strListIps << ipIt->ip;
-                    allIps << PingIpInfo { ipIt->ip, QString(), it->customConfig->name(), it->customConfig->nick(), wsnet::PingType::kIcmp };
+                    allIps << PingIpInfo { ipIt->ip, QString(), it->customConfig->name(), it->customConfig->nick(), wsnet::PingType::kIcmp, it->customConfig->name() };
                 }
             }
             else
             {
                 strListIps << remoteIt->ipOrHostname.ip;
-                allIps << PingIpInfo { remoteIt->ipOrHostname.ip, QString(), it->customConfig->name(), it->customConfig->nick(), wsnet::PingType::kIcmp };
+                allIps << PingIpInfo { remoteIt->ipOrHostname.ip, QString(), it->customConfig->name(), it->customConfig->nick(), wsnet::PingType::kIcmp, it->customConfig->name() };
             }
         }
     }
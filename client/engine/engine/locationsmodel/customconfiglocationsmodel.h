@@ -29,11 +29,11 @@ public:
 
 signals:
     void locationsUpdated( QSharedPointer<types::Location> location);
-    void locationPingTimeChanged(const LocationID &id, PingTime timeMs);
+    void locationsPingTimeChanged(const QHash<LocationID, PingTime> &pingTimes);
     void whitelistIpsChanged(const QStringList &ips);
 
 private slots:
-    void onPingInfoChanged(const QString &ip, int timems);
+    void onPingInfoChanged(const QHash<QString, PingTime> &pings);
 
 private:
     PingManager pingManager_;
@@ -2,6 +2,8 @@
 
 #include <QThread>
 
+const int typeIdLocationsPingTimes = qRegisterMetaType<QHash<LocationID, PingTime>>("QHash<LocationID,PingTime>");
+
 namespace locationsmodel {
 
 LocationsModel::LocationsModel(QObject *parent, IConnectStateController *stateController, INetworkDetectionManager *networkDetectionManager) : QObject(parent)
@@ -11,11 +13,11 @@ LocationsModel::LocationsModel(QObject *parent, IConnectStateController *stateCo
 
     connect(apiLocationsModel_, &ApiLocationsModel::locationsUpdated, this, &LocationsModel::locationsUpdated);
     connect(apiLocationsModel_, &ApiLocationsModel::bestLocationUpdated, this, &LocationsModel::bestLocationUpdated);
-    connect(apiLocationsModel_, &ApiLocationsModel::locationPingTimeChanged, this, &LocationsModel::locationPingTimeChanged);
+    connect(apiLocationsModel_, &ApiLocationsModel::locationsPingTimeChanged, this, &LocationsModel::locationsPingTimeChanged);
     connect(apiLocationsModel_, &ApiLocationsModel::whitelistIpsChanged, this, &LocationsModel::whitelistLocationsIpsChanged);
 
     connect(customConfigLocationsModel_, &CustomConfigLocationsModel::locationsUpdated, this, &LocationsModel::customConfigsLocationsUpdated);
-    connect(customConfigLocationsModel_, &CustomConfigLocationsModel::locationPingTimeChanged, this, &LocationsModel::locationPingTimeChanged);
+    connect(customConfigLocationsModel_, &CustomConfigLocationsModel::locationsPingTimeChanged, this, &LocationsModel::locationsPingTimeChanged);
     connect(customConfigLocationsModel_, &CustomConfigLocationsModel::whitelistIpsChanged, this, &LocationsModel::whitelistCustomConfigsIpsChanged);
 }
 
@@ -51,4 +53,9 @@ QSharedPointer<BaseLocationInfo> LocationsModel::getMutableLocationInfoById(cons
     }
 }
 
+void LocationsModel::setPriorityLocations(const QVector<LocationID> &locations)
+{
+    apiLocationsModel_->setPriorityLocations(locations);
+}
+
 } //namespace locationsmodel
@@ -23,11 +23,13 @@ public:
 
     QSharedPointer<BaseLocationInfo> getMutableLocationInfoById(const LocationID &locationId);
 
+    void setPriorityLocations(const QVector<LocationID> &locations);
+
 signals:
     void locationsUpdated(const LocationID &bestLocation, const QString &staticIpDeviceName, QSharedPointer<QVector<types::Location> > locations);
     void customConfigsLocationsUpdated(QSharedPointer<types::Location > location);
     void bestLocationUpdated(const LocationID &bestLocation);
-    void locationPingTimeChanged(const LocationID &id, PingTime timeMs);
+    void locationsPingTimeChanged(const QHash<LocationID, PingTime> &pingTimes);
 
     void whitelistLocationsIpsChanged(const QStringList &ips);
     void whitelistCustomConfigsIpsChanged(const QStringList &ips);
@@ -82,6 +82,12 @@ QString MutableLocationInfo::getIpForNode(int indNode, int indIp) const
     return nodes_[indNode]->getIp(indIp);
 }
 
+QString MutableLocationInfo::getHostnameForNode(int indNode) const
+{
+    WS_ASSERT(indNode >= 0 && indNode < nodes_.count());
+    return nodes_[indNode]->getHostname();
+}
+
 // goto next node or to first (if current selected last or incorrect)
 void MutableLocationInfo::selectNextNode()
 {
@@ -27,6 +27,7 @@ public:
 
     int nodesCount() const;
     QString getIpForNode(int indNode, int indIp) const;
+    QString getHostnameForNode(int indNode) const;
 
     void selectNextNode();
     void selectNodeByIp(const QString &addr);
@@ -30,10 +30,10 @@ void PacketSizeController::setPacketSize(const types::PacketSize &packetSize)
     setPacketSizeImpl(packetSize);
 }
 
-void PacketSizeController::detectAppropriatePacketSize(const QString &hostname)
+void PacketSizeController::detectAppropriatePacketSize(const QString &hostname, const QString &networkOrSsid)
 {
     QMutexLocker locker(&mutex_);
-    QMetaObject::invokeMethod(this, "detectAppropriatePacketSizeImpl", Q_ARG(QString, hostname));
+    QMetaObject::invokeMethod(this, "detectAppropriatePacketSizeImpl", Q_ARG(QString, hostname), Q_ARG(QString, networkOrSsid));
 }
 
 void PacketSizeController::earlyStop()
@@ -51,14 +51,14 @@ void PacketSizeController::setPacketSizeImpl(const types::PacketSize &packetSize
     }
 }
 
-void PacketSizeController::detectAppropriatePacketSizeImpl(const QString &hostname)
+void PacketSizeController::detectAppropriatePacketSizeImpl(const QString &hostname, const QString &networkOrSsid)
 {
     {
         QMutexLocker locker(&mutex_);
         earlyStop_ = false;
     }
 
-    const int mtu = getIdealPacketSize(hostname);
+    const int mtu = getIdealPacketSize(hostname, networkOrSsid);
     const bool is_error = mtu < 0;
 
     QMutexLocker locker(&mutex_);
@@ -74,9 +74,8 @@ void PacketSizeController::detectAppropriatePacketSizeImpl(const QString &hostna
     emit finishedPacketSizeDetection(is_error);
 }
 
-int PacketSizeController::getIdealPacketSize(const QString &hostname)
+int PacketSizeController::getIdealPacketSize(const QString &hostname, const QString &networkOrSsid)
 {
-    int mtu = 1470;
     QString modifiedHostname = hostname;
 
     // if this is IP, use without change
@@ -93,28 +92,21 @@ int PacketSizeController::getIdealPacketSize(const QString &hostname)
 
     qCDebug(LOG_PACKET_SIZE) << "Detecting packet size via:" << modifiedHostname;
 
-    bool success = false;
-    while (mtu >= 1300)
-    {
+    bool isStopped = false;
+    const int mtu = pmtuDiscovery_.discover(modifiedHostname, networkOrSsid, [this, &isStopped]() {
         QMutexLocker locker(&mutex_);
-        if (earlyStop_)
+        if (earlyStop_ && !isStopped)
         {
             qCInfo(LOG_PACKET_SIZE) << "Exiting packet size detection loop early";
-            break;
+            isStopped = true;
         }
+        return earlyStop_;
+    });
 
-        bool pingSuccess = NetworkUtils::pingWithMtu(modifiedHostname, mtu);
-        if (pingSuccess)
-        {
-            success = true;
-            break;
-        }
-        mtu -= 10;
-    }
-
-    if (!success)
+    if (mtu < 0)
     {
-        qCWarning(LOG_PACKET_SIZE) << "Couldn't find appropriate MTU -- check internet connection";
+        if (!isStopped)
+            qCWarning(LOG_PACKET_SIZE) << "Couldn't find appropriate MTU -- check internet connection";
         return -1;
     }
 
@@ -2,6 +2,7 @@
 
 #include <QObject>
 #include <QMutex>
+#include "pmtudiscovery.h"
 #include "types/packetsize.h"
 
 #ifdef Q_OS_WIN
@@ -15,7 +16,7 @@ public:
     explicit PacketSizeController(QObject *parent = nullptr);
 
     void setPacketSize(const types::PacketSize &packetSize);
-    void detectAppropriatePacketSize(const QString &hostname);
+    void detectAppropriatePacketSize(const QString &hostname, const QString &networkOrSsid);
     void earlyStop();
 
 signals:
@@ -27,17 +28,18 @@ public slots:
     void finish();
 
 private slots:
-    void detectAppropriatePacketSizeImpl(const QString &hostname);
+    void detectAppropriatePacketSizeImpl(const QString &hostname, const QString &networkOrSsid);
 
 private:
     QMutex mutex_;
     bool earlyStop_;
     types::PacketSize packetSize_;
+    PmtuDiscovery pmtuDiscovery_;
 
 #ifdef Q_OS_WIN
     QScopedPointer<Debug::CrashHandlerForThread> crashHandler_;
 #endif
 
     void setPacketSizeImpl(const types::PacketSize &packetSize);
-    int getIdealPacketSize(const QString &hostname);
+    int getIdealPacketSize(const QString &hostname, const QString &networkOrSsid);
 };
@@ -1,5 +1,7 @@
 #include "pingmanager.h"
 
+#include <limits>
+
 #include "../connectstatecontroller/iconnectstatecontroller.h"
 #include "types/pingtime.h"
 #include "utils/extraconfig.h"
@@ -9,9 +11,26 @@ using namespace wsnet;
 
 PingManager::PingManager(QObject *parent, IConnectStateController *stateController,
                          INetworkDetectionManager *networkDetectionManager, const QString &storageSettingName) : QObject(parent),
-    connectStateController_(stateController), networkDetectionManager_(networkDetectionManager), pingStorage_(storageSettingName)
+    connectStateController_(stateController), networkDetectionManager_(networkDetectionManager), pingStorage_(storageSettingName),
+    pingResults_(std::make_shared<PingResults>())
 {
+    pingResults_->owner = this;
+
+    pingTimer_.setSingleShot(true);
     connect(&pingTimer_, &QTimer::timeout, this, &PingManager::onPingTimer);
+    resultsTimer_.setSingleShot(true);
+    connect(&resultsTimer_, &QTimer::timeout, this, &PingManager::onResultsTimer);
+
+    // the timer is not running while pings are not allowed, so resume on the state changes
+    connect(networkDetectionManager_, &INetworkDetectionManager::onlineStateChanged, this, &PingManager::onPingTimer);
+    connect(networkDetectionManager_, &INetworkDetectionManager::networkChanged, this, &PingManager::onPingTimer);
+    connect(connectStateController_, &IConnectStateController::stateChanged, this, &PingManager::onPingTimer);
+}
+
+PingManager::~PingManager()
+{
+    std::lock_guard<std::mutex> locker(pingResults_->mutex);
+    pingResults_->owner = nullptr;
 }
 
 void PingManager::updateIps(const QVector<PingIpInfo> &ips)
@@ -29,7 +48,10 @@ void PingManager::updateIps(const QVector<PingIpInfo> &ips)
             PingTime pingTime;
             qint64 iterTime;
             pingStorage_.getPingData(ip_info.ip, pingTime, iterTime);
-            ips_[ip_info.ip] = PingIpState(ip_info, iterTime, pingTime == PingTime::PING_FAILED);
+            PingIpState &pni = ips_[ip_info.ip];
+            pni = PingIpState(ip_info, iterTime, pingTime == PingTime::PING_FAILED);
+            pni.isPriority = priorityIps_.contains(ip_info.ip);
+            scheduleNextPing(pni);
         }
         else {
             it.value().existThisIp = true;
@@ -42,7 +64,18 @@ void PingManager::updateIps(const QVector<PingIpInfo> &ips)
         if (!it.value().existThisIp) {
             PingLog::addLog("PingIpsController::updateIps", "removed unused ip: " + it.key());
             pingStorage_.removePingNode(it.key());
+            unscheduleIp(it.value());
+            const QString region = it.value().ipInfo.region;
+            const bool isRegionProbe = regionProbes_.contains(region) && regionProbes_[region].ip == it.key();
             it = ips_.erase(it);
+            // no probe for the region anymore, so re-ping it entirely
+            if (isRegionProbe) {
+                regionProbes_.remove(region);
+                for (auto itRegion = ips_.begin(); itRegion != ips_.end(); ++itRegion) {
+                    if (itRegion->ipInfo.region == region && !itRegion->nowPinging && itRegion->scheduledTime == 0)
+                        scheduleNextPing(itRegion.value());
+                }
+            }
         }
         else {
             ++it;
@@ -52,7 +85,6 @@ void PingManager::updateIps(const QVector<PingIpInfo> &ips)
     failedPingLogController_.clear();
 
     onPingTimer();
-    pingTimer_.start(PING_TIMER_INTERVAL);
 }
 
 void PingManager::clearIps()
@@ -70,72 +102,190 @@ PingTime PingManager::getPing(const QString &ip) const
     return pingStorage_.getPing(ip);
 }
 
+void PingManager::setPriorityIps(const QSet<QString> &ips)
+{
+    priorityIps_ = ips;
+    for (auto it = ips_.begin(); it != ips_.end(); ++it) {
+        PingIpState &pni = it.value();
+        bool isPriority = priorityIps_.contains(it.key());
+        if (pni.isPriority != isPriority) {
+            pni.isPriority = isPriority;
+            // the nodes waiting for their region probe stay unscheduled
+            if (pni.scheduledTime != 0 && !pni.latestPingFailed)
+                scheduleNextPing(pni);
+        }
+    }
+    restartPingTimer();
+}
+
 void PingManager::onPingTimer()
 {
-    using namespace std::placeholders;
     // We don't attempt to issue a ping request when state is CONNECT_STATE_CONNECTING, as the firewall will block it.
-    if (!networkDetectionManager_->isOnline() || connectStateController_->currentState() != CONNECT_STATE_DISCONNECTED)
+    if (!networkDetectionManager_->isOnline() || connectStateController_->currentState() != CONNECT_STATE_DISCONNECTED) {
+        pingTimer_.stop();
         return;
+    }
 
     if (ips_.isEmpty())
         return;
 
+    checkIteration();
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (now - budgetWindowStart_ >= PING_BUDGET_WINDOW_MS) {
+        budgetWindowStart_ = now;
+        pingsInBudgetWindow_ = 0;
+    }
+
+    std::set<ScheduleEntry> *schedule;
+    while (pingsInBudgetWindow_ < MAX_PINGS_PER_BUDGET_WINDOW && (schedule = dueSchedule(now)) != nullptr) {
+        auto itIp = ips_.find(schedule->begin()->ip);
+        WS_ASSERT(itIp != ips_.end());
+        unscheduleIp(itIp.value());
+        startPing(itIp.value());
+        pingsInBudgetWindow_++;
+    }
+
+    restartPingTimer();
+}
+
+void PingManager::checkIteration()
+{
     QDateTime curDateTime = QDateTime::currentDateTimeUtc();
     QDateTime nextDateTime = QDateTime::fromMSecsSinceEpoch(pingStorage_.currentIterationTime(), Qt::UTC).addSecs(NEXT_PERIOD_SECS);
 
-    // if the network has changed or ping by time, then re-ping all nodes
+    // if ping by time, then re-ping all nodes, if the network has changed, then re-ping the affected regions
     types::NetworkInterface curNetworkInterface;
     networkDetectionManager_->getCurrentNetworkInterface(curNetworkInterface);
-    if (pingStorage_.currentIterationTime() == 0 || curDateTime > nextDateTime || curNetworkInterface.networkOrSsid != pingStorage_.currentIterationNetworkOrSsid()) {
+    if (pingStorage_.currentIterationTime() == 0 || curDateTime > nextDateTime) {
         pingStorage_.setCurrentIterationData(curDateTime.toMSecsSinceEpoch(), curNetworkInterface.networkOrSsid);
+        regionProbes_.clear();
         for (auto it = ips_.begin(); it != ips_.end(); ++it) {
             it.value().resetState();
+            scheduleNextPing(it.value());
         }
-        if (curDateTime > nextDateTime)
-            PingLog::addLog("PingIpsController::onPingTimer", "Re-ping all nodes by time");
-        else
-            PingLog::addLog("PingIpsController::onPingTimer", "Re-ping all nodes by network change");
+        PingLog::addLog("PingIpsController::onPingTimer", "Re-ping all nodes by time");
+    } else if (curNetworkInterface.networkOrSsid != pingStorage_.currentIterationNetworkOrSsid()) {
+        pingStorage_.setCurrentIterationData(curDateTime.toMSecsSinceEpoch(), curNetworkInterface.networkOrSsid);
+        startRegionProbes();
+        PingLog::addLog("PingIpsController::onPingTimer", "Re-ping affected regions by network change");
     }
+}
 
+void PingManager::startRegionProbes()
+{
+    regionProbes_.clear();
     for (auto it = ips_.begin(); it != ips_.end(); ++it) {
         PingIpState &pni = it.value();
+        unscheduleIp(pni);
+        pni.resetState();
 
-        if (pni.nowPinging)
+        // the nodes without the previous latency are pinged anyway
+        PingTime prevPingTime = pingStorage_.getPing(it.key());
+        if (prevPingTime == PingTime::NO_PING_INFO) {
+            scheduleNextPing(pni);
             continue;
+        }
 
-        // Checking the option ws-use-icmp-pings and force ICMP pings if enabled.
-        wsnet::PingType pingType = pni.ipInfo.pingType;
-        if (ExtraConfig::instance().getUseICMPPings()) {
-            pingType = wsnet::PingType::kIcmp;
+        if (!regionProbes_.contains(pni.ipInfo.region)) {
+            regionProbes_[pni.ipInfo.region] = RegionProbe{ it.key(), prevPingTime };
+            scheduleIp(pni, QDateTime::currentMSecsSinceEpoch(), 0);
         }
+    }
+}
 
-        if (pni.iterationTime != pingStorage_.currentIterationTime()) {
-            PingLog::addLog("PingNodesController::onPingTimer", QString::fromLatin1("ping new node: %1 (%2 - %3)").arg(pni.ipInfo.ip, pni.ipInfo.city, pni.ipInfo.nick));
-            pni.nowPinging = true;
-            WSNet::instance()->pingManager()->ping(pni.ipInfo.ip.toStdString(), pni.ipInfo.hostname.toStdString(), pingType,
-                        [this](const std::string &ip, bool isSuccess, std::int32_t timeMs, bool isFromDisconnectedVpnState) {
-                            QMetaObject::invokeMethod(this, [this, ip, isSuccess, timeMs, isFromDisconnectedVpnState] {
-                                onPingFinished(ip, isSuccess, timeMs, isFromDisconnectedVpnState);
-                        });
-            });
-        } else if (pni.latestPingFailed) {
-            if (pni.nextTimeForFailedPing == 0 || QDateTime::currentMSecsSinceEpoch() >= pni.nextTimeForFailedPing) {
-                pni.nowPinging = true;
-                PingLog::addLog("PingNodesController::onPingTimer", "start ping because latest ping failed: " + it.key());
-                WSNet::instance()->pingManager()->ping(pni.ipInfo.ip.toStdString(), pni.ipInfo.hostname.toStdString(), pingType,
-                   [this](const std::string &ip, bool isSuccess, std::int32_t timeMs, bool isFromDisconnectedVpnState) {
-                       QMetaObject::invokeMethod(this, [this, ip, isSuccess, timeMs, isFromDisconnectedVpnState] { // NOLINT: false positive for memory leak
-                           onPingFinished(ip, isSuccess, timeMs, isFromDisconnectedVpnState);
-                    });
-                });
-            }
+void PingManager::finishRegionProbe(const QString &region, PingTime pingTime)
+{
+    auto itProbe = regionProbes_.find(region);
+    if (itProbe == regionProbes_.end())
+        return;
+
+    const int prevTimeMs = itProbe->prevPingTime.toInt();
+    const bool isAffected = (pingTime == PingTime::PING_FAILED) != (itProbe->prevPingTime == PingTime::PING_FAILED) ||
+                            qAbs(pingTime.toInt() - prevTimeMs) > qMax(AFFECTED_REGION_MIN_LATENCY_DIFF_MS, (int)(prevTimeMs * AFFECTED_REGION_LATENCY_RATIO));
+    regionProbes_.erase(itProbe);
+
+    PingLog::addLog("PingIpsController::finishRegionProbe", QString::fromLatin1("region %1 %2").arg(region, isAffected ? "is affected by network change, re-ping it" : "is not affected by network change"));
+
+    const qint64 curIterationTime = pingStorage_.currentIterationTime();
+    for (auto it = ips_.begin(); it != ips_.end(); ++it) {
+        PingIpState &pni = it.value();
+        if (pni.ipInfo.region != region || pni.iterationTime == curIterationTime || pni.nowPinging || pni.scheduledTime != 0)
+            continue;
+
+        if (isAffected) {
+            scheduleNextPing(pni);
+        } else {
+            // keep the previous latency for the current iteration
+            PingTime prevPingTime = pingStorage_.getPing(it.key());
+            pingStorage_.setPing(it.key(), prevPingTime);
+            pni.iterationTime = curIterationTime;
+            pni.latestPingFailed = (prevPingTime == PingTime::PING_FAILED);
+            scheduleNextPing(pni);
         }
     }
 }
 
-void PingManager::onPingFinished(const std::string &ip, bool isSuccess, int32_t timeMs, bool isFromDisconnectedVpnState)
+void PingManager::startPing(PingIpState &pni)
+{
+    // Checking the option ws-use-icmp-pings and force ICMP pings if enabled.
+    wsnet::PingType pingType = pni.ipInfo.pingType;
+    if (ExtraConfig::instance().getUseICMPPings()) {
+        pingType = wsnet::PingType::kIcmp;
+    }
+
+    if (pni.iterationTime != pingStorage_.currentIterationTime())
+        PingLog::addLog("PingNodesController::onPingTimer", QString::fromLatin1("ping new node: %1 (%2 - %3)").arg(pni.ipInfo.ip, pni.ipInfo.city, pni.ipInfo.nick));
+    else if (pni.latestPingFailed)
+        PingLog::addLog("PingNodesController::onPingTimer", "start ping because latest ping failed: " + pni.ipInfo.ip);
+
+    pni.nowPinging = true;
+    // only the first result of a batch posts an event to this thread
+    std::shared_ptr<PingResults> pingResults = pingResults_;
+    WSNet::instance()->pingManager()->ping(pni.ipInfo.ip.toStdString(), pni.ipInfo.hostname.toStdString(), pingType,
+                [pingResults](const std::string &ip, bool isSuccess, std::int32_t timeMs, bool isFromDisconnectedVpnState) {
+                    std::lock_guard<std::mutex> locker(pingResults->mutex);
+                    if (!pingResults->owner)
+                        return;
+                    pingResults->results.push_back(PingResult{ ip, isSuccess, timeMs, isFromDisconnectedVpnState });
+                    if (!pingResults->isBatchScheduled) {
+                        pingResults->isBatchScheduled = true;
+                        PingManager *owner = pingResults->owner;
+                        QMetaObject::invokeMethod(owner, [owner] { // NOLINT: false positive for memory leak
+                            owner->resultsTimer_.start(RESULTS_BATCH_PERIOD_MS);
+                        });
+                    }
+    });
+}
+
+void PingManager::onResultsTimer()
+{
+    std::vector<PingResult> results;
+    {
+        std::lock_guard<std::mutex> locker(pingResults_->mutex);
+        results.swap(pingResults_->results);
+        pingResults_->isBatchScheduled = false;
+    }
+
+    QHash<QString, PingTime> changedPings;
+    for (const PingResult &result : results)
+        onPingFinished(result, changedPings);
+
+    if (pingStorage_.isAllNodesHaveCurIteration()) {
+        PingLog::addLog("PingIpsController::onPingFinished", "All nodes have the same iteration time");
+    }
+    restartPingTimer();
+
+    if (!changedPings.isEmpty())
+        emit pingInfoChanged(changedPings);
+}
+
+void PingManager::onPingFinished(const PingResult &result, QHash<QString, PingTime> &changedPings)
 {
-    QString ipStr = QString::fromStdString(ip);
+    const bool isSuccess = result.isSuccess;
+    const std::int32_t timeMs = result.timeMs;
+    const bool isFromDisconnectedVpnState = result.isFromDisconnectedVpnState;
+    QString ipStr = QString::fromStdString(result.ip);
 
     auto itNode = ips_.find(ipStr);
     if (itNode == ips_.end()) {
@@ -146,6 +296,7 @@ void PingManager::onPingFinished(const std::string &ip, bool isSuccess, int32_t
     // Note: we only issue ping requests in the disconnected state.  However, it is possible we transitioned to the
     // connecting/connected state between the time the ping request was issued to PingHost and when it was executed.
     PingIpState &p = itNode.value();
+    const bool isRegionProbe = regionProbes_.contains(p.ipInfo.region) && regionProbes_[p.ipInfo.region].ip == ipStr;
     if (isSuccess) {
         p.nextTimeForFailedPing = 0;
         p.latestPingFailed = false;
@@ -155,8 +306,11 @@ void PingManager::onPingFinished(const std::string &ip, bool isSuccess, int32_t
         // we're back in the disconnected state.
         if (isFromDisconnectedVpnState) {
             p.iterationTime = pingStorage_.currentIterationTime();
+            p.lastPingTime = QDateTime::currentMSecsSinceEpoch();
             pingStorage_.setPing(ipStr, timeMs);
-            emit pingInfoChanged(ipStr, timeMs);
+            if (isRegionProbe)
+                finishRegionProbe(p.ipInfo.region, timeMs);
+            changedPings[ipStr] = timeMs;
             PingLog::addLog("PingIpsController::onPingFinished", QString::fromLatin1("ping successful: %1 (%2 - %3) %4ms").arg(p.ipInfo.ip, p.ipInfo.city, p.ipInfo.nick).arg(timeMs));
         }
         else {
@@ -174,8 +328,11 @@ void PingManager::onPingFinished(const std::string &ip, bool isSuccess, int32_t
 
             if (isFromDisconnectedVpnState) {
                 p.iterationTime = pingStorage_.currentIterationTime();
+                p.lastPingTime = QDateTime::currentMSecsSinceEpoch();
                 pingStorage_.setPing(ipStr, PingTime::PING_FAILED);
-                emit pingInfoChanged(ipStr, PingTime::PING_FAILED);
+                if (isRegionProbe)
+                    finishRegionProbe(p.ipInfo.region, PingTime::PING_FAILED);
+                changedPings[ipStr] = PingTime::PING_FAILED;
             }
 
             if (failedPingLogController_.logFailedIPs(ipStr)) {
@@ -187,9 +344,89 @@ void PingManager::onPingFinished(const std::string &ip, bool isSuccess, int32_t
             p.nextTimeForFailedPing = QDateTime::currentMSecsSinceEpoch() + 1000 * p.curDelayForFailedPing;
         }
     }
-    if (pingStorage_.isAllNodesHaveCurIteration()) {
-        PingLog::addLog("PingIpsController::onPingFinished", "All nodes have the same iteration time");
+    if (isRegionProbe && regionProbes_.contains(p.ipInfo.region))
+        scheduleIp(p, p.latestPingFailed ? p.nextTimeForFailedPing : QDateTime::currentMSecsSinceEpoch(), 0);
+    else
+        scheduleNextPing(p);
+}
+
+void PingManager::scheduleIp(PingIpState &pni, qint64 time, int priority)
+{
+    unscheduleIp(pni);
+    // the zero value means "not scheduled"
+    pni.scheduledTime = qMax(time, (qint64)1);
+    pni.scheduledPriority = priority;
+    schedules_[priority].insert(ScheduleEntry{ pni.scheduledTime, pni.ipInfo.ip });
+}
+
+void PingManager::unscheduleIp(PingIpState &pni)
+{
+    if (pni.scheduledTime == 0)
+        return;
+    schedules_[pni.scheduledPriority].erase(ScheduleEntry{ pni.scheduledTime, pni.ipInfo.ip });
+    pni.scheduledTime = 0;
+}
+
+void PingManager::scheduleNextPing(PingIpState &pni)
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const int priority = pni.isPriority ? 0 : 1;
+    if (pni.iterationTime != pingStorage_.currentIterationTime()) {
+        scheduleIp(pni, now, priority);
+    } else if (pni.latestPingFailed) {
+        scheduleIp(pni, pni.nextTimeForFailedPing == 0 ? now : pni.nextTimeForFailedPing, priority);
+    } else if (pni.isPriority) {
+        // lastPingTime is unknown for the nodes loaded from the storage
+        const qint64 lastPingTime = pni.lastPingTime != 0 ? pni.lastPingTime : pni.iterationTime;
+        scheduleIp(pni, lastPingTime + PRIORITY_NEXT_PERIOD_SECS * 1000LL, priority);
+    } else {
+        // the whole iteration is restarted at this time
+        scheduleIp(pni, pni.iterationTime + NEXT_PERIOD_SECS * 1000LL, priority);
+    }
+}
+
+void PingManager::restartPingTimer()
+{
+    if (isScheduleEmpty()) {
+        pingTimer_.stop();
+        return;
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 nextTime = nextScheduledTime();
+    if (pingsInBudgetWindow_ >= MAX_PINGS_PER_BUDGET_WINDOW)
+        nextTime = qMax(nextTime, budgetWindowStart_ + PING_BUDGET_WINDOW_MS);
+
+    const qint64 interval = qBound((qint64)0, nextTime - now, NEXT_PERIOD_SECS * 1000LL);
+    pingTimer_.start((int)interval);
+}
+
+std::set<PingManager::ScheduleEntry> *PingManager::dueSchedule(qint64 time)
+{
+    for (auto &schedule : schedules_) {
+        if (!schedule.empty() && schedule.begin()->time <= time)
+            return &schedule;
+    }
+    return nullptr;
+}
+
+bool PingManager::isScheduleEmpty() const
+{
+    for (const auto &schedule : schedules_) {
+        if (!schedule.empty())
+            return false;
+    }
+    return true;
+}
+
+qint64 PingManager::nextScheduledTime() const
+{
+    qint64 time = std::numeric_limits<qint64>::max();
+    for (const auto &schedule : schedules_) {
+        if (!schedule.empty())
+            time = qMin(time, schedule.begin()->time);
     }
+    return time;
 }
 
 int PingManager::exponentialBackoff_GetNextDelay(int curDelay, float factor, float jitter, float maxDelay)
@@ -4,6 +4,12 @@
 #include <QTimer>
 #include <QDateTime>
 #include <QHash>
+#include <QSet>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <tuple>
+#include <vector>
 
 #include <wsnet/WSNet.h>
 
@@ -20,16 +26,23 @@ struct PingIpInfo
     QString city;      // only for log
     QString nick;      // only for log
     wsnet::PingType pingType;
+    QString region;    // the nodes of the same region are re-pinged together after a network change
 };
 
 // logic of ping all nodes (taken into account connected/disconnected state, latest ping time, repeat failed pings)
-// starts ping on updateIps(...) and repeat ping every 24 hours
+// starts ping on updateIps(...) and repeat ping every 48 hours (priority nodes more often)
+// The nodes are kept in deadline-ordered schedules, so the timer only wakes up when some node is due. The due nodes of
+// the priority locations (set by the GUI: visible and favorite) are pinged before the others.
+// The pings are rate-limited to spread a full sweep over time. After a network change only one probe node
+// per region is pinged first, and the rest of the region is re-pinged only if the probe latency changed noticeably.
+// The ping results are collected from the wsnet threads and applied in batches, at most once per RESULTS_BATCH_PERIOD_MS.
 class PingManager : public QObject
 {
     Q_OBJECT
 public:
     explicit PingManager(QObject *parent, IConnectStateController *stateController, INetworkDetectionManager *networkDetectionManager,
                          const QString &storageSettingName);
+    ~PingManager();
 
     void updateIps(const QVector<PingIpInfo> &ips);
     void clearIps();
@@ -37,17 +50,28 @@ public:
     bool isAllNodesHaveCurIteration() const;
     PingTime getPing(const QString &ip) const;
 
+    // the nodes of visible or favorite locations, they are pinged first and re-pinged more often
+    void setPriorityIps(const QSet<QString> &ips);
+
 signals:
-    void pingInfoChanged(const QString &ip, int timems);
+    // ip -> ping time, all the ping results of a batch
+    void pingInfoChanged(const QHash<QString, PingTime> &pings);
 
 private slots:
     void onPingTimer();
+    void onResultsTimer();
 
 private:
-    static constexpr int PING_TIMER_INTERVAL = 1000;
     static constexpr int MAX_FAILED_PING_IN_ROW = 3;
     static constexpr int MIN_DELAY_FOR_FAILED_IN_ROW_PINGS = 1;
     static constexpr int NEXT_PERIOD_SECS = 2*60*60*24;   //  How many secs to wait until the next ping (48 hours)
+    static constexpr int PRIORITY_NEXT_PERIOD_SECS = 60*60*6;   // the same for the priority nodes (6 hours)
+    static constexpr int PING_BUDGET_WINDOW_MS = 1000;
+    static constexpr int MAX_PINGS_PER_BUDGET_WINDOW = 20;
+    static constexpr int RESULTS_BATCH_PERIOD_MS = 50;
+    // a region is re-pinged after a network change if its probe latency changed more than by this value or ratio
+    static constexpr int AFFECTED_REGION_MIN_LATENCY_DIFF_MS = 30;
+    static constexpr double AFFECTED_REGION_LATENCY_RATIO = 0.25;
 
     IConnectStateController* const connectStateController_;
     INetworkDetectionManager* const networkDetectionManager_;
@@ -65,6 +89,10 @@ private:
         qint64 nextTimeForFailedPing;
         int curDelayForFailedPing = MIN_DELAY_FOR_FAILED_IN_ROW_PINGS;
         bool existThisIp;
+        bool isPriority = false;
+        qint64 lastPingTime = 0;
+        qint64 scheduledTime = 0;   // 0 if not scheduled
+        int scheduledPriority = 0;
 
         PingIpState()
         {
@@ -91,10 +119,67 @@ private:
         }
     };
 
+    struct ScheduleEntry
+    {
+        qint64 time;
+        QString ip;
+
+        bool operator<(const ScheduleEntry &other) const
+        {
+            return std::tie(time, ip) < std::tie(other.time, other.ip);
+        }
+    };
+
+    struct RegionProbe
+    {
+        QString ip;
+        PingTime prevPingTime;
+    };
+
+    struct PingResult
+    {
+        std::string ip;
+        bool isSuccess;
+        std::int32_t timeMs;
+        bool isFromDisconnectedVpnState;
+    };
+
+    // filled by the wsnet callbacks, the owner is reset in the destructor, so the late callbacks are ignored
+    struct PingResults
+    {
+        std::mutex mutex;
+        std::vector<PingResult> results;
+        PingManager *owner = nullptr;
+        bool isBatchScheduled = false;
+    };
+
+    std::shared_ptr<PingResults> pingResults_;
+    QTimer resultsTimer_;
+
     QHash<QString, PingIpState> ips_;
+    // a deadline-ordered schedule for each priority, 0 is the highest; the due nodes of a higher priority go first
+    static constexpr int kPrioritiesCount = 2;
+    std::set<ScheduleEntry> schedules_[kPrioritiesCount];
+    QHash<QString, RegionProbe> regionProbes_;   // region -> probe node, while the region is being checked
+    QSet<QString> priorityIps_;
     QTimer pingTimer_;
-
-    void onPingFinished(const std::string &ip, bool isSuccess, std::int32_t timeMs, bool isFromDisconnectedVpnState);
+    qint64 budgetWindowStart_ = 0;
+    int pingsInBudgetWindow_ = 0;
+
+    void onPingFinished(const PingResult &result, QHash<QString, PingTime> &changedPings);
+    void checkIteration();
+    void startRegionProbes();
+    void finishRegionProbe(const QString &region, PingTime pingTime);
+    void startPing(PingIpState &pni);
+
+    void scheduleIp(PingIpState &pni, qint64 time, int priority = 1);
+    void unscheduleIp(PingIpState &pni);
+    void scheduleNextPing(PingIpState &pni);
+    void restartPingTimer();
+    // the highest priority schedule with a node due by the time, or nullptr
+    std::set<ScheduleEntry> *dueSchedule(qint64 time);
+    bool isScheduleEmpty() const;
+    qint64 nextScheduledTime() const;
 
 
     // Exponential Backoff algorithm, get next delay
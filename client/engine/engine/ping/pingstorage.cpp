@@ -1,31 +1,66 @@
 #include "pingstorage.h"
 
 #include <QDataStream>
+#include <QDir>
 #include <QIODevice>
 #include <QSettings>
+#include <QStandardPaths>
+#include <QtEndian>
 
+#include "utils/log/categories.h"
 #include "utils/simplecrypt.h"
+#include "utils/ws_assert.h"
 #include "types/global_consts.h"
 
 PingStorage::PingStorage(const QString &settingsKey) : settingsKey_(settingsKey)
 {
-    loadFromSettings();
+    const QString path = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    QDir().mkpath(path);
+    file_.setFileName(path + "/" + settingsKey_ + ".dat");
+    if (!file_.open(QIODevice::ReadWrite)) {
+        qCDebug(LOG_PING) << "Can't open the ping storage file, the ping data will not be saved:" << file_.errorString();
+    }
+
+    if (!loadFromFile()) {
+        // migrate the data from the legacy settings storage, if any; the legacy copy is kept until the file is written
+        loadFromSettings();
+        if (compact()) {
+            QSettings settings;
+            settings.remove(settingsKey_);
+        }
+    }
+    recalcPendingNodesCount();
 }
 
 PingStorage::~PingStorage()
 {
-    saveToSettings();
+    file_.close();
 }
 
 void PingStorage::setCurrentIterationData(qint64 msecsSinceEpoch, const QString &networkOrSsid)
 {
     curIterationTime_ = msecsSinceEpoch;
     curIterationNetworkOrSsid_ = networkOrSsid;
+    writeHeader();
+    recalcPendingNodesCount();
 }
 
 void PingStorage::setPing(const QString &ip, PingTime timeMs)
 {
-    pingDataDB_[ip] = PingData{timeMs, curIterationTime_};
+    auto it = pingDataDB_.find(ip);
+    if (it == pingDataDB_.end()) {
+        it = pingDataDB_.insert(ip, PingData());
+        it->slot_ = allocSlot();
+        if (it->iterationTime_ != curIterationTime_)
+            pendingNodesCount_++;
+    }
+
+    if (it->iterationTime_ != curIterationTime_)
+        pendingNodesCount_--;
+
+    it->timeMs_ = timeMs;
+    it->iterationTime_ = curIterationTime_;
+    writeRecord(it->slot_, ip, &it.value());
 }
 
 PingTime PingStorage::getPing(const QString &ip) const
@@ -53,42 +88,93 @@ void PingStorage::getPingData(const QString &ip, PingTime &outPingTime, qint64 &
 
 void PingStorage::initPingDataIfNotExists(const QString &ip)
 {
-    if (!pingDataDB_.contains(ip))
-        pingDataDB_[ip] = PingData();
+    if (pingDataDB_.contains(ip))
+        return;
+
+    PingData pingData;
+    pingData.slot_ = allocSlot();
+    pingDataDB_[ip] = pingData;
+    if (pingData.iterationTime_ != curIterationTime_)
+        pendingNodesCount_++;
+    writeRecord(pingData.slot_, ip, &pingData);
 }
 
 void PingStorage::removePingNode(const QString &ip)
 {
-    pingDataDB_.remove(ip);
-}
+    auto it = pingDataDB_.find(ip);
+    if (it == pingDataDB_.end())
+        return;
 
-bool PingStorage::isAllNodesHaveCurIteration() const
-{
-    for (const auto &it : pingDataDB_.values())
-        if (it.iterationTime_ != curIterationTime_)
-            return false;
+    if (it->iterationTime_ != curIterationTime_)
+        pendingNodesCount_--;
 
-    return true;
+    writeRecord(it->slot_, QString(), nullptr);
+    freeSlots_ << it->slot_;
+    pingDataDB_.erase(it);
+    maybeCompact();
 }
 
-void PingStorage::saveToSettings()
+bool PingStorage::loadFromFile()
 {
-    QByteArray arr;
-    {
-        QDataStream ds(&arr, QIODevice::WriteOnly);
-        ds << magic_;
-        ds << versionForSerialization_;
-        ds << curIterationTime_;
-        ds << curIterationNetworkOrSsid_;
-        ds << pingDataDB_.size();
-        for (auto it = pingDataDB_.begin(); it != pingDataDB_.end(); ++it) {
-            ds << it.key() << it.value().timeMs_.toInt() << it.value().iterationTime_;
-        }
+    curIterationTime_ = 0;
+    curIterationNetworkOrSsid_.clear();
+    pingDataDB_.clear();
+    freeSlots_.clear();
+    slotsCount_ = 0;
+
+    if (!file_.isOpen() || file_.size() < kHeaderSize)
+        return false;
+
+    file_.seek(0);
+    const QByteArray header = file_.read(kHeaderSize);
+    if (header.size() != kHeaderSize)
+        return false;
+
+    const char *h = header.constData();
+    if (qFromLittleEndian<quint32>(h) != magic_ || qFromLittleEndian<quint32>(h + 4) != fileVersion_)
+        return false;
+
+    curIterationTime_ = qFromLittleEndian<qint64>(h + 8);
+    const int networkLen = qFromLittleEndian<quint16>(h + 16);
+    if (networkLen > 0 && networkLen <= kHeaderSize - 18) {
+        SimpleCrypt simpleCrypt(SIMPLE_CRYPT_KEY);
+        curIterationNetworkOrSsid_ = simpleCrypt.decryptToString(header.mid(18, networkLen));
+    }
+
+    slotsCount_ = (file_.size() - kHeaderSize) / kRecordSize;
+    const QByteArray records = file_.read((qint64)slotsCount_ * kRecordSize);
+    if (records.size() != slotsCount_ * kRecordSize) {
+        curIterationTime_ = 0;
+        curIterationNetworkOrSsid_.clear();
+        slotsCount_ = 0;
+        return false;
     }
 
-    QSettings settings;
     SimpleCrypt simpleCrypt(SIMPLE_CRYPT_KEY);
-    settings.setValue(settingsKey_, simpleCrypt.encryptToString(arr));
+    for (int slot = 0; slot < slotsCount_; ++slot) {
+        // the free slots are zeroed
+        const char *encrypted = records.constData() + slot * kRecordSize;
+        if (encrypted[0] == 0) {
+            freeSlots_ << slot;
+            continue;
+        }
+        const QByteArray record = simpleCrypt.decryptToByteArray(QByteArray(encrypted, kEncryptedRecordSize));
+        const char *r = record.constData();
+        const int ipLen = record.size() == kRecordDataSize ? (quint8)r[1] : 0;
+        if (ipLen == 0 || r[0] == 0 || ipLen > kMaxIpLength) {
+            freeSlots_ << slot;
+            continue;
+        }
+
+        PingData pingData;
+        pingData.timeMs_ = qFromLittleEndian<qint32>(r + 48);
+        pingData.iterationTime_ = qFromLittleEndian<qint64>(r + 52);
+        pingData.slot_ = slot;
+        pingDataDB_[QString::fromLatin1(r + 2, ipLen)] = pingData;
+    }
+
+    maybeCompact();
+    return true;
 }
 
 void PingStorage::loadFromSettings()
@@ -141,3 +227,95 @@ void PingStorage::loadFromSettings()
         }
     }
 }
+
+bool PingStorage::compact()
+{
+    freeSlots_.clear();
+    slotsCount_ = 0;
+    for (auto it = pingDataDB_.begin(); it != pingDataDB_.end(); ++it) {
+        it->slot_ = slotsCount_++;
+    }
+
+    if (!file_.isOpen())
+        return false;
+
+    writeHeader();
+    for (auto it = pingDataDB_.cbegin(); it != pingDataDB_.cend(); ++it) {
+        writeRecord(it->slot_, it.key(), &it.value());
+    }
+    return file_.resize(kHeaderSize + (qint64)slotsCount_ * kRecordSize) && file_.flush() && file_.error() == QFileDevice::NoError;
+}
+
+void PingStorage::maybeCompact()
+{
+    if (freeSlots_.count() >= kMinFreeSlotsForCompaction && freeSlots_.count() > pingDataDB_.count())
+        compact();
+}
+
+void PingStorage::recalcPendingNodesCount()
+{
+    pendingNodesCount_ = 0;
+    for (auto it = pingDataDB_.cbegin(); it != pingDataDB_.cend(); ++it) {
+        if (it->iterationTime_ != curIterationTime_)
+            pendingNodesCount_++;
+    }
+}
+
+void PingStorage::writeHeader()
+{
+    if (!file_.isOpen())
+        return;
+
+    QByteArray header(kHeaderSize, '\0');
+    char *h = header.data();
+    qToLittleEndian<quint32>(magic_, h);
+    qToLittleEndian<quint32>(fileVersion_, h + 4);
+    qToLittleEndian<qint64>(curIterationTime_, h + 8);
+
+    SimpleCrypt simpleCrypt(SIMPLE_CRYPT_KEY);
+    const QByteArray network = simpleCrypt.encryptToByteArray(curIterationNetworkOrSsid_);
+    // an overlong network name is not saved, so the nodes will be re-pinged on the next launch
+    if (network.size() <= kHeaderSize - 18) {
+        qToLittleEndian<quint16>(network.size(), h + 16);
+        memcpy(h + 18, network.constData(), network.size());
+    }
+
+    file_.seek(0);
+    file_.write(header);
+    file_.flush();
+}
+
+void PingStorage::writeRecord(int slot, const QString &ip, const PingData *pingData)
+{
+    if (!file_.isOpen() || slot < 0)
+        return;
+
+    QByteArray encrypted(kRecordSize, '\0');
+    const QByteArray ipArr = ip.toLatin1();
+    if (pingData && !ipArr.isEmpty() && ipArr.size() <= kMaxIpLength) {
+        char record[kRecordDataSize] = {};
+        record[0] = 1;
+        record[1] = (char)ipArr.size();
+        memcpy(record + 2, ipArr.constData(), ipArr.size());
+        qToLittleEndian<qint32>(pingData->timeMs_.toInt(), record + 48);
+        qToLittleEndian<qint64>(pingData->iterationTime_, record + 52);
+
+        // no compression, so that the size is fixed
+        SimpleCrypt simpleCrypt(SIMPLE_CRYPT_KEY);
+        simpleCrypt.setCompressionMode(SimpleCrypt::CompressionNever);
+        const QByteArray data = simpleCrypt.encryptToByteArray(QByteArray(record, kRecordDataSize));
+        WS_ASSERT(data.size() == kEncryptedRecordSize);
+        encrypted.replace(0, data.size(), data);
+    }
+
+    file_.seek(kHeaderSize + (qint64)slot * kRecordSize);
+    file_.write(encrypted);
+    file_.flush();
+}
+
+int PingStorage::allocSlot()
+{
+    if (!freeSlots_.isEmpty())
+        return freeSlots_.takeLast();
+    return slotsCount_++;
+}
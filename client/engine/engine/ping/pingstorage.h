@@ -1,10 +1,15 @@
 #pragma once
 
+#include <QFile>
 #include <QHash>
+#include <QVector>
 
 #include "types/pingtime.h"
 
 // IP ping storage that saves state between program launches
+// The data is kept in a binary file of fixed-size records, so each ping result is written in place
+// without rewriting the whole database. Slots of removed nodes are reused and the file is compacted
+// when there are too many of them. The records are obfuscated with SimpleCrypt, as the legacy settings value was.
 class PingStorage
 {
 public:
@@ -23,13 +28,14 @@ public:
 
 
     void removePingNode(const QString &ip);
-    bool isAllNodesHaveCurIteration() const;
+    bool isAllNodesHaveCurIteration() const { return pendingNodesCount_ == 0; }
 
 private:
     struct PingData
     {
         PingTime timeMs_;
         qint64 iterationTime_ = 0;
+        int slot_ = -1;     // record index in the file
     };
 
     const QString settingsKey_;
@@ -38,10 +44,32 @@ private:
 
     // Maps the ip to its ping data.
     QHash<QString, PingData> pingDataDB_;
+    // number of nodes whose iteration time differs from the current iteration
+    int pendingNodesCount_ = 0;
+
+    QFile file_;
+    int slotsCount_ = 0;
+    QVector<int> freeSlots_;
 
     static constexpr quint32 magic_ = 0x734AB2AE;
-    static constexpr int versionForSerialization_ = 3;  // should increment the version if the data format is changed
+    static constexpr int versionForSerialization_ = 3;  // should increment the version if the data format is changed (legacy settings format)
+    static constexpr quint32 fileVersion_ = 2;          // should increment the version if the file format is changed
+
+    static constexpr int kHeaderSize = 256;
+    static constexpr int kRecordDataSize = 60;
+    // SimpleCrypt adds the version, the flags, a random char and the checksum to the record data
+    static constexpr int kEncryptedRecordSize = kRecordDataSize + 5;
+    static constexpr int kRecordSize = 80;
+    static constexpr int kMaxIpLength = 46;
+    static constexpr int kMinFreeSlotsForCompaction = 64;
 
-    void saveToSettings();
+    bool loadFromFile();
     void loadFromSettings();
+    bool compact();
+    void maybeCompact();
+    void recalcPendingNodesCount();
+
+    void writeHeader();
+    void writeRecord(int slot, const QString &ip, const PingData *pingData);   // pingData == nullptr for a free slot
+    int allocSlot();
 };
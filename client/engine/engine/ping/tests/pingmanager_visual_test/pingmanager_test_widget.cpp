@@ -42,8 +42,9 @@ Widget::Widget(QWidget *parent)
     accessManager_ = new NetworkAccessManager(this);
     pingHosts_ = new PingMultipleHosts(this, connectStateController_, accessManager_);
     pingManager_ = new PingManager(this, connectStateController_, networkDetectionManager_, pingHosts_, "pingData", "pingmanager.log");
-    connect(pingManager_, &PingManager::pingInfoChanged, [this](const QString &ip, int timems) {
-        qDebug() << "Finished ip: " << ip << " -> " << timems << "ms";
+    connect(pingManager_, &PingManager::pingInfoChanged, [this](const QHash<QString, PingTime> &pings) {
+        for (auto it = pings.constBegin(); it != pings.constEnd(); ++it)
+            qDebug() << "Finished ip: " << it.key() << " -> " << it.value().toInt() << "ms";
         if (pingManager_->isAllNodesHaveCurIteration()) {
             qDebug() << "All nodes have the same iteration";
         }
@@ -0,0 +1,396 @@
+#include "pmtudiscovery.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+
+#include "utils/log/categories.h"
+#include "utils/network_utils/network_utils.h"
+
+#ifdef Q_OS_WIN
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #include <iphlpapi.h>
+    #include <icmpapi.h>
+#else
+    #include <arpa/inet.h>
+    #include <fcntl.h>
+    #include <netdb.h>
+    #include <netinet/in.h>
+    #include <netinet/ip.h>
+    #include <netinet/ip_icmp.h>
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <unistd.h>
+    #include <errno.h>
+    #ifdef Q_OS_LINUX
+        #include <linux/errqueue.h>
+    #endif
+#endif
+
+namespace {
+
+// IPv4 header + ICMP header
+constexpr int kIcmpOverhead = 28;
+
+bool resolveIpv4(const QString &hostname, in_addr *outAddr)
+{
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    struct addrinfo *result = nullptr;
+    if (getaddrinfo(hostname.toStdString().c_str(), nullptr, &hints, &result) != 0 || !result)
+        return false;
+    *outAddr = reinterpret_cast<sockaddr_in *>(result->ai_addr)->sin_addr;
+    freeaddrinfo(result);
+    return true;
+}
+
+#ifdef Q_OS_WIN
+
+class IcmpProber
+{
+public:
+    ~IcmpProber()
+    {
+        if (handle_ != INVALID_HANDLE_VALUE)
+            IcmpCloseHandle(handle_);
+    }
+
+    bool open(const in_addr &addr)
+    {
+        addr_ = addr;
+        handle_ = IcmpCreateFile();
+        return handle_ != INVALID_HANDLE_VALUE;
+    }
+
+    QVector<PmtuDiscovery::ProbeResult> probe(const QVector<int> &sizes, int timeoutMs, int *outMtuHint)
+    {
+        *outMtuHint = 0;
+        QVector<PmtuDiscovery::ProbeResult> results(sizes.size(), PmtuDiscovery::ProbeResult::kNoReply);
+        QVector<HANDLE> events;
+        QVector<QByteArray> replies;
+        QVector<int> probeInds;
+        const QByteArray data(PmtuDiscovery::kMaxSize, 'w');
+
+        IP_OPTION_INFORMATION options = {};
+        options.Ttl = 128;
+        options.Flags = IP_FLAG_DF;
+
+        for (int i = 0; i < sizes.size(); ++i) {
+            HANDLE event = CreateEvent(NULL, FALSE, FALSE, NULL);
+            if (event == NULL)
+                continue;
+            // the reply buffer must also fit an ICMP error and IO_STATUS_BLOCK (16 bytes)
+            QByteArray reply(sizeof(ICMP_ECHO_REPLY) + sizes[i] + 8 + 16, '\0');
+            DWORD ret = IcmpSendEcho2(handle_, event, NULL, NULL, addr_.S_un.S_addr, (LPVOID)data.constData(), sizes[i],
+                                      &options, reply.data(), reply.size(), timeoutMs);
+            if (ret == 0 && GetLastError() != ERROR_IO_PENDING) {
+                if (GetLastError() == IP_PACKET_TOO_BIG)
+                    results[i] = PmtuDiscovery::ProbeResult::kTooBig;
+                CloseHandle(event);
+                continue;
+            }
+            events << event;
+            replies << reply;
+            probeInds << i;
+        }
+
+        if (!events.isEmpty()) {
+            // the requests complete by themselves after timeoutMs, the margin is for the completion routine
+            const DWORD waitRes = WaitForMultipleObjects(events.size(), events.constData(), TRUE, timeoutMs + 500);
+            if (waitRes >= WAIT_OBJECT_0 + DWORD(events.size())) {
+                // the driver still owns the reply and send buffers of the pending requests: closing the handle cancels them,
+                // and the buffers are released only after every event is signalled
+                qCWarning(LOG_PACKET_SIZE) << "ICMP probes not completed in time, cancelling them:" << waitRes << GetLastError();
+                IcmpCloseHandle(handle_);
+                WaitForMultipleObjects(events.size(), events.constData(), TRUE, INFINITE);
+                handle_ = IcmpCreateFile();
+            }
+            for (int i = 0; i < events.size(); ++i) {
+                if (IcmpParseReplies(replies[i].data(), replies[i].size()) > 0) {
+                    const ICMP_ECHO_REPLY *reply = reinterpret_cast<const ICMP_ECHO_REPLY *>(replies[i].constData());
+                    if (reply->Status == IP_SUCCESS)
+                        results[probeInds[i]] = PmtuDiscovery::ProbeResult::kOk;
+                    else if (reply->Status == IP_PACKET_TOO_BIG)
+                        results[probeInds[i]] = PmtuDiscovery::ProbeResult::kTooBig;
+                }
+                CloseHandle(events[i]);
+            }
+        }
+        return results;
+    }
+
+private:
+    HANDLE handle_ = INVALID_HANDLE_VALUE;
+    in_addr addr_;
+};
+
+#else
+
+quint16 icmpChecksum(const quint8 *data, int size)
+{
+    quint32 sum = 0;
+    for (int i = 0; i + 1 < size; i += 2)
+        sum += (data[i] << 8) | data[i + 1];
+    if (size & 1)
+        sum += data[size - 1] << 8;
+    while (sum >> 16)
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    return htons(static_cast<quint16>(~sum));
+}
+
+// Unprivileged ICMP datagram socket, the kernel fills in the identifier and matches the replies to the socket.
+class IcmpProber
+{
+public:
+    ~IcmpProber()
+    {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    bool open(const in_addr &addr)
+    {
+        fd_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_ICMP);
+        if (fd_ < 0)
+            return false;
+
+#ifdef Q_OS_LINUX
+        // set DF but ignore the cached path MTU, so the sizes above it are still probed
+        int val = IP_PMTUDISC_PROBE;
+        setsockopt(fd_, IPPROTO_IP, IP_MTU_DISCOVER, &val, sizeof(val));
+        // receive the ICMP "fragmentation needed" errors in the error queue
+        int on = 1;
+        setsockopt(fd_, IPPROTO_IP, IP_RECVERR, &on, sizeof(on));
+#else
+        int on = 1;
+        setsockopt(fd_, IPPROTO_IP, IP_DONTFRAG, &on, sizeof(on));
+#endif
+        fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL, 0) | O_NONBLOCK);
+
+        struct sockaddr_in sa = {};
+        sa.sin_family = AF_INET;
+        sa.sin_addr = addr;
+        if (::connect(fd_, reinterpret_cast<sockaddr *>(&sa), sizeof(sa)) < 0) {
+            close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        return true;
+    }
+
+    QVector<PmtuDiscovery::ProbeResult> probe(const QVector<int> &sizes, int timeoutMs, int *outMtuHint)
+    {
+        *outMtuHint = 0;
+        QVector<PmtuDiscovery::ProbeResult> results(sizes.size(), PmtuDiscovery::ProbeResult::kNoReply);
+        QHash<quint16, int> seqToInd;
+        quint8 packet[ICMP_MINLEN + PmtuDiscovery::kMaxSize] = {};
+
+        for (int i = 0; i < sizes.size(); ++i) {
+            const quint16 seq = ++seq_;
+            struct icmp *hdr = reinterpret_cast<struct icmp *>(packet);
+            hdr->icmp_type = ICMP_ECHO;
+            hdr->icmp_code = 0;
+            hdr->icmp_id = 0;
+            hdr->icmp_seq = htons(seq);
+            hdr->icmp_cksum = 0;
+            const int len = ICMP_MINLEN + sizes[i];
+            hdr->icmp_cksum = icmpChecksum(packet, len);
+
+            if (send(fd_, packet, len, 0) < 0) {
+                if (errno == EMSGSIZE)
+                    results[i] = PmtuDiscovery::ProbeResult::kTooBig;
+                continue;
+            }
+            seqToInd[seq] = i;
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        int pending = seqToInd.size();
+        while (pending > 0) {
+            const int remainingMs = timeoutMs - timer.elapsed();
+            if (remainingMs <= 0)
+                break;
+            struct pollfd pfd = { fd_, POLLIN, 0 };
+            if (poll(&pfd, 1, remainingMs) <= 0)
+                continue;
+
+#ifdef Q_OS_LINUX
+            if (pfd.revents & POLLERR) {
+                int ind = readError(seqToInd, outMtuHint);
+                if (ind >= 0 && results[ind] == PmtuDiscovery::ProbeResult::kNoReply) {
+                    results[ind] = PmtuDiscovery::ProbeResult::kTooBig;
+                    pending--;
+                }
+                continue;
+            }
+#endif
+            quint8 buf[2048];
+            const ssize_t n = recv(fd_, buf, sizeof(buf), 0);
+            if (n <= 0)
+                continue;
+            // macOS returns the IP header too
+            const quint8 *reply = buf;
+            ssize_t replyLen = n;
+            if ((buf[0] >> 4) == 4) {
+                const int ipHeaderLen = (buf[0] & 0x0F) * 4;
+                reply += ipHeaderLen;
+                replyLen -= ipHeaderLen;
+            }
+            if (replyLen < (ssize_t)ICMP_MINLEN)
+                continue;
+            const struct icmp *hdr = reinterpret_cast<const struct icmp *>(reply);
+            if (hdr->icmp_type != ICMP_ECHOREPLY)
+                continue;
+            auto it = seqToInd.constFind(ntohs(hdr->icmp_seq));
+            if (it != seqToInd.constEnd() && results[it.value()] == PmtuDiscovery::ProbeResult::kNoReply) {
+                results[it.value()] = PmtuDiscovery::ProbeResult::kOk;
+                pending--;
+            }
+        }
+
+#ifdef Q_OS_LINUX
+        // the path MTU learned by the kernel from the earlier errors
+        int mtu = 0;
+        socklen_t mtuLen = sizeof(mtu);
+        if (getsockopt(fd_, IPPROTO_IP, IP_MTU, &mtu, &mtuLen) == 0 && mtu > 0 && (*outMtuHint == 0 || mtu < *outMtuHint)) {
+            // the local interface MTU is reported until an error is received, it's only a hint for the upper bound
+            *outMtuHint = mtu;
+        }
+#endif
+        return results;
+    }
+
+private:
+    int fd_ = -1;
+    quint16 seq_ = 0;
+
+#ifdef Q_OS_LINUX
+    // returns the index of the probe rejected as too big, or -1
+    int readError(const QHash<quint16, int> &seqToInd, int *outMtuHint)
+    {
+        quint8 data[ICMP_MINLEN + PmtuDiscovery::kMaxSize];
+        char control[512];
+        struct iovec iov = { data, sizeof(data) };
+        struct msghdr msg = {};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        const ssize_t n = recvmsg(fd_, &msg, MSG_ERRQUEUE);
+        if (n < (ssize_t)ICMP_MINLEN)
+            return -1;
+
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level != IPPROTO_IP || cmsg->cmsg_type != IP_RECVERR)
+                continue;
+            const struct sock_extended_err *err = reinterpret_cast<const struct sock_extended_err *>(CMSG_DATA(cmsg));
+            const bool isFragNeeded = (err->ee_origin == SO_EE_ORIGIN_ICMP && err->ee_type == ICMP_DEST_UNREACH && err->ee_code == ICMP_FRAG_NEEDED) ||
+                                      (err->ee_origin == SO_EE_ORIGIN_LOCAL && err->ee_errno == EMSGSIZE);
+            if (!isFragNeeded)
+                continue;
+            const int mtu = static_cast<int>(err->ee_info);
+            if (mtu > 0 && (*outMtuHint == 0 || mtu < *outMtuHint))
+                *outMtuHint = mtu;
+
+            // the error queue returns the payload of the rejected probe
+            const struct icmp *hdr = reinterpret_cast<const struct icmp *>(data);
+            auto it = seqToInd.constFind(ntohs(hdr->icmp_seq));
+            if (it != seqToInd.constEnd())
+                return it.value();
+        }
+        return -1;
+    }
+#endif
+};
+
+#endif
+
+} // namespace
+
+int PmtuDiscovery::discover(const QString &hostname, const QString &networkId, const StopFunc &isStopped)
+{
+    const QString cacheKey = networkId + "/" + hostname;
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    auto it = cache_.constFind(cacheKey);
+    if (it != cache_.constEnd() && now - it->time < kCacheTtlMs) {
+        qCDebug(LOG_PACKET_SIZE) << "Using the cached packet size for the network:" << it->size;
+        return it->size;
+    }
+
+    in_addr addr;
+    IcmpProber prober;
+    int size;
+    if (resolveIpv4(hostname, &addr) && prober.open(addr)) {
+        size = search([&prober](const QVector<int> &sizes, int *outMtuHint) {
+            return prober.probe(sizes, kProbeTimeoutMs, outMtuHint);
+        }, isStopped);
+    } else {
+        qCDebug(LOG_PACKET_SIZE) << "ICMP socket is not available, falling back to ping";
+        size = search([&hostname](const QVector<int> &sizes, int *outMtuHint) {
+            *outMtuHint = 0;
+            QVector<ProbeResult> results;
+            for (int s : sizes)
+                results << (NetworkUtils::pingWithMtu(hostname, s) ? ProbeResult::kOk : ProbeResult::kNoReply);
+            return results;
+        }, isStopped);
+    }
+
+    if (size > 0)
+        cache_[cacheKey] = CacheEntry{ size, now };
+    return size;
+}
+
+void PmtuDiscovery::clearCache()
+{
+    cache_.clear();
+}
+
+int PmtuDiscovery::search(const ProbeFunc &probe, const StopFunc &isStopped)
+{
+    // the indexes on the grid: lo is the largest size known to pass, hi is the smallest size known to fail
+    int lo = -1;
+    int hi = (kMaxSize - kMinSize) / kStep + 1;
+    bool isFirstRound = true;
+
+    while (hi - lo > 1) {
+        if (isStopped())
+            return -1;
+
+        // split the unknown range into equal parts, most networks pass the largest size so it's probed first
+        QVector<int> indexes;
+        if (isFirstRound)
+            indexes << hi - 1;
+        const int count = qMin(kProbesInFlight, hi - lo - 1);
+        for (int i = 1; i <= count; ++i) {
+            const int ind = qBound(lo + 1, lo + (i * (hi - lo)) / (count + 1), hi - 1);
+            if (!indexes.contains(ind))
+                indexes << ind;
+        }
+        isFirstRound = false;
+
+        QVector<int> sizes;
+        for (int ind : indexes)
+            sizes << sizeForIndex(ind);
+        int mtuHint = 0;
+        const QVector<ProbeResult> results = probe(sizes, &mtuHint);
+
+        for (int i = 0; i < indexes.size(); ++i) {
+            if (results[i] == ProbeResult::kOk)
+                lo = qMax(lo, indexes[i]);
+        }
+        // a lost reply below a passed size is not a size problem
+        for (int i = 0; i < indexes.size(); ++i) {
+            if (results[i] != ProbeResult::kOk && indexes[i] > lo)
+                hi = qMin(hi, indexes[i]);
+        }
+        if (mtuHint > 0) {
+            const int maxSize = mtuHint - kIcmpOverhead;
+            const int maxInd = maxSize < kMinSize ? -1 : (maxSize - kMinSize) / kStep;
+            if (maxInd + 1 > lo)
+                hi = qMin(hi, maxInd + 1);
+        }
+    }
+
+    return lo >= 0 ? sizeForIndex(lo) : -1;
+}
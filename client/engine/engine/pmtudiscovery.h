@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <functional>
+
+// Path MTU discovery with DF-flagged ICMP echo probes sent from an in-process socket.
+// The sizes are the ICMP payload sizes (as for "ping -s"), searched on the grid kMinSize..kMaxSize with kStep.
+// Several sizes are probed at once, so the search takes a couple of round trips instead of one probe per grid step.
+// The "fragmentation needed" errors and the path MTU known to the OS narrow the search down when available.
+// If the ICMP socket cannot be opened (e.g. not allowed by net.ipv4.ping_group_range on Linux),
+// the same search is done with NetworkUtils::pingWithMtu, one probe at a time.
+class PmtuDiscovery
+{
+public:
+    static constexpr int kMinSize = 1300;
+    static constexpr int kMaxSize = 1470;
+    static constexpr int kStep = 10;
+
+    // returns true if the discovery must be interrupted, checked between the rounds of probes
+    typedef std::function<bool()> StopFunc;
+
+    // returns the largest payload size which passes the path, or -1
+    // the results are cached per network (networkId) and host
+    int discover(const QString &hostname, const QString &networkId, const StopFunc &isStopped);
+    void clearCache();
+
+    enum class ProbeResult { kOk, kTooBig, kNoReply };
+
+private:
+    static constexpr int kProbesInFlight = 5;
+    static constexpr int kProbeTimeoutMs = 1000;
+    static constexpr qint64 kCacheTtlMs = 60 * 60 * 1000;
+
+    struct CacheEntry
+    {
+        int size;
+        qint64 time;
+    };
+    QHash<QString, CacheEntry> cache_;
+
+    // sends the probes of the given sizes at once, returns the result for each size and the next-hop MTU hint if any
+    typedef std::function<QVector<ProbeResult>(const QVector<int> &sizes, int *outMtuHint)> ProbeFunc;
+
+    static int search(const ProbeFunc &probe, const StopFunc &isStopped);
+    static int sizeForIndex(int ind) { return kMinSize + ind * kStep; }
+};
@@ -301,7 +301,9 @@ uint VpnShareController::findPort(uint userPort)
 
     uint port = 0;
     if (!getLastSavedPort(port)) {
-        port = AvailablePort::getAvailablePort(18888);
+        // only the number is needed, the proxy server binds the port later
+        port = AvailablePort::reservePort(18888);
+        AvailablePort::releasePort(port);
         saveLastPort(port);
     }
     return port;
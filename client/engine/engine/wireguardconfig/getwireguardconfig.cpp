@@ -18,8 +18,13 @@ const QString GetWireGuardConfig::KEY_WIREGUARD_CONFIG = "wireguardConfig";
 
 using namespace wsnet;
 
-GetWireGuardConfig::GetWireGuardConfig(QObject *parent) : QObject(parent),
-    simpleCrypt_(SIMPLE_CRYPT_KEY)
+GetWireGuardConfig::GetWireGuardConfig(QObject *parent) :
+    GetWireGuardConfig(parent, WSNet::instance()->serverAPI(), WSNet::instance()->apiResourcersManager()->authHash())
+{
+}
+
+GetWireGuardConfig::GetWireGuardConfig(QObject *parent, std::shared_ptr<WSNetServerAPI> serverAPI, const std::string &authHash) : QObject(parent),
+    simpleCrypt_(SIMPLE_CRYPT_KEY), serverAPI_(serverAPI), authHash_(authHash)
 {
 }
 
@@ -143,14 +148,14 @@ void GetWireGuardConfig::onWgConfigsConnectAnswer(ServerApiRetCode serverApiRetC
 void GetWireGuardConfig::submitWireguardConnectRequest()
 {
     WS_ASSERT(request_ == nullptr);
-    request_ = WSNet::instance()->serverAPI()->wgConfigsConnect(WSNet::instance()->apiResourcersManager()->authHash(), wireGuardConfig_.clientPublicKey().toStdString(),
-                                                                serverName_.toStdString(), deviceId_.toStdString(), std::string(),
-                                                                [this](ServerApiRetCode serverApiRetCode, const std::string &jsonData)
-                                                                {
-                                                                    QMetaObject::invokeMethod(this, [this, serverApiRetCode, jsonData]() {
-                                                                        onWgConfigsConnectAnswer(serverApiRetCode, jsonData);
-                                                                    });
-                                                                });
+    request_ = serverAPI_->wgConfigsConnect(authHash_, wireGuardConfig_.clientPublicKey().toStdString(),
+                                            serverName_.toStdString(), deviceId_.toStdString(), std::string(),
+                                            [this](ServerApiRetCode serverApiRetCode, const std::string &jsonData)
+                                            {
+                                                QMetaObject::invokeMethod(this, [this, serverApiRetCode, jsonData]() {
+                                                    onWgConfigsConnectAnswer(serverApiRetCode, jsonData);
+                                                });
+                                            });
 }
 
 void GetWireGuardConfig::submitWireGuardInitRequest(bool generateKeyPair)
@@ -165,14 +170,14 @@ void GetWireGuardConfig::submitWireGuardInitRequest(bool generateKeyPair)
         setWireGuardKeyPair(wireGuardConfig_.clientPublicKey(), wireGuardConfig_.clientPrivateKey());
     }
     WS_ASSERT(request_ == nullptr);
-    request_ = WSNet::instance()->serverAPI()->wgConfigsInit(WSNet::instance()->apiResourcersManager()->authHash(), wireGuardConfig_.clientPublicKey().toStdString(),
-                                                                deleteOldestKey_,
-                                                                [this](ServerApiRetCode serverApiRetCode, const std::string &jsonData)
-                                                                {
-                                                                    QMetaObject::invokeMethod(this, [this, serverApiRetCode, jsonData]() { // NOLINT: false positive for memory leak
-                                                                        onWgConfigsInitAnswer(serverApiRetCode, jsonData);
-                                                                    });
-                                                                });
+    request_ = serverAPI_->wgConfigsInit(authHash_, wireGuardConfig_.clientPublicKey().toStdString(),
+                                         deleteOldestKey_,
+                                         [this](ServerApiRetCode serverApiRetCode, const std::string &jsonData)
+                                         {
+                                             QMetaObject::invokeMethod(this, [this, serverApiRetCode, jsonData]() { // NOLINT: false positive for memory leak
+                                                 onWgConfigsInitAnswer(serverApiRetCode, jsonData);
+                                             });
+                                         });
 }
 
 bool GetWireGuardConfig::getWireGuardKeyPair(QString &publicKey, QString &privateKey)
@@ -216,13 +221,14 @@ void GetWireGuardConfig::setWireGuardPeerInfo(const QString &presharedKey, const
 
 WireGuardConfig GetWireGuardConfig::readWireGuardConfigFromSettings()
 {
+    SimpleCrypt simpleCrypt(SIMPLE_CRYPT_KEY);
     QSettings settings;
     if (settings.contains(KEY_WIREGUARD_CONFIG))
     {
         QString s = settings.value(KEY_WIREGUARD_CONFIG, "").toString();
         if (!s.isEmpty())
         {
-            QByteArray arr = simpleCrypt_.decryptToByteArray(s);
+            QByteArray arr = simpleCrypt.decryptToByteArray(s);
             QDataStream ds(&arr, QIODevice::ReadOnly);
 
             quint32 magic, version;
@@ -294,3 +300,8 @@ void GetWireGuardConfig::removeWireGuardSettings()
     settings.remove("wireguardPresharedKey");
     settings.remove("wireguardAllowedIPs");
 }
+
+QString GetWireGuardConfig::storedPublicKey()
+{
+    return readWireGuardConfigFromSettings().clientPublicKey();
+}
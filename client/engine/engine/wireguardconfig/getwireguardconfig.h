@@ -21,10 +21,14 @@ class GetWireGuardConfig : public QObject
     Q_OBJECT
 public:
     GetWireGuardConfig(QObject *parent);
+    // the requests go to the given ServerAPI instead of the WSNet's one (used by the tests)
+    GetWireGuardConfig(QObject *parent, std::shared_ptr<wsnet::WSNetServerAPI> serverAPI, const std::string &authHash);
     ~GetWireGuardConfig();
 
     void getWireGuardConfig(const QString &serverName, bool deleteOldestKey, const QString &deviceId);
     static void removeWireGuardSettings();
+    // the public key of the key-pair stored in settings, empty if there is no key-pair yet
+    static QString storedPublicKey();
 
 signals:
     void getWireGuardConfigAnswer(WireGuardConfigRetCode retCode, const WireGuardConfig &config);
@@ -45,6 +49,8 @@ private:
     bool isRetryInitRequest_;
     std::shared_ptr<wsnet::WSNetCancelableCallback> request_;
     SimpleCrypt simpleCrypt_;
+    std::shared_ptr<wsnet::WSNetServerAPI> serverAPI_;
+    std::string authHash_;
 
     void submitWireguardConnectRequest();
     void submitWireGuardInitRequest(bool generateKeyPair);
@@ -53,7 +59,7 @@ private:
     void setWireGuardKeyPair(const QString &publicKey, const QString &privateKey);
     bool getWireGuardPeerInfo(QString &presharedKey, QString &allowedIPs);
     void setWireGuardPeerInfo(const QString &presharedKey, const QString &allowedIPs);
-    WireGuardConfig readWireGuardConfigFromSettings();
+    static WireGuardConfig readWireGuardConfigFromSettings();
     void writeWireGuardConfigToSettings(const WireGuardConfig &wgConfig);
 
     // for serialization
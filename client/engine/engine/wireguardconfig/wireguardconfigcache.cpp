@@ -0,0 +1,133 @@
+#include "wireguardconfigcache.h"
+#include <QDateTime>
+#include "utils/log/categories.h"
+#include "utils/utils.h"
+
+WireGuardConfigCache::WireGuardConfigCache(QObject *parent, IConnectStateController *stateController) :
+    WireGuardConfigCache(parent, stateController, nullptr, kIdleDelayMs, kExpiryMs)
+{
+}
+
+WireGuardConfigCache::WireGuardConfigCache(QObject *parent, IConnectStateController *stateController,
+                                           std::shared_ptr<wsnet::WSNetServerAPI> serverAPI, int idleDelayMs, int expiryMs) : QObject(parent),
+    connectStateController_(stateController), serverAPI_(serverAPI), idleDelayMs_(idleDelayMs), expiryMs_(expiryMs), getWireGuardConfig_(nullptr)
+{
+    timer_.setSingleShot(true);
+    connect(&timer_, &QTimer::timeout, this, &WireGuardConfigCache::onTimer);
+    connect(connectStateController_, &IConnectStateController::stateChanged, this, &WireGuardConfigCache::onConnectStateChanged);
+}
+
+void WireGuardConfigCache::setHostnames(const QStringList &hostnames)
+{
+    const QStringList newHostnames = hostnames.mid(0, kMaxHostnames);
+    if (newHostnames == hostnames_)
+        return;
+    hostnames_ = newHostnames;
+
+    for (auto it = entries_.begin(); it != entries_.end(); ) {
+        if (!hostnames_.contains(it.key()))
+            it = entries_.erase(it);
+        else
+            ++it;
+    }
+    removeExpired();
+
+    if (isIdle() && !getWireGuardConfig_)
+        timer_.start(idleDelayMs_);
+}
+
+void WireGuardConfigCache::clear()
+{
+    stopFetching();
+    entries_.clear();
+    if (isIdle() && !hostnames_.isEmpty())
+        timer_.start(idleDelayMs_);
+}
+
+bool WireGuardConfigCache::take(const QString &hostname, WireGuardConfig &config)
+{
+    auto it = entries_.find(hostname);
+    if (it == entries_.end())
+        return false;
+
+    const Entry entry = it.value();
+    entries_.erase(it);
+    if (entry.expiresAt <= QDateTime::currentMSecsSinceEpoch())
+        return false;
+
+    // the key-pair was regenerated after the config was fetched, so all the configs are useless
+    if (entry.config.clientPublicKey() != GetWireGuardConfig::storedPublicKey()) {
+        entries_.clear();
+        return false;
+    }
+
+    config = entry.config;
+    return true;
+}
+
+void WireGuardConfigCache::onConnectStateChanged(CONNECT_STATE state, DISCONNECT_REASON /*reason*/, CONNECT_ERROR /*err*/, const LocationID & /*location*/)
+{
+    if (state == CONNECT_STATE_DISCONNECTED) {
+        removeExpired();
+        if (!hostnames_.isEmpty())
+            timer_.start(idleDelayMs_);
+    } else {
+        // do not compete with the connection for the API
+        timer_.stop();
+        stopFetching();
+    }
+}
+
+void WireGuardConfigCache::onTimer()
+{
+    if (!isIdle() || getWireGuardConfig_)
+        return;
+
+    for (const QString &hostname : std::as_const(hostnames_)) {
+        if (!entries_.contains(hostname)) {
+            fetchingHostname_ = hostname;
+            // the fake ServerAPI of the tests does not check the auth hash
+            getWireGuardConfig_ = serverAPI_ ? new GetWireGuardConfig(this, serverAPI_, std::string()) : new GetWireGuardConfig(this);
+            connect(getWireGuardConfig_, &GetWireGuardConfig::getWireGuardConfigAnswer, this, &WireGuardConfigCache::onGetWireGuardConfigAnswer);
+            getWireGuardConfig_->getWireGuardConfig(hostname, false, QString());
+            return;
+        }
+    }
+}
+
+void WireGuardConfigCache::onGetWireGuardConfigAnswer(WireGuardConfigRetCode retCode, const WireGuardConfig &config)
+{
+    getWireGuardConfig_->deleteLater();
+    getWireGuardConfig_ = nullptr;
+
+    if (retCode != WireGuardConfigRetCode::kSuccess) {
+        qCDebug(LOG_WIREGUARD) << "Could not prefetch WireGuard config for" << fetchingHostname_ << ", retCode:" << (int)retCode;
+        timer_.start(kRetryAfterFailureMs);
+        return;
+    }
+
+    qCDebug(LOG_WIREGUARD) << "Prefetched WireGuard config for" << fetchingHostname_;
+    entries_[fetchingHostname_] = Entry{ config, QDateTime::currentMSecsSinceEpoch() + expiryMs_ };
+    timer_.start(0);
+}
+
+bool WireGuardConfigCache::isIdle() const
+{
+    return connectStateController_->currentState() == CONNECT_STATE_DISCONNECTED;
+}
+
+void WireGuardConfigCache::removeExpired()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (auto it = entries_.begin(); it != entries_.end(); ) {
+        if (it.value().expiresAt <= now)
+            it = entries_.erase(it);
+        else
+            ++it;
+    }
+}
+
+void WireGuardConfigCache::stopFetching()
+{
+    SAFE_DELETE(getWireGuardConfig_);
+}
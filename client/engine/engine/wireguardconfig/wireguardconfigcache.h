@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+#include "getwireguardconfig.h"
+#include "engine/connectstatecontroller/iconnectstatecontroller.h"
+
+// Fetches the WireGuard configs for the likely next connects in the background, so the connect does not wait for the API.
+// The configs are fetched one by one only while disconnected and idle, and are kept for a limited time.
+// The expired configs are not re-fetched until the next disconnect or hostnames change, to not load the API while idle.
+// A config is invalidated if the key-pair stored in settings changes, and all the configs on clear() (e.g. the server list changed).
+class WireGuardConfigCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit WireGuardConfigCache(QObject *parent, IConnectStateController *stateController);
+    // for the tests: the configs are fetched from the given ServerAPI, with the given delays
+    WireGuardConfigCache(QObject *parent, IConnectStateController *stateController,
+                         std::shared_ptr<wsnet::WSNetServerAPI> serverAPI, int idleDelayMs, int expiryMs);
+
+    // the node hostnames for which the configs should be prepared, in priority order
+    void setHostnames(const QStringList &hostnames);
+    void clear();
+
+    // returns a prepared config for the hostname, the config is removed from the cache
+    bool take(const QString &hostname, WireGuardConfig &config);
+
+private slots:
+    void onConnectStateChanged(CONNECT_STATE state, DISCONNECT_REASON reason, CONNECT_ERROR err, const LocationID &location);
+    void onTimer();
+    void onGetWireGuardConfigAnswer(WireGuardConfigRetCode retCode, const WireGuardConfig &config);
+
+private:
+    static constexpr int kIdleDelayMs = 10 * 1000;          // wait after the disconnect or the hostnames change before fetching
+    static constexpr int kExpiryMs = 15 * 60 * 1000;
+    static constexpr int kRetryAfterFailureMs = 5 * 60 * 1000;
+    static constexpr int kMaxHostnames = 12;
+
+    struct Entry
+    {
+        WireGuardConfig config;
+        qint64 expiresAt;
+    };
+
+    IConnectStateController *connectStateController_;
+    std::shared_ptr<wsnet::WSNetServerAPI> serverAPI_;     // nullptr for the WSNet's ServerAPI
+    const int idleDelayMs_;
+    const int expiryMs_;
+    QHash<QString, Entry> entries_;
+    QStringList hostnames_;
+    QTimer timer_;
+    GetWireGuardConfig *getWireGuardConfig_;
+    QString fetchingHostname_;
+
+    bool isIdle() const;
+    void removeExpired();
+    void stopFetching();
+};
@@ -0,0 +1,297 @@
+#include <QtTest>
+#include "wireguardconfigcache.test.h"
+#include "wireguardconfigcache.h"
+
+namespace {
+
+class FakeCancelableCallback : public wsnet::WSNetCancelableCallback
+{
+public:
+    void cancel() override { isCanceled = true; }
+    bool isCanceled = false;
+};
+
+// answers the WireGuard requests asynchronously as the real ServerAPI does, the other requests fail
+class FakeServerAPI : public wsnet::WSNetServerAPI
+{
+public:
+    QStringList connectedHostnames;
+    int initCount = 0;
+    bool isFailing = false;
+    int answerDelayMs = 10;
+
+    std::shared_ptr<wsnet::WSNetCancelableCallback> wgConfigsInit(const std::string &authHash, const std::string &clientPublicKey,
+                                                                  bool deleteOldestKey, wsnet::WSNetRequestFinishedCallback callback) override
+    {
+        initCount++;
+        return answer(callback, R"({"data":{"config":{"PresharedKey":"psk","AllowedIPs":"0.0.0.0/0"}}})");
+    }
+
+    std::shared_ptr<wsnet::WSNetCancelableCallback> wgConfigsConnect(const std::string &authHash, const std::string &clientPublicKey,
+                                                                     const std::string &hostname, const std::string &deviceId, const std::string &wgTtl,
+                                                                     wsnet::WSNetRequestFinishedCallback callback) override
+    {
+        connectedHostnames << QString::fromStdString(hostname);
+        return answer(callback, R"({"data":{"config":{"Address":"100.64.0.)" + std::to_string(connectedHostnames.size()) + R"(/32","DNS":"10.255.255.1"}}})");
+    }
+
+    void setApiResolutionsSettings(bool isAutomatic, std::string manualAddress) override {}
+    void setIgnoreSslErrors(bool bIgnore) override {}
+    void resetFailover() override {}
+    std::shared_ptr<wsnet::WSNetCancelableCallback> setTryingBackupEndpointCallback(wsnet::WSNetTryingBackupEndpointCallback tryingBackupEndpointCallback) override { return nullptr; }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> login(const std::string &username, const std::string &password, const std::string &code2fa, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> session(const std::string &authHash, const std::string &appleId, const std::string &gpDeviceId, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> claimVoucherCode(const std::string &authHash, const std::string &voucherCode, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> deleteSession(const std::string &authHash, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> serverLocations(const std::string &language, const std::string &revision, bool isPro, const std::vector<std::string> &alcList, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> serverCredentials(const std::string &authHash, bool isOpenVpnProtocol, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> serverConfigs(const std::string &authHash, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> portMap(const std::string &authHash, std::uint32_t version, const std::vector<std::string> &forceProtocols, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> recordInstall(bool isDesktop, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> addEmail(const std::string &authHash, const std::string &email, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> confirmEmail(const std::string &authHash, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> signup(const std::string &username, const std::string &password, const std::string &referringUsername, const std::string &email, const std::string &voucherCode, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> webSession(const std::string &authHash, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> checkUpdate(wsnet::UpdateChannel updateChannel, const std::string &appVersion, const std::string &appBuild, const std::string &osVersion, const std::string &osBuild, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> debugLog(const std::string &username, const std::string &strLog, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> speedRating(const std::string &authHash, const std::string &hostname, const std::string &ip, std::int32_t rating, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> staticIps(const std::string &authHash, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> pingTest(std::uint32_t timeoutMs, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> notifications(const std::string &authHash, const std::string &pcpid, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> getRobertFilters(const std::string &authHash, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> setRobertFilter(const std::string &authHash, const std::string &id, std::int32_t status, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> syncRobert(const std::string &authHash, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> myIP(wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> mobileBillingPlans(const std::string &authHash, const std::string &mobilePlanType, const std::string &promo, int version, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> sendPayment(const std::string &authHash, const std::string &appleID, const std::string &appleData, const std::string &appleSIG, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> verifyPayment(const std::string &authHash, const std::string &purchaseToken, const std::string &gpPackageName, const std::string &gpProductId, const std::string &type, const std::string &amazonUserId, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> postBillingCpid(const std::string &authHash, const std::string &payCpid, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> getXpressLoginCode(wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> verifyXpressLoginCode(const std::string &xpressCode, const std::string &sig, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> sendSupportTicket(const std::string &supportEmail, const std::string &supportName, const std::string &supportSubject, const std::string &supportMessage, const std::string &supportCategory, const std::string &type, const std::string &channel, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> regToken(wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> signupUsingToken(const std::string &token, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> claimAccount(const std::string &authHash, const std::string &username, const std::string &password, const std::string &email, const std::string &voucherCode, const std::string &claimAccount, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> shakeData(const std::string &authHash, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> recordShakeForDataScore(const std::string &authHash, const std::string &score, const std::string &signature, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> verifyTvLoginCode(const std::string &authHash, const std::string &xpressCode, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+    std::shared_ptr<wsnet::WSNetCancelableCallback> cancelAccount(const std::string &authHash, const std::string &password, wsnet::WSNetRequestFinishedCallback callback) override { return fail(callback); }
+
+private:
+    std::shared_ptr<wsnet::WSNetCancelableCallback> answer(wsnet::WSNetRequestFinishedCallback callback, const std::string &json)
+    {
+        auto request = std::make_shared<FakeCancelableCallback>();
+        const wsnet::ServerApiRetCode retCode = isFailing ? wsnet::ServerApiRetCode::kNetworkError : wsnet::ServerApiRetCode::kSuccess;
+        QTimer::singleShot(answerDelayMs, [request, callback, retCode, json]() {
+            if (!request->isCanceled)
+                callback(retCode, retCode == wsnet::ServerApiRetCode::kSuccess ? json : std::string());
+        });
+        return request;
+    }
+
+    std::shared_ptr<wsnet::WSNetCancelableCallback> fail(wsnet::WSNetRequestFinishedCallback callback)
+    {
+        auto request = std::make_shared<FakeCancelableCallback>();
+        QTimer::singleShot(0, [request, callback]() {
+            if (!request->isCanceled)
+                callback(wsnet::ServerApiRetCode::kNetworkError, std::string());
+        });
+        return request;
+    }
+};
+
+class FakeConnectStateController : public IConnectStateController
+{
+public:
+    explicit FakeConnectStateController(QObject *parent) : IConnectStateController(parent) {}
+
+    CONNECT_STATE currentState() override { return state_; }
+    CONNECT_STATE prevState() override { return prevState_; }
+    DISCONNECT_REASON disconnectReason() override { return DISCONNECTED_ITSELF; }
+    CONNECT_ERROR connectionError() override { return NO_CONNECT_ERROR; }
+    const LocationID& locationId() override { return location_; }
+
+    void setState(CONNECT_STATE state)
+    {
+        prevState_ = state_;
+        state_ = state;
+        emit stateChanged(state_, DISCONNECTED_ITSELF, NO_CONNECT_ERROR, location_);
+    }
+
+private:
+    CONNECT_STATE state_ = CONNECT_STATE_DISCONNECTED;
+    CONNECT_STATE prevState_ = CONNECT_STATE_DISCONNECTED;
+    LocationID location_;
+};
+
+constexpr int kIdleDelayMs = 20;
+constexpr int kLongExpiryMs = 60 * 1000;
+
+} // namespace
+
+void TestWireGuardConfigCache::initTestCase()
+{
+    // the key-pair is kept in the settings, do not touch the settings of the app
+    QCoreApplication::setOrganizationName("Windscribe");
+    QCoreApplication::setApplicationName("wireguardconfigcache.test");
+}
+
+void TestWireGuardConfigCache::init()
+{
+    GetWireGuardConfig::removeWireGuardSettings();
+}
+
+void TestWireGuardConfigCache::cleanupTestCase()
+{
+    GetWireGuardConfig::removeWireGuardSettings();
+}
+
+void TestWireGuardConfigCache::testPrefetch()
+{
+    auto api = std::make_shared<FakeServerAPI>();
+    FakeConnectStateController stateController(nullptr);
+    WireGuardConfigCache cache(nullptr, &stateController, api, kIdleDelayMs, kLongExpiryMs);
+
+    cache.setHostnames(QStringList() << "node-a" << "node-b");
+    QTRY_COMPARE(api->connectedHostnames, QStringList() << "node-a" << "node-b");
+    // the key-pair is registered once and reused for the next configs
+    QCOMPARE(api->initCount, 1);
+
+    WireGuardConfig config;
+    QTRY_VERIFY(cache.take("node-b", config));
+    QCOMPARE(config.clientIpAddress(), QString("100.64.0.2/32"));
+    QCOMPARE(config.clientPublicKey(), GetWireGuardConfig::storedPublicKey());
+    // a config is used only once
+    QVERIFY(!cache.take("node-b", config));
+    QVERIFY(cache.take("node-a", config));
+    QCOMPARE(config.clientIpAddress(), QString("100.64.0.1/32"));
+
+    // the taken configs are not re-fetched until the next disconnect
+    QTest::qWait(kIdleDelayMs * 5);
+    QCOMPARE(api->connectedHostnames.size(), 2);
+}
+
+void TestWireGuardConfigCache::testNoPrefetchWhileConnected()
+{
+    auto api = std::make_shared<FakeServerAPI>();
+    FakeConnectStateController stateController(nullptr);
+    stateController.setState(CONNECT_STATE_CONNECTED);
+    WireGuardConfigCache cache(nullptr, &stateController, api, kIdleDelayMs, kLongExpiryMs);
+
+    cache.setHostnames(QStringList() << "node-a");
+    QTest::qWait(kIdleDelayMs * 5);
+    QVERIFY(api->connectedHostnames.isEmpty());
+    WireGuardConfig config;
+    QVERIFY(!cache.take("node-a", config));
+
+    stateController.setState(CONNECT_STATE_DISCONNECTED);
+    QTRY_COMPARE(api->connectedHostnames, QStringList() << "node-a");
+
+    // a connect in the middle of a fetch cancels it
+    api->answerDelayMs = 500;
+    cache.setHostnames(QStringList() << "node-a" << "node-b");
+    QTRY_COMPARE(api->connectedHostnames.size(), 2);
+    stateController.setState(CONNECT_STATE_CONNECTING);
+    QTest::qWait(kIdleDelayMs * 5);
+    QVERIFY(cache.take("node-a", config));
+    QVERIFY(!cache.take("node-b", config));
+}
+
+void TestWireGuardConfigCache::testExpiry()
+{
+    constexpr int kExpiryMs = 200;
+    auto api = std::make_shared<FakeServerAPI>();
+    FakeConnectStateController stateController(nullptr);
+    WireGuardConfigCache cache(nullptr, &stateController, api, kIdleDelayMs, kExpiryMs);
+
+    cache.setHostnames(QStringList() << "node-a");
+    QTRY_COMPARE(api->connectedHostnames.size(), 1);
+    QTest::qWait(kExpiryMs + 50);
+
+    WireGuardConfig config;
+    QVERIFY(!cache.take("node-a", config));
+    // the expired configs are not re-fetched while idle
+    QCOMPARE(api->connectedHostnames.size(), 1);
+
+    // but they are after the next disconnect
+    stateController.setState(CONNECT_STATE_CONNECTED);
+    stateController.setState(CONNECT_STATE_DISCONNECTED);
+    QTRY_COMPARE(api->connectedHostnames.size(), 2);
+    QTRY_VERIFY(cache.take("node-a", config));
+}
+
+void TestWireGuardConfigCache::testKeyPairChanged()
+{
+    auto api = std::make_shared<FakeServerAPI>();
+    FakeConnectStateController stateController(nullptr);
+    WireGuardConfigCache cache(nullptr, &stateController, api, kIdleDelayMs, kLongExpiryMs);
+
+    cache.setHostnames(QStringList() << "node-a" << "node-b");
+    QTRY_COMPARE(api->connectedHostnames.size(), 2);
+    QTest::qWait(kIdleDelayMs * 5);
+
+    // e.g. the key-pair was regenerated by a live request after the 1311 error
+    GetWireGuardConfig::removeWireGuardSettings();
+
+    WireGuardConfig config;
+    QVERIFY(!cache.take("node-a", config));
+    // all the configs of the old key-pair are dropped
+    QVERIFY(!cache.take("node-b", config));
+}
+
+void TestWireGuardConfigCache::testClear()
+{
+    auto api = std::make_shared<FakeServerAPI>();
+    FakeConnectStateController stateController(nullptr);
+    WireGuardConfigCache cache(nullptr, &stateController, api, kIdleDelayMs, kLongExpiryMs);
+
+    cache.setHostnames(QStringList() << "node-a");
+    QTRY_COMPARE(api->connectedHostnames.size(), 1);
+    QTest::qWait(kIdleDelayMs * 5);
+
+    cache.clear();
+    WireGuardConfig config;
+    QVERIFY(!cache.take("node-a", config));
+    // the configs are fetched again, e.g. for the new server list
+    QTRY_COMPARE(api->connectedHostnames.size(), 2);
+    QTest::qWait(kIdleDelayMs * 5);
+
+    // a hostname removed from the list is dropped from the cache
+    cache.setHostnames(QStringList() << "node-b");
+    QVERIFY(!cache.take("node-a", config));
+    QTRY_VERIFY(cache.take("node-b", config));
+    QCOMPARE(api->connectedHostnames, QStringList() << "node-a" << "node-a" << "node-b");
+}
+
+void TestWireGuardConfigCache::testFallbackToLiveRequest()
+{
+    auto api = std::make_shared<FakeServerAPI>();
+    FakeConnectStateController stateController(nullptr);
+    WireGuardConfigCache cache(nullptr, &stateController, api, kIdleDelayMs, kLongExpiryMs);
+
+    // the prefetch fails, so there is nothing in the cache
+    api->isFailing = true;
+    cache.setHostnames(QStringList() << "node-a");
+    QTRY_COMPARE(api->initCount, 1);
+    QTest::qWait(kIdleDelayMs * 5);
+    api->isFailing = false;
+
+    WireGuardConfig config;
+    QVERIFY(!cache.take("node-a", config));
+
+    // the connection manager makes a live request then
+    GetWireGuardConfig live(nullptr, api, "authHash");
+    bool isAnswered = false;
+    connect(&live, &GetWireGuardConfig::getWireGuardConfigAnswer, this, [&](WireGuardConfigRetCode retCode, const WireGuardConfig &liveConfig) {
+        QCOMPARE(retCode, WireGuardConfigRetCode::kSuccess);
+        config = liveConfig;
+        isAnswered = true;
+    });
+    stateController.setState(CONNECT_STATE_CONNECTING);
+    live.getWireGuardConfig("node-a", false, QString());
+    QTRY_VERIFY(isAnswered);
+    QCOMPARE(api->connectedHostnames, QStringList() << "node-a");
+    QVERIFY(!config.clientIpAddress().isEmpty());
+}
+
+QTEST_MAIN(TestWireGuardConfigCache)
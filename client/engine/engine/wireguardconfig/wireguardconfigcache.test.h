@@ -0,0 +1,22 @@
+#pragma once
+
+#include <QObject>
+#include <QTest>
+
+// tests for class WireGuardConfigCache, the API requests go to a local fake ServerAPI
+class TestWireGuardConfigCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanupTestCase();
+
+    void testPrefetch();
+    void testNoPrefetchWhileConnected();
+    void testExpiry();
+    void testKeyPairChanged();
+    void testClear();
+    void testFallbackToLiveRequest();
+};
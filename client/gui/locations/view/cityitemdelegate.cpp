@@ -71,7 +71,7 @@ void CityItemDelegate::paint(QPainter *painter, const ItemStyleOption &option, c
 
         // static ip text
         painter->setOpacity(0.5);
-        IndependentPixmap pixmapStaticIp = cache->pixmap(CityItemDelegateCache::kStaticIpId);
+        TextPixmap pixmapStaticIp = cache->pixmap(CityItemDelegateCache::kStaticIpId);
         WS_ASSERT(!pixmapStaticIp.isNull());
         QRect rc( option.rect.width() - pixmapStaticIp.width() - 38*G_SCALE,  option.rect.top(), pixmapStaticIp.width(), option.rect.height());
         pixmapStaticIp.draw(rc.left(), rc.top() + (rc.height() -  pixmapStaticIp.height()) / 2, painter);
@@ -113,7 +113,7 @@ void CityItemDelegate::paint(QPainter *painter, const ItemStyleOption &option, c
 
     // text
     painter->setOpacity(textOpacity);
-    IndependentPixmap pixmapCaption = cache->pixmap(CityItemDelegateCache::kCityId);
+    TextPixmap pixmapCaption = cache->pixmap(CityItemDelegateCache::kCityId);
     WS_ASSERT(!pixmapCaption.isNull());
     QRect rcCaption( left_offs + LOCATION_ITEM_MARGIN * G_SCALE * 4 + LOCATION_ITEM_FLAG_WIDTH * G_SCALE,  option.rect.top(), pixmapCaption.width(), option.rect.height());
     pixmapCaption.draw(rcCaption.left(), rcCaption.top() + (rcCaption.height() -  pixmapCaption.height()) / 2, painter);
@@ -121,7 +121,7 @@ void CityItemDelegate::paint(QPainter *painter, const ItemStyleOption &option, c
     // city text for non-static and non-custom views only
     if (!lid.isStaticIpsLocation() && !lid.isCustomConfigsLocation())
     {
-        IndependentPixmap pixmapNick = cache->pixmap(CityItemDelegateCache::kNickId);
+        TextPixmap pixmapNick = cache->pixmap(CityItemDelegateCache::kNickId);
         WS_ASSERT(!pixmapNick.isNull());
         QRect rc( rcCaption.left() + rcCaption.width() +  8*G_SCALE,  option.rect.top(), pixmapNick.width(), option.rect.height());
         pixmapNick.draw(rc.left(), rc.top() + (rc.height() -  pixmapNick.height()) / 2, painter);
@@ -408,7 +408,7 @@ QRect CityItemDelegate::latencyIconRect(const QRect &itemRect) const
 QRect CityItemDelegate::captionRect(const QRect &itemRect, const IItemCacheData *cacheData) const
 {
     const CityItemDelegateCache *cache = static_cast<const CityItemDelegateCache *>(cacheData);
-    IndependentPixmap pixmapCaption = cache->pixmap(CityItemDelegateCache::kCityId);
+    TextPixmap pixmapCaption = cache->pixmap(CityItemDelegateCache::kCityId);
     return QRect(itemRect.left() + LOCATION_ITEM_MARGIN * G_SCALE * 4 + LOCATION_ITEM_FLAG_WIDTH * G_SCALE,
                  itemRect.top() + (itemRect.height() - pixmapCaption.height()) / 2,
                  pixmapCaption.width(), pixmapCaption.height());
@@ -59,7 +59,7 @@ void CountryItemDelegate::paint(QPainter *painter, const ItemStyleOption &option
     painter->setOpacity(textOpacity );
     QRect rc = option.rect;
     rc.adjust(64*G_SCALE, 0, 0, 0);
-    IndependentPixmap pixmap = cache->pixmap(CountryItemDelegateCache::kCaptionId);
+    TextPixmap pixmap = cache->pixmap(CountryItemDelegateCache::kCaptionId);
     pixmap.draw(rc.left(), rc.top() + (rc.height() - pixmap.height()) / 2, painter);
 
     // p2p icon
@@ -5,11 +5,13 @@
 #include <QMouseEvent>
 #include <QPainter>
 #include <QRegion>
+#include <algorithm>
 
 #include "dpiscalemanager.h"
 #include "locations/locationsmodel_roles.h"
 #include "clickableandtooltiprects.h"
 #include "commongraphics/commongraphics.h"
+#include "textpixmapcache.h"
 
 namespace gui_locations {
 
@@ -24,12 +26,17 @@ ExpandableItemsWidget::ExpandableItemsWidget(QWidget *parent, QAbstractItemModel
   , nonexpandableItemDelegate_(nullptr)
   , bMousePressed_(false)
   , mousePressedClickableId_(-1)
+  , pixmapCache_(kMaxPixmapCacheCost)
 {
     setMouseTracking(true);
     setModel(model);
 
     connect(&expandingAnimation_, &QVariantAnimation::valueChanged, this, &ExpandableItemsWidget::onExpandingAnimationValueChanged);
     connect(&expandingAnimation_, &QVariantAnimation::finished, this, &ExpandableItemsWidget::onExpandingAnimationFinished);
+
+    visibleLocationsTimer_.setSingleShot(true);
+    visibleLocationsTimer_.setInterval(kVisibleLocationsPeriod);
+    connect(&visibleLocationsTimer_, &QTimer::timeout, this, &ExpandableItemsWidget::onVisibleLocationsTimer);
 }
 
 ExpandableItemsWidget::~ExpandableItemsWidget()
@@ -86,14 +93,15 @@ void ExpandableItemsWidget::setModel(QAbstractItemModel *model)
             return;
         }
         WS_ASSERT(topLeft.parent() == bottomRight.parent());
-        // update cache data
+        // update cache data and repaint only the changed rows
         for (int i = topLeft.row(); i <= bottomRight.row(); ++i) {
             QPersistentModelIndex mi = model_->index(i, 0, topLeft.parent());
             WS_ASSERT(mi.isValid());
             WS_ASSERT(itemsCacheData_.contains(mi));
             delegateForItem(mi)->updateCacheData(mi, itemsCacheData_[mi].get());
+            pixmapCache_.remove(mi);
+            updateItem(mi);
         }
-        update();
     });
 
     connect(model_, &QAbstractItemModel::layoutChanged, [this]() {
@@ -134,12 +142,14 @@ void ExpandableItemsWidget::setItemHeight(int height)
 void ExpandableItemsWidget::setShowLatencyInMs(bool isShowLatencyInMs)
 {
     isShowLatencyInMs_ = isShowLatencyInMs;
+    pixmapCache_.clear();
     update();
 }
 
 void ExpandableItemsWidget::setShowLocationLoad(bool isShowLocationLoad)
 {
     isShowLocationLoad_ = isShowLocationLoad;
+    pixmapCache_.clear();
     update();
 }
 
@@ -150,8 +160,10 @@ void ExpandableItemsWidget::updateSelectedItemByCursorPos()
     if (sel != selectedInd_)
     {
         // close tooltips for prev selected item
-        if (selectedInd_.isValid())
+        if (selectedInd_.isValid()) {
             closeAndClearAllActiveTooltips(selectedInd_);
+            updateItem(selectedInd_);
+        }
 
         selectedInd_ = sel;
         if (selectedInd_.isValid() && delegateForItem(selectedInd_)->isForbiddenCursor(selectedInd_))
@@ -163,7 +175,7 @@ void ExpandableItemsWidget::updateSelectedItemByCursorPos()
             cursorUpdateHelper_->setPointingHandCursor();
         }
 
-        update();
+        updateItem(selectedInd_);
     }
 
     // update tooltips
@@ -198,7 +210,7 @@ int ExpandableItemsWidget::selectItemByOffs(int offs)
     if (!selectedInd_.isValid()) {
         if (items_.count() > 0) {
             selectedInd_ = items_[0];
-            update();
+            updateItem(selectedInd_);
         }
     } else {
         QVector<ItemRect> items = getItemRects();
@@ -210,13 +222,14 @@ int ExpandableItemsWidget::selectItemByOffs(int offs)
             int newSelectedItemInd = it - items.begin()  + offs;
             newSelectedItemInd = qMin(newSelectedItemInd, items.count() - 1);
             newSelectedItemInd = qMax(newSelectedItemInd, 0);
+            updateItem(selectedInd_);
             selectedInd_ = items[newSelectedItemInd].modelIndex;
             if (selectedInd_.isValid() && delegateForItem(selectedInd_)->isForbiddenCursor(selectedInd_)) {
                 cursorUpdateHelper_->setForbiddenCursor();
             } else {
                 cursorUpdateHelper_->setPointingHandCursor();
             }
-            update();
+            updateItem(selectedInd_);
             return newSelectedItemInd * itemHeight_;
         }
     }
@@ -269,6 +282,9 @@ void ExpandableItemsWidget::updateScaling()
     }
 
     itemsCacheData_.clear();
+    pixmapCache_.clear();
+    // the texts of the previous scale are no longer needed, the new ones are rendered on the first paint
+    TextPixmapCache::instance().clear();
     for (int i = 0, rows_cnt = model_->rowCount(); i < rows_cnt; ++i) {
         QModelIndex mi = model_->index(i, 0);
         itemsCacheData_[mi] = QSharedPointer<IItemCacheData>(delegateForItem(mi)->createCacheData(mi));
@@ -280,20 +296,38 @@ void ExpandableItemsWidget::updateScaling()
 void ExpandableItemsWidget::paintEvent(QPaintEvent *event)
 {
     QPainter painter(this);
-    QVector<ItemRect> items = getItemRects();
+    // only the items in the exposed rect are visited
+    QVector<ItemRect> items = getItemRects(event->rect().top(), event->rect().bottom() + 1);
     for (const auto &item : qAsConst(items)) {
-        IItemDelegate *delegate = delegateForItem(item.modelIndex);
         double expandedProgress;
         if (item.modelIndex == expandingItem_)
             expandedProgress = (double)expandingCurrentHeight_ / (double)expandingAnimation_.endValue().toInt();
         else
             expandedProgress = item.isExpanded ? 1.0 : 0.0;
 
-        if (item.rc.intersects(event->rect())) {
-            QRect fullItemRect(item.rc.left(), item.rc.top(), item.rc.width(), itemHeight_);
-            ItemStyleOption opt(this, fullItemRect, item.modelIndex == selectedInd_ ? 1.0 : 0.0, expandedProgress, isShowLocationLoad_, isShowLatencyInMs_);
-            delegate->paint(&painter, opt, item.modelIndex, itemsCacheData_[item.modelIndex].get());
-        }
+        paintItem(&painter, item, expandedProgress);
+    }
+
+    // scrolling, expanding and model changes all end up here
+    if (!visibleLocationsTimer_.isActive())
+        visibleLocationsTimer_.start();
+}
+
+void ExpandableItemsWidget::onVisibleLocationsTimer()
+{
+    if (!isVisible())
+        return;
+
+    const QRect rc = visibleRegion().boundingRect();
+    QVector<LocationID> locations;
+    if (!rc.isEmpty()) {
+        const QVector<ItemRect> items = getItemRects(rc.top(), rc.bottom() + 1);
+        for (const auto &item : items)
+            locations << qvariant_cast<LocationID>(item.modelIndex.data(gui_locations::kLocationId));
+    }
+    if (visibleLocations_ != locations) {
+        visibleLocations_ = locations;
+        emit visibleLocationsChanged(visibleLocations_);
     }
 }
 
@@ -378,7 +412,13 @@ void ExpandableItemsWidget::onExpandingAnimationValueChanged(const QVariant &val
 {
     expandingCurrentHeight_ = value.toInt();
     updateHeight();
-    update();
+    // the items above the expanding item do not move, so repaint from it to the bottom only
+    if (expandingItem_.isValid()) {
+        const QRect rc = itemRect(expandingItem_);
+        update(0, rc.top(), width(), height() - rc.top());
+    } else {
+        update();
+    }
 }
 
 void ExpandableItemsWidget::onExpandingAnimationFinished()
@@ -399,6 +439,7 @@ void ExpandableItemsWidget::resetItemsList()
 
     items_.clear();
     itemsCacheData_.clear();
+    pixmapCache_.clear();
     expandedItems_.clear();
     for (int i = 0, rows_cnt = model_->rowCount(); i < rows_cnt; ++i)
     {
@@ -415,7 +456,7 @@ void ExpandableItemsWidget::resetItemsList()
 
 QPersistentModelIndex ExpandableItemsWidget::detectSelectedItem(const QPoint &pt, QRect *outputRect)
 {
-    QVector<ItemRect> items = getItemRects();
+    QVector<ItemRect> items = getItemRects(pt.y(), pt.y() + 1);
     for (const auto &item : qAsConst(items)) {
         if (item.rc.contains(pt)) {
             if (outputRect) {
@@ -444,8 +485,11 @@ bool ExpandableItemsWidget::isExpandableItem(const QPersistentModelIndex &ind)
 
 void ExpandableItemsWidget::updateHeight()
 {
+    topLevelOffsets_.resize(items_.count() + 1);
     int curHeight = 0;
-    for (const auto &it : qAsConst(items_)) {
+    for (int i = 0, cnt = items_.count(); i < cnt; ++i) {
+        const QPersistentModelIndex &it = items_[i];
+        topLevelOffsets_[i] = curHeight;
         curHeight += itemHeight_;
         if (expandedItems_.contains(it)) {
             if (it == expandingItem_)
@@ -454,6 +498,7 @@ void ExpandableItemsWidget::updateHeight()
                 curHeight += calcHeightOfChildItems(it);
         }
     }
+    topLevelOffsets_[items_.count()] = curHeight;
     resize(size().width(), curHeight);
 
     if (curHeight == 0) {
@@ -476,14 +521,9 @@ int ExpandableItemsWidget::calcHeightOfChildItems(const QPersistentModelIndex &i
 
 int ExpandableItemsWidget::getOffsForTopLevelItem(const QPersistentModelIndex &ind)
 {
-    int top = 0;
-    for (const auto &it : qAsConst(items_)) {
-        if (it == ind)
-            return top;
-        top += itemHeight_;
-        if (expandedItems_.contains(it))
-            top += model_->rowCount(it) * itemHeight_;
-    }
+    const int row = ind.row();
+    if (row >= 0 && row < items_.count() && items_[row] == ind)
+        return topLevelOffsets_[row];
     WS_ASSERT(false);
     return 0;
 }
@@ -591,6 +631,12 @@ void ExpandableItemsWidget::removeCacheDataForInvalidIndexes()
         else
             ++it;
     }
+
+    const auto keys = pixmapCache_.keys();
+    for (const auto &key : keys) {
+        if (!key.isValid())
+            pixmapCache_.remove(key);
+    }
 }
 
 void ExpandableItemsWidget::debugAssertCheckInternalData()
@@ -663,43 +709,117 @@ void ExpandableItemsWidget::expandItem(const QPersistentModelIndex &ind)
     }
 }
 
-QVector<ExpandableItemsWidget::ItemRect> ExpandableItemsWidget::getItemRects()
+QVector<ExpandableItemsWidget::ItemRect> ExpandableItemsWidget::getItemRects(int top, int bottom)
 {
     QVector<ItemRect> result;
-    result.reserve(items_.count() * 3);
-    int top = 0;
-
-    for (const auto &it : qAsConst(items_)) {
+    const int first = topLevelBlockAt(qMax(top, 0));
+    if (first == -1)
+        return result;
+
+    for (int i = first, cnt = items_.count(); i < cnt && topLevelOffsets_[i] < bottom; ++i) {
+        const QPersistentModelIndex &it = items_[i];
+        const int blockTop = topLevelOffsets_[i];
+        const int blockBottom = topLevelOffsets_[i + 1];
         bool isExpandedItem = expandedItems_.contains(it);
-        QRect rcItem = QRect(0, top, size().width(), itemHeight_);
-        result << ItemRect{it, rcItem, isExpandedItem};
-        top += itemHeight_;
+        if (blockTop + itemHeight_ > top)
+            result << ItemRect{it, QRect(0, blockTop, size().width(), itemHeight_), isExpandedItem};
 
         if (isExpandedItem) {
-            int childsCount = it.model()->rowCount(it);
-            int expandedHeight = (it == expandingItem_) ? expandingCurrentHeight_:  childsCount * itemHeight_;
-
-            for (int row = 0; row < childsCount; row++)
-            {
-                QModelIndex childInd = it.model()->index(row, 0, it);
-                int curItemHeight = expandedHeight >= itemHeight_ ? itemHeight_ : expandedHeight;
-                if (curItemHeight == 0)
-                    break;
-
-                QRect rcChildItem(0, top, size().width(), curItemHeight);
-                result << ItemRect{childInd, rcChildItem, false};
-
-                top += curItemHeight;
-                expandedHeight -= curItemHeight;
-                if (expandedHeight == 0)
+            // all the children have the same height, except the last visible one during the expanding animation
+            const int childsTop = blockTop + itemHeight_;
+            const int childsCount = it.model()->rowCount(it);
+            int row = top > childsTop ? (top - childsTop) / itemHeight_ : 0;
+            for (; row < childsCount; ++row) {
+                const int childTop = childsTop + row * itemHeight_;
+                if (childTop >= blockBottom || childTop >= bottom)
                     break;
-                if (expandedHeight < 0)
-                    WS_ASSERT(false);
+                const int curItemHeight = qMin(itemHeight_, blockBottom - childTop);
+                QRect rcChildItem(0, childTop, size().width(), curItemHeight);
+                result << ItemRect{it.model()->index(row, 0, it), rcChildItem, false};
             }
         }
     }
     return result;
 }
 
+int ExpandableItemsWidget::topLevelBlockAt(int y) const
+{
+    if (items_.isEmpty() || topLevelOffsets_.count() != items_.count() + 1 || y >= topLevelOffsets_.last())
+        return -1;
+    // first offset greater than y, the block containing y is the previous one
+    auto it = std::upper_bound(topLevelOffsets_.begin(), topLevelOffsets_.end(), y);
+    return qMax(0, static_cast<int>(it - topLevelOffsets_.begin()) - 1);
+}
+
+QRect ExpandableItemsWidget::itemRect(const QPersistentModelIndex &ind) const
+{
+    if (!ind.isValid() || topLevelOffsets_.count() != items_.count() + 1)
+        return QRect();
+
+    const QModelIndex parentInd = ind.parent();
+    if (!parentInd.isValid()) {
+        const int row = ind.row();
+        if (row >= items_.count() || items_[row] != ind)
+            return QRect();
+        return QRect(0, topLevelOffsets_[row], size().width(), itemHeight_);
+    }
+
+    const int parentRow = parentInd.row();
+    if (parentRow >= items_.count() || !expandedItems_.contains(items_[parentRow]))
+        return QRect();
+    const int top = topLevelOffsets_[parentRow] + itemHeight_ * (ind.row() + 1);
+    const int blockBottom = topLevelOffsets_[parentRow + 1];
+    if (top >= blockBottom)
+        return QRect();
+    return QRect(0, top, size().width(), qMin(itemHeight_, blockBottom - top));
+}
+
+void ExpandableItemsWidget::updateItem(const QPersistentModelIndex &ind)
+{
+    if (!ind.isValid())
+        return;
+    const QRect rc = itemRect(ind);
+    if (!rc.isEmpty())
+        update(rc);
+}
+
+void ExpandableItemsWidget::paintItem(QPainter *painter, const ItemRect &item, double expandedProgress)
+{
+    IItemDelegate *delegate = delegateForItem(item.modelIndex);
+    const IItemCacheData *cacheData = itemsCacheData_[item.modelIndex].get();
+    const bool isSelected = (item.modelIndex == selectedInd_);
+    const QSize itemSize(item.rc.width(), itemHeight_);
+
+    // the selected and the animated items change every frame, no need to cache them
+    if (isSelected || item.modelIndex == expandingItem_ || itemSize.isEmpty()) {
+        QRect fullItemRect(item.rc.left(), item.rc.top(), item.rc.width(), itemHeight_);
+        ItemStyleOption opt(this, fullItemRect, isSelected ? 1.0 : 0.0, expandedProgress, isShowLocationLoad_, isShowLatencyInMs_);
+        delegate->paint(painter, opt, item.modelIndex, cacheData);
+        return;
+    }
+
+    ItemPixmap *cached = pixmapCache_.object(item.modelIndex);
+    if (!cached || cached->size != itemSize || cached->isExpanded != item.isExpanded) {
+        const qreal dpr = devicePixelRatioF();
+        QPixmap pixmap(itemSize * dpr);
+        pixmap.setDevicePixelRatio(dpr);
+        pixmap.fill(Qt::transparent);
+        {
+            QPainter pixmapPainter(&pixmap);
+            ItemStyleOption opt(this, QRect(QPoint(0, 0), itemSize), 0.0, expandedProgress, isShowLocationLoad_, isShowLatencyInMs_);
+            delegate->paint(&pixmapPainter, opt, item.modelIndex, cacheData);
+        }
+        const int cost = pixmap.width() * pixmap.height() * pixmap.depth() / 8;
+        cached = new ItemPixmap{pixmap, itemSize, item.isExpanded};
+        if (!pixmapCache_.insert(item.modelIndex, cached, cost)) {
+            // QCache has already deleted the object
+            ItemStyleOption opt(this, QRect(item.rc.topLeft(), itemSize), 0.0, expandedProgress, isShowLocationLoad_, isShowLatencyInMs_);
+            delegate->paint(painter, opt, item.modelIndex, cacheData);
+            return;
+        }
+    }
+    painter->drawPixmap(item.rc.topLeft(), cached->pixmap);
+}
+
 } // namespace gui_locations
 
@@ -2,7 +2,10 @@
 
 #include <QWidget>
 #include <QAbstractItemModel>
+#include <QCache>
+#include <QPixmap>
 #include <QSet>
+#include <QTimer>
 #include <QVariantAnimation>
 #include "iitemdelegate.h"
 #include "cursorupdatehelper.h"
@@ -12,6 +15,9 @@ namespace gui_locations {
 
 // widget where items of QAbstractItemModel are drawn, supports animated expansion
 // supports tree with one level of children or list
+// painting is incremental: only the items intersecting the exposed rect are visited (found via a prefix-sum
+// index of the top-level item offsets), changes of a single item repaint only its row,
+// and the rendered items are kept in a pixmap cache which is invalidated per item
 class ExpandableItemsWidget : public QWidget
 {
     Q_OBJECT
@@ -57,12 +63,18 @@ signals:
     // the expanding items should be visible so send this signal to LocationsView to update the scroll position.
     void expandingAnimationStarted(int top, int height);
 
+    // the locations in the visible part of the widget, at most once per kVisibleLocationsPeriod after a repaint
+    void visibleLocationsChanged(const QVector<LocationID> &locations);
+
 private slots:
     void onExpandingAnimationValueChanged(const QVariant &value);
     void onExpandingAnimationFinished();
+    void onVisibleLocationsTimer();
 
 private:
     static constexpr int kExpandingAnimationDuration = 200;
+    static constexpr int kMaxPixmapCacheCost = 32 * 1024 * 1024;  // in bytes
+    static constexpr int kVisibleLocationsPeriod = 500;
     QScopedPointer<CursorUpdateHelper> cursorUpdateHelper_;
 
     bool isEmptyList_;
@@ -94,6 +106,21 @@ private:
 
     QSet<int> hoveringToolTips_;
 
+    // topLevelOffsets_[i] is the top of items_[i] (the item itself plus its visible children make a block),
+    // the last element is the total height; rebuilt in updateHeight()
+    QVector<int> topLevelOffsets_;
+
+    // rendered item in a steady state (not selected, not animated)
+    struct ItemPixmap {
+        QPixmap pixmap;
+        QSize size;
+        bool isExpanded;
+    };
+    QCache<QPersistentModelIndex, ItemPixmap> pixmapCache_;
+
+    QTimer visibleLocationsTimer_;
+    QVector<LocationID> visibleLocations_;
+
     struct ItemRect {
         QPersistentModelIndex modelIndex;
         QRect rc;
@@ -120,7 +147,13 @@ private:
     void debugAssertCheckInternalData();   // for debug purposes
     void stopExpandingAnimation();
     void expandItem(const QPersistentModelIndex &ind);
-    QVector<ItemRect> getItemRects();
+    // returns the rects of the items intersecting the vertical range [top, bottom)
+    QVector<ItemRect> getItemRects(int top = 0, int bottom = INT_MAX);
+    // returns the index in items_ of the top-level block containing the y coordinate or -1
+    int topLevelBlockAt(int y) const;
+    QRect itemRect(const QPersistentModelIndex &ind) const;
+    void updateItem(const QPersistentModelIndex &ind);
+    void paintItem(QPainter *painter, const ItemRect &item, double expandedProgress);
 };
 
 } // namespace gui_locations
@@ -53,6 +53,7 @@ LocationsView::LocationsView(QWidget *parent, QAbstractItemModel *model) : QScro
     connect(widget_, &ExpandableItemsWidget::clickedOnPremiumStarCity, [this]() {
         emit clickedOnPremiumStarCity();
     });
+    connect(widget_, &ExpandableItemsWidget::visibleLocationsChanged, this, &LocationsView::visibleLocationsChanged);
 }
 
 LocationsView::~LocationsView()
@@ -40,6 +40,7 @@ signals:
     void selected(const LocationID &lid);
     void clickedOnPremiumStarCity();
     void emptyListStateChanged(bool isEmptyList);
+    void visibleLocationsChanged(const QVector<LocationID> &locations);
 
 private slots:
     void onScrollBarActionTriggered(int action);
@@ -3,23 +3,15 @@
 
 namespace gui_locations {
 
-TextPixmap::TextPixmap(const QString &text, const QFont &font, qreal devicePixelRatio) : text_(text)
+TextPixmap::TextPixmap(const QString &text, const QFont &font, qreal devicePixelRatio)
+    : entry_(TextPixmapCache::instance().get(text, font, devicePixelRatio))
 {
-    if (!text.isEmpty())
-    {
-        QFontMetrics fm(font);
-        QRect rcText = fm.boundingRect(text);
-        QPixmap pixmap(fm.horizontalAdvance(text)*devicePixelRatio, rcText.height()*devicePixelRatio);
-        pixmap.setDevicePixelRatio(devicePixelRatio);
-        pixmap.fill(Qt::transparent);
-        {
-            QPainter painter(&pixmap);
-            painter.setPen(Qt::white);      // for current needs, we use only white color
-            painter.setFont(font);
-            painter.drawText(QRect(0, 0, fm.horizontalAdvance(text), rcText.height()), Qt::AlignLeft, text);
-        }
-        pixmap_ = IndependentPixmap(pixmap);
-    }
+}
+
+void TextPixmap::draw(int x, int y, QPainter *painter) const
+{
+    if (entry_)
+        TextPixmapCache::instance().draw(entry_, x, y, painter);
 }
 
 void TextPixmaps::add(int id, const QString &text, const QFont &font, qreal devicePixelRatio)
@@ -41,10 +33,10 @@ void TextPixmaps::updateIfTextChanged(int id, const QString &text, const QFont &
     }
 }
 
-IndependentPixmap TextPixmaps::pixmap(int id) const
+TextPixmap TextPixmaps::pixmap(int id) const
 {
     WS_ASSERT(pixmaps_.contains(id));
-    return pixmaps_[id].pixmap();
+    return pixmaps_[id];
 }
 
 } // namespace gui_locations
@@ -1,26 +1,30 @@
 #pragma once
 
-#include "textpixmap.h"
-#include "graphicresources/independentpixmap.h"
+#include "textpixmapcache.h"
 
 #include <QHash>
 
 namespace gui_locations {
 
-// Util class: convert the text to QPixmap to speed up subsequent drawings
+// Util class: a text rendered to a pixmap to speed up subsequent drawings
 // The reason for this is that drawing text is quite slow and it speeds up significantly
+// The pixmap itself is a region of the shared TextPixmapCache atlas, it is rendered on the first draw.
 // todo: move to common utils?
 class TextPixmap
 {
 public:
     TextPixmap() {}
     explicit TextPixmap(const QString &text, const QFont &font, qreal devicePixelRatio);
-    IndependentPixmap pixmap() const { return pixmap_; }
-    QString text() const { return text_; }
+
+    bool isNull() const { return entry_.isNull(); }
+    int width() const { return entry_ ? entry_->size.width() : 0; }
+    int height() const { return entry_ ? entry_->size.height() : 0; }
+    void draw(int x, int y, QPainter *painter) const;
+
+    QString text() const { return entry_ ? entry_->text : QString(); }
 
 private:
-    IndependentPixmap pixmap_;
-    QString text_;
+    QSharedPointer<TextPixmapCache::Entry> entry_;
 };
 
 // convenient for managing multiple text pixmaps
@@ -30,7 +34,7 @@ public:
     TextPixmaps() {}
     void add(int id, const QString &text, const QFont &font, qreal devicePixelRatio);
     void updateIfTextChanged(int id, const QString &text, const QFont &font, qreal devicePixelRatio);
-    IndependentPixmap pixmap(int id) const;
+    TextPixmap pixmap(int id) const;
 
 private:
     QHash<int, TextPixmap> pixmaps_;
@@ -38,4 +42,3 @@ private:
 
 
 } // namespace gui_locations
-
@@ -0,0 +1,166 @@
+#include "textpixmapcache.h"
+#include <QFontMetrics>
+#include <algorithm>
+
+namespace gui_locations {
+
+QSharedPointer<TextPixmapCache::Entry> TextPixmapCache::get(const QString &text, const QFont &font, qreal devicePixelRatio)
+{
+    if (text.isEmpty())
+        return QSharedPointer<Entry>();
+
+    const Key key { text, font.key(), devicePixelRatio };
+    auto it = entries_.constFind(key);
+    if (it != entries_.constEnd()) {
+        QSharedPointer<Entry> entry = it.value().toStrongRef();
+        if (entry)
+            return entry;
+    }
+
+    QSharedPointer<Entry> entry(new Entry);
+    entry->text = text;
+    entry->font = font;
+    entry->devicePixelRatio = devicePixelRatio;
+    QFontMetrics fm(font);
+    entry->size = QSize(fm.horizontalAdvance(text), fm.boundingRect(text).height());
+    entry->deviceSize = QSize(entry->size.width() * devicePixelRatio, entry->size.height() * devicePixelRatio);
+    entries_[key] = entry;
+
+    if (entries_.size() >= expiredCheckSize_) {
+        removeExpiredEntries();
+        expiredCheckSize_ = qMax(kMinExpiredCheckSize, (int)entries_.size() * 2);
+    }
+    return entry;
+}
+
+void TextPixmapCache::draw(const QSharedPointer<Entry> &entry, int x, int y, QPainter *painter)
+{
+    if (entry->page == -1 && entry->ownPixmap.isNull())
+        render(entry);
+
+    const QRectF target(x, y, entry->deviceSize.width() / entry->devicePixelRatio, entry->deviceSize.height() / entry->devicePixelRatio);
+    if (!entry->ownPixmap.isNull()) {
+        painter->drawPixmap(target, entry->ownPixmap, QRectF(entry->ownPixmap.rect()));
+    } else if (entry->page != -1) {
+        Page &page = pages_[entry->page];
+        page.lastUsed = ++tick_;
+        painter->drawPixmap(target, page.pixmap, QRectF(entry->rect));
+    }
+}
+
+void TextPixmapCache::clear()
+{
+    for (const auto &weakEntry : std::as_const(entries_)) {
+        QSharedPointer<Entry> entry = weakEntry.toStrongRef();
+        if (entry) {
+            entry->page = -1;
+            entry->ownPixmap = QPixmap();
+        }
+    }
+    pages_.clear();
+    removeExpiredEntries();
+}
+
+void TextPixmapCache::render(const QSharedPointer<Entry> &entry)
+{
+    if (entry->deviceSize.isEmpty())
+        return;
+
+    int ind = -1;
+    QRect rect;
+    if (entry->deviceSize.width() + kPadding <= kPageSize && entry->deviceSize.height() + kPadding <= kPageSize) {
+        for (int i = 0; i < pages_.size() && ind == -1; ++i) {
+            if (allocate(pages_[i], entry->deviceSize, rect))
+                ind = i;
+        }
+        if (ind == -1) {
+            if (pages_.size() < kMaxPages) {
+                Page page;
+                page.pixmap = QPixmap(kPageSize, kPageSize);
+                page.pixmap.fill(Qt::transparent);
+                pages_ << page;
+                ind = pages_.size() - 1;
+            } else {
+                ind = std::min_element(pages_.cbegin(), pages_.cend(), [](const Page &a, const Page &b) { return a.lastUsed < b.lastUsed; }) - pages_.cbegin();
+                resetPage(ind);
+            }
+            allocate(pages_[ind], entry->deviceSize, rect);
+        }
+    }
+
+    QPixmap *pixmap;
+    QPoint origin;
+    if (ind != -1) {
+        entry->page = ind;
+        entry->rect = rect;
+        pages_[ind].entries << entry;
+        pixmap = &pages_[ind].pixmap;
+        origin = rect.topLeft();
+    } else {
+        // too large for the atlas, a rare case
+        entry->ownPixmap = QPixmap(entry->deviceSize);
+        entry->ownPixmap.fill(Qt::transparent);
+        pixmap = &entry->ownPixmap;
+    }
+
+    QPainter painter(pixmap);
+    painter.setClipRect(QRect(origin, entry->deviceSize));
+    painter.translate(origin);
+    painter.scale(entry->devicePixelRatio, entry->devicePixelRatio);
+    painter.setPen(Qt::white);      // for current needs, we use only white color
+    painter.setFont(entry->font);
+    painter.drawText(QRect(QPoint(0, 0), entry->size), Qt::AlignLeft, entry->text);
+}
+
+bool TextPixmapCache::allocate(Page &page, const QSize &size, QRect &rect)
+{
+    const int width = size.width() + kPadding;
+    const int height = size.height() + kPadding;
+
+    // the lowest shelf that fits, but not much higher than the text
+    Shelf *best = nullptr;
+    for (Shelf &shelf : page.shelves) {
+        if (shelf.height >= height && shelf.height <= height + height / 2 && shelf.width + width <= kPageSize &&
+            (!best || shelf.height < best->height)) {
+            best = &shelf;
+        }
+    }
+    if (!best) {
+        const int top = page.shelves.isEmpty() ? 0 : page.shelves.last().top + page.shelves.last().height;
+        if (top + height > kPageSize)
+            return false;
+        page.shelves << Shelf { top, height, 0 };
+        best = &page.shelves.last();
+    }
+
+    rect = QRect(QPoint(best->width, best->top), size);
+    best->width += width;
+    return true;
+}
+
+void TextPixmapCache::resetPage(int ind)
+{
+    Page &page = pages_[ind];
+    for (const auto &weakEntry : std::as_const(page.entries)) {
+        QSharedPointer<Entry> entry = weakEntry.toStrongRef();
+        if (entry && entry->page == ind)
+            entry->page = -1;
+    }
+    page.entries.clear();
+    page.shelves.clear();
+    page.pixmap.fill(Qt::transparent);
+    page.lastUsed = 0;
+    removeExpiredEntries();
+}
+
+void TextPixmapCache::removeExpiredEntries()
+{
+    for (auto it = entries_.begin(); it != entries_.end(); ) {
+        if (it.value().isNull())
+            it = entries_.erase(it);
+        else
+            ++it;
+    }
+}
+
+} // namespace gui_locations
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <QFont>
+#include <QHash>
+#include <QPainter>
+#include <QPixmap>
+#include <QSharedPointer>
+#include <QVector>
+#include <QWeakPointer>
+
+namespace gui_locations {
+
+// Shared cache of the rendered texts for the location items, keyed by (text, font, DPR).
+// The texts are rendered lazily on the first draw and packed into a few atlas pages (shelf packing),
+// instead of a separate QPixmap for each item. The memory is bounded by kMaxPages: when there is no room left,
+// the least recently drawn page is cleared and its texts are re-rendered on their next draw.
+// Must be used in the GUI thread only.
+class TextPixmapCache
+{
+public:
+    struct Entry
+    {
+        QString text;
+        QFont font;
+        qreal devicePixelRatio;
+        QSize size;             // logical
+        QSize deviceSize;
+        int page = -1;          // -1 if not rendered yet or evicted
+        QRect rect;             // in the page, device pixels
+        QPixmap ownPixmap;      // for the texts that are too large for a page
+    };
+
+    static TextPixmapCache &instance()
+    {
+        static TextPixmapCache tpc;
+        return tpc;
+    }
+
+    QSharedPointer<Entry> get(const QString &text, const QFont &font, qreal devicePixelRatio);
+    void draw(const QSharedPointer<Entry> &entry, int x, int y, QPainter *painter);
+    void clear();
+
+private:
+    static constexpr int kPageSize = 1024;     // device pixels, 4 MB per page
+    static constexpr int kMaxPages = 8;
+    static constexpr int kPadding = 1;         // so that the neighbours do not bleed in with smooth scaling
+    static constexpr int kMinExpiredCheckSize = 1024;
+
+    struct Key
+    {
+        QString text;
+        QString fontKey;
+        qreal devicePixelRatio;
+        bool operator==(const Key &other) const
+        {
+            return text == other.text && fontKey == other.fontKey && devicePixelRatio == other.devicePixelRatio;
+        }
+        friend size_t qHash(const Key &key, size_t seed = 0)
+        {
+            return qHashMulti(seed, key.text, key.fontKey, key.devicePixelRatio);
+        }
+    };
+
+    struct Shelf
+    {
+        int top;
+        int height;
+        int width;      // used
+    };
+
+    struct Page
+    {
+        QPixmap pixmap;
+        QVector<Shelf> shelves;
+        QVector<QWeakPointer<Entry>> entries;
+        quint64 lastUsed = 0;
+    };
+
+    QHash<Key, QWeakPointer<Entry>> entries_;
+    QVector<Page> pages_;
+    quint64 tick_ = 0;
+    int expiredCheckSize_ = kMinExpiredCheckSize;     // the weak references of the released texts are removed when the hash grows to this size
+
+    TextPixmapCache() {}
+    void render(const QSharedPointer<Entry> &entry);
+    bool allocate(Page &page, const QSize &size, QRect &rect);
+    void resetPage(int ind);
+    void removeExpiredEntries();
+};
+
+} // namespace gui_locations
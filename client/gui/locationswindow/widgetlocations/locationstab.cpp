@@ -75,6 +75,7 @@ LocationsTab::LocationsTab(QWidget *parent, Preferences *preferences, gui_locati
     gui_locations::LocationsView *viewAllLocations = new gui_locations::LocationsView(this, locationsModelManager->sortedLocationsProxyModel());
     connect(viewAllLocations, &gui_locations::LocationsView::selected, this, &LocationsTab::onLocationSelected);
     connect(viewAllLocations, &gui_locations::LocationsView::clickedOnPremiumStarCity, this, &LocationsTab::onClickedOnPremiumStarCity);
+    connect(viewAllLocations, &gui_locations::LocationsView::visibleLocationsChanged, locationsModelManager, &gui_locations::LocationsModelManager::setVisibleLocations);
     EmptyListWidget *emptyListWidgetAllLocations = new EmptyListWidget(this);
     widgetAllLocations_ = new WidgetSwitcher(this, viewAllLocations, emptyListWidgetAllLocations);
 
@@ -82,6 +83,7 @@ LocationsTab::LocationsTab(QWidget *parent, Preferences *preferences, gui_locati
     gui_locations::LocationsView * viewConfiguredLocations = new gui_locations::LocationsView(this, locationsModelManager->customConfigsProxyModel());
     connect(viewConfiguredLocations, &gui_locations::LocationsView::selected, this, &LocationsTab::onLocationSelected);
     connect(viewConfiguredLocations, &gui_locations::LocationsView::clickedOnPremiumStarCity, this, &LocationsTab::onClickedOnPremiumStarCity);
+    connect(viewConfiguredLocations, &gui_locations::LocationsView::visibleLocationsChanged, locationsModelManager, &gui_locations::LocationsModelManager::setVisibleLocations);
     EmptyListWidget *emptyListWidgetConfigured = new EmptyListWidget(this);
     emptyListWidgetConfigured->setIcon("locations/FOLDER_ICON_BIG");
     connect(emptyListWidgetConfigured, &EmptyListWidget::clicked, [this]() {
@@ -94,6 +96,7 @@ LocationsTab::LocationsTab(QWidget *parent, Preferences *preferences, gui_locati
     gui_locations::LocationsView *viewStaticIpsLocations_ = new gui_locations::LocationsView(this, locationsModelManager->staticIpsProxyModel());
     connect(viewStaticIpsLocations_, &gui_locations::LocationsView::selected, this, &LocationsTab::onLocationSelected);
     connect(viewStaticIpsLocations_, &gui_locations::LocationsView::clickedOnPremiumStarCity, this, &LocationsTab::onClickedOnPremiumStarCity);
+    connect(viewStaticIpsLocations_, &gui_locations::LocationsView::visibleLocationsChanged, locationsModelManager, &gui_locations::LocationsModelManager::setVisibleLocations);
     EmptyListWidget *emptyListWidgetStaticIps = new EmptyListWidget(this);
     emptyListWidgetStaticIps->setIcon("locations/STATIC_IP_ICON_BIG");
     emptyListWidgetStaticIps->hide();
@@ -110,6 +113,7 @@ LocationsTab::LocationsTab(QWidget *parent, Preferences *preferences, gui_locati
     gui_locations::LocationsView *viewFavoriteLocations_ = new gui_locations::LocationsView(this, locationsModelManager->favoriteCitiesProxyModel());
     connect(viewFavoriteLocations_, &gui_locations::LocationsView::selected, this, &LocationsTab::onLocationSelected);
     connect(viewFavoriteLocations_, &gui_locations::LocationsView::clickedOnPremiumStarCity, this, &LocationsTab::onClickedOnPremiumStarCity);
+    connect(viewFavoriteLocations_, &gui_locations::LocationsView::visibleLocationsChanged, locationsModelManager, &gui_locations::LocationsModelManager::setVisibleLocations);
     EmptyListWidget *emptyListWidgetFavorites = new EmptyListWidget(this);
     emptyListWidgetFavorites->setIcon("locations/BROKEN_HEART_ICON");
     widgetFavoriteLocations_ = new WidgetSwitcher(this, viewFavoriteLocations_, emptyListWidgetFavorites);
@@ -119,6 +123,7 @@ LocationsTab::LocationsTab(QWidget *parent, Preferences *preferences, gui_locati
     gui_locations::LocationsView *viewSearchLocations = new gui_locations::LocationsView(this, locationsModelManager->filterLocationsProxyModel());
     connect(viewSearchLocations, &gui_locations::LocationsView::selected, this, &LocationsTab::onLocationSelected);
     connect(viewSearchLocations, &gui_locations::LocationsView::clickedOnPremiumStarCity, this, &LocationsTab::onClickedOnPremiumStarCity);
+    connect(viewSearchLocations, &gui_locations::LocationsView::visibleLocationsChanged, locationsModelManager, &gui_locations::LocationsModelManager::setVisibleLocations);
     EmptyListWidget *emptyListWidgetSearchLocations = new EmptyListWidget(this);
     widgetSearchLocations_ = new WidgetSwitcher(this, viewSearchLocations, emptyListWidgetSearchLocations);
     widgetSearchLocations_->hide();
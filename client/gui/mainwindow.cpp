@@ -30,6 +30,7 @@
 #include "languagecontroller.h"
 #include "launchonstartup/launchonstartup.h"
 #include "locations/locationsmodel_roles.h"
+#include "locations/view/textpixmapcache.h"
 #include "mainwindowstate.h"
 #include "multipleaccountdetection/multipleaccountdetectionfactory.h"
 #include "showingdialogstate.h"
@@ -584,6 +585,7 @@ bool MainWindow::doClose(QCloseEvent *event, bool isFromSigTerm_mac)
     backend_->locationsModelManager()->saveFavoriteLocations();
 
     ImageResourcesSvg::instance().finishGracefully();
+    TextPixmapCache::instance().clear();
 
     if (WindscribeApplication::instance()->isExitWithRestart() || isFromSigTerm_mac || isSpontaneousCloseEvent_) {
         // Since we may process events below, disable UI updates and prevent the slot for this signal
@@ -13,6 +13,8 @@ public:
     virtual ~WSNetDnsRequestResult() {}
 
     virtual std::vector<std::string> ips() = 0;
+    // the smallest TTL of the returned records in seconds, 0 if unknown
+    virtual std::uint32_t ttl() = 0;
     virtual std::uint32_t elapsedMs() = 0;
     virtual bool isError() = 0;
     virtual std::string errorString() = 0;
@@ -234,6 +234,9 @@ void DnsResolver_cares::caresCallback(void *arg, int status, int timeouts, struc
                 continue;
             }
             result->ips_.push_back(addr_buf);
+            if (node->ai_ttl > 0 && (result->ttl_ == 0 || (std::uint32_t)node->ai_ttl < result->ttl_)) {
+                result->ttl_ = node->ai_ttl;
+            }
         }
         result->isError_ = false;
     } else {
@@ -57,11 +57,13 @@ private:
     {
     public:
         std::vector<std::string> ips() override { return ips_; }
+        std::uint32_t ttl() override { return ttl_; }
         std::uint32_t elapsedMs() override { return elapsedMs_; }
         bool isError() override { return isError_; }
         std::string errorString() override { return errorString_; }
 
         std::vector<std::string> ips_;
+        std::uint32_t ttl_ = 0;
         unsigned int elapsedMs_;
         bool isError_;
         std::string errorString_;
@@ -21,6 +21,7 @@ CertManager::CertManager()
     auto fdCert = fs.open("resources/windscribe_cert.crt");
     parseCertsBundle(std::string(fdCert.begin(), fdCert.end()));
 
+    buildStore();
     g_logger->debug("CertManager number of certificates : {}", certs_.size());
 }
 
@@ -34,9 +35,9 @@ int CertManager::count()
     return (int)certs_.size();
 }
 
-X509 *CertManager::getCert(int ind)
+X509_STORE *CertManager::store()
 {
-    return certs_[ind].cert;
+    return store_;
 }
 
 void CertManager::parseCertsBundle(const std::string &arr)
@@ -72,8 +73,26 @@ CertManager::CertDescr CertManager::loadCert(const std::string_view &data)
     return cd;
 }
 
+void CertManager::buildStore()
+{
+    store_ = X509_STORE_new();
+    assert(store_ != nullptr);
+    for (const auto &it : certs_) {
+        if (it.cert)
+            X509_STORE_add_cert(store_, it.cert);
+    }
+    // the same flags curl sets on the store it creates, since the store replaces it in the SSL_CTX
+    X509_STORE_set_flags(store_, X509_V_FLAG_PARTIAL_CHAIN | X509_V_FLAG_TRUSTED_FIRST);
+}
+
 void CertManager::cleanCerts()
 {
+    // SSL_CTX's still using the store hold their own references
+    if (store_) {
+        X509_STORE_free(store_);
+        store_ = nullptr;
+    }
+
     for (const auto & it : certs_) {
         X509_free(it.cert);
         BIO_free(it.bio);
@@ -6,6 +6,8 @@
 
 namespace wsnet {
 
+// Loads the bundled certificates and builds the trust store from them once.
+// The store is immutable after the constructor, so it is shared by reference count between all the SSL_CTX's.
 class CertManager
 {
 public:
@@ -13,7 +15,7 @@ public:
     ~CertManager();
 
     int count();
-    X509 *getCert(int ind);
+    X509_STORE *store();
 
 private:
     struct CertDescr
@@ -23,9 +25,11 @@ private:
     };
 
     std::vector<CertDescr> certs_;
+    X509_STORE *store_ = nullptr;
 
     void parseCertsBundle(const std::string &arr);
     CertDescr loadCert(const std::string_view &data);
+    void buildStore();
     void cleanCerts();
 
 
@@ -1,5 +1,5 @@
 #include "curlnetworkmanager.h"
-#include <regex>
+#include <algorithm>
 #include "utils/wsnet_logger.h"
 #include "utils/utils.h"
 #include "utils/crypto_utils.h"
@@ -14,17 +14,34 @@
 #endif
 namespace wsnet {
 
-CurlNetworkManager::CurlNetworkManager(CurlFinishedCallback finishedCallback, CurlProgressCallback progressCallback, CurlReadyDataCallback readyDataCallback) :
-    finishedCallback_(finishedCallback), progressCallback_(progressCallback), readyDataCallback_(readyDataCallback),
-    finish_(false), multiHandle_(nullptr)
+CurlNetworkManager::CurlNetworkManager(boost::asio::io_context &io_context, CurlFinishedCallback finishedCallback, CurlProgressCallback progressCallback,
+                                       CurlReadyDataCallback readyDataCallback) :
+    io_context_(io_context), finishedCallback_(finishedCallback), progressCallback_(progressCallback), readyDataCallback_(readyDataCallback),
+    multiHandle_(nullptr), timer_(io_context), shareHandle_(nullptr)
 {
 }
 
 CurlNetworkManager::~CurlNetworkManager()
 {
-    finish_ = true;
-    condition_.notify_all();
-    thread_.join();
+    if (multiHandle_) {
+        for (auto &it : requests_) {
+            if (it)
+                curl_multi_remove_handle(multiHandle_, it->curlEasyHandle);
+        }
+        requests_.clear();
+        slotByRequestId_.clear();
+
+        // the wait handlers which are still queued in the io_context must not touch the sockets owned by curl
+        for (auto &it : sockets_)
+            it.second->release();
+        sockets_.clear();
+        timer_.cancel();
+        curl_multi_cleanup(multiHandle_);
+    }
+
+    // all the easy handles using the share handle are already cleaned up
+    if (shareHandle_)
+        curl_share_cleanup(shareHandle_);
 
     if (isCurlGlobalInitialized_)
         curl_global_cleanup();
@@ -47,35 +64,52 @@ bool CurlNetworkManager::init()
         isCurlGlobalInitialized_ = true;
 
         multiHandle_ = curl_multi_init();
-        thread_ = std::thread(std::bind(&CurlNetworkManager::run, this));
+        if (!multiHandle_) {
+            g_logger->critical("curl_multi_init failed");
+            return false;
+        }
+        curl_multi_setopt(multiHandle_, CURLMOPT_SOCKETFUNCTION, multiSocketCallback);
+        curl_multi_setopt(multiHandle_, CURLMOPT_SOCKETDATA, this);
+        curl_multi_setopt(multiHandle_, CURLMOPT_TIMERFUNCTION, multiTimerCallback);
+        curl_multi_setopt(multiHandle_, CURLMOPT_TIMERDATA, this);
+
+        // no lock functions needed, all the easy handles are used in the io_context thread
+        shareHandle_ = curl_share_init();
+        if (shareHandle_) {
+            if (curl_share_setopt(shareHandle_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION) != CURLSHE_OK) {
+                g_logger->info("TLS session sharing is not supported by curl");
+                curl_share_cleanup(shareHandle_);
+                shareHandle_ = nullptr;
+            }
+        }
     }
     return true;
 }
 
-void CurlNetworkManager::executeRequest(std::uint64_t requestId, const std::shared_ptr<WSNetHttpRequest> &request, const std::vector<std::string> &ips, std::uint32_t timeoutMs)
+void CurlNetworkManager::executeRequest(std::uint64_t requestId, const std::shared_ptr<WSNetHttpRequest> &request, const std::vector<std::string> &ips,
+                                        std::uint32_t timeoutMs, bool isStreamData)
 {
     RequestInfo *requestInfo = new RequestInfo();
     requestInfo->id = requestId;
     requestInfo->curlNetworkManager = this;
     requestInfo->curlEasyHandle = curl_easy_init();
     requestInfo->isDebugLogCurlError = request->isDebugLogCurlError();
+    requestInfo->isStreamData = isStreamData;
 
     // Prepare data for debug log privacy
     if (requestInfo->isDebugLogCurlError) {
-        requestInfo->domain = utils::topDomain(request->hostname());
-        requestInfo->domainMd5 = crypto_utils::md5(requestInfo->domain);
-        requestInfo->ips = ips;
-        for (const auto &it : requestInfo->ips) {
-            requestInfo->ipsMd5.push_back(crypto_utils::md5(it));
+        const std::string domain = utils::topDomain(request->hostname());
+        requestInfo->logScrubber.addPattern(domain, md5(domain));
+        for (const auto &it : ips) {
+            requestInfo->logScrubber.addPattern(it, md5(it));
         }
     }
 
     if (requestInfo->curlEasyHandle)  {
-        std::lock_guard locker(mutex_);
         if (setupOptions(requestInfo, request, ips, timeoutMs)) {
-            activeRequests_[requestId] = requestInfo;
-            condition_.notify_all();
-            curl_multi_wakeup(multiHandle_);
+            addRequest(requestInfo);
+            // curl sets the timer to start the request
+            curl_multi_add_handle(multiHandle_, requestInfo->curlEasyHandle);
             return;
         }
     }
@@ -86,15 +120,11 @@ void CurlNetworkManager::executeRequest(std::uint64_t requestId, const std::shar
 
 void CurlNetworkManager::cancelRequest(std::uint64_t requestId)
 {
-    std::lock_guard locker(mutex_);
-    auto it = activeRequests_.find(requestId);
-    if (it != activeRequests_.end())
-        it->second->isNeedRemoveFromMultiHandle = true;
+    removeRequest(requestId);
 }
 
 void CurlNetworkManager::setProxySettings(const std::string &address, const std::string &username, const std::string &password)
 {
-    std::lock_guard locker(mutex_);
     proxySettings_.address = address;
     proxySettings_.username = username;
     proxySettings_.password = password;
@@ -102,137 +132,262 @@ void CurlNetworkManager::setProxySettings(const std::string &address, const std:
 
 void CurlNetworkManager::setWhitelistSocketsCallback(std::shared_ptr<CancelableCallback<WSNetHttpNetworkManagerWhitelistSocketsCallback> > callback)
 {
-    std::lock_guard locker(mutexForWhiteListSockets_);
     whitelistSocketsCallback_ = callback;
 }
 
-void CurlNetworkManager::run()
+int CurlNetworkManager::multiSocketCallback(CURL *easy, curl_socket_t s, int what, void *userp, void *socketp)
+{
+    CurlNetworkManager *this_ = (CurlNetworkManager *)userp;
+    if (what == CURL_POLL_REMOVE)
+        this_->removeSocket(s);
+    else
+        this_->addSocket(s, what);
+    return 0;
+}
+
+int CurlNetworkManager::multiTimerCallback(CURLM *multi, long timeoutMs, void *userp)
 {
-    while (!finish_) {
+    CurlNetworkManager *this_ = (CurlNetworkManager *)userp;
+    this_->timer_.cancel();
+    if (timeoutMs >= 0) {
+        // curl_multi_socket_action must not be called from the callback, even for a zero timeout
+        this_->timer_.expires_after(std::chrono::milliseconds(timeoutMs));
+        this_->timer_.async_wait([this_](const boost::system::error_code &ec) {
+            if (!ec)
+                this_->socketAction(CURL_SOCKET_TIMEOUT, 0);
+        });
+    }
+    return 0;
+}
 
-        {
-            std::unique_lock<std::mutex> locker(mutex_);
-            while (activeRequests_.empty() && !finish_)
-                condition_.wait(locker);
+void CurlNetworkManager::addSocket(curl_socket_t s, int what)
+{
+    std::shared_ptr<SocketInfo> socketInfo;
+    auto it = sockets_.find(s);
+    if (it == sockets_.end()) {
+        socketInfo = std::make_shared<SocketInfo>(io_context_);
+        boost::system::error_code ec;
+#ifdef _WIN32
+        // the protocol does not matter for waiting on the socket
+        socketInfo->descriptor.assign(boost::asio::ip::tcp::v4(), s, ec);
+#else
+        socketInfo->descriptor.assign(s, ec);
+#endif
+        if (ec) {
+            g_logger->error("Failed to assign curl socket: {}", ec.message());
+            return;
         }
+        sockets_[s] = socketInfo;
+    } else {
+        socketInfo = it->second;
+    }
 
-        if (finish_)
-            break;
+    socketInfo->action = what;
+    waitSocket(socketInfo, s);
+}
 
-        {
-            std::lock_guard locker(mutex_);
-            // add curl handles for requests which have not been added
-            for (auto it = activeRequests_.begin(); it != activeRequests_.end(); ++it) {
-                if (!it->second->isAddedToMultiHandle) {
-                    curl_multi_add_handle(multiHandle_, it->second->curlEasyHandle);
-                    it->second->isAddedToMultiHandle = true;
-                }
-            }
+void CurlNetworkManager::removeSocket(curl_socket_t s)
+{
+    auto it = sockets_.find(s);
+    if (it == sockets_.end())
+        return;
 
-            // check for need to be deleted requests (for cases when the function abort() was called)
-            for (auto it = activeRequests_.begin(); it != activeRequests_.end(); /*++it*/) {  // should not increment it in the for loop
-                if (it->second->isNeedRemoveFromMultiHandle) {
-                    RequestInfo *ri = it->second;
-                    if (it->second->isAddedToMultiHandle)
-                        curl_multi_remove_handle(multiHandle_, ri->curlEasyHandle);
-                    it = activeRequests_.erase(it);
-                    delete ri;
-                } else {
-                    ++it;
-                }
-            }
-        }
+    // curl closes the socket itself
+    it->second->release();
+    sockets_.erase(it);
+}
 
-        int still_running;
-        curl_multi_perform(multiHandle_, &still_running);
-        // check finished requests
-        struct CURLMsg *curlMsg = nullptr;
-        do {
-            int msgq = 0;
-            curlMsg = curl_multi_info_read(multiHandle_, &msgq);
-            if (curlMsg && (curlMsg->msg == CURLMSG_DONE)) {
-                CURL *curlEasyHandle = curlMsg->easy_handle;
-                std::uint64_t *pointerId;
-                curl_easy_getinfo(curlEasyHandle, CURLINFO_PRIVATE, &pointerId);
-                assert(pointerId != nullptr);
-
-                curl_off_t totalTime;
-                curl_easy_getinfo(curlEasyHandle, CURLINFO_TOTAL_TIME_T, &totalTime);
-
-                curl_multi_remove_handle(multiHandle_, curlEasyHandle);
-
-                CURLcode result = curlMsg->data.result;
-
-                std::uint64_t id;
-                //remove request from activeRequests
-                {
-                    std::lock_guard locker(mutex_);
-                    id = *pointerId;
-                    auto it = activeRequests_.find(id);
-                    assert(it != activeRequests_.end());
-                    assert(it->second->curlEasyHandle == curlEasyHandle);
-
-                    if (result != CURLE_OK) {
-                        g_logger->debug("Curl request error: {}", curl_easy_strerror(result));
-
-                        // Log all curl output for a failed request
-                        if (it->second->isDebugLogCurlError) {
-                            for (const auto &log: it->second->debugLogs) {
-                                g_logger->info("{}", log);
-                            }
-                        }
-                    } else {
-                        // Log curl output for a successful request, only strings containing "Trying" and "Connected" substrings to reduce log bloat
-                        if (it->second->isDebugLogCurlError) {
-                            for (const auto &log: it->second->debugLogs) {
-                                if (log.find("Trying") != std::string::npos || log.find("Connected") != std::string::npos) {
-                                    g_logger->info("{}", log);
-                                }
-                            }
+void CurlNetworkManager::waitSocket(const std::shared_ptr<SocketInfo> &socketInfo, curl_socket_t s)
+{
+    if ((socketInfo->action & CURL_POLL_IN) && !socketInfo->isWaitingRead) {
+        socketInfo->isWaitingRead = true;
+        socketInfo->descriptor.async_wait(SocketDescriptor::wait_read, [this, socketInfo, s](const boost::system::error_code &ec) {
+            socketInfo->isWaitingRead = false;
+            if (socketInfo->isRemoved || ec == boost::asio::error::operation_aborted)
+                return;
+            socketAction(s, ec ? CURL_CSELECT_ERR : CURL_CSELECT_IN);
+            // re-arm if curl is still interested in the socket
+            if (!socketInfo->isRemoved)
+                waitSocket(socketInfo, s);
+        });
+    }
+    if ((socketInfo->action & CURL_POLL_OUT) && !socketInfo->isWaitingWrite) {
+        socketInfo->isWaitingWrite = true;
+        socketInfo->descriptor.async_wait(SocketDescriptor::wait_write, [this, socketInfo, s](const boost::system::error_code &ec) {
+            socketInfo->isWaitingWrite = false;
+            if (socketInfo->isRemoved || ec == boost::asio::error::operation_aborted)
+                return;
+            socketAction(s, ec ? CURL_CSELECT_ERR : CURL_CSELECT_OUT);
+            if (!socketInfo->isRemoved)
+                waitSocket(socketInfo, s);
+        });
+    }
+}
+
+void CurlNetworkManager::socketAction(curl_socket_t s, int evBitmask)
+{
+    int stillRunning;
+    curl_multi_socket_action(multiHandle_, s, evBitmask, &stillRunning);
+    flushProgressAndData();
+    checkFinishedRequests();
+}
+
+void CurlNetworkManager::checkFinishedRequests()
+{
+    struct CURLMsg *curlMsg = nullptr;
+    do {
+        int msgq = 0;
+        curlMsg = curl_multi_info_read(multiHandle_, &msgq);
+        if (curlMsg && (curlMsg->msg == CURLMSG_DONE)) {
+            CURL *curlEasyHandle = curlMsg->easy_handle;
+            CURLcode result = curlMsg->data.result;
+            char *privateData = nullptr;
+            curl_easy_getinfo(curlEasyHandle, CURLINFO_PRIVATE, &privateData);
+            RequestInfo *requestInfo = reinterpret_cast<RequestInfo *>(privateData);
+            assert(requestInfo != nullptr);
+
+            if (result == CURLE_OK)
+                updateTlsStats(curlEasyHandle);
+
+            if (result != CURLE_OK) {
+                g_logger->debug("Curl request error: {}", curl_easy_strerror(result));
+
+                // Log all curl output for a failed request
+                if (requestInfo->isDebugLogCurlError) {
+                    for (const auto &log: requestInfo->debugLogs) {
+                        g_logger->info("{}", log);
+                    }
+                }
+            } else {
+                // Log curl output for a successful request, only strings containing "Trying" and "Connected" substrings to reduce log bloat
+                if (requestInfo->isDebugLogCurlError) {
+                    for (const auto &log: requestInfo->debugLogs) {
+                        if (log.find("Trying") != std::string::npos || log.find("Connected") != std::string::npos) {
+                            g_logger->info("{}", log);
                         }
                     }
-
-                    delete it->second;
-                    activeRequests_.erase(id);
                 }
-                finishedCallback_(id, result == CURLE_OK, curl_easy_strerror(result));
             }
-        } while(curlMsg);
 
+            // the streamed data has been already passed in flushProgressAndData()
+            const std::uint64_t id = requestInfo->id;
+            std::string data = std::move(requestInfo->data);
+            // curlMsg is invalid after this
+            removeRequest(id);
+            finishedCallback_(id, result == CURLE_OK, curl_easy_strerror(result), std::move(data));
+        }
+    } while(curlMsg);
+}
 
-        // wait for activity or timeout
-        int numfds;
-        curl_multi_poll(multiHandle_, NULL, 0, 1000, &numfds);
+void CurlNetworkManager::addRequest(RequestInfo *requestInfo)
+{
+    std::size_t slot;
+    if (freeSlots_.empty()) {
+        slot = requests_.size();
+        requests_.emplace_back(requestInfo);
+    } else {
+        slot = freeSlots_.back();
+        freeSlots_.pop_back();
+        requests_[slot].reset(requestInfo);
     }
+    slotByRequestId_[requestInfo->id] = slot;
+}
+
+void CurlNetworkManager::removeRequest(std::uint64_t requestId)
+{
+    auto it = slotByRequestId_.find(requestId);
+    if (it == slotByRequestId_.end())
+        return;
+
+    std::unique_ptr<RequestInfo> &requestInfo = requests_[it->second];
+    curl_multi_remove_handle(multiHandle_, requestInfo->curlEasyHandle);
+    requestInfo.reset();
+    freeSlots_.push_back(it->second);
+    slotByRequestId_.erase(it);
+}
+
+const std::string &CurlNetworkManager::md5(const std::string &str)
+{
+    auto it = md5Cache_.find(str);
+    if (it != md5Cache_.end())
+        return it->second;
 
-    for (auto it = activeRequests_.begin(); it != activeRequests_.end(); ++it)
-        delete it->second;
-    activeRequests_.clear();
+    if (md5Cache_.size() >= kMaxMd5CacheSize)
+        md5Cache_.clear();
+    return md5Cache_.emplace(str, crypto_utils::md5(str)).first->second;
 }
 
 CURLcode CurlNetworkManager::sslctx_function(CURL *curl, void *sslctx, void *parm)
 {
-    X509_STORE *store = SSL_CTX_get_cert_store((SSL_CTX *)sslctx);
+    // replace the store created by curl with the prebuilt one, the SSL_CTX takes a reference to it
     CertManager *certManager = static_cast<CertManager *>(parm);
-    for (int i = 0; i < certManager->count(); ++i)
-        X509_STORE_add_cert(store, certManager->getCert(i));
-
+    SSL_CTX_set1_cert_store((SSL_CTX *)sslctx, certManager->store());
     return CURLE_OK;
 }
 
+void CurlNetworkManager::updateTlsStats(CURL *curlEasyHandle)
+{
+    curl_off_t connectTime = 0;
+    curl_off_t appConnectTime = 0;
+    curl_easy_getinfo(curlEasyHandle, CURLINFO_CONNECT_TIME_T, &connectTime);
+    curl_easy_getinfo(curlEasyHandle, CURLINFO_APPCONNECT_TIME_T, &appConnectTime);
+
+    // zero for plain http
+    if (appConnectTime == 0 || appConnectTime < connectTime)
+        return;
+
+    const curl_off_t handshakeTime = appConnectTime - connectTime;
+    tlsStats_.count++;
+    tlsStats_.totalConnectUs += connectTime;
+    tlsStats_.totalHandshakeUs += handshakeTime;
+    tlsStats_.maxHandshakeUs = std::max(tlsStats_.maxHandshakeUs, handshakeTime);
+
+    if (tlsStats_.count >= kTlsStatsLogPeriod) {
+        g_logger->debug("TLS handshakes: {}, avg connect {} ms, avg handshake {} ms, max handshake {} ms",
+                        tlsStats_.count, tlsStats_.totalConnectUs / tlsStats_.count / 1000,
+                        tlsStats_.totalHandshakeUs / tlsStats_.count / 1000, tlsStats_.maxHandshakeUs / 1000);
+        tlsStats_ = TlsHandshakeStats();
+    }
+}
+
+void CurlNetworkManager::flushProgressAndData()
+{
+    for (auto &ri : requests_) {
+        if (!ri)
+            continue;
+        if (ri->isProgressChanged) {
+            ri->isProgressChanged = false;
+            progressCallback_(ri->id, ri->bytesReceived, ri->bytesTotal);
+        }
+        if (ri->isStreamData && !ri->data.empty()) {
+            readyDataCallback_(ri->id, std::move(ri->data));
+            ri->data = std::string();
+        }
+    }
+}
+
 size_t CurlNetworkManager::writeDataCallback(void *ptr, size_t size, size_t count, void *ri)
 {
     RequestInfo *requestInfo = static_cast<RequestInfo *>(ri);
-    std::string data((char *)ptr, (char *)ptr + size * count);
-    requestInfo->curlNetworkManager->readyDataCallback_(requestInfo->id, data);
+    if (!requestInfo->isContentLengthChecked) {
+        requestInfo->isContentLengthChecked = true;
+        curl_off_t contentLength = -1;
+        if (!requestInfo->isStreamData && curl_easy_getinfo(requestInfo->curlEasyHandle, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &contentLength) == CURLE_OK &&
+            contentLength > 0) {
+            requestInfo->data.reserve(std::min(contentLength, kMaxPreallocatedDataSize));
+        }
+    }
+    requestInfo->data.append((const char *)ptr, size * count);
     return size*count;
 }
 
 int CurlNetworkManager::progressCallback(void *ri, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
 {
     RequestInfo *requestInfo = static_cast<RequestInfo *>(ri);
-    if (dltotal > 0) {
-        requestInfo->curlNetworkManager->progressCallback_(requestInfo->id, dlnow, dltotal);
+    if (dltotal > 0 && ((std::uint64_t)dlnow != requestInfo->bytesReceived || (std::uint64_t)dltotal != requestInfo->bytesTotal)) {
+        requestInfo->bytesReceived = dlnow;
+        requestInfo->bytesTotal = dltotal;
+        requestInfo->isProgressChanged = true;
     }
     return 0;
 }
@@ -241,7 +396,6 @@ int CurlNetworkManager::curlSocketCallback(void *clientp, curl_socket_t curlfd,
 {
     CurlNetworkManager *this_ = (CurlNetworkManager *)clientp;
 
-    std::lock_guard locker(this_->mutexForWhiteListSockets_);
     // whitelist the new socket descriptor
     if (this_->whitelistSockets_.find(curlfd) == this_->whitelistSockets_.end()) {
         this_->whitelistSockets_.insert(curlfd);
@@ -260,7 +414,6 @@ int CurlNetworkManager::curlCloseSocketCallback(void *clientp, curl_socket_t cur
 #else
     close(curlfd);
 #endif
-    std::lock_guard locker(this_->mutexForWhiteListSockets_);
     // whitelist the deleted socket descriptor
     if (this_->whitelistSockets_.find(curlfd) != this_->whitelistSockets_.end()) {
         this_->whitelistSockets_.erase(curlfd);
@@ -277,18 +430,8 @@ int CurlNetworkManager::curlTrace(CURL *handle, curl_infotype type, char *data,
     RequestInfo *requestInfo = static_cast<RequestInfo *>(clientp);
 
     if (type == CURLINFO_TEXT) {
-        // replace all domains in the string with their md5 for privacy.
-        std::string src = std::string(data, size);
-        std::regex reg(requestInfo->domain);
-        std::string res = regex_replace(src, reg, requestInfo->domainMd5);
-
-        // replace all IPv4 addresses in the string with their md5 for privacy.
-        for (size_t i = 0; i < requestInfo->ips.size(); ++i) {
-            std::regex reg(requestInfo->ips[i]);
-            res = regex_replace(res, reg, requestInfo->ipsMd5[i]);
-        }
-
-        requestInfo->debugLogs.push_back(res);
+        // replace the domain and the IP addresses in the string with their md5 for privacy.
+        requestInfo->debugLogs.push_back(requestInfo->logScrubber.scrub(data, size));
     }
     return 0;
 }
@@ -359,7 +502,7 @@ bool CurlNetworkManager::setupOptions(RequestInfo *requestInfo, const std::share
             return false;
     }
 
-    curl_easy_setopt(requestInfo->curlEasyHandle, CURLOPT_PRIVATE, new std::uint64_t(requestInfo->id));    // our user data, must be deleted in the RequestInfo destructor
+    curl_easy_setopt(requestInfo->curlEasyHandle, CURLOPT_PRIVATE, requestInfo);    // our user data, owned by requests_
 
     // set post data
     std::string postData = request->postData();
@@ -408,6 +551,10 @@ bool CurlNetworkManager::setupSslVerification(RequestInfo *requestInfo, const st
         if (curl_easy_setopt(requestInfo->curlEasyHandle, CURLOPT_SSL_CTX_DATA, &certManager_) != CURLE_OK) return false;
     }
 
+    if (shareHandle_) {
+        if (curl_easy_setopt(requestInfo->curlEasyHandle, CURLOPT_SHARE, shareHandle_) != CURLE_OK) return false;
+    }
+
     return true;
 }
 
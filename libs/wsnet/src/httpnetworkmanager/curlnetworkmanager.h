@@ -1,33 +1,43 @@
 #pragma once
 
 #include <curl/curl.h>
-#include <thread>
-#include <mutex>
-#include <atomic>
-#include <map>
-#include <condition_variable>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include <boost/asio.hpp>
 #include "WSNetHttpRequest.h"
 #include "WSNetHttpNetworkManager.h"
 #include "certmanager.h"
+#include "logscrubber.h"
 #include "utils/cancelablecallback.h"
 
 namespace wsnet {
 
-typedef std::function<void(std::uint64_t requestId, bool bSuccess, const std::string &curlError)> CurlFinishedCallback;
+// the data is moved to the callee, it is empty for the streamed requests
+typedef std::function<void(std::uint64_t requestId, bool bSuccess, const std::string &curlError, std::string &&data)> CurlFinishedCallback;
 typedef std::function<void(std::uint64_t requestId, std::uint64_t bytesReceived, std::uint64_t bytesTotal)> CurlProgressCallback;
-typedef std::function<void(std::uint64_t requestId, const std::string &data)> CurlReadyDataCallback;
+typedef std::function<void(std::uint64_t requestId, std::string &&data)> CurlReadyDataCallback;
 
 // Implementing queries with curl library.
+// Curl is driven by the io_context: the curl sockets are waited for with asio descriptors and the curl timeout with an asio timer
+// (curl_multi_socket_action API), so there is no separate thread. All the functions must be called in the io_context thread,
+// the callbacks are called in it too.
+// Curl writes the response directly into the request buffer. The progress and the streamed data are reported
+// at most once per curl event for each request, so a large download does not result in a callback per curl chunk.
 class CurlNetworkManager
 {
 public:
-    explicit CurlNetworkManager(CurlFinishedCallback finishedCallback, CurlProgressCallback progressCallback, CurlReadyDataCallback readyDataCallback);
+    explicit CurlNetworkManager(boost::asio::io_context &io_context, CurlFinishedCallback finishedCallback, CurlProgressCallback progressCallback,
+                                CurlReadyDataCallback readyDataCallback);
     virtual ~CurlNetworkManager();
 
     bool init();
 
     // the calling party must take care that the requestId's are unique
-    void executeRequest(std::uint64_t requestId, const std::shared_ptr<WSNetHttpRequest> &request, const std::vector<std::string> &ips, std::uint32_t timeoutMs);
+    // isStreamData: the data is passed to CurlReadyDataCallback as it arrives, otherwise the whole body is passed to CurlFinishedCallback
+    void executeRequest(std::uint64_t requestId, const std::shared_ptr<WSNetHttpRequest> &request, const std::vector<std::string> &ips,
+                        std::uint32_t timeoutMs, bool isStreamData);
     void cancelRequest(std::uint64_t requestId);
 
     void setProxySettings(const std::string &address, const std::string &username, const std::string &password);
@@ -35,9 +45,7 @@ public:
     void setWhitelistSocketsCallback(std::shared_ptr<CancelableCallback<WSNetHttpNetworkManagerWhitelistSocketsCallback> > callback);
 
 private:
-    void run();
-
-private:
+    boost::asio::io_context &io_context_;
     bool isCurlGlobalInitialized_ = false;
     CurlFinishedCallback finishedCallback_;
     CurlProgressCallback progressCallback_;
@@ -45,11 +53,6 @@ private:
 
     CertManager certManager_;
 
-    std::mutex mutex_;
-    std::condition_variable condition_;
-    std::thread thread_;
-    std::atomic<bool> finish_;
-
     struct ProxySettings {
         std::string address;
         std::string username;
@@ -62,33 +65,82 @@ private:
         CurlNetworkManager *curlNetworkManager;
         CURL *curlEasyHandle = nullptr;
         std::vector<struct curl_slist *> curlLists;
-        bool isAddedToMultiHandle = false;
-        bool isNeedRemoveFromMultiHandle = false;
         bool isDebugLogCurlError = false;
-        std::string domain;
-        std::string domainMd5;
-        std::vector<std::string> ips;
-        std::vector<std::string> ipsMd5;
+        LogScrubber logScrubber;    // replaces the domain and IPs with their md5 in the debug logs
         std::vector<std::string> debugLogs;
 
+        bool isStreamData = false;
+        bool isContentLengthChecked = false;
+        std::string data;
+        bool isProgressChanged = false;
+        std::uint64_t bytesReceived = 0;
+        std::uint64_t bytesTotal = 0;
+
         // free all curl handles and data
         ~RequestInfo() {
-            if (curlEasyHandle) {
-                // delete our user data (pointer to quint64)
-                std::uint64_t *id;
-                if (curl_easy_getinfo(curlEasyHandle, CURLINFO_PRIVATE, &id) == CURLE_OK && id != nullptr)
-                    delete id;
+            if (curlEasyHandle)
                 curl_easy_cleanup(curlEasyHandle);
-            }
             for (struct curl_slist *list : curlLists)
                 curl_slist_free_all(list);
         }
     };
 
+    // The active requests are stored in a flat vector, the slots of the finished ones are reused.
+    // The easy handle keeps a pointer to its RequestInfo (CURLOPT_PRIVATE), so no lookup is needed on curl events.
+    std::vector<std::unique_ptr<RequestInfo>> requests_;
+    std::vector<std::size_t> freeSlots_;
+    std::unordered_map<std::uint64_t, std::size_t> slotByRequestId_;
+
+#ifdef _WIN32
+    typedef boost::asio::ip::tcp::socket SocketDescriptor;
+#else
+    typedef boost::asio::posix::stream_descriptor SocketDescriptor;
+#endif
+
+    // the asio wrapper of a curl socket, the socket itself is owned by curl
+    struct SocketInfo {
+        explicit SocketInfo(boost::asio::io_context &io_context) : descriptor(io_context) {}
+        // stop watching the socket without closing it, the pending waits are aborted
+        void release()
+        {
+            isRemoved = true;
+#ifdef _WIN32
+            boost::system::error_code ec;
+            descriptor.release(ec);
+#else
+            descriptor.release();
+#endif
+        }
+        SocketDescriptor descriptor;
+        int action = CURL_POLL_NONE;    // what curl is waiting for
+        bool isWaitingRead = false;
+        bool isWaitingWrite = false;
+        bool isRemoved = false;
+    };
+
     CURLM *multiHandle_;
-    std::map<std::uint64_t, RequestInfo *> activeRequests_;
+    boost::asio::steady_timer timer_;
+    std::unordered_map<curl_socket_t, std::shared_ptr<SocketInfo>> sockets_;
+
+    // TLS sessions shared between all the requests, so that a repeated request to the same endpoint resumes the session
+    // instead of a full handshake (the connections themselves are not reused)
+    CURLSH *shareHandle_;
+
+    // TLS handshake timing, logged every kTlsStatsLogPeriod handshakes
+    struct TlsHandshakeStats {
+        std::uint32_t count = 0;
+        curl_off_t totalConnectUs = 0;
+        curl_off_t totalHandshakeUs = 0;
+        curl_off_t maxHandshakeUs = 0;
+    };
+    static constexpr std::uint32_t kTlsStatsLogPeriod = 20;
+    static constexpr curl_off_t kMaxPreallocatedDataSize = 64 * 1024 * 1024;   // do not trust the Content-Length header beyond this
+    TlsHandshakeStats tlsStats_;
+
+    // md5 of the domains and IPs for the debug logs, the same ones are used by most of the requests
+    static constexpr std::size_t kMaxMd5CacheSize = 1024;
+    std::unordered_map<std::string, std::string> md5Cache_;
 
-    std::mutex mutexForWhiteListSockets_; // this socket protects whitelistSocketsCallback_ variable
     std::shared_ptr<CancelableCallback<WSNetHttpNetworkManagerWhitelistSocketsCallback> > whitelistSocketsCallback_;
     std::set<int> whitelistSockets_;
 
@@ -98,6 +150,20 @@ private:
     static int curlSocketCallback(void *clientp, curl_socket_t curlfd, curlsocktype purpose);
     static int curlCloseSocketCallback(void *clientp, curl_socket_t curlfd);
     static int curlTrace(CURL *handle, curl_infotype type, char *data, size_t size, void *clientp);
+    static int multiSocketCallback(CURL *easy, curl_socket_t s, int what, void *userp, void *socketp);
+    static int multiTimerCallback(CURLM *multi, long timeoutMs, void *userp);
+
+    void addSocket(curl_socket_t s, int what);
+    void removeSocket(curl_socket_t s);
+    void waitSocket(const std::shared_ptr<SocketInfo> &socketInfo, curl_socket_t s);
+    void socketAction(curl_socket_t s, int evBitmask);
+    void checkFinishedRequests();
+    void flushProgressAndData();
+    void updateTlsStats(CURL *curlEasyHandle);
+    const std::string &md5(const std::string &str);
+
+    void addRequest(RequestInfo *requestInfo);
+    void removeRequest(std::uint64_t requestId);
 
     bool setupOptions(RequestInfo *requestInfo, const std::shared_ptr<WSNetHttpRequest> &request, const std::vector<std::string> &ips, std::uint32_t timeoutMs);
     bool setupResolveHosts(RequestInfo *requestInfo, const std::shared_ptr<WSNetHttpRequest> &request, const std::vector<std::string> &ips);
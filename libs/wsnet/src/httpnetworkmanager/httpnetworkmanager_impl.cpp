@@ -7,9 +7,11 @@ namespace wsnet {
 HttpNetworkManager_impl::HttpNetworkManager_impl(boost::asio::io_context &io_context, WSNetDnsResolver *dnsResolver) :
     io_context_(io_context),
     dnsCache_(dnsResolver, std::bind(&HttpNetworkManager_impl::onDnsResolvedCallback, this, std::placeholders::_1)),
-    curlNetworkManager_(std::bind(&HttpNetworkManager_impl::onCurlFinishedCallback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
+    curlNetworkManager_(io_context,
+                        std::bind(&HttpNetworkManager_impl::onCurlFinishedCallback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4),
                         std::bind(&HttpNetworkManager_impl::onCurlProgressCallback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
-                        std::bind(&HttpNetworkManager_impl::onCurlReadyDataCallback, this, std::placeholders::_1, std::placeholders::_2))
+                        std::bind(&HttpNetworkManager_impl::onCurlReadyDataCallback, this, std::placeholders::_1, std::placeholders::_2)),
+    whitelistIpsTimer_(io_context)
 {
 }
 
@@ -102,16 +104,19 @@ void HttpNetworkManager_impl::onDnsResolvedImpl(const DnsCacheResult &result)
 
     request->second.ips = result.ips;
 
-    if (request->second.request->isWhiteListIps())
+    if (request->second.request->isWhiteListIps()) {
         whitelistIps(result.ips);
+        request->second.isIpsWhitelisted = true;
+    }
 
-    curlNetworkManager_.executeRequest(request->first, request->second.request, result.ips, request->second.request->timeoutMs() - result.elapsedMs);
+    curlNetworkManager_.executeRequest(request->first, request->second.request, result.ips, request->second.request->timeoutMs() - result.elapsedMs,
+                                       !request->second.callbacks->isDataReadyNull());
 }
 
-void HttpNetworkManager_impl::onCurlFinishedCallback(std::uint64_t requestId, bool bSuccess, const std::string &curlError)
+void HttpNetworkManager_impl::onCurlFinishedCallback(std::uint64_t requestId, bool bSuccess, const std::string &curlError, std::string &&data)
 {
-    boost::asio::post(io_context_, [this, requestId, bSuccess, curlError] {
-        onCurlFinishedCallbackImpl(requestId, bSuccess, curlError);
+    boost::asio::post(io_context_, [this, requestId, bSuccess, curlError, data = std::move(data)] {
+        onCurlFinishedCallbackImpl(requestId, bSuccess, curlError, data);
     });
 }
 
@@ -122,21 +127,21 @@ void HttpNetworkManager_impl::onCurlProgressCallback(std::uint64_t requestId, st
     });
 }
 
-void HttpNetworkManager_impl::onCurlReadyDataCallback(std::uint64_t requestId, const std::string &data)
+void HttpNetworkManager_impl::onCurlReadyDataCallback(std::uint64_t requestId, std::string &&data)
 {
-    boost::asio::post(io_context_, [this, requestId, data] {
+    boost::asio::post(io_context_, [this, requestId, data = std::move(data)] {
         onCurlReadyDataCallbackImpl(requestId, data);
     });
 }
 
-void HttpNetworkManager_impl::onCurlFinishedCallbackImpl(std::uint64_t requestId, bool bSuccess, const std::string &curlError)
+void HttpNetworkManager_impl::onCurlFinishedCallbackImpl(std::uint64_t requestId, bool bSuccess, const std::string &curlError, const std::string &data)
 {
     auto request = requestsMap_.find(requestId);
     if (request != requestsMap_.end()) {
         NetworkError networkError = (bSuccess ? NetworkError::kSuccess : NetworkError::kCurlError);
         RequestData &rd = request->second;
-        rd.callbacks->callFinished(rd.userDataId, utils::since(rd.startTime).count(), networkError, curlError, rd.data);
-        if (rd.request->isRemoveFromWhitelistIpsAfterFinish())
+        rd.callbacks->callFinished(rd.userDataId, utils::since(rd.startTime).count(), networkError, curlError, data);
+        if (rd.isIpsWhitelisted && rd.request->isRemoveFromWhitelistIpsAfterFinish())
             removeWhitelistIps(rd.ips);
         requestsMap_.erase(requestId);
     }
@@ -163,50 +168,91 @@ void HttpNetworkManager_impl::onCurlReadyDataCallbackImpl(std::uint64_t requestI
         if (rd.callbacks->isCanceled()) {
             cancelAndRemoveRequest(request);
         } else {
-            if (!rd.callbacks->isDataReadyNull()) {
-                // call callback
-                rd.callbacks->callDataReady(rd.userDataId, data);
-            } else {
-                // append data to internal data buffer
-                request->second.data.reserve( request->second.data.size() + data.size() );
-                request->second.data.insert( request->second.data.end(), data.begin(), data.end() );
-            }
+            rd.callbacks->callDataReady(rd.userDataId, data);
         }
     }
 }
 
 void HttpNetworkManager_impl::whitelistIps(const std::vector<std::string> &ips)
 {
-    bool bChanged = isWhitelistCallbackChanged_;
     for (const auto &ip : ips) {
-        auto res = whitelistIps_.insert(ip);
-        if (res.second)
-            bChanged = true;
-    }
-    if (bChanged && whitelistIpsCallback_) {
-        whitelistIpsCallback_->call(whitelistIps_);
-        isWhitelistCallbackChanged_ = false;
+        whitelistIpsRefs_[ip]++;
+        unusedWhitelistIps_.erase(ip);
+        if (whitelistIps_.insert(ip).second)
+            whitelistIpsGeneration_++;
     }
+    // the request must not start before the firewall is configured, so not delayed
+    notifyWhitelistIps();
 }
 
 void HttpNetworkManager_impl::removeWhitelistIps(const std::vector<std::string> &ips)
 {
-    bool bChanged = isWhitelistCallbackChanged_;
+    const auto now = std::chrono::steady_clock::now();
     for (const auto &ip : ips) {
-        if (whitelistIps_.erase(ip))
-            bChanged = true;
+        auto it = whitelistIpsRefs_.find(ip);
+        if (it == whitelistIpsRefs_.end())
+            continue;
+        if (--it->second == 0) {
+            whitelistIpsRefs_.erase(it);
+            unusedWhitelistIps_[ip] = now;
+        }
     }
-    if (bChanged && whitelistIpsCallback_) {
-        whitelistIpsCallback_->call(whitelistIps_);
-        isWhitelistCallbackChanged_ = false;
+    if (!unusedWhitelistIps_.empty())
+        startWhitelistIpsTimer();
+}
+
+void HttpNetworkManager_impl::startWhitelistIpsTimer()
+{
+    if (isWhitelistIpsTimerActive_)
+        return;
+
+    auto earliest = std::chrono::steady_clock::time_point::max();
+    for (const auto &it : unusedWhitelistIps_)
+        earliest = std::min(earliest, it.second);
+
+    isWhitelistIpsTimerActive_ = true;
+    whitelistIpsTimer_.expires_at(earliest + std::chrono::milliseconds(kWhitelistIpsRemoveDelayMs));
+    whitelistIpsTimer_.async_wait([this] (boost::system::error_code const& err) {
+        isWhitelistIpsTimerActive_ = false;
+        if (!err)
+            onWhitelistIpsTimer();
+    });
+}
+
+void HttpNetworkManager_impl::onWhitelistIpsTimer()
+{
+    for (auto it = unusedWhitelistIps_.begin(); it != unusedWhitelistIps_.end(); ) {
+        if (utils::since(it->second).count() >= kWhitelistIpsRemoveDelayMs) {
+            if (whitelistIps_.erase(it->first))
+                whitelistIpsGeneration_++;
+            it = unusedWhitelistIps_.erase(it);
+        } else {
+            ++it;
+        }
     }
+    notifyWhitelistIps();
+
+    if (!unusedWhitelistIps_.empty())
+        startWhitelistIpsTimer();
+}
+
+void HttpNetworkManager_impl::notifyWhitelistIps()
+{
+    if (!whitelistIpsCallback_)
+        return;
+    if (whitelistIpsGeneration_ == notifiedWhitelistIpsGeneration_ && !isWhitelistCallbackChanged_)
+        return;
+
+    whitelistIpsCallback_->call(whitelistIps_);
+    notifiedWhitelistIpsGeneration_ = whitelistIpsGeneration_;
+    isWhitelistCallbackChanged_ = false;
 }
 
 void HttpNetworkManager_impl::cancelAndRemoveRequest(const std::map<std::uint64_t, RequestData>::iterator &request)
 {
     RequestData &rd = request->second;
     curlNetworkManager_.cancelRequest(request->first);
-    if (rd.request->isRemoveFromWhitelistIpsAfterFinish())
+    if (rd.isIpsWhitelisted && rd.request->isRemoveFromWhitelistIpsAfterFinish())
         removeWhitelistIps(rd.ips);
     requestsMap_.erase(request);
 }
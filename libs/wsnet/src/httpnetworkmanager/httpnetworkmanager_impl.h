@@ -38,6 +38,19 @@ private:
     std::shared_ptr<CancelableCallback<WSNetHttpNetworkManagerWhitelistIpsCallback> > whitelistIpsCallback_;
     bool isWhitelistCallbackChanged_ = false;
 
+    // The whitelisted IPs are reference counted by the requests using them. An IP is removed from the whitelist
+    // only after it has been unused for kWhitelistIpsRemoveDelayMs, so the short-lived requests to the same IPs
+    // (ping sweeps, failover) do not reconfigure the firewall on every request.
+    // The generation is incremented on every change of whitelistIps_, the callback is called only if it was not notified yet.
+    static constexpr int kWhitelistIpsRemoveDelayMs = 5000;
+    std::map<std::string, int> whitelistIpsRefs_;
+    std::map<std::string, std::chrono::steady_clock::time_point> unusedWhitelistIps_;  // unused since
+    std::set<std::string> whitelistIps_;
+    std::uint64_t whitelistIpsGeneration_ = 0;
+    std::uint64_t notifiedWhitelistIpsGeneration_ = 0;
+    boost::asio::steady_timer whitelistIpsTimer_;
+    bool isWhitelistIpsTimerActive_ = false;
+
 
     struct RequestData
     {
@@ -46,27 +59,28 @@ private:
         std::shared_ptr<HttpNetworkManagerCallbacks> callbacks;
         std::chrono::steady_clock::time_point startTime;
         std::vector<std::string> ips;
-        std::string data;
+        bool isIpsWhitelisted = false;
     };
 
     std::map<std::uint64_t, RequestData> requestsMap_;
     std::uint64_t curRequestId_ = 0;
 
-    std::set<std::string> whitelistIps_;
-
     void onDnsResolvedCallback(const DnsCacheResult &result);
     void onDnsResolvedImpl(const DnsCacheResult &result);
 
-    void onCurlFinishedCallback(std::uint64_t requestId, bool bSuccess, const std::string &curlError);
+    void onCurlFinishedCallback(std::uint64_t requestId, bool bSuccess, const std::string &curlError, std::string &&data);
     void onCurlProgressCallback(std::uint64_t requestId, std::uint64_t bytesReceived, std::uint64_t bytesTotal);
-    void onCurlReadyDataCallback(std::uint64_t requestId, const std::string &data);
+    void onCurlReadyDataCallback(std::uint64_t requestId, std::string &&data);
 
-    void onCurlFinishedCallbackImpl(std::uint64_t requestId, bool bSuccess, const std::string &curlError);
+    void onCurlFinishedCallbackImpl(std::uint64_t requestId, bool bSuccess, const std::string &curlError, const std::string &data);
     void onCurlProgressCallbackImpl(std::uint64_t requestId, std::uint64_t bytesReceived, std::uint64_t bytesTotal);
     void onCurlReadyDataCallbackImpl(std::uint64_t requestId, const std::string &data);
 
     void whitelistIps(const std::vector<std::string> &ips);
     void removeWhitelistIps(const std::vector<std::string> &ips);
+    void startWhitelistIpsTimer();
+    void onWhitelistIpsTimer();
+    void notifyWhitelistIps();
 
     void cancelAndRemoveRequest(const std::map<std::uint64_t, RequestData>::iterator &request);
 };
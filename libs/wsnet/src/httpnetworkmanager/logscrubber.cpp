@@ -0,0 +1,114 @@
+#include "logscrubber.h"
+#include <algorithm>
+#include <queue>
+
+namespace wsnet {
+
+void LogScrubber::addPattern(const std::string &pattern, const std::string &replacement)
+{
+    if (pattern.empty())
+        return;
+
+    int node = 0;
+    for (char c : pattern) {
+        int next = child(node, c);
+        if (next == -1) {
+            next = (int)nodes_.size();
+            auto &children = nodes_[node].next;
+            children.insert(std::upper_bound(children.begin(), children.end(), std::make_pair(c, -1)), std::make_pair(c, next));
+            nodes_.emplace_back();
+        }
+        node = next;
+    }
+    // the same pattern twice, keep the first replacement
+    if (nodes_[node].pattern != -1)
+        return;
+
+    nodes_[node].pattern = (int)replacements_.size();
+    replacements_.push_back(replacement);
+    patternLengths_.push_back(pattern.size());
+    isBuilt_ = false;
+}
+
+const std::string &LogScrubber::scrub(const char *data, size_t size)
+{
+    buffer_.assign(data, size);
+    if (replacements_.empty())
+        return buffer_;
+    if (!isBuilt_)
+        build();
+
+    // find all the matches, the longest pattern for each end position
+    matches_.clear();
+    int node = 0;
+    for (size_t i = 0; i < size; ++i) {
+        int next;
+        while ((next = child(node, data[i])) == -1 && node != 0)
+            node = nodes_[node].fail;
+        node = (next == -1) ? 0 : next;
+
+        for (int out = nodes_[node].outputNode; out != -1; out = nodes_[nodes_[out].fail].outputNode) {
+            const int pattern = nodes_[out].pattern;
+            matches_.push_back(Match { i + 1 - patternLengths_[pattern], patternLengths_[pattern], pattern });
+        }
+    }
+    if (matches_.empty())
+        return buffer_;
+
+    // leftmost-longest, non-overlapping
+    std::sort(matches_.begin(), matches_.end(), [](const Match &a, const Match &b) {
+        return a.start < b.start || (a.start == b.start && a.length > b.length);
+    });
+    buffer_.clear();
+    size_t pos = 0;
+    for (const auto &m : matches_) {
+        if (m.start < pos)
+            continue;
+        buffer_.append(data + pos, m.start - pos);
+        buffer_.append(replacements_[m.pattern]);
+        pos = m.start + m.length;
+    }
+    buffer_.append(data + pos, size - pos);
+    return buffer_;
+}
+
+void LogScrubber::build()
+{
+    // breadth-first, so the fail node is always processed before
+    std::queue<int> queue;
+    nodes_[0].fail = 0;
+    nodes_[0].outputNode = -1;
+    for (const auto &it : nodes_[0].next) {
+        nodes_[it.second].fail = 0;
+        queue.push(it.second);
+    }
+
+    while (!queue.empty()) {
+        const int node = queue.front();
+        queue.pop();
+
+        const int fail = nodes_[node].fail;
+        nodes_[node].outputNode = (nodes_[node].pattern != -1) ? node : nodes_[fail].outputNode;
+
+        for (const auto &it : nodes_[node].next) {
+            int f = fail;
+            int next;
+            while ((next = child(f, it.first)) == -1 && f != 0)
+                f = nodes_[f].fail;
+            nodes_[it.second].fail = (next == -1 || next == it.second) ? 0 : next;
+            queue.push(it.second);
+        }
+    }
+    isBuilt_ = true;
+}
+
+int LogScrubber::child(int node, char c) const
+{
+    const auto &children = nodes_[node].next;
+    auto it = std::lower_bound(children.begin(), children.end(), std::make_pair(c, -1));
+    if (it != children.end() && it->first == c)
+        return it->second;
+    return -1;
+}
+
+} // namespace wsnet
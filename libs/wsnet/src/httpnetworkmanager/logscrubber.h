@@ -0,0 +1,47 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace wsnet {
+
+// Replaces the sensitive substrings (the domain and the IPs of a request) in curl trace lines, for privacy.
+// All the patterns are matched in one pass with an Aho-Corasick automaton built once per request,
+// the leftmost-longest non-overlapping matches are replaced.
+class LogScrubber final
+{
+public:
+    void addPattern(const std::string &pattern, const std::string &replacement);
+    bool isEmpty() const { return replacements_.empty(); }
+
+    // the result is valid until the next call
+    const std::string &scrub(const char *data, size_t size);
+
+private:
+    struct Node
+    {
+        std::vector<std::pair<char, int>> next;  // sorted by the char
+        int fail = 0;
+        int outputNode = -1;    // the nearest node (this or by the fail links) where a pattern ends
+        int pattern = -1;       // the pattern ending in this node
+    };
+
+    struct Match
+    {
+        size_t start;
+        size_t length;
+        int pattern;
+    };
+
+    std::vector<Node> nodes_ = std::vector<Node>(1);
+    std::vector<std::string> replacements_;
+    std::vector<size_t> patternLengths_;
+    bool isBuilt_ = false;
+
+    std::string buffer_;
+    std::vector<Match> matches_;
+
+    void build();
+    int child(int node, char c) const;
+};
+
+} // namespace wsnet
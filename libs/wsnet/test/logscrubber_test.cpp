@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+#include "logscrubber.h"
+
+using namespace wsnet;
+
+namespace {
+
+std::string scrub(LogScrubber &scrubber, const std::string &str)
+{
+    return scrubber.scrub(str.c_str(), str.size());
+}
+
+} // namespace
+
+TEST(LogScrubber, NoPatterns)
+{
+    LogScrubber scrubber;
+    EXPECT_TRUE(scrubber.isEmpty());
+    EXPECT_EQ(scrub(scrubber, "Connected to api.windscribe.com (104.20.26.217) port 443"), "Connected to api.windscribe.com (104.20.26.217) port 443");
+
+    // the empty patterns are ignored
+    scrubber.addPattern("", "x");
+    EXPECT_TRUE(scrubber.isEmpty());
+}
+
+TEST(LogScrubber, NoMatch)
+{
+    LogScrubber scrubber;
+    scrubber.addPattern("windscribe.com", "DOMAIN");
+    scrubber.addPattern("104.20.26.217", "IP");
+
+    EXPECT_EQ(scrub(scrubber, ""), "");
+    EXPECT_EQ(scrub(scrubber, "ALPN: server accepted h2"), "ALPN: server accepted h2");
+    // the prefixes of the patterns only
+    EXPECT_EQ(scrub(scrubber, "windscribe.co 104.20.26.21 windscribe"), "windscribe.co 104.20.26.21 windscribe");
+    // the patterns are matched literally, the dot is not a wildcard
+    EXPECT_EQ(scrub(scrubber, "windscribeXcom 104x20x26x217"), "windscribeXcom 104x20x26x217");
+}
+
+TEST(LogScrubber, Replace)
+{
+    LogScrubber scrubber;
+    scrubber.addPattern("windscribe.com", "DOMAIN");
+    scrubber.addPattern("104.20.26.217", "IP1");
+    scrubber.addPattern("172.67.10.55", "IP2");
+
+    EXPECT_EQ(scrub(scrubber, "Connected to api.windscribe.com (104.20.26.217) port 443"), "Connected to api.DOMAIN (IP1) port 443");
+    EXPECT_EQ(scrub(scrubber, "Trying 172.67.10.55:443... Trying 104.20.26.217:443... Trying 172.67.10.55:443..."),
+              "Trying IP2:443... Trying IP1:443... Trying IP2:443...");
+    // the whole input and the adjacent matches
+    EXPECT_EQ(scrub(scrubber, "windscribe.com"), "DOMAIN");
+    EXPECT_EQ(scrub(scrubber, "windscribe.comwindscribe.com172.67.10.55"), "DOMAINDOMAINIP2");
+}
+
+TEST(LogScrubber, OverlappingPatterns)
+{
+    // the same start, the longest wins
+    LogScrubber ips;
+    ips.addPattern("10.0.0.1", "SHORT");
+    ips.addPattern("10.0.0.10", "LONG");
+    EXPECT_EQ(scrub(ips, "10.0.0.10 10.0.0.1 10.0.0.100"), "LONG SHORT LONG0");
+
+    // a pattern inside another one
+    LogScrubber nested;
+    nested.addPattern("scribe", "INNER");
+    nested.addPattern("windscribe.com", "OUTER");
+    EXPECT_EQ(scrub(nested, "windscribe.com windscribe.net"), "OUTER windINNER.net");
+
+    // the leftmost wins, the overlapped match is not replaced
+    LogScrubber leftmost;
+    leftmost.addPattern("bcde", "B");
+    leftmost.addPattern("ab", "A");
+    EXPECT_EQ(scrub(leftmost, "abcde bcde"), "Acde B");
+
+    // the matches found only by the fail links
+    LogScrubber failLinks;
+    failLinks.addPattern("he", "1");
+    failLinks.addPattern("she", "2");
+    failLinks.addPattern("his", "3");
+    failLinks.addPattern("hers", "4");
+    EXPECT_EQ(scrub(failLinks, "ushers"), "u2rs");
+    EXPECT_EQ(scrub(failLinks, "hishers"), "34");
+    EXPECT_EQ(scrub(failLinks, "ahehe"), "a11");
+}
+
+TEST(LogScrubber, DuplicatePattern)
+{
+    LogScrubber scrubber;
+    scrubber.addPattern("windscribe.com", "FIRST");
+    scrubber.addPattern("windscribe.com", "SECOND");
+    EXPECT_EQ(scrub(scrubber, "api.windscribe.com"), "api.FIRST");
+}
+
+TEST(LogScrubber, ChunkBoundaries)
+{
+    LogScrubber scrubber;
+    scrubber.addPattern("windscribe.com", "DOMAIN");
+
+    // the matches at the start and the end of a chunk
+    EXPECT_EQ(scrub(scrubber, "windscribe.com:443"), "DOMAIN:443");
+    EXPECT_EQ(scrub(scrubber, "Host: windscribe.com"), "Host: DOMAIN");
+
+    // every chunk is scrubbed on its own (curl passes each info message whole), a pattern split between
+    // two chunks is not matched and the state of one chunk does not leak into the next one
+    EXPECT_EQ(scrub(scrubber, "Host: windscr"), "Host: windscr");
+    EXPECT_EQ(scrub(scrubber, "ibe.com"), "ibe.com");
+    EXPECT_EQ(scrub(scrubber, "windscribe.co"), "windscribe.co");
+    EXPECT_EQ(scrub(scrubber, "m windscribe.com"), "m DOMAIN");
+
+    // the size is respected, the data is not null-terminated
+    const std::string data = "windscribe.com windscribe.com";
+    EXPECT_EQ(scrubber.scrub(data.c_str(), 20), "DOMAIN winds");
+    const std::string binary("a\0windscribe.com\0b", 18);
+    EXPECT_EQ(scrubber.scrub(binary.c_str(), binary.size()), std::string("a\0DOMAIN\0b", 10));
+}
+
+TEST(LogScrubber, AddPatternAfterScrub)
+{
+    LogScrubber scrubber;
+    scrubber.addPattern("windscribe.com", "DOMAIN");
+    EXPECT_EQ(scrub(scrubber, "windscribe.com 104.20.26.217"), "DOMAIN 104.20.26.217");
+
+    // the automaton is rebuilt for the new pattern
+    scrubber.addPattern("104.20.26.217", "IP");
+    EXPECT_EQ(scrub(scrubber, "windscribe.com 104.20.26.217"), "DOMAIN IP");
+}
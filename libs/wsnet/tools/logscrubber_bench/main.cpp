@@ -0,0 +1,137 @@
+// Replays a recorded curl trace through the debug log scrubbing of CurlNetworkManager::curlTrace:
+// the previous implementation (a std::regex per pattern and per trace line) and LogScrubber.
+// Usage: logscrubber_bench [trace file] [replays count]
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <regex>
+#include <string>
+#include <vector>
+#include "logscrubber.h"
+
+namespace {
+
+struct Trace
+{
+    std::vector<std::string> patterns;  // the first one is the domain, the others are the IPs
+    std::vector<std::string> lines;
+};
+
+bool loadTrace(const std::string &path, Trace &trace)
+{
+    std::ifstream file(path);
+    if (!file)
+        return false;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        if (line.rfind("pattern ", 0) == 0)
+            trace.patterns.push_back(line.substr(8));
+        else
+            trace.lines.push_back(line + "\n");     // curl passes the info messages with the line ending
+    }
+    return !trace.patterns.empty() && !trace.lines.empty();
+}
+
+// stands in for the md5 of the pattern, with the same length
+std::string replacement(const std::string &pattern)
+{
+    char buf[33];
+    std::snprintf(buf, sizeof(buf), "%016zx%016zx", std::hash<std::string>()(pattern), pattern.size());
+    return buf;
+}
+
+// the scrubbing before LogScrubber
+std::string regexScrub(const std::string &src, const std::vector<std::string> &patterns, const std::vector<std::string> &replacements)
+{
+    std::regex reg(patterns[0]);
+    std::string res = std::regex_replace(src, reg, replacements[0]);
+    for (size_t i = 1; i < patterns.size(); ++i) {
+        std::regex reg(patterns[i]);
+        res = std::regex_replace(res, reg, replacements[i]);
+    }
+    return res;
+}
+
+template<typename Function>
+double measureNsPerLine(const Trace &trace, int replays, Function scrubLine)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < replays; ++i) {
+        for (const auto &line : trace.lines)
+            scrubLine(line);
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    return (double)elapsed.count() / ((double)replays * trace.lines.size());
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const std::string path = argc > 1 ? argv[1] : LOGSCRUBBER_BENCH_TRACE;
+    const int replays = argc > 2 ? std::stoi(argv[2]) : 200;
+
+    Trace trace;
+    if (!loadTrace(path, trace)) {
+        std::printf("Could not load the trace: %s\n", path.c_str());
+        return 1;
+    }
+
+    std::vector<std::string> replacements;
+    for (const auto &pattern : trace.patterns)
+        replacements.push_back(replacement(pattern));
+
+    // the scrubber is built once per request, as in CurlNetworkManager::executeRequest
+    auto makeScrubber = [&]() {
+        wsnet::LogScrubber scrubber;
+        for (size_t i = 0; i < trace.patterns.size(); ++i)
+            scrubber.addPattern(trace.patterns[i], replacements[i]);
+        return scrubber;
+    };
+
+    // both must produce the same logs (the dots of the regexes are wildcards, but they do not match anything else in a trace)
+    wsnet::LogScrubber scrubber = makeScrubber();
+    size_t mismatches = 0;
+    size_t scrubbed = 0;
+    for (const auto &line : trace.lines) {
+        const std::string expected = regexScrub(line, trace.patterns, replacements);
+        const std::string &actual = scrubber.scrub(line.c_str(), line.size());
+        if (actual != expected) {
+            mismatches++;
+            std::printf("Mismatch:\n  regex:       %s  LogScrubber: %s", expected.c_str(), actual.c_str());
+        }
+        if (actual != line)
+            scrubbed++;
+    }
+
+    std::vector<std::string> logs;
+    logs.reserve(trace.lines.size());
+    const double regexNs = measureNsPerLine(trace, replays, [&](const std::string &line) {
+        logs.push_back(regexScrub(line, trace.patterns, replacements));
+        if (logs.size() == trace.lines.size())
+            logs.clear();
+    });
+    const double scrubberNs = measureNsPerLine(trace, replays, [&](const std::string &line) {
+        logs.push_back(scrubber.scrub(line.c_str(), line.size()));
+        if (logs.size() == trace.lines.size())
+            logs.clear();
+    });
+    // including the automaton build, once per replay of the trace
+    const double scrubberWithBuildNs = measureNsPerLine(trace, replays, [&](const std::string &line) {
+        if (logs.empty())
+            scrubber = makeScrubber();
+        logs.push_back(scrubber.scrub(line.c_str(), line.size()));
+        if (logs.size() == trace.lines.size())
+            logs.clear();
+    });
+
+    std::printf("Trace: %zu lines (%zu scrubbed), %zu patterns, %d replays\n", trace.lines.size(), scrubbed, trace.patterns.size(), replays);
+    std::printf("regex:                  %10.1f ns/line\n", regexNs);
+    std::printf("LogScrubber:            %10.1f ns/line (x%.1f)\n", scrubberNs, regexNs / scrubberNs);
+    std::printf("LogScrubber with build: %10.1f ns/line (x%.1f)\n", scrubberWithBuildNs, regexNs / scrubberWithBuildNs);
+    return mismatches == 0 ? 0 : 1;
+}